@@ -247,6 +247,7 @@ luacrun_new_ctx (lua_State *S)
   int ctx_idx = lua_gettop (S);
   memset (ctx, 0, sizeof (libcrun_context_t));
   ctx->fifo_exec_wait_fd = -1;
+  ctx->psi_fd = -1;
   if (lua_istable (S, 1))
     {
       luacrun_ctx_setup (S, ctx_idx, 1);
@@ -683,6 +684,147 @@ luacrun_ctx_update_container (lua_State *S)
   return 1;
 }
 
+/* Set the field KEY of the table at IDX to the integer VAL, a limit that is
+   not set is left as nil.  */
+static void
+luacrun_set_stat (lua_State *S, int idx, const char *key, uint64_t val)
+{
+  if (val == LIBCRUN_STATS_UNLIMITED)
+    return;
+  lua_pushinteger (S, (lua_Integer) val);
+  lua_setfield (S, idx, key);
+}
+
+static void
+luacrun_set_pressure (lua_State *S, int idx, const char *key, const struct libcrun_pressure_s *some,
+                      const struct libcrun_pressure_s *full)
+{
+  const struct libcrun_pressure_s *values[] = { some, full };
+  const char *names[] = { "some", "full" };
+  size_t i;
+
+  lua_createtable (S, 0, 2);
+  for (i = 0; i < 2; i++)
+    {
+      lua_createtable (S, 0, 4);
+      lua_pushnumber (S, values[i]->avg10);
+      lua_setfield (S, -2, "avg10");
+      lua_pushnumber (S, values[i]->avg60);
+      lua_setfield (S, -2, "avg60");
+      lua_pushnumber (S, values[i]->avg300);
+      lua_setfield (S, -2, "avg300");
+      luacrun_set_stat (S, lua_gettop (S), "total", values[i]->total);
+      lua_setfield (S, -2, names[i]);
+    }
+  lua_setfield (S, idx, key);
+}
+
+/* Get the resource usage of the container. (ctx: userdata, id: string) [-0, +1, -]
+
+The sections that could not be read are missing from the table.
+*/
+LUA_API int
+luacrun_ctx_stats_container (lua_State *S)
+{
+  libcrun_context_t *ctx = luaL_checkudata (S, 1, LUA_CRUN_TAG_CTX);
+  const char *id = luaL_checkstring (S, 2);
+  struct libcrun_container_stats_s stats;
+  libcrun_error_t crun_err = NULL;
+  int ret, tabidx, secidx;
+
+  luaL_checkstack (S, 5, NULL);
+
+  ret = libcrun_container_stats (ctx, id, &stats, &crun_err);
+  luacrun_SoftErrIf (S, ret < 0, &crun_err, lua_pushnil (S), 1);
+
+  lua_createtable (S, 0, 7);
+  tabidx = lua_gettop (S);
+  luacrun_set_stat (S, tabidx, "version", stats.version);
+  luacrun_set_stat (S, tabidx, "timestamp", stats.timestamp);
+
+  if (stats.valid & LIBCRUN_CONTAINER_STATS_CPU)
+    {
+      lua_createtable (S, 0, 6);
+      secidx = lua_gettop (S);
+      luacrun_set_stat (S, secidx, "usage_usec", stats.cpu.usage_usec);
+      luacrun_set_stat (S, secidx, "user_usec", stats.cpu.user_usec);
+      luacrun_set_stat (S, secidx, "system_usec", stats.cpu.system_usec);
+      luacrun_set_stat (S, secidx, "nr_periods", stats.cpu.nr_periods);
+      luacrun_set_stat (S, secidx, "nr_throttled", stats.cpu.nr_throttled);
+      luacrun_set_stat (S, secidx, "throttled_usec", stats.cpu.throttled_usec);
+      lua_setfield (S, tabidx, "cpu");
+    }
+
+  if (stats.valid & LIBCRUN_CONTAINER_STATS_MEMORY)
+    {
+      lua_createtable (S, 0, 20);
+      secidx = lua_gettop (S);
+      luacrun_set_stat (S, secidx, "usage", stats.memory.usage);
+      luacrun_set_stat (S, secidx, "limit", stats.memory.limit);
+      luacrun_set_stat (S, secidx, "swap_usage", stats.memory.swap_usage);
+      luacrun_set_stat (S, secidx, "swap_limit", stats.memory.swap_limit);
+      luacrun_set_stat (S, secidx, "anon", stats.memory.anon);
+      luacrun_set_stat (S, secidx, "file", stats.memory.file);
+      luacrun_set_stat (S, secidx, "kernel_stack", stats.memory.kernel_stack);
+      luacrun_set_stat (S, secidx, "slab", stats.memory.slab);
+      luacrun_set_stat (S, secidx, "sock", stats.memory.sock);
+      luacrun_set_stat (S, secidx, "shmem", stats.memory.shmem);
+      luacrun_set_stat (S, secidx, "file_mapped", stats.memory.file_mapped);
+      luacrun_set_stat (S, secidx, "file_dirty", stats.memory.file_dirty);
+      luacrun_set_stat (S, secidx, "file_writeback", stats.memory.file_writeback);
+      luacrun_set_stat (S, secidx, "active_anon", stats.memory.active_anon);
+      luacrun_set_stat (S, secidx, "inactive_anon", stats.memory.inactive_anon);
+      luacrun_set_stat (S, secidx, "active_file", stats.memory.active_file);
+      luacrun_set_stat (S, secidx, "inactive_file", stats.memory.inactive_file);
+      luacrun_set_stat (S, secidx, "pgfault", stats.memory.pgfault);
+      luacrun_set_stat (S, secidx, "pgmajfault", stats.memory.pgmajfault);
+
+      lua_createtable (S, 0, 5);
+      luacrun_set_stat (S, lua_gettop (S), "low", stats.memory.events_low);
+      luacrun_set_stat (S, lua_gettop (S), "high", stats.memory.events_high);
+      luacrun_set_stat (S, lua_gettop (S), "max", stats.memory.events_max);
+      luacrun_set_stat (S, lua_gettop (S), "oom", stats.memory.events_oom);
+      luacrun_set_stat (S, lua_gettop (S), "oom_kill", stats.memory.events_oom_kill);
+      lua_setfield (S, secidx, "events");
+
+      lua_setfield (S, tabidx, "memory");
+    }
+
+  if (stats.valid & LIBCRUN_CONTAINER_STATS_IO)
+    {
+      lua_createtable (S, 0, 6);
+      secidx = lua_gettop (S);
+      luacrun_set_stat (S, secidx, "rbytes", stats.io.rbytes);
+      luacrun_set_stat (S, secidx, "wbytes", stats.io.wbytes);
+      luacrun_set_stat (S, secidx, "rios", stats.io.rios);
+      luacrun_set_stat (S, secidx, "wios", stats.io.wios);
+      luacrun_set_stat (S, secidx, "dbytes", stats.io.dbytes);
+      luacrun_set_stat (S, secidx, "dios", stats.io.dios);
+      lua_setfield (S, tabidx, "io");
+    }
+
+  if (stats.valid & LIBCRUN_CONTAINER_STATS_PIDS)
+    {
+      lua_createtable (S, 0, 2);
+      secidx = lua_gettop (S);
+      luacrun_set_stat (S, secidx, "current", stats.pids.current);
+      luacrun_set_stat (S, secidx, "limit", stats.pids.limit);
+      lua_setfield (S, tabidx, "pids");
+    }
+
+  if (stats.valid & LIBCRUN_CONTAINER_STATS_PRESSURE)
+    {
+      lua_createtable (S, 0, 3);
+      secidx = lua_gettop (S);
+      luacrun_set_pressure (S, secidx, "cpu", &stats.pressure.cpu_some, &stats.pressure.cpu_full);
+      luacrun_set_pressure (S, secidx, "memory", &stats.pressure.memory_some, &stats.pressure.memory_full);
+      luacrun_set_pressure (S, secidx, "io", &stats.pressure.io_some, &stats.pressure.io_full);
+      lua_setfield (S, tabidx, "pressure");
+    }
+
+  return 1;
+}
+
 #define luacrun_CtxStringAccessor(name, uval_idx)                      \
   LUA_API int luacrun_ctx_get_##name (lua_State *S)                    \
   {                                                                    \
@@ -762,6 +904,7 @@ static const luaL_Reg luacrun_ctx_index[]
         { "status", &luacrun_ctx_status_container },
         { "iter_names", &luacrun_ctx_iter_containers },
         { "update", &luacrun_ctx_update_container },
+        { "stats", &luacrun_ctx_stats_container },
         luacrun_RegAddCtxAccessor ("state_root", state_root),
         luacrun_RegAddCtxAccessor ("id", id),
         luacrun_RegAddCtxAccessor ("bundle", bundle),
@@ -816,6 +959,7 @@ static const luaL_Reg luacrun_library_reg[] = {
   { .name = "status_container", .func = &luacrun_ctx_status_container },
   { .name = "iter_container_names", .func = &luacrun_ctx_iter_containers },
   { .name = "update_container", .func = &luacrun_ctx_update_container },
+  { .name = "stats_container", .func = &luacrun_ctx_stats_container },
   { NULL, NULL },
 };
 
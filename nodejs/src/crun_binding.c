@@ -3533,6 +3533,176 @@ napi_value CrunResourceUsage(napi_env env, napi_callback_info info) {
     return result;
 }
 
+/**
+ * stats(id, options?) -> {version, timestamp, cpu, memory, io, pids, pressure}
+ *
+ * Same schema as `crun stats`, the limits that are not set are null and the
+ * sections that could not be read are missing.
+ */
+
+static void set_stat_number(napi_env env, napi_value obj, const char* key, uint64_t value) {
+    napi_value val;
+
+    if (value == LIBCRUN_STATS_UNLIMITED)
+        napi_get_null(env, &val);
+    else
+        napi_create_double(env, (double) value, &val);
+    napi_set_named_property(env, obj, key, val);
+}
+
+static napi_value create_pressure_object(napi_env env, const struct libcrun_pressure_s* some,
+                                         const struct libcrun_pressure_s* full) {
+    const struct libcrun_pressure_s* values[] = { some, full };
+    const char* names[] = { "some", "full" };
+    napi_value obj, val;
+
+    napi_create_object(env, &obj);
+    for (size_t i = 0; i < 2; i++) {
+        napi_value entry;
+
+        napi_create_object(env, &entry);
+        napi_create_double(env, values[i]->avg10, &val);
+        napi_set_named_property(env, entry, "avg10", val);
+        napi_create_double(env, values[i]->avg60, &val);
+        napi_set_named_property(env, entry, "avg60", val);
+        napi_create_double(env, values[i]->avg300, &val);
+        napi_set_named_property(env, entry, "avg300", val);
+        set_stat_number(env, entry, "total", values[i]->total);
+        napi_set_named_property(env, obj, names[i], entry);
+    }
+
+    return obj;
+}
+
+napi_value CrunStats(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2], result, section, val;
+    struct libcrun_container_stats_s stats;
+
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+    if (argc < 1) {
+        return napi_create_error_obj(env, -1, "please specify a ID for the container");
+    }
+
+    char* id = napi_get_string(env, args[0]);
+    if (!id) {
+        return napi_create_error_obj(env, -1, "Invalid container id");
+    }
+
+    char* state_root = NULL;
+    bool systemd_cgroup = false;
+
+    if (argc >= 2) {
+        napi_valuetype type;
+        napi_typeof(env, args[1], &type);
+        if (type == napi_object) {
+            state_root = get_string_property(env, args[1], "stateRoot");
+            systemd_cgroup = get_bool_property(env, args[1], "systemdCgroup", false);
+        }
+    }
+
+    libcrun_context_t crun_context = {0};
+
+    crun_context.id = id;
+    crun_context.state_root = state_root;
+    crun_context.systemd_cgroup = systemd_cgroup ? 1 : 0;
+    crun_context.fifo_exec_wait_fd = -1;
+
+    libcrun_error_t err = NULL;
+    int ret = libcrun_container_stats(&crun_context, id, &stats, &err);
+
+    free(id);
+    free(state_root);
+
+    if (ret < 0) {
+        return create_error_from_crun(env, "Failed to read container stats", &err);
+    }
+
+    napi_create_object(env, &result);
+
+    napi_create_uint32(env, stats.version, &val);
+    napi_set_named_property(env, result, "version", val);
+    set_stat_number(env, result, "timestamp", stats.timestamp);
+
+    if (stats.valid & LIBCRUN_CONTAINER_STATS_CPU) {
+        napi_create_object(env, &section);
+        set_stat_number(env, section, "usage_usec", stats.cpu.usage_usec);
+        set_stat_number(env, section, "user_usec", stats.cpu.user_usec);
+        set_stat_number(env, section, "system_usec", stats.cpu.system_usec);
+        set_stat_number(env, section, "nr_periods", stats.cpu.nr_periods);
+        set_stat_number(env, section, "nr_throttled", stats.cpu.nr_throttled);
+        set_stat_number(env, section, "throttled_usec", stats.cpu.throttled_usec);
+        napi_set_named_property(env, result, "cpu", section);
+    }
+
+    if (stats.valid & LIBCRUN_CONTAINER_STATS_MEMORY) {
+        napi_value events;
+
+        napi_create_object(env, &section);
+        set_stat_number(env, section, "usage", stats.memory.usage);
+        set_stat_number(env, section, "limit", stats.memory.limit);
+        set_stat_number(env, section, "swap_usage", stats.memory.swap_usage);
+        set_stat_number(env, section, "swap_limit", stats.memory.swap_limit);
+        set_stat_number(env, section, "anon", stats.memory.anon);
+        set_stat_number(env, section, "file", stats.memory.file);
+        set_stat_number(env, section, "kernel_stack", stats.memory.kernel_stack);
+        set_stat_number(env, section, "slab", stats.memory.slab);
+        set_stat_number(env, section, "sock", stats.memory.sock);
+        set_stat_number(env, section, "shmem", stats.memory.shmem);
+        set_stat_number(env, section, "file_mapped", stats.memory.file_mapped);
+        set_stat_number(env, section, "file_dirty", stats.memory.file_dirty);
+        set_stat_number(env, section, "file_writeback", stats.memory.file_writeback);
+        set_stat_number(env, section, "active_anon", stats.memory.active_anon);
+        set_stat_number(env, section, "inactive_anon", stats.memory.inactive_anon);
+        set_stat_number(env, section, "active_file", stats.memory.active_file);
+        set_stat_number(env, section, "inactive_file", stats.memory.inactive_file);
+        set_stat_number(env, section, "pgfault", stats.memory.pgfault);
+        set_stat_number(env, section, "pgmajfault", stats.memory.pgmajfault);
+
+        napi_create_object(env, &events);
+        set_stat_number(env, events, "low", stats.memory.events_low);
+        set_stat_number(env, events, "high", stats.memory.events_high);
+        set_stat_number(env, events, "max", stats.memory.events_max);
+        set_stat_number(env, events, "oom", stats.memory.events_oom);
+        set_stat_number(env, events, "oom_kill", stats.memory.events_oom_kill);
+        napi_set_named_property(env, section, "events", events);
+
+        napi_set_named_property(env, result, "memory", section);
+    }
+
+    if (stats.valid & LIBCRUN_CONTAINER_STATS_IO) {
+        napi_create_object(env, &section);
+        set_stat_number(env, section, "rbytes", stats.io.rbytes);
+        set_stat_number(env, section, "wbytes", stats.io.wbytes);
+        set_stat_number(env, section, "rios", stats.io.rios);
+        set_stat_number(env, section, "wios", stats.io.wios);
+        set_stat_number(env, section, "dbytes", stats.io.dbytes);
+        set_stat_number(env, section, "dios", stats.io.dios);
+        napi_set_named_property(env, result, "io", section);
+    }
+
+    if (stats.valid & LIBCRUN_CONTAINER_STATS_PIDS) {
+        napi_create_object(env, &section);
+        set_stat_number(env, section, "current", stats.pids.current);
+        set_stat_number(env, section, "limit", stats.pids.limit);
+        napi_set_named_property(env, result, "pids", section);
+    }
+
+    if (stats.valid & LIBCRUN_CONTAINER_STATS_PRESSURE) {
+        napi_create_object(env, &section);
+        napi_set_named_property(env, section, "cpu",
+                                create_pressure_object(env, &stats.pressure.cpu_some, &stats.pressure.cpu_full));
+        napi_set_named_property(env, section, "memory",
+                                create_pressure_object(env, &stats.pressure.memory_some, &stats.pressure.memory_full));
+        napi_set_named_property(env, section, "io",
+                                create_pressure_object(env, &stats.pressure.io_some, &stats.pressure.io_full));
+        napi_set_named_property(env, result, "pressure", section);
+    }
+
+    return result;
+}
+
 napi_value Init(napi_env env, napi_value exports) {
 
     napi_property_descriptor props[] = {
@@ -3550,6 +3720,7 @@ napi_value Init(napi_env env, napi_value exports) {
         {"update", NULL, CrunUpdate, NULL, NULL, NULL, napi_default, NULL},
         {"ps",      NULL, CrunPs,     NULL, NULL, NULL, napi_default, NULL},
         {"resourceUsage", NULL, CrunResourceUsage, NULL, NULL, NULL, napi_default, NULL},
+        {"stats", NULL, CrunStats, NULL, NULL, NULL, napi_default, NULL},
         {"execIntractive", NULL, CrunExecInteractive, NULL, NULL, NULL, napi_default, NULL},
         {"runIntractive", NULL, CrunRunAsync, NULL, NULL, NULL, napi_default, NULL},
         {"runDetach", NULL, CrunRunDetached, NULL, NULL, NULL, napi_default, NULL},
@@ -130,6 +130,7 @@ make_context (PyObject *self arg_unused, PyObject *args, PyObject *kwargs)
 
   memset (ctx, 0, sizeof (*ctx));
   ctx->fifo_exec_wait_fd = -1;
+  ctx->psi_fd = -1;
 
   if (!PyArg_ParseTupleAndKeywords
       (args, kwargs, "s|ssbsbbbb", kwlist, &id, &bundle, &state_root,
@@ -360,6 +361,44 @@ container_status (PyObject *self arg_unused, PyObject *args)
   return PyUnicode_FromString (buffer);
 }
 
+static PyObject *
+container_stats (PyObject *self arg_unused, PyObject *args)
+{
+  libcrun_error_t err;
+  PyObject *ctx_obj = NULL;
+  libcrun_context_t *ctx;
+  char *id = NULL;
+  struct libcrun_container_stats_s stats;
+  cleanup_free char *buffer = NULL;
+  size_t size = 0;
+  FILE *memfile;
+  int ret;
+
+  if (!PyArg_ParseTuple (args, "Os", &ctx_obj, &id))
+    return NULL;
+
+  ctx = PyCapsule_GetPointer (ctx_obj, CONTEXT_OBJ_TAG);
+  if (ctx == NULL)
+    return NULL;
+
+  Py_BEGIN_ALLOW_THREADS;
+  ret = libcrun_container_stats (ctx, id, &stats, &err);
+  Py_END_ALLOW_THREADS;
+  if (ret < 0)
+    return set_error (&err);
+
+  memfile = open_memstream (&buffer, &size);
+  if (memfile == NULL)
+    return PyErr_NoMemory ();
+
+  ret = libcrun_container_stats_write_json (id, &stats, memfile, &err);
+  fclose (memfile);
+  if (ret < 0)
+    return set_error (&err);
+
+  return PyUnicode_FromString (buffer);
+}
+
 static int
 load_json_file (yajl_val *out, const char *jsondata, struct parser_context *ctx arg_unused, libcrun_error_t *err)
 {
@@ -486,6 +525,8 @@ static PyMethodDef CrunMethods[] = {
    "Get the status of a container."},
   {"update", container_update, METH_VARARGS,
    "Update the constraints of a container."},
+  {"stats", container_stats, METH_VARARGS,
+   "Get the resource usage of a container as JSON."},
   {"spec", container_spec, METH_VARARGS,
    "Generate a new configuration file."},
   {"make_context", (PyCFunction) make_context, METH_VARARGS | METH_KEYWORDS,
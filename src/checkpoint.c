@@ -26,6 +26,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <regex.h>
+#include <inttypes.h>
 #if HAVE_CRIU && HAVE_DLOPEN
 #  include <criu/criu.h>
 #endif
@@ -47,6 +48,8 @@ enum
   OPTION_NETWORK_LOCK_METHOD,
   OPTION_PARENT_PATH,
   OPTION_PRE_DUMP,
+  OPTION_PRE_DUMP_ITERATIONS,
+  OPTION_PRE_DUMP_THRESHOLD,
   OPTION_MANAGE_CGROUPS_MODE,
 };
 
@@ -66,6 +69,8 @@ static struct argp_option options[]
 #ifdef CRIU_PRE_DUMP_SUPPORT
         { "parent-path", OPTION_PARENT_PATH, "DIR", 0, "path for previous criu image files in pre-dump", 0 },
         { "pre-dump", OPTION_PRE_DUMP, 0, 0, "dump container's memory information only, leave the container running after this", 0 },
+        { "pre-dump-iterations", OPTION_PRE_DUMP_ITERATIONS, "N", 0, "run up to N pre-dumps before the final dump", 0 },
+        { "pre-dump-threshold", OPTION_PRE_DUMP_THRESHOLD, "PAGES", 0, "stop the pre-dumps once one writes at most PAGES pages (default: 1024)", 0 },
 #endif
         { "manage-cgroups-mode", OPTION_MANAGE_CGROUPS_MODE, "MODE", 0, "cgroups mode: 'soft' (default), 'ignore', 'full' and 'strict'", 0 },
         {
@@ -136,6 +141,24 @@ parse_opt (int key, char *arg, struct argp_state *state)
       cr_options.pre_dump = true;
       break;
 
+    case OPTION_PRE_DUMP_ITERATIONS:
+      {
+        int value = parse_int_or_fail (argp_mandatory_argument (arg, state), "pre-dump-iterations");
+        if (value < 0)
+          libcrun_fail_with_error (ERANGE, "invalid value for `%s`", "pre-dump-iterations");
+        cr_options.pre_dump_iterations = value;
+      }
+      break;
+
+    case OPTION_PRE_DUMP_THRESHOLD:
+      {
+        int value = parse_int_or_fail (argp_mandatory_argument (arg, state), "pre-dump-threshold");
+        if (value < 0)
+          libcrun_fail_with_error (ERANGE, "invalid value for `%s`", "pre-dump-threshold");
+        cr_options.pre_dump_threshold = value;
+      }
+      break;
+
     case OPTION_LEAVE_RUNNING:
       cr_options.leave_running = true;
       break;
@@ -173,6 +196,13 @@ parse_opt (int key, char *arg, struct argp_state *state)
 
 static struct argp run_argp = { options, parse_opt, args_doc, doc, NULL, NULL, NULL };
 
+static void
+print_pre_dump (void *arg arg_unused, unsigned int iteration, uint64_t pages, uint64_t duration_usec)
+{
+  printf ("pre-dump %u: %" PRIu64 " pages written in %" PRIu64 " ms\n", iteration, pages, duration_usec / 1000);
+  fflush (stdout);
+}
+
 int
 crun_command_checkpoint (struct crun_global_arguments *global_args, int argc, char **argv, libcrun_error_t *err)
 {
@@ -185,6 +215,8 @@ crun_command_checkpoint (struct crun_global_arguments *global_args, int argc, ch
   };
 
   cr_options.manage_cgroups_mode = -1;
+  cr_options.pre_dump_threshold = 1024;
+  cr_options.pre_dump_cb = print_pre_dump;
 
   argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, &cr_options);
   crun_assert_n_args (argc - first_arg, 1, 2);
@@ -0,0 +1,188 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <argp.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "crun.h"
+#include "create_batch.h"
+#include "libcrun/container.h"
+#include "libcrun/utils.h"
+
+enum
+{
+  OPTION_MAX_WORKERS = 1000,
+  OPTION_POOL_SIZE,
+  OPTION_NO_NEW_KEYRING,
+  OPTION_NO_PIVOT
+};
+
+static char doc[] = "OCI runtime";
+
+static unsigned int max_workers;
+
+static unsigned int pool_size;
+
+static libcrun_context_t crun_context;
+
+static struct argp_option options[]
+    = { { "max-workers", OPTION_MAX_WORKERS, "N", 0, "create at most N containers in parallel (default: number of CPUs)", 0 },
+        { "pool-size", OPTION_POOL_SIZE, "N", 0, "create N containers CONTAINER-0...CONTAINER-N-1 from each bundle", 0 },
+        { "no-pivot", OPTION_NO_PIVOT, 0, 0, "do not use pivot_root", 0 },
+        { "no-new-keyring", OPTION_NO_NEW_KEYRING, 0, 0, "keep the same session key", 0 },
+        {
+            0,
+        } };
+
+static char args_doc[] = "create-batch [OPTION]... CONTAINER=BUNDLE...";
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  switch (key)
+    {
+    case OPTION_MAX_WORKERS:
+      max_workers = parse_int_or_fail (argp_mandatory_argument (arg, state), "max-workers");
+      break;
+
+    case OPTION_POOL_SIZE:
+      pool_size = parse_int_or_fail (argp_mandatory_argument (arg, state), "pool-size");
+      if (pool_size == 0)
+        libcrun_fail_with_error (0, "invalid pool size `%s`", arg);
+      break;
+
+    case OPTION_NO_PIVOT:
+      crun_context.no_pivot = true;
+      break;
+
+    case OPTION_NO_NEW_KEYRING:
+      crun_context.no_new_keyring = true;
+      break;
+
+    case ARGP_KEY_NO_ARGS:
+      libcrun_fail_with_error (0, "please specify at least a CONTAINER=BUNDLE pair");
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+
+  return 0;
+}
+
+static struct argp run_argp = { options, parse_opt, args_doc, doc, NULL, NULL, NULL };
+
+int
+crun_command_create_batch (struct crun_global_arguments *global_args, int argc, char **argv, libcrun_error_t *err)
+{
+  cleanup_free struct libcrun_container_batch_entry_s *entries = NULL;
+  cleanup_free libcrun_container_t **containers = NULL;
+  cleanup_free char **bundles = NULL;
+  cleanup_free char **ids = NULL;
+  int first_arg = 0, ret, failures;
+  size_t i, j, n_args, replicas, len;
+
+  argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, &crun_context);
+  crun_assert_n_args (argc - first_arg, 1, -1);
+
+  ret = init_libcrun_context (&crun_context, NULL, global_args, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  n_args = argc - first_arg;
+  replicas = pool_size ? pool_size : 1;
+  len = n_args * replicas;
+  entries = xmalloc0 (sizeof (*entries) * len);
+  containers = xmalloc0 (sizeof (*containers) * n_args);
+  bundles = xmalloc0 (sizeof (char *) * n_args);
+  ids = xmalloc0 (sizeof (char *) * len);
+
+  /* Parse all the configuration files before any container is created, so
+     that an invalid entry does not leave the batch half done.  */
+  for (i = 0; i < n_args; i++)
+    {
+      cleanup_free char *config_file = NULL;
+      char *arg = argv[first_arg + i];
+      char *sep = strchr (arg, '=');
+
+      if (sep == NULL || sep == arg || sep[1] == '\0')
+        libcrun_fail_with_error (0, "invalid argument `%s`, expected CONTAINER=BUNDLE", arg);
+      *sep = '\0';
+
+      bundles[i] = realpath (sep + 1, NULL);
+      if (bundles[i] == NULL)
+        libcrun_fail_with_error (errno, "realpath `%s` failed", sep + 1);
+
+      ret = append_paths (&config_file, err, bundles[i], "config.json", NULL);
+      if (UNLIKELY (ret < 0))
+        goto exit;
+
+      containers[i] = libcrun_container_load_from_file (config_file, err);
+      if (containers[i] == NULL)
+        {
+          ret = -1;
+          goto exit;
+        }
+
+      /* Every worker runs in its own process, so the replicas can share
+         the same parsed configuration.  */
+      for (j = 0; j < replicas; j++)
+        {
+          struct libcrun_container_batch_entry_s *entry = &entries[i * replicas + j];
+
+          if (pool_size)
+            xasprintf (&ids[i * replicas + j], "%s-%zu", arg, j);
+
+          entry->id = pool_size ? ids[i * replicas + j] : arg;
+          entry->bundle = bundles[i];
+          entry->container = containers[i];
+        }
+    }
+
+  failures = libcrun_container_create_batch (&crun_context, entries, len, max_workers, 0, err);
+  if (UNLIKELY (failures < 0))
+    {
+      ret = failures;
+      goto exit;
+    }
+
+  for (i = 0; i < len; i++)
+    if (entries[i].ret < 0)
+      {
+        libcrun_error (entries[i].err->status, "create `%s`: %s", entries[i].id, entries[i].err->msg);
+        crun_error_release (&entries[i].err);
+      }
+
+  ret = 0;
+  if (failures > 0)
+    ret = crun_make_error (err, 0, "%d of %zu containers could not be created", failures, len);
+
+exit:
+  for (i = 0; i < n_args; i++)
+    {
+      libcrun_container_free (containers[i]);
+      free (bundles[i]);
+    }
+  for (i = 0; i < len; i++)
+    free (ids[i]);
+  return ret;
+}
@@ -41,6 +41,9 @@
 #include "list.h"
 #include "start.h"
 #include "create.h"
+#include "create_batch.h"
+#include "wasm_host.h"
+#include "update_batch.h"
 #include "exec.h"
 #include "state.h"
 #include "update.h"
@@ -49,6 +52,7 @@
 #include "unpause.h"
 #include "oci_features.h"
 #include "ps.h"
+#include "stats.h"
 #include "checkpoint.h"
 #include "mounts.h"
 #include "restore.h"
@@ -102,6 +106,7 @@ init_libcrun_context (libcrun_context_t *con, const char *id, struct crun_global
   con->force_no_cgroup = glob->option_force_no_cgroup;
   con->notify_socket = getenv ("NOTIFY_SOCKET");
   con->fifo_exec_wait_fd = -1;
+  con->psi_fd = -1;
   con->argc = glob->argc;
   con->argv = glob->argv;
 
@@ -149,6 +154,10 @@ enum
   COMMAND_CHECKPOINT,
   COMMAND_RESTORE,
   COMMAND_MOUNTS,
+  COMMAND_CREATE_BATCH,
+  COMMAND_WASM_HOST,
+  COMMAND_UPDATE_BATCH,
+  COMMAND_STATS,
 };
 
 struct commands_s commands[] = { { COMMAND_CREATE, "create", crun_command_create },
@@ -170,6 +179,10 @@ struct commands_s commands[] = { { COMMAND_CREATE, "create", crun_command_create
                                  { COMMAND_RESTORE, "restore", crun_command_restore },
 #endif
                                  { COMMAND_MOUNTS, "mounts", crun_command_mounts },
+                                 { COMMAND_CREATE_BATCH, "create-batch", crun_command_create_batch },
+                                 { COMMAND_WASM_HOST, "wasm-host", crun_command_wasm_host },
+                                 { COMMAND_UPDATE_BATCH, "update-batch", crun_command_update_batch },
+                                 { COMMAND_STATS, "stats", crun_command_stats },
                                  {
                                      0,
                                  } };
@@ -179,6 +192,7 @@ static char doc[] = "\nCOMMANDS:\n"
                     "\tcheckpoint  - checkpoint a container\n"
 #endif
                     "\tcreate      - create a container\n"
+                    "\tcreate-batch - create multiple containers in parallel\n"
                     "\tdelete      - remove definition for a container\n"
                     "\texec        - exec a command in a running container\n"
                     "\tfeatures    - show the enabled features\n"
@@ -193,9 +207,12 @@ static char doc[] = "\nCOMMANDS:\n"
                     "\tspec        - generate a configuration file\n"
                     "\tstart       - start a container\n"
                     "\tstate       - output the state of a container\n"
+                    "\tstats       - show the resource usage of a container\n"
                     "\tpause       - pause all the processes in the container\n"
                     "\tresume      - unpause the processes in the container\n"
-                    "\tupdate      - update container resource constraints\n";
+                    "\tupdate      - update container resource constraints\n"
+                    "\tupdate-batch - update the resources of multiple containers\n"
+                    "\twasm-host   - create containers from a process that keeps the handler warm\n";
 
 static char args_doc[] = "COMMAND [OPTION...]";
 
@@ -0,0 +1,281 @@
+/* ANSI-C code in the format produced by gperf version 3.1 */
+/* Command-line: gperf --lookup-function-name libcrun_annotation_in_word_set -m 100 -tCEG -S1 src/libcrun/annotations.perf  */
+/* Computed positions: -k'$' */
+
+#if !((' ' == 32) && ('!' == 33) && ('"' == 34) && ('#' == 35) \
+      && ('%' == 37) && ('&' == 38) && ('\'' == 39) && ('(' == 40) \
+      && (')' == 41) && ('*' == 42) && ('+' == 43) && (',' == 44) \
+      && ('-' == 45) && ('.' == 46) && ('/' == 47) && ('0' == 48) \
+      && ('1' == 49) && ('2' == 50) && ('3' == 51) && ('4' == 52) \
+      && ('5' == 53) && ('6' == 54) && ('7' == 55) && ('8' == 56) \
+      && ('9' == 57) && (':' == 58) && (';' == 59) && ('<' == 60) \
+      && ('=' == 61) && ('>' == 62) && ('?' == 63) && ('A' == 65) \
+      && ('B' == 66) && ('C' == 67) && ('D' == 68) && ('E' == 69) \
+      && ('F' == 70) && ('G' == 71) && ('H' == 72) && ('I' == 73) \
+      && ('J' == 74) && ('K' == 75) && ('L' == 76) && ('M' == 77) \
+      && ('N' == 78) && ('O' == 79) && ('P' == 80) && ('Q' == 81) \
+      && ('R' == 82) && ('S' == 83) && ('T' == 84) && ('U' == 85) \
+      && ('V' == 86) && ('W' == 87) && ('X' == 88) && ('Y' == 89) \
+      && ('Z' == 90) && ('[' == 91) && ('\\' == 92) && (']' == 93) \
+      && ('^' == 94) && ('_' == 95) && ('a' == 97) && ('b' == 98) \
+      && ('c' == 99) && ('d' == 100) && ('e' == 101) && ('f' == 102) \
+      && ('g' == 103) && ('h' == 104) && ('i' == 105) && ('j' == 106) \
+      && ('k' == 107) && ('l' == 108) && ('m' == 109) && ('n' == 110) \
+      && ('o' == 111) && ('p' == 112) && ('q' == 113) && ('r' == 114) \
+      && ('s' == 115) && ('t' == 116) && ('u' == 117) && ('v' == 118) \
+      && ('w' == 119) && ('x' == 120) && ('y' == 121) && ('z' == 122) \
+      && ('{' == 123) && ('|' == 124) && ('}' == 125) && ('~' == 126))
+/* The character set is not based on ISO-646.  */
+#error "gperf generated tables don't work with this execution character set. Please report a bug to <bug-gperf@gnu.org>."
+#endif
+
+#line 19 "src/libcrun/annotations.perf"
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "annotations.h"
+
+#line 29 "src/libcrun/annotations.perf"
+struct annotation_s;
+enum
+  {
+    TOTAL_KEYWORDS = 29,
+    MIN_WORD_LENGTH = 9,
+    MAX_WORD_LENGTH = 36,
+    MIN_HASH_VALUE = 12,
+    MAX_HASH_VALUE = 49
+  };
+
+/* maximum key range = 38, duplicates = 0 */
+
+#ifdef __GNUC__
+__inline
+#else
+#ifdef __cplusplus
+inline
+#endif
+#endif
+static unsigned int
+hash (register const char *str, register size_t len)
+{
+  static const unsigned char asso_values[] =
+    {
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50,  0,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50,  6, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50,  5,  0, 50,
+       2,  2, 50,  2, 50, 50, 50, 50,  3, 50,
+      50,  0,  1, 50, 18, 13,  1,  0, 50, 50,
+      50,  0, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50, 50, 50, 50, 50,
+      50, 50, 50, 50, 50, 50
+    };
+  return len + asso_values[(unsigned char)str[len - 1]];
+}
+
+static const struct annotation_s wordlist[] =
+  {
+#line 35 "src/libcrun/annotations.perf"
+    {"krun.ram_mib", ANNOTATION_KRUN_RAM_MIB},
+#line 36 "src/libcrun/annotations.perf"
+    {"krun.variant", ANNOTATION_KRUN_VARIANT},
+#line 48 "src/libcrun/annotations.perf"
+    {"run.oci.psi.io", ANNOTATION_PSI_IO},
+#line 47 "src/libcrun/annotations.perf"
+    {"run.oci.psi.cpu", ANNOTATION_PSI_CPU},
+#line 59 "src/libcrun/annotations.perf"
+    {"run.oci.zygote", ANNOTATION_ZYGOTE},
+#line 38 "src/libcrun/annotations.perf"
+    {"org.criu.config", ANNOTATION_CRIU_CONFIG},
+#line 49 "src/libcrun/annotations.perf"
+    {"run.oci.psi.memory", ANNOTATION_PSI_MEMORY},
+#line 57 "src/libcrun/annotations.perf"
+    {"run.oci.wasm_cache", ANNOTATION_WASM_CACHE},
+#line 42 "src/libcrun/annotations.perf"
+    {"run.oci.hooks.stdout", ANNOTATION_HOOKS_STDOUT},
+#line 34 "src/libcrun/annotations.perf"
+    {"krun.cpus", ANNOTATION_KRUN_CPUS},
+#line 58 "src/libcrun/annotations.perf"
+    {"run.oci.wasm_populate", ANNOTATION_WASM_POPULATE},
+#line 39 "src/libcrun/annotations.perf"
+    {"run.oci.delegate-cgroup", ANNOTATION_DELEGATE_CGROUP},
+#line 56 "src/libcrun/annotations.perf"
+    {"run.oci.systemd.subgroup", ANNOTATION_SYSTEMD_SUBGROUP},
+#line 37 "src/libcrun/annotations.perf"
+    {"module.wasm.image/variant", ANNOTATION_MODULE_WASM_VARIANT},
+#line 54 "src/libcrun/annotations.perf"
+    {"run.oci.stdio_buffer_size", ANNOTATION_STDIO_BUFFER_SIZE},
+#line 45 "src/libcrun/annotations.perf"
+    {"run.oci.mount_context_type", ANNOTATION_MOUNT_CONTEXT_TYPE},
+#line 52 "src/libcrun/annotations.perf"
+    {"run.oci.seccomp_bpf_data", ANNOTATION_SECCOMP_BPF_DATA},
+#line 33 "src/libcrun/annotations.perf"
+    {"io.kubernetes.cri.sandbox-id", ANNOTATION_CRI_SANDBOX_ID},
+#line 55 "src/libcrun/annotations.perf"
+    {"run.oci.systemd.force_cgroup_v1", ANNOTATION_SYSTEMD_FORCE_CGROUP_V1},
+#line 40 "src/libcrun/annotations.perf"
+    {"run.oci.handler", ANNOTATION_HANDLER},
+#line 32 "src/libcrun/annotations.perf"
+    {"io.kubernetes.cri.container-type", ANNOTATION_CRI_CONTAINER_TYPE},
+#line 31 "src/libcrun/annotations.perf"
+    {"io.kubernetes.cri-o.SandboxID", ANNOTATION_CRIO_SANDBOX_ID},
+#line 50 "src/libcrun/annotations.perf"
+    {"run.oci.seccomp.plugins", ANNOTATION_SECCOMP_PLUGINS},
+#line 41 "src/libcrun/annotations.perf"
+    {"run.oci.hooks.stderr", ANNOTATION_HOOKS_STDERR},
+#line 53 "src/libcrun/annotations.perf"
+    {"run.oci.seccomp_fail_unknown_syscall", ANNOTATION_SECCOMP_FAIL_UNKNOWN_SYSCALL},
+#line 46 "src/libcrun/annotations.perf"
+    {"run.oci.pidfd_receiver", ANNOTATION_PIDFD_RECEIVER},
+#line 44 "src/libcrun/annotations.perf"
+    {"run.oci.keep_original_groups", ANNOTATION_KEEP_ORIGINAL_GROUPS},
+#line 51 "src/libcrun/annotations.perf"
+    {"run.oci.seccomp.receiver", ANNOTATION_SECCOMP_RECEIVER},
+#line 43 "src/libcrun/annotations.perf"
+    {"run.oci.idmapped_mounts.share_userns", ANNOTATION_IDMAPPED_MOUNTS_SHARE_USERNS},
+  };
+
+const struct annotation_s *
+libcrun_annotation_in_word_set (register const char *str, register size_t len)
+{
+  if (len <= MAX_WORD_LENGTH && len >= MIN_WORD_LENGTH)
+    {
+      register unsigned int key = hash (str, len);
+
+      if (key <= MAX_HASH_VALUE && key >= MIN_HASH_VALUE)
+        {
+          register const struct annotation_s *resword;
+
+          switch (key - 12)
+            {
+              case 0:
+                resword = &wordlist[0];
+                goto compare;
+              case 1:
+                resword = &wordlist[1];
+                goto compare;
+              case 2:
+                resword = &wordlist[2];
+                goto compare;
+              case 3:
+                resword = &wordlist[3];
+                goto compare;
+              case 4:
+                resword = &wordlist[4];
+                goto compare;
+              case 5:
+                resword = &wordlist[5];
+                goto compare;
+              case 6:
+                resword = &wordlist[6];
+                goto compare;
+              case 8:
+                resword = &wordlist[7];
+                goto compare;
+              case 9:
+                resword = &wordlist[8];
+                goto compare;
+              case 10:
+                resword = &wordlist[9];
+                goto compare;
+              case 11:
+                resword = &wordlist[10];
+                goto compare;
+              case 12:
+                resword = &wordlist[11];
+                goto compare;
+              case 13:
+                resword = &wordlist[12];
+                goto compare;
+              case 14:
+                resword = &wordlist[13];
+                goto compare;
+              case 15:
+                resword = &wordlist[14];
+                goto compare;
+              case 16:
+                resword = &wordlist[15];
+                goto compare;
+              case 17:
+                resword = &wordlist[16];
+                goto compare;
+              case 18:
+                resword = &wordlist[17];
+                goto compare;
+              case 19:
+                resword = &wordlist[18];
+                goto compare;
+              case 21:
+                resword = &wordlist[19];
+                goto compare;
+              case 22:
+                resword = &wordlist[20];
+                goto compare;
+              case 23:
+                resword = &wordlist[21];
+                goto compare;
+              case 24:
+                resword = &wordlist[22];
+                goto compare;
+              case 26:
+                resword = &wordlist[23];
+                goto compare;
+              case 27:
+                resword = &wordlist[24];
+                goto compare;
+              case 28:
+                resword = &wordlist[25];
+                goto compare;
+              case 29:
+                resword = &wordlist[26];
+                goto compare;
+              case 30:
+                resword = &wordlist[27];
+                goto compare;
+              case 37:
+                resword = &wordlist[28];
+                goto compare;
+            }
+          return 0;
+        compare:
+          {
+            register const char *s = resword->name;
+
+            if (*str == *s && !strcmp (str + 1, s + 1))
+              return resword;
+          }
+        }
+    }
+  return 0;
+}
+#line 60 "src/libcrun/annotations.perf"
+
+int
+libcrun_annotation_slot (const char *name)
+{
+  const struct annotation_s *a;
+
+  a = libcrun_annotation_in_word_set (name, strlen (name));
+  return a ? a->slot : -1;
+}
@@ -0,0 +1,72 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANNOTATIONS_H
+#define ANNOTATIONS_H
+
+#include <stddef.h>
+
+/* Annotations known to crun.  They are classified once when the container
+   configuration is loaded, so that looking them up later is just an index
+   into an array.  Keep in sync with annotations.perf.  */
+enum libcrun_annotation
+{
+  ANNOTATION_CRIO_SANDBOX_ID = 0,
+  ANNOTATION_CRI_CONTAINER_TYPE,
+  ANNOTATION_CRI_SANDBOX_ID,
+  ANNOTATION_KRUN_CPUS,
+  ANNOTATION_KRUN_RAM_MIB,
+  ANNOTATION_KRUN_VARIANT,
+  ANNOTATION_MODULE_WASM_VARIANT,
+  ANNOTATION_CRIU_CONFIG,
+  ANNOTATION_DELEGATE_CGROUP,
+  ANNOTATION_HANDLER,
+  ANNOTATION_HOOKS_STDERR,
+  ANNOTATION_HOOKS_STDOUT,
+  ANNOTATION_IDMAPPED_MOUNTS_SHARE_USERNS,
+  ANNOTATION_KEEP_ORIGINAL_GROUPS,
+  ANNOTATION_MOUNT_CONTEXT_TYPE,
+  ANNOTATION_PIDFD_RECEIVER,
+  ANNOTATION_PSI_CPU,
+  ANNOTATION_PSI_IO,
+  ANNOTATION_PSI_MEMORY,
+  ANNOTATION_SECCOMP_PLUGINS,
+  ANNOTATION_SECCOMP_RECEIVER,
+  ANNOTATION_SECCOMP_BPF_DATA,
+  ANNOTATION_SECCOMP_FAIL_UNKNOWN_SYSCALL,
+  ANNOTATION_STDIO_BUFFER_SIZE,
+  ANNOTATION_SYSTEMD_FORCE_CGROUP_V1,
+  ANNOTATION_SYSTEMD_SUBGROUP,
+  ANNOTATION_WASM_CACHE,
+  ANNOTATION_WASM_POPULATE,
+  ANNOTATION_ZYGOTE,
+  ANNOTATIONS_MAX,
+};
+
+struct annotation_s
+{
+  char *name;
+  int slot;
+};
+
+const struct annotation_s *libcrun_annotation_in_word_set (const char *str, size_t len);
+
+/* Returns the slot for NAME, or -1 if crun does not know the annotation.  */
+int libcrun_annotation_slot (const char *name);
+
+#endif
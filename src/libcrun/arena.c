@@ -0,0 +1,170 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "utils.h"
+
+#define ARENA_CHUNK_SIZE 8192
+#define ARENA_ALIGN (_Alignof (max_align_t))
+
+struct arena_chunk_s
+{
+  struct arena_chunk_s *next;
+  size_t size;
+  size_t used;
+  _Alignas (max_align_t) char data[];
+};
+
+struct libcrun_arena_s
+{
+  /* The chunk used for the next allocations, it is the head of the list.  */
+  struct arena_chunk_s *chunks;
+  size_t n_chunks;
+};
+
+static struct arena_chunk_s *
+arena_new_chunk (struct libcrun_arena_s *arena, size_t size)
+{
+  struct arena_chunk_s *chunk = xmalloc (sizeof (*chunk) + size);
+
+  chunk->size = size;
+  chunk->used = 0;
+  arena->n_chunks++;
+  return chunk;
+}
+
+struct libcrun_arena_s *
+libcrun_arena_new ()
+{
+  return xmalloc0 (sizeof (struct libcrun_arena_s));
+}
+
+void
+libcrun_arena_free (struct libcrun_arena_s *arena)
+{
+  struct arena_chunk_s *chunk, *next;
+
+  if (arena == NULL)
+    return;
+
+  for (chunk = arena->chunks; chunk; chunk = next)
+    {
+      next = chunk->next;
+      free (chunk);
+    }
+  free (arena);
+}
+
+void *
+libcrun_arena_alloc (struct libcrun_arena_s *arena, size_t size)
+{
+  struct arena_chunk_s *chunk = arena->chunks;
+  size_t offset;
+
+  size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+  /* Big allocations get their own chunk, placed after the current one so
+     that its free space is not wasted.  */
+  if (size > ARENA_CHUNK_SIZE / 4)
+    {
+      struct arena_chunk_s *big = arena_new_chunk (arena, size);
+
+      big->used = size;
+      if (chunk)
+        {
+          big->next = chunk->next;
+          chunk->next = big;
+        }
+      else
+        {
+          big->next = NULL;
+          arena->chunks = big;
+        }
+      return big->data;
+    }
+
+  if (chunk == NULL || chunk->size - chunk->used < size)
+    {
+      chunk = arena_new_chunk (arena, ARENA_CHUNK_SIZE);
+      chunk->next = arena->chunks;
+      arena->chunks = chunk;
+    }
+
+  offset = chunk->used;
+  chunk->used += size;
+  return chunk->data + offset;
+}
+
+char *
+libcrun_arena_strdup (struct libcrun_arena_s *arena, const char *str)
+{
+  size_t len = strlen (str) + 1;
+
+  return memcpy (libcrun_arena_alloc (arena, len), str, len);
+}
+
+char *
+libcrun_arena_asprintf (struct libcrun_arena_s *arena, const char *fmt, ...)
+{
+  struct arena_chunk_s *chunk = arena->chunks;
+  size_t avail = 0;
+  char *ret;
+  va_list ap;
+  int len;
+
+  /* Try to print directly in the free space of the current chunk, where
+     the next small allocation is placed.  */
+  if (chunk)
+    {
+      avail = chunk->size - chunk->used;
+      if (avail > ARENA_CHUNK_SIZE / 4)
+        avail = ARENA_CHUNK_SIZE / 4;
+    }
+
+  va_start (ap, fmt);
+  len = vsnprintf (avail ? chunk->data + chunk->used : NULL, avail, fmt, ap);
+  va_end (ap);
+  if (UNLIKELY (len < 0))
+    OOM ();
+
+  if ((size_t) len < avail)
+    return libcrun_arena_alloc (arena, len + 1);
+
+  ret = libcrun_arena_alloc (arena, len + 1);
+
+  va_start (ap, fmt);
+  vsnprintf (ret, len + 1, fmt, ap);
+  va_end (ap);
+
+  return ret;
+}
+
+size_t
+libcrun_arena_get_chunks (struct libcrun_arena_s *arena)
+{
+  return arena->n_chunks;
+}
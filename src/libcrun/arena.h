@@ -0,0 +1,51 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <config.h>
+#include <stddef.h>
+
+/* A bump allocator for the allocations that live as long as the setup of
+   a container.  Memory is taken from large chunks and it is released only
+   when the arena is freed.  The allocation functions never fail, they
+   abort on OOM like xmalloc.  */
+struct libcrun_arena_s;
+
+struct libcrun_arena_s *libcrun_arena_new (void);
+
+void libcrun_arena_free (struct libcrun_arena_s *arena);
+
+void *libcrun_arena_alloc (struct libcrun_arena_s *arena, size_t size);
+
+char *libcrun_arena_strdup (struct libcrun_arena_s *arena, const char *str);
+
+char *libcrun_arena_asprintf (struct libcrun_arena_s *arena, const char *fmt, ...) __attribute__ ((format (printf, 2, 3)));
+
+/* Number of chunks allocated with malloc by ARENA.  */
+size_t libcrun_arena_get_chunks (struct libcrun_arena_s *arena);
+
+#define cleanup_arena __attribute__ ((cleanup (cleanup_arenap)))
+
+static inline void
+cleanup_arenap (struct libcrun_arena_s **p)
+{
+  libcrun_arena_free (*p);
+}
+
+#endif
@@ -43,6 +43,10 @@ struct libcrun_cgroup_status
   int manager;
 
   bool bpf_dev_set;
+
+  /* Connection to systemd to use for the update instead of opening a new
+     one.  Not owned.  */
+  void *systemd_bus;
 };
 
 /* Forward declaration for function pointers below.  */
@@ -105,6 +109,47 @@ convert_shares_to_weight (uint64_t shares)
 int initialize_cpuset_subsystem (const char *path, libcrun_error_t *err);
 int initialize_cpuset_subsystem_resources (const char *path, runtime_spec_schema_config_linux_resources *resources, libcrun_error_t *err);
 
+/* Writes values to the files under a cgroup directory.  The files opened
+   and the list of the available controllers are cached until the writer
+   is released.  */
+struct cgroup_writer_file_s
+{
+  char *name;
+  int fd;
+  bool readable;
+};
+
+struct cgroup_writer_s
+{
+  int dirfd;
+  bool cgroup2;
+
+  /* Read the file before writing a single value and skip the write if the
+     value is already set.  Only worth it when updating an existing cgroup,
+     a new cgroup has only the default values.  */
+  bool skip_unchanged;
+
+  /* Content of cgroup.controllers, read the first time it is needed.  */
+  char *controllers;
+  bool controllers_read;
+
+  struct cgroup_writer_file_s *files;
+  size_t files_len;
+};
+
+void cgroup_writer_init (struct cgroup_writer_s *w, int dirfd, bool cgroup2);
+void cgroup_writer_release (struct cgroup_writer_s *w);
+#define cleanup_cgroup_writer __attribute__ ((cleanup (cgroup_writer_release)))
+
+/* Write DATA to the file NAME, or to ALIAS if NAME does not exist.  */
+int cgroup_writer_write (struct cgroup_writer_s *w, const char *name, const char *alias, const void *data, size_t len,
+                         libcrun_error_t *err);
+
+/* RET is the result of an operation on the file NAME.  If it failed because
+   the controller for NAME is not enabled, replace the error with a more
+   meaningful one.  */
+int cgroup_writer_check_controller (struct cgroup_writer_s *w, int ret, const char *name, libcrun_error_t *err);
+
 int write_cpuset_resources (int dirfd_cpuset, int cgroup2, runtime_spec_schema_config_linux_resources_cpu *cpu, libcrun_error_t *err);
 
 int write_cpu_burst (int cpu_dirfd, bool cgroup2, runtime_spec_schema_config_linux_resources_cpu *cpu, libcrun_error_t *err);
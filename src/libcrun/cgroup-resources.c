@@ -66,20 +66,6 @@ write_cgroup_file (int dirfd, const char *name, const void *data, size_t len, li
   return write_file_at_with_flags (dirfd, O_WRONLY | O_CLOEXEC, 0, name, data, len, err);
 }
 
-static int
-write_cgroup_file_or_alias (int dirfd, const char *name, const char *alias, const void *data, size_t len, libcrun_error_t *err)
-{
-  int ret;
-
-  ret = write_cgroup_file (dirfd, name, data, len, err);
-  if (UNLIKELY (alias != NULL && ret < 0 && crun_error_get_errno (err) == ENOENT))
-    {
-      crun_error_release (err);
-      ret = write_cgroup_file (dirfd, alias, data, len, err);
-    }
-  return ret;
-}
-
 static inline int
 openat_with_alias (int dirfd, const char *name, const char *alias, const char **used_name, int flags, libcrun_error_t *err)
 {
@@ -129,95 +115,25 @@ is_rwm (const char *str, libcrun_error_t *err)
 }
 
 static int
-check_cgroup_v2_controller_available_wrapper (int ret, int cgroup_dirfd, const char *name, libcrun_error_t *err)
-{
-  if (ret == 0 || err == NULL)
-    return 0;
-
-  errno = crun_error_get_errno (err);
-
-  /* If the file is not found, try to give a more meaningful error message.  */
-  if (errno == ENOENT || errno == EPERM || errno == EACCES)
-    {
-      cleanup_free char *controllers = NULL;
-      libcrun_error_t tmp_err = NULL;
-      cleanup_free char *key = NULL;
-      char *saveptr = NULL;
-      bool found = false;
-      const char *token;
-      char *it;
-
-      /* Check if the specified controller is enabled.  */
-      key = xstrdup (name);
-
-      it = strchr (key, '.');
-      if (it == NULL)
-        {
-          crun_error_release (err);
-          return crun_make_error (err, 0, "the specified key has not the form CONTROLLER.VALUE `%s`", name);
-        }
-      *it = '\0';
-
-      /* cgroup. files are not part of a controller.  Return the original error.  */
-      if (strcmp (key, "cgroup") == 0)
-        return ret;
-
-      /* If the cgroup.controllers file cannot be read, return the original error.  */
-      if (read_all_file_at (cgroup_dirfd, "cgroup.controllers", &controllers, NULL, &tmp_err) < 0)
-        {
-          crun_error_release (&tmp_err);
-          return ret;
-        }
-      for (token = strtok_r (controllers, " \n", &saveptr); token; token = strtok_r (NULL, " \n", &saveptr))
-        {
-          if (strcmp (token, key) == 0)
-            {
-              found = true;
-              break;
-            }
-        }
-      if (! found)
-        {
-          cleanup_free char *absolute_path = NULL;
-          libcrun_error_t tmp_err = NULL;
-
-          crun_error_release (err);
-          ret = get_realpath_to_file (cgroup_dirfd, "cgroup.controllers", &absolute_path, &tmp_err);
-          if (LIKELY (ret >= 0))
-            ret = crun_make_error (err, 0, "controller `%s` is not available under %s", key, absolute_path);
-          else
-            {
-              crun_error_release (&tmp_err);
-              ret = crun_make_error (err, 0, "the requested cgroup controller `%s` is not available", key);
-            }
-        }
-    }
-  return ret;
-}
-
-static int
-write_file_and_check_controllers_at (bool cgroup2, int dirfd, const char *name, const char *name_alias,
+write_file_and_check_controllers_at (struct cgroup_writer_s *w, const char *name, const char *name_alias,
                                      const void *data, size_t len, libcrun_error_t *err)
 {
   int ret;
 
-  ret = write_cgroup_file_or_alias (dirfd, name, name_alias, data, len, err);
-  if (cgroup2)
-    return check_cgroup_v2_controller_available_wrapper (ret, dirfd, name, err);
-  return ret;
+  ret = cgroup_writer_write (w, name, name_alias, data, len, err);
+  return cgroup_writer_check_controller (w, ret, name, err);
 }
 
 static int
-open_file_and_check_controllers_at (bool cgroup2, int dirfd, const char *name, int flags, libcrun_error_t *err)
+open_file_and_check_controllers_at (struct cgroup_writer_s *w, const char *name, int flags, libcrun_error_t *err)
 {
   int ret;
 
-  ret = openat (dirfd, name, flags);
+  ret = openat (w->dirfd, name, flags | O_CLOEXEC);
   if (UNLIKELY (ret < 0))
     {
       ret = crun_make_error (err, errno, "open `%s`", name);
-      if (cgroup2)
-        return check_cgroup_v2_controller_available_wrapper (ret, dirfd, name, err);
+      return cgroup_writer_check_controller (w, ret, name, err);
     }
   return ret;
 }
@@ -283,9 +199,11 @@ write_blkio_v2_resources_throttling (int fd, const char *name, throttling_s **th
 }
 
 static int
-write_blkio_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linux_resources_block_io *blkio,
+write_blkio_resources (struct cgroup_writer_s *w, runtime_spec_schema_config_linux_resources_block_io *blkio,
                        libcrun_error_t *err)
 {
+  bool cgroup2 = w->cgroup2;
+  int dirfd = w->dirfd;
   char fmt_buf[128];
   int len;
   int ret;
@@ -299,13 +217,13 @@ write_blkio_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linux
         return crun_make_error (err, 0, "internal error: static buffer too small");
       if (! cgroup2)
         {
-          ret = write_cgroup_file_or_alias (dirfd, "blkio.weight", "blkio.bfq.weight", fmt_buf, len, err);
+          ret = cgroup_writer_write (w, "blkio.weight", "blkio.bfq.weight", fmt_buf, len, err);
           if (UNLIKELY (ret < 0))
             return ret;
         }
       else
         {
-          ret = write_cgroup_file (dirfd, "io.bfq.weight", fmt_buf, len, err);
+          ret = cgroup_writer_write (w, "io.bfq.weight", NULL, fmt_buf, len, err);
           if (UNLIKELY (ret < 0))
             {
               if (crun_error_get_errno (err) == ENOENT)
@@ -319,7 +237,7 @@ write_blkio_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linux
                   if (UNLIKELY (len >= (int) sizeof (fmt_buf)))
                     return crun_make_error (err, 0, "internal error: static buffer too small");
 
-                  ret = write_cgroup_file (dirfd, "io.weight", fmt_buf, len, err);
+                  ret = cgroup_writer_write (w, "io.weight", NULL, fmt_buf, len, err);
                 }
 
               if (UNLIKELY (ret < 0))
@@ -336,7 +254,7 @@ write_blkio_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linux
       if (UNLIKELY (len >= (int) sizeof (fmt_buf)))
         return crun_make_error (err, 0, "internal error: static buffer too small");
 
-      ret = write_cgroup_file (dirfd, "blkio.leaf_weight", fmt_buf, len, err);
+      ret = cgroup_writer_write (w, "blkio.leaf_weight", NULL, fmt_buf, len, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -352,10 +270,10 @@ write_blkio_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linux
             return crun_make_error (err, errno, "open `io.bfq.weight`");
           for (i = 0; i < blkio->weight_device_len; i++)
             {
-              uint32_t w = blkio->weight_device[i]->weight;
+              uint32_t weight = blkio->weight_device[i]->weight;
 
               len = snprintf (fmt_buf, sizeof (fmt_buf), "%" PRIu64 ":%" PRIu64 " %i\n", blkio->weight_device[i]->major,
-                              blkio->weight_device[i]->minor, w);
+                              blkio->weight_device[i]->minor, weight);
               if (UNLIKELY (len >= (int) sizeof (fmt_buf)))
                 return crun_make_error (err, 0, "internal error: static buffer too small");
 
@@ -415,14 +333,10 @@ write_blkio_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linux
   if (cgroup2)
     {
       cleanup_close int wfd = -1;
-      const char *name = "io.max";
 
-      wfd = openat (dirfd, name, O_WRONLY | O_CLOEXEC);
+      wfd = open_file_and_check_controllers_at (w, "io.max", O_WRONLY, err);
       if (UNLIKELY (wfd < 0))
-        {
-          ret = crun_make_error (err, errno, "open `%s`", name);
-          return check_cgroup_v2_controller_available_wrapper (ret, dirfd, name, err);
-        }
+        return wfd;
 
       ret = write_blkio_v2_resources_throttling (wfd, "rbps", (throttling_s **) blkio->throttle_read_bps_device,
                                                  blkio->throttle_read_bps_device_len, err);
@@ -514,7 +428,7 @@ write_network_resources (int dirfd_netclass, int dirfd_netprio, runtime_spec_sch
 }
 
 static int
-write_hugetlb_resources (int dirfd, bool cgroup2,
+write_hugetlb_resources (struct cgroup_writer_s *w,
                          runtime_spec_schema_config_linux_resources_hugepage_limits_element **htlb, size_t htlb_len,
                          libcrun_error_t *err)
 {
@@ -527,14 +441,14 @@ write_hugetlb_resources (int dirfd, bool cgroup2,
       int len;
       int ret;
 
-      suffix = cgroup2 ? "max" : "limit_in_bytes";
+      suffix = w->cgroup2 ? "max" : "limit_in_bytes";
 
       xasprintf (&filename, "hugetlb.%s.%s", htlb[i]->page_size, suffix);
 
       len = snprintf (fmt_buf, sizeof (fmt_buf), "%" PRIu64, htlb[i]->limit);
       if (UNLIKELY (len >= (int) sizeof (fmt_buf)))
         return crun_make_error (err, 0, "internal error: static buffer too small");
-      ret = write_file_and_check_controllers_at (cgroup2, dirfd, filename, NULL, fmt_buf, len, err);
+      ret = write_file_and_check_controllers_at (w, filename, NULL, fmt_buf, len, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -545,10 +459,14 @@ static int
 write_devices_resources_v1 (int dirfd, runtime_spec_schema_defs_linux_device_cgroup **devs, size_t devs_len,
                             libcrun_error_t *err)
 {
+  cleanup_cgroup_writer struct cgroup_writer_s w;
   size_t i;
   int len;
   int ret;
 
+  /* Each rule is a separate write, use the same file descriptor for all of them.  */
+  cgroup_writer_init (&w, dirfd, false);
+
   for (i = 0; i < devs_len; i++)
     {
       /* It is plenty of room for "TYPE MAJOR:MINOR ACCESS", where type is one char, and ACCESS is at most 3.   */
@@ -588,7 +506,7 @@ write_devices_resources_v1 (int dirfd, runtime_spec_schema_defs_linux_device_cgr
           if (UNLIKELY (len >= FMT_BUF_LEN))
             return crun_make_error (err, 0, "internal error: static buffer too small");
         }
-      ret = write_cgroup_file (dirfd, file, fmt_buf, len, err);
+      ret = cgroup_writer_write (&w, file, NULL, fmt_buf, len, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -623,7 +541,7 @@ write_devices_resources_v1 (int dirfd, runtime_spec_schema_defs_linux_device_cgr
       if (UNLIKELY (len >= (int) sizeof (device)))
         return crun_make_error (err, 0, "internal error: static buffer too small");
 
-      ret = write_cgroup_file (dirfd, "devices.allow", device, strlen (device), err);
+      ret = cgroup_writer_write (&w, "devices.allow", NULL, device, strlen (device), err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -784,8 +702,9 @@ cg_itoa (char *buf, size_t size, int64_t value, bool use_max, libcrun_error_t *e
 }
 
 static int
-write_memory (int dirfd, bool cgroup2, runtime_spec_schema_config_linux_resources_memory *memory, libcrun_error_t *err)
+write_memory (struct cgroup_writer_s *w, runtime_spec_schema_config_linux_resources_memory *memory, libcrun_error_t *err)
 {
+  bool cgroup2 = w->cgroup2;
   char limit_buf[32];
   int limit_buf_len;
 
@@ -796,13 +715,14 @@ write_memory (int dirfd, bool cgroup2, runtime_spec_schema_config_linux_resource
   if (UNLIKELY (limit_buf_len < 0))
     return limit_buf_len;
 
-  return write_cgroup_file (dirfd, cgroup2 ? "memory.max" : "memory.limit_in_bytes", limit_buf, limit_buf_len, err);
+  return cgroup_writer_write (w, cgroup2 ? "memory.max" : "memory.limit_in_bytes", NULL, limit_buf, limit_buf_len, err);
 }
 
 static int
-write_memory_swap (int dirfd, bool cgroup2, runtime_spec_schema_config_linux_resources_memory *memory,
+write_memory_swap (struct cgroup_writer_s *w, runtime_spec_schema_config_linux_resources_memory *memory,
                    libcrun_error_t *err)
 {
+  bool cgroup2 = w->cgroup2;
   int ret;
   int64_t swap;
   char swap_buf[32];
@@ -830,7 +750,7 @@ write_memory_swap (int dirfd, bool cgroup2, runtime_spec_schema_config_linux_res
   if (UNLIKELY (len < 0))
     return len;
 
-  ret = write_cgroup_file (dirfd, fname, swap_buf, len, err);
+  ret = cgroup_writer_write (w, fname, NULL, swap_buf, len, err);
   if (ret >= 0)
     return ret;
 
@@ -845,9 +765,10 @@ write_memory_swap (int dirfd, bool cgroup2, runtime_spec_schema_config_linux_res
 }
 
 static int
-write_memory_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linux_resources_memory *memory,
+write_memory_resources (struct cgroup_writer_s *w, runtime_spec_schema_config_linux_resources_memory *memory,
                         libcrun_error_t *err)
 {
+  bool cgroup2 = w->cgroup2;
   int len;
   int ret;
   char fmt_buf[32];
@@ -861,11 +782,11 @@ write_memory_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linu
       uint64_t val, val_swap;
       int ret;
 
-      ret = read_all_file_at (dirfd, "memory.current", &current, NULL, err);
+      ret = read_all_file_at (w->dirfd, "memory.current", &current, NULL, err);
       if (UNLIKELY (ret < 0))
         return ret;
 
-      ret = read_all_file_at (dirfd, "memory.swap.current", &swap_current, NULL, err);
+      ret = read_all_file_at (w->dirfd, "memory.swap.current", &swap_current, NULL, err);
       if (UNLIKELY (ret < 0))
         return ret;
 
@@ -889,7 +810,7 @@ write_memory_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linu
 
   if (memory->limit_present)
     {
-      ret = write_memory (dirfd, cgroup2, memory, err);
+      ret = write_memory (w, memory, err);
       if (ret >= 0)
         memory_limits_written = true;
       else
@@ -907,13 +828,13 @@ write_memory_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linu
         }
     }
 
-  ret = write_memory_swap (dirfd, cgroup2, memory, err);
+  ret = write_memory_swap (w, memory, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
   if (memory->limit_present && ! memory_limits_written)
     {
-      ret = write_memory (dirfd, cgroup2, memory, err);
+      ret = write_memory (w, memory, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -926,7 +847,7 @@ write_memory_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linu
       len = snprintf (fmt_buf, sizeof (fmt_buf), "%" PRIu64, memory->kernel);
       if (UNLIKELY (len >= (int) sizeof (fmt_buf)))
         return crun_make_error (err, 0, "internal error: static buffer too small");
-      ret = write_cgroup_file (dirfd, "memory.kmem.limit_in_bytes", fmt_buf, len, err);
+      ret = cgroup_writer_write (w, "memory.kmem.limit_in_bytes", NULL, fmt_buf, len, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -939,7 +860,7 @@ write_memory_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linu
       if (cgroup2)
         return crun_make_error (err, 0, "cannot set useHierarchy memory with cgroupv2");
 
-      ret = write_cgroup_file (dirfd, "memory.use_hierarchy", (memory->use_hierarchy) ? "1" : "0", 1, err);
+      ret = cgroup_writer_write (w, "memory.use_hierarchy", NULL, (memory->use_hierarchy) ? "1" : "0", 1, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -949,8 +870,8 @@ write_memory_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linu
       len = snprintf (fmt_buf, sizeof (fmt_buf), "%" PRIu64, memory->reservation);
       if (UNLIKELY (len >= (int) sizeof (fmt_buf)))
         return crun_make_error (err, 0, "internal error: static buffer too small");
-      ret = write_file_and_check_controllers_at (cgroup2, dirfd, cgroup2 ? "memory.low" : "memory.soft_limit_in_bytes",
-                                                 NULL, fmt_buf, len, err);
+      ret = write_file_and_check_controllers_at (w, cgroup2 ? "memory.low" : "memory.soft_limit_in_bytes", NULL,
+                                                 fmt_buf, len, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -959,7 +880,7 @@ write_memory_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linu
       if (cgroup2)
         return crun_make_error (err, 0, "cannot disable OOM killer with cgroupv2");
 
-      ret = write_cgroup_file (dirfd, "memory.oom_control", "1", 1, err);
+      ret = cgroup_writer_write (w, "memory.oom_control", NULL, "1", 1, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -971,7 +892,7 @@ write_memory_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linu
       len = snprintf (fmt_buf, sizeof (fmt_buf), "%" PRIu64, memory->kernel_tcp);
       if (UNLIKELY (len >= (int) sizeof (fmt_buf)))
         return crun_make_error (err, 0, "internal error: static buffer too small");
-      ret = write_cgroup_file (dirfd, "memory.kmem.tcp.limit_in_bytes", fmt_buf, len, err);
+      ret = cgroup_writer_write (w, "memory.kmem.tcp.limit_in_bytes", NULL, fmt_buf, len, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -983,7 +904,7 @@ write_memory_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linu
       len = snprintf (fmt_buf, sizeof (fmt_buf), "%" PRIu64, memory->swappiness);
       if (UNLIKELY (len >= (int) sizeof (fmt_buf)))
         return crun_make_error (err, 0, "internal error: static buffer too small");
-      ret = write_cgroup_file (dirfd, "memory.swappiness", fmt_buf, len, err);
+      ret = cgroup_writer_write (w, "memory.swappiness", NULL, fmt_buf, len, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -991,9 +912,9 @@ write_memory_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linu
   return 0;
 }
 
-int
-write_cpu_burst (int cpu_dirfd, bool cgroup2, runtime_spec_schema_config_linux_resources_cpu *cpu,
-                 libcrun_error_t *err)
+static int
+write_cpu_burst_with_writer (struct cgroup_writer_s *w, runtime_spec_schema_config_linux_resources_cpu *cpu,
+                             libcrun_error_t *err)
 {
   char fmt_buf[32];
   int len;
@@ -1004,11 +925,21 @@ write_cpu_burst (int cpu_dirfd, bool cgroup2, runtime_spec_schema_config_linux_r
   len = snprintf (fmt_buf, sizeof (fmt_buf), "%" PRIi64, cpu->burst);
   if (UNLIKELY (len >= (int) sizeof (fmt_buf)))
     return crun_make_error (err, 0, "internal error: static buffer too small");
-  return write_cgroup_file (cpu_dirfd, cgroup2 ? "cpu.max.burst" : "cpu.cfs_burst_us", fmt_buf, len, err);
+  return cgroup_writer_write (w, w->cgroup2 ? "cpu.max.burst" : "cpu.cfs_burst_us", NULL, fmt_buf, len, err);
+}
+
+int
+write_cpu_burst (int cpu_dirfd, bool cgroup2, runtime_spec_schema_config_linux_resources_cpu *cpu,
+                 libcrun_error_t *err)
+{
+  cleanup_cgroup_writer struct cgroup_writer_s w;
+
+  cgroup_writer_init (&w, cpu_dirfd, cgroup2);
+  return write_cpu_burst_with_writer (&w, cpu, err);
 }
 
 static int
-write_pids_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linux_resources_pids *pids,
+write_pids_resources (struct cgroup_writer_s *w, runtime_spec_schema_config_linux_resources_pids *pids,
                       libcrun_error_t *err)
 {
   if (pids->limit)
@@ -1021,7 +952,7 @@ write_pids_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linux_
       if (UNLIKELY (len < 0))
         return len;
 
-      ret = write_file_and_check_controllers_at (cgroup2, dirfd, "pids.max", NULL, fmt_buf, len, err);
+      ret = write_file_and_check_controllers_at (w, "pids.max", NULL, fmt_buf, len, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -1030,9 +961,10 @@ write_pids_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linux_
 }
 
 static int
-write_cpu_resources (int dirfd_cpu, bool cgroup2, runtime_spec_schema_config_linux_resources_cpu *cpu,
+write_cpu_resources (struct cgroup_writer_s *w, runtime_spec_schema_config_linux_resources_cpu *cpu,
                      libcrun_error_t *err)
 {
+  bool cgroup2 = w->cgroup2;
   int len, period_len;
   int ret;
   char fmt_buf[64];
@@ -1051,8 +983,7 @@ write_cpu_resources (int dirfd_cpu, bool cgroup2, runtime_spec_schema_config_lin
       if (UNLIKELY (len >= (int) sizeof (fmt_buf)))
         return crun_make_error (err, 0, "internal error: static buffer too small");
 
-      ret = write_file_and_check_controllers_at (cgroup2, dirfd_cpu, cgroup2 ? "cpu.weight" : "cpu.shares",
-                                                 NULL, fmt_buf, len, err);
+      ret = write_file_and_check_controllers_at (w, cgroup2 ? "cpu.weight" : "cpu.shares", NULL, fmt_buf, len, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -1065,7 +996,7 @@ write_cpu_resources (int dirfd_cpu, bool cgroup2, runtime_spec_schema_config_lin
           len = snprintf (fmt_buf, sizeof (fmt_buf), "%" PRIu64, cpu->period);
           if (UNLIKELY (len >= (int) sizeof (fmt_buf)))
             return crun_make_error (err, 0, "internal error: static buffer too small");
-          ret = write_cgroup_file (dirfd_cpu, "cpu.cfs_period_us", fmt_buf, len, err);
+          ret = cgroup_writer_write (w, "cpu.cfs_period_us", NULL, fmt_buf, len, err);
           if (UNLIKELY (ret < 0))
             {
               /*
@@ -1092,12 +1023,12 @@ write_cpu_resources (int dirfd_cpu, bool cgroup2, runtime_spec_schema_config_lin
           len = snprintf (fmt_buf, sizeof (fmt_buf), "%" PRIi64, cpu->quota);
           if (UNLIKELY (len >= (int) sizeof (fmt_buf)))
             return crun_make_error (err, 0, "internal error: static buffer too small");
-          ret = write_cgroup_file (dirfd_cpu, "cpu.cfs_quota_us", fmt_buf, len, err);
+          ret = cgroup_writer_write (w, "cpu.cfs_quota_us", NULL, fmt_buf, len, err);
           if (UNLIKELY (ret < 0))
             return ret;
           if (period_str != NULL)
             {
-              ret = write_cgroup_file (dirfd_cpu, "cpu.cfs_period_us", period_str, period_len, err);
+              ret = cgroup_writer_write (w, "cpu.cfs_period_us", NULL, period_str, period_len, err);
               if (UNLIKELY (ret < 0))
                 return ret;
             }
@@ -1110,7 +1041,7 @@ write_cpu_resources (int dirfd_cpu, bool cgroup2, runtime_spec_schema_config_lin
       len = snprintf (fmt_buf, sizeof (fmt_buf), "%" PRIu64, cpu->realtime_period);
       if (UNLIKELY (len >= (int) sizeof (fmt_buf)))
         return crun_make_error (err, 0, "internal error: static buffer too small");
-      ret = write_cgroup_file (dirfd_cpu, "cpu.rt_period_us", fmt_buf, len, err);
+      ret = cgroup_writer_write (w, "cpu.rt_period_us", NULL, fmt_buf, len, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -1121,7 +1052,7 @@ write_cpu_resources (int dirfd_cpu, bool cgroup2, runtime_spec_schema_config_lin
       len = snprintf (fmt_buf, sizeof (fmt_buf), "%" PRIu64, cpu->realtime_runtime);
       if (UNLIKELY (len >= (int) sizeof (fmt_buf)))
         return crun_make_error (err, 0, "internal error: static buffer too small");
-      ret = write_cgroup_file (dirfd_cpu, "cpu.rt_runtime_us", fmt_buf, len, err);
+      ret = cgroup_writer_write (w, "cpu.rt_runtime_us", NULL, fmt_buf, len, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -1130,7 +1061,7 @@ write_cpu_resources (int dirfd_cpu, bool cgroup2, runtime_spec_schema_config_lin
       len = snprintf (fmt_buf, sizeof (fmt_buf), "%" PRIi64, cpu->idle);
       if (UNLIKELY (len >= (int) sizeof (fmt_buf)))
         return crun_make_error (err, 0, "internal error: static buffer too small");
-      ret = write_cgroup_file (dirfd_cpu, "cpu.idle", fmt_buf, len, err);
+      ret = cgroup_writer_write (w, "cpu.idle", NULL, fmt_buf, len, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -1147,17 +1078,17 @@ write_cpu_resources (int dirfd_cpu, bool cgroup2, runtime_spec_schema_config_lin
       if (UNLIKELY (len >= (int) sizeof (fmt_buf)))
         return crun_make_error (err, 0, "internal error: static buffer too small");
 
-      ret = write_file_and_check_controllers_at (cgroup2, dirfd_cpu, "cpu.max", NULL, fmt_buf, len, err);
+      ret = write_file_and_check_controllers_at (w, "cpu.max", NULL, fmt_buf, len, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
 
-  return write_cpu_burst (dirfd_cpu, cgroup2, cpu, err);
+  return write_cpu_burst_with_writer (w, cpu, err);
 }
 
-int
-write_cpuset_resources (int dirfd_cpuset, int cgroup2, runtime_spec_schema_config_linux_resources_cpu *cpu,
-                        libcrun_error_t *err)
+static int
+write_cpuset_resources_with_writer (struct cgroup_writer_s *w, runtime_spec_schema_config_linux_resources_cpu *cpu,
+                                    libcrun_error_t *err)
 {
   int ret;
 
@@ -1166,21 +1097,29 @@ write_cpuset_resources (int dirfd_cpuset, int cgroup2, runtime_spec_schema_confi
 
   if (cpu->cpus)
     {
-      ret = write_file_and_check_controllers_at (cgroup2, dirfd_cpuset, "cpuset.cpus", "cpus",
-                                                 cpu->cpus, strlen (cpu->cpus), err);
+      ret = write_file_and_check_controllers_at (w, "cpuset.cpus", "cpus", cpu->cpus, strlen (cpu->cpus), err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
   if (cpu->mems)
     {
-      ret = write_file_and_check_controllers_at (cgroup2, dirfd_cpuset, "cpuset.mems", "mems", cpu->mems, strlen (cpu->mems),
-                                                 err);
+      ret = write_file_and_check_controllers_at (w, "cpuset.mems", "mems", cpu->mems, strlen (cpu->mems), err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
   return 0;
 }
 
+int
+write_cpuset_resources (int dirfd_cpuset, int cgroup2, runtime_spec_schema_config_linux_resources_cpu *cpu,
+                        libcrun_error_t *err)
+{
+  cleanup_cgroup_writer struct cgroup_writer_s w;
+
+  cgroup_writer_init (&w, dirfd_cpuset, cgroup2);
+  return write_cpuset_resources_with_writer (&w, cpu, err);
+}
+
 static int
 open_cgroup_subsystem (const char *subsystem, const char *path, libcrun_error_t *err)
 {
@@ -1199,20 +1138,24 @@ open_cgroup_subsystem (const char *subsystem, const char *path, libcrun_error_t
 }
 
 int
-update_cgroup_v1_resources (runtime_spec_schema_config_linux_resources *resources, const char *path, libcrun_error_t *err)
+update_cgroup_v1_resources (runtime_spec_schema_config_linux_resources *resources, const char *path, bool skip_unchanged,
+                            libcrun_error_t *err)
 {
   int ret;
 
   if (resources->block_io)
     {
       cleanup_close int dirfd_blkio = -1;
+      cleanup_cgroup_writer struct cgroup_writer_s w = { .dirfd = -1 };
       runtime_spec_schema_config_linux_resources_block_io *blkio = resources->block_io;
 
       dirfd_blkio = open_cgroup_subsystem ("blkio", path, err);
       if (UNLIKELY (dirfd_blkio < 0))
         return dirfd_blkio;
 
-      ret = write_blkio_resources (dirfd_blkio, false, blkio, err);
+      cgroup_writer_init (&w, dirfd_blkio, false);
+      w.skip_unchanged = skip_unchanged;
+      ret = write_blkio_resources (&w, blkio, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -1239,13 +1182,15 @@ update_cgroup_v1_resources (runtime_spec_schema_config_linux_resources *resource
   if (resources->hugepage_limits_len)
     {
       cleanup_close int dirfd_htlb = -1;
+      cleanup_cgroup_writer struct cgroup_writer_s w = { .dirfd = -1 };
 
       dirfd_htlb = open_cgroup_subsystem ("hugetlb", path, err);
       if (UNLIKELY (dirfd_htlb < 0))
         return dirfd_htlb;
 
-      ret = write_hugetlb_resources (dirfd_htlb, false, resources->hugepage_limits, resources->hugepage_limits_len,
-                                     err);
+      cgroup_writer_init (&w, dirfd_htlb, false);
+      w.skip_unchanged = skip_unchanged;
+      ret = write_hugetlb_resources (&w, resources->hugepage_limits, resources->hugepage_limits_len, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -1266,12 +1211,15 @@ update_cgroup_v1_resources (runtime_spec_schema_config_linux_resources *resource
   if (resources->memory)
     {
       cleanup_close int dirfd_mem = -1;
+      cleanup_cgroup_writer struct cgroup_writer_s w = { .dirfd = -1 };
 
       dirfd_mem = open_cgroup_subsystem ("memory", path, err);
       if (UNLIKELY (dirfd_mem < 0))
         return dirfd_mem;
 
-      ret = write_memory_resources (dirfd_mem, false, resources->memory, err);
+      cgroup_writer_init (&w, dirfd_mem, false);
+      w.skip_unchanged = skip_unchanged;
+      ret = write_memory_resources (&w, resources->memory, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -1279,12 +1227,15 @@ update_cgroup_v1_resources (runtime_spec_schema_config_linux_resources *resource
   if (resources->pids)
     {
       cleanup_close int dirfd_pid = -1;
+      cleanup_cgroup_writer struct cgroup_writer_s w = { .dirfd = -1 };
 
       dirfd_pid = open_cgroup_subsystem ("pids", path, err);
       if (UNLIKELY (dirfd_pid < 0))
         return dirfd_pid;
 
-      ret = write_pids_resources (dirfd_pid, false, resources->pids, err);
+      cgroup_writer_init (&w, dirfd_pid, false);
+      w.skip_unchanged = skip_unchanged;
+      ret = write_pids_resources (&w, resources->pids, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -1293,12 +1244,16 @@ update_cgroup_v1_resources (runtime_spec_schema_config_linux_resources *resource
     {
       cleanup_close int dirfd_cpu = -1;
       cleanup_close int dirfd_cpuset = -1;
+      cleanup_cgroup_writer struct cgroup_writer_s w_cpu = { .dirfd = -1 };
+      cleanup_cgroup_writer struct cgroup_writer_s w_cpuset = { .dirfd = -1 };
 
       dirfd_cpu = open_cgroup_subsystem ("cpu", path, err);
       if (UNLIKELY (dirfd_cpu < 0))
         return dirfd_cpu;
 
-      ret = write_cpu_resources (dirfd_cpu, false, resources->cpu, err);
+      cgroup_writer_init (&w_cpu, dirfd_cpu, false);
+      w_cpu.skip_unchanged = skip_unchanged;
+      ret = write_cpu_resources (&w_cpu, resources->cpu, err);
       if (UNLIKELY (ret < 0))
         return ret;
 
@@ -1309,7 +1264,9 @@ update_cgroup_v1_resources (runtime_spec_schema_config_linux_resources *resource
       if (UNLIKELY (dirfd_cpuset < 0))
         return dirfd_cpuset;
 
-      ret = write_cpuset_resources (dirfd_cpuset, false, resources->cpu, err);
+      cgroup_writer_init (&w_cpuset, dirfd_cpuset, false);
+      w_cpuset.skip_unchanged = skip_unchanged;
+      ret = write_cpuset_resources_with_writer (&w_cpuset, resources->cpu, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -1321,7 +1278,7 @@ update_cgroup_v1_resources (runtime_spec_schema_config_linux_resources *resource
 }
 
 static int
-write_unified_resources (int cgroup_dirfd, runtime_spec_schema_config_linux_resources *resources, libcrun_error_t *err)
+write_unified_resources (struct cgroup_writer_s *w, runtime_spec_schema_config_linux_resources *resources, libcrun_error_t *err)
 {
   size_t i;
   int ret;
@@ -1341,7 +1298,7 @@ write_unified_resources (int cgroup_dirfd, runtime_spec_schema_config_linux_reso
 
       value = xstrdup (resources->unified->values[i]);
 
-      fd = open_file_and_check_controllers_at (true, cgroup_dirfd, resources->unified->keys[i], O_WRONLY, err);
+      fd = open_file_and_check_controllers_at (w, resources->unified->keys[i], O_WRONLY, err);
       if (UNLIKELY (fd < 0))
         return fd;
 
@@ -1357,10 +1314,12 @@ write_unified_resources (int cgroup_dirfd, runtime_spec_schema_config_linux_reso
 }
 
 static int
-update_cgroup_v2_resources (runtime_spec_schema_config_linux_resources *resources, const char *path, bool need_bpf_dev, libcrun_error_t *err)
+update_cgroup_v2_resources (runtime_spec_schema_config_linux_resources *resources, const char *path, bool need_bpf_dev,
+                            bool skip_unchanged, libcrun_error_t *err)
 {
   cleanup_free char *cgroup_path = NULL;
   cleanup_close int cgroup_dirfd = -1;
+  cleanup_cgroup_writer struct cgroup_writer_s w = { .dirfd = -1 };
   int ret;
 
   if (resources->network)
@@ -1374,6 +1333,11 @@ update_cgroup_v2_resources (runtime_spec_schema_config_linux_resources *resource
   if (UNLIKELY (cgroup_dirfd < 0))
     return crun_make_error (err, errno, "open `%s`", cgroup_path);
 
+  /* All the files are under the same directory, share the writer so each
+     file is opened once and cgroup.controllers is read at most once.  */
+  cgroup_writer_init (&w, cgroup_dirfd, true);
+  w.skip_unchanged = skip_unchanged;
+
   if (need_bpf_dev && resources->devices_len)
     {
       ret = write_devices_resources (cgroup_dirfd, true, resources->devices, resources->devices_len, err);
@@ -1383,37 +1347,36 @@ update_cgroup_v2_resources (runtime_spec_schema_config_linux_resources *resource
 
   if (resources->memory)
     {
-      ret = write_memory_resources (cgroup_dirfd, true, resources->memory, err);
+      ret = write_memory_resources (&w, resources->memory, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
   if (resources->pids)
     {
-      ret = write_pids_resources (cgroup_dirfd, true, resources->pids, err);
+      ret = write_pids_resources (&w, resources->pids, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
   if (resources->cpu)
     {
-      ret = write_cpu_resources (cgroup_dirfd, true, resources->cpu, err);
+      ret = write_cpu_resources (&w, resources->cpu, err);
       if (UNLIKELY (ret < 0))
         return ret;
 
-      ret = write_cpuset_resources (cgroup_dirfd, true, resources->cpu, err);
+      ret = write_cpuset_resources_with_writer (&w, resources->cpu, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
   if (resources->block_io)
     {
-      ret = write_blkio_resources (cgroup_dirfd, true, resources->block_io, err);
+      ret = write_blkio_resources (&w, resources->block_io, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
 
   if (resources->hugepage_limits_len)
     {
-      ret = write_hugetlb_resources (cgroup_dirfd, true, resources->hugepage_limits, resources->hugepage_limits_len,
-                                     err);
+      ret = write_hugetlb_resources (&w, resources->hugepage_limits, resources->hugepage_limits_len, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -1421,7 +1384,7 @@ update_cgroup_v2_resources (runtime_spec_schema_config_linux_resources *resource
   /* Write unified resources if any.  They have higher precedence and override any previous setting.  */
   if (resources->unified)
     {
-      ret = write_unified_resources (cgroup_dirfd, resources, err);
+      ret = write_unified_resources (&w, resources, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -1434,6 +1397,7 @@ update_cgroup_resources (const char *path,
                          const char *state_root,
                          runtime_spec_schema_config_linux_resources *resources,
                          bool need_bpf_dev,
+                         bool skip_unchanged,
                          libcrun_error_t *err)
 {
   int cgroup_mode;
@@ -1469,11 +1433,11 @@ update_cgroup_resources (const char *path,
   switch (cgroup_mode)
     {
     case CGROUP_MODE_UNIFIED:
-      return update_cgroup_v2_resources (resources, path, need_bpf_dev, err);
+      return update_cgroup_v2_resources (resources, path, need_bpf_dev, skip_unchanged, err);
 
     case CGROUP_MODE_LEGACY:
     case CGROUP_MODE_HYBRID:
-      return update_cgroup_v1_resources (resources, path, err);
+      return update_cgroup_v1_resources (resources, path, skip_unchanged, err);
 
     default:
       return crun_make_error (err, 0, "invalid cgroup mode `%d`", cgroup_mode);
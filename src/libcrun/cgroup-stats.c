@@ -0,0 +1,991 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <yajl/yajl_gen.h>
+
+#include "cgroup-stats.h"
+#include "cgroup.h"
+#include "cgroup-utils.h"
+#include "status.h"
+#include "utils.h"
+
+#define YAJL_STR(x) ((const unsigned char *) (x))
+
+/* The file does not exist, the controller is not enabled.  */
+#define STATS_FILE_MISSING -2
+
+static const struct
+{
+  const char *name;
+  uint32_t section;
+} stats_files[STATS_FILE_MAX] = {
+  [STATS_FILE_CPU_STAT] = { "cpu.stat", LIBCRUN_CONTAINER_STATS_CPU },
+  [STATS_FILE_MEMORY_CURRENT] = { "memory.current", LIBCRUN_CONTAINER_STATS_MEMORY },
+  [STATS_FILE_MEMORY_MAX] = { "memory.max", LIBCRUN_CONTAINER_STATS_MEMORY },
+  [STATS_FILE_MEMORY_SWAP_CURRENT] = { "memory.swap.current", LIBCRUN_CONTAINER_STATS_MEMORY },
+  [STATS_FILE_MEMORY_SWAP_MAX] = { "memory.swap.max", LIBCRUN_CONTAINER_STATS_MEMORY },
+  [STATS_FILE_MEMORY_STAT] = { "memory.stat", LIBCRUN_CONTAINER_STATS_MEMORY },
+  [STATS_FILE_MEMORY_EVENTS] = { "memory.events", LIBCRUN_CONTAINER_STATS_MEMORY },
+  [STATS_FILE_IO_STAT] = { "io.stat", LIBCRUN_CONTAINER_STATS_IO },
+  [STATS_FILE_PIDS_CURRENT] = { "pids.current", LIBCRUN_CONTAINER_STATS_PIDS },
+  [STATS_FILE_PIDS_MAX] = { "pids.max", LIBCRUN_CONTAINER_STATS_PIDS },
+  [STATS_FILE_CPU_PRESSURE] = { "cpu.pressure", LIBCRUN_CONTAINER_STATS_PRESSURE },
+  [STATS_FILE_MEMORY_PRESSURE] = { "memory.pressure", LIBCRUN_CONTAINER_STATS_PRESSURE },
+  [STATS_FILE_IO_PRESSURE] = { "io.pressure", LIBCRUN_CONTAINER_STATS_PRESSURE },
+};
+
+struct stats_key_s
+{
+  const char *name;
+  size_t offset;
+};
+
+#define STATS_KEY(name, field)                               \
+  {                                                          \
+    name, offsetof (struct libcrun_container_stats_s, field) \
+  }
+
+/* The same names are used for the JSON output.  */
+static const struct stats_key_s cpu_stat_keys[] = {
+  STATS_KEY ("usage_usec", cpu.usage_usec),
+  STATS_KEY ("user_usec", cpu.user_usec),
+  STATS_KEY ("system_usec", cpu.system_usec),
+  STATS_KEY ("nr_periods", cpu.nr_periods),
+  STATS_KEY ("nr_throttled", cpu.nr_throttled),
+  STATS_KEY ("throttled_usec", cpu.throttled_usec),
+  { NULL, 0 },
+};
+
+static const struct stats_key_s memory_stat_keys[] = {
+  STATS_KEY ("anon", memory.anon),
+  STATS_KEY ("file", memory.file),
+  STATS_KEY ("kernel_stack", memory.kernel_stack),
+  STATS_KEY ("slab", memory.slab),
+  STATS_KEY ("sock", memory.sock),
+  STATS_KEY ("shmem", memory.shmem),
+  STATS_KEY ("file_mapped", memory.file_mapped),
+  STATS_KEY ("file_dirty", memory.file_dirty),
+  STATS_KEY ("file_writeback", memory.file_writeback),
+  STATS_KEY ("active_anon", memory.active_anon),
+  STATS_KEY ("inactive_anon", memory.inactive_anon),
+  STATS_KEY ("active_file", memory.active_file),
+  STATS_KEY ("inactive_file", memory.inactive_file),
+  STATS_KEY ("pgfault", memory.pgfault),
+  STATS_KEY ("pgmajfault", memory.pgmajfault),
+  { NULL, 0 },
+};
+
+static const struct stats_key_s memory_events_keys[] = {
+  STATS_KEY ("low", memory.events_low),
+  STATS_KEY ("high", memory.events_high),
+  STATS_KEY ("max", memory.events_max),
+  STATS_KEY ("oom", memory.events_oom),
+  STATS_KEY ("oom_kill", memory.events_oom_kill),
+  { NULL, 0 },
+};
+
+static const struct stats_key_s io_stat_keys[] = {
+  STATS_KEY ("rbytes", io.rbytes),
+  STATS_KEY ("wbytes", io.wbytes),
+  STATS_KEY ("rios", io.rios),
+  STATS_KEY ("wios", io.wios),
+  STATS_KEY ("dbytes", io.dbytes),
+  STATS_KEY ("dios", io.dios),
+  { NULL, 0 },
+};
+
+#undef STATS_KEY
+
+struct libcrun_container_stats_reader_s
+{
+  int dirfd;
+  /* -1 if the file was not opened yet.  */
+  int fds[STATS_FILE_MAX];
+
+  char *buffer;
+  size_t buffer_size;
+};
+
+static inline uint64_t *
+stats_field (struct libcrun_container_stats_s *stats, size_t offset)
+{
+  return (uint64_t *) ((char *) stats + offset);
+}
+
+static inline const uint64_t *
+stats_field_const (const struct libcrun_container_stats_s *stats, size_t offset)
+{
+  return (const uint64_t *) ((const char *) stats + offset);
+}
+
+static const struct stats_key_s *
+find_stats_key (const struct stats_key_s *keys, const char *name)
+{
+  for (; keys->name; keys++)
+    if (strcmp (keys->name, name) == 0)
+      return keys;
+  return NULL;
+}
+
+static int
+parse_uint64 (const char *value, uint64_t *out, libcrun_error_t *err)
+{
+  unsigned long long v;
+  char *endptr = NULL;
+
+  if (strncmp (value, "max", 3) == 0 && (value[3] == '\0' || value[3] == '\n'))
+    {
+      *out = LIBCRUN_STATS_UNLIMITED;
+      return 0;
+    }
+
+  errno = 0;
+  v = strtoull (value, &endptr, 10);
+  if (UNLIKELY (errno != 0 || endptr == value || (*endptr != '\0' && *endptr != '\n')))
+    return crun_make_error (err, errno, "invalid value `%.*s`", (int) strcspn (value, "\n"), value);
+
+  *out = v;
+  return 0;
+}
+
+/* Lines in the form "KEY VALUE".  */
+static int
+parse_flat_keyed (char *content, const struct stats_key_s *keys, struct libcrun_container_stats_s *stats,
+                  libcrun_error_t *err)
+{
+  char *saveptr = NULL;
+  char *line;
+  int ret;
+
+  for (line = strtok_r (content, "\n", &saveptr); line; line = strtok_r (NULL, "\n", &saveptr))
+    {
+      const struct stats_key_s *key;
+      char *value;
+
+      value = strchr (line, ' ');
+      if (value == NULL)
+        continue;
+      *value++ = '\0';
+
+      key = find_stats_key (keys, line);
+      if (key == NULL)
+        continue;
+
+      ret = parse_uint64 (value, stats_field (stats, key->offset), err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+  return 0;
+}
+
+/* Lines in the form "DEVICE KEY=VALUE...".  The values for all the devices
+   are added together.  */
+static int
+parse_nested_keyed_sum (char *content, const struct stats_key_s *keys, struct libcrun_container_stats_s *stats,
+                        libcrun_error_t *err)
+{
+  char *saveptr = NULL;
+  char *line;
+  int ret;
+
+  for (line = strtok_r (content, "\n", &saveptr); line; line = strtok_r (NULL, "\n", &saveptr))
+    {
+      char *saveptr_line = NULL;
+      char *token;
+
+      /* Skip the device.  */
+      token = strtok_r (line, " ", &saveptr_line);
+      if (token == NULL)
+        continue;
+
+      for (token = strtok_r (NULL, " ", &saveptr_line); token; token = strtok_r (NULL, " ", &saveptr_line))
+        {
+          const struct stats_key_s *key;
+          uint64_t value;
+          char *eq;
+
+          eq = strchr (token, '=');
+          if (eq == NULL)
+            continue;
+          *eq = '\0';
+
+          key = find_stats_key (keys, token);
+          if (key == NULL)
+            continue;
+
+          ret = parse_uint64 (eq + 1, &value, err);
+          if (UNLIKELY (ret < 0))
+            return ret;
+
+          *stats_field (stats, key->offset) += value;
+        }
+    }
+  return 0;
+}
+
+/* Lines in the form "some avg10=0.00 avg60=0.00 avg300=0.00 total=0".  */
+static int
+parse_pressure (char *content, struct libcrun_pressure_s *some, struct libcrun_pressure_s *full, libcrun_error_t *err)
+{
+  char *saveptr = NULL;
+  char *line;
+  int ret;
+
+  for (line = strtok_r (content, "\n", &saveptr); line; line = strtok_r (NULL, "\n", &saveptr))
+    {
+      struct libcrun_pressure_s *p;
+      char *saveptr_line = NULL;
+      char *token;
+
+      token = strtok_r (line, " ", &saveptr_line);
+      if (token == NULL)
+        continue;
+
+      if (strcmp (token, "some") == 0)
+        p = some;
+      else if (strcmp (token, "full") == 0)
+        p = full;
+      else
+        continue;
+
+      for (token = strtok_r (NULL, " ", &saveptr_line); token; token = strtok_r (NULL, " ", &saveptr_line))
+        {
+          double *avg = NULL;
+          char *endptr = NULL;
+          char *eq;
+
+          eq = strchr (token, '=');
+          if (eq == NULL)
+            continue;
+          *eq++ = '\0';
+
+          if (strcmp (token, "total") == 0)
+            {
+              ret = parse_uint64 (eq, &p->total, err);
+              if (UNLIKELY (ret < 0))
+                return ret;
+              continue;
+            }
+
+          if (strcmp (token, "avg10") == 0)
+            avg = &p->avg10;
+          else if (strcmp (token, "avg60") == 0)
+            avg = &p->avg60;
+          else if (strcmp (token, "avg300") == 0)
+            avg = &p->avg300;
+          else
+            continue;
+
+          errno = 0;
+          *avg = strtod (eq, &endptr);
+          if (UNLIKELY (errno != 0 || endptr == eq))
+            return crun_make_error (err, errno, "invalid value `%s`", eq);
+        }
+    }
+  return 0;
+}
+
+int
+stats_parse_file (enum stats_file_e file, char *content, struct libcrun_container_stats_s *stats,
+                  libcrun_error_t *err)
+{
+  switch (file)
+    {
+    case STATS_FILE_CPU_STAT:
+      return parse_flat_keyed (content, cpu_stat_keys, stats, err);
+
+    case STATS_FILE_MEMORY_CURRENT:
+      return parse_uint64 (content, &stats->memory.usage, err);
+
+    case STATS_FILE_MEMORY_MAX:
+      return parse_uint64 (content, &stats->memory.limit, err);
+
+    case STATS_FILE_MEMORY_SWAP_CURRENT:
+      return parse_uint64 (content, &stats->memory.swap_usage, err);
+
+    case STATS_FILE_MEMORY_SWAP_MAX:
+      return parse_uint64 (content, &stats->memory.swap_limit, err);
+
+    case STATS_FILE_MEMORY_STAT:
+      return parse_flat_keyed (content, memory_stat_keys, stats, err);
+
+    case STATS_FILE_MEMORY_EVENTS:
+      return parse_flat_keyed (content, memory_events_keys, stats, err);
+
+    case STATS_FILE_IO_STAT:
+      return parse_nested_keyed_sum (content, io_stat_keys, stats, err);
+
+    case STATS_FILE_PIDS_CURRENT:
+      return parse_uint64 (content, &stats->pids.current, err);
+
+    case STATS_FILE_PIDS_MAX:
+      return parse_uint64 (content, &stats->pids.limit, err);
+
+    case STATS_FILE_CPU_PRESSURE:
+      return parse_pressure (content, &stats->pressure.cpu_some, &stats->pressure.cpu_full, err);
+
+    case STATS_FILE_MEMORY_PRESSURE:
+      return parse_pressure (content, &stats->pressure.memory_some, &stats->pressure.memory_full, err);
+
+    case STATS_FILE_IO_PRESSURE:
+      return parse_pressure (content, &stats->pressure.io_some, &stats->pressure.io_full, err);
+
+    default:
+      return crun_make_error (err, 0, "internal error: unknown stats file `%d`", file);
+    }
+}
+
+static int
+stats_reader_open (const char *state_root, const char *id, libcrun_container_stats_reader_t **out,
+                   libcrun_error_t *err)
+{
+  cleanup_container_status libcrun_container_status_t status = {};
+  cleanup_free char *cgroup_path = NULL;
+  libcrun_container_stats_reader_t *reader;
+  int cgroup_mode;
+  size_t i;
+  int dirfd;
+  int ret;
+
+  ret = libcrun_read_container_status (&status, state_root, id, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (status.cgroup_path == NULL || status.cgroup_path[0] == '\0')
+    return crun_make_error (err, 0, "the container is not using cgroups");
+
+  cgroup_mode = libcrun_get_cgroup_mode (err);
+  if (UNLIKELY (cgroup_mode < 0))
+    return cgroup_mode;
+
+  if (cgroup_mode != CGROUP_MODE_UNIFIED)
+    return crun_make_error (err, 0, "stats are supported only on cgroup v2");
+
+  ret = append_paths (&cgroup_path, err, CGROUP_ROOT, status.cgroup_path, NULL);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  dirfd = open (cgroup_path, O_DIRECTORY | O_PATH | O_CLOEXEC);
+  if (UNLIKELY (dirfd < 0))
+    return crun_make_error (err, errno, "open `%s`", cgroup_path);
+
+  reader = xmalloc0 (sizeof (*reader));
+  reader->dirfd = dirfd;
+  for (i = 0; i < STATS_FILE_MAX; i++)
+    reader->fds[i] = -1;
+
+  /* Enough for memory.stat, it grows if needed.  */
+  reader->buffer_size = 8192;
+  reader->buffer = xmalloc (reader->buffer_size);
+
+  *out = reader;
+  return 0;
+}
+
+int
+libcrun_container_stats_reader_open (libcrun_context_t *context, const char *id,
+                                     libcrun_container_stats_reader_t **out, libcrun_error_t *err)
+{
+  return stats_reader_open (context->state_root, id, out, err);
+}
+
+void
+libcrun_container_stats_reader_free (libcrun_container_stats_reader_t *reader)
+{
+  size_t i;
+
+  if (reader == NULL)
+    return;
+
+  for (i = 0; i < STATS_FILE_MAX; i++)
+    if (reader->fds[i] >= 0)
+      TEMP_FAILURE_RETRY (close (reader->fds[i]));
+
+  TEMP_FAILURE_RETRY (close (reader->dirfd));
+  free (reader->buffer);
+  free (reader);
+}
+
+/* Read FILE with a single read, the fd is kept open for the next time.
+   Returns 0 if the file does not exist.  */
+static int
+stats_read_file (libcrun_container_stats_reader_t *reader, enum stats_file_e file, char **content,
+                 libcrun_error_t *err)
+{
+  const char *name = stats_files[file].name;
+  int fd = reader->fds[file];
+  ssize_t len;
+
+  if (fd == STATS_FILE_MISSING)
+    return 0;
+
+  if (fd < 0)
+    {
+      fd = openat (reader->dirfd, name, O_RDONLY | O_CLOEXEC);
+      if (UNLIKELY (fd < 0))
+        {
+          if (errno == ENOENT)
+            {
+              reader->fds[file] = STATS_FILE_MISSING;
+              return 0;
+            }
+          return crun_make_error (err, errno, "open `%s`", name);
+        }
+      reader->fds[file] = fd;
+    }
+
+  while (1)
+    {
+      len = TEMP_FAILURE_RETRY (pread (fd, reader->buffer, reader->buffer_size, 0));
+      if (UNLIKELY (len < 0))
+        return crun_make_error (err, errno, "read `%s`", name);
+
+      if ((size_t) len < reader->buffer_size)
+        break;
+
+      /* The buffer was filled, the content might be truncated.  */
+      reader->buffer_size *= 2;
+      reader->buffer = xrealloc (reader->buffer, reader->buffer_size);
+    }
+
+  reader->buffer[len] = '\0';
+  *content = reader->buffer;
+  return 1;
+}
+
+int
+stats_reader_read_files (libcrun_container_stats_reader_t *reader, uint32_t files,
+                         struct libcrun_container_stats_s *stats, libcrun_error_t *err)
+{
+  struct timespec ts;
+  size_t i;
+  int ret;
+
+  memset (stats, 0, sizeof (*stats));
+  stats->version = LIBCRUN_CONTAINER_STATS_VERSION;
+  stats->memory.limit = LIBCRUN_STATS_UNLIMITED;
+  stats->memory.swap_limit = LIBCRUN_STATS_UNLIMITED;
+  stats->pids.limit = LIBCRUN_STATS_UNLIMITED;
+
+  if (LIKELY (clock_gettime (CLOCK_REALTIME, &ts) == 0))
+    stats->timestamp = ((uint64_t) ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+
+  for (i = 0; i < STATS_FILE_MAX; i++)
+    {
+      char *content = NULL;
+
+      if (! (files & STATS_FILE_BIT (i)))
+        continue;
+
+      ret = stats_read_file (reader, i, &content, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+      if (ret == 0)
+        continue;
+
+      ret = stats_parse_file (i, content, stats, err);
+      if (UNLIKELY (ret < 0))
+        return crun_error_wrap (err, "parse `%s`", stats_files[i].name);
+
+      stats->valid |= stats_files[i].section;
+    }
+
+  return 0;
+}
+
+int
+libcrun_container_stats_reader_read (libcrun_container_stats_reader_t *reader, struct libcrun_container_stats_s *stats,
+                                     libcrun_error_t *err)
+{
+  return stats_reader_read_files (reader, STATS_FILES_ALL, stats, err);
+}
+
+int
+libcrun_container_stats (libcrun_context_t *context, const char *id, struct libcrun_container_stats_s *stats,
+                         libcrun_error_t *err)
+{
+  libcrun_container_stats_reader_t *reader = NULL;
+  int ret;
+
+  ret = libcrun_container_stats_reader_open (context, id, &reader, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = libcrun_container_stats_reader_read (reader, stats, err);
+
+  libcrun_container_stats_reader_free (reader);
+  return ret;
+}
+
+static void
+gen_key (yajl_gen gen, const char *key)
+{
+  yajl_gen_string (gen, YAJL_STR (key), strlen (key));
+}
+
+static void
+gen_uint64 (yajl_gen gen, const char *key, uint64_t value)
+{
+  char buf[32];
+  int len;
+
+  len = snprintf (buf, sizeof (buf), "%" PRIu64, value);
+  gen_key (gen, key);
+  yajl_gen_number (gen, buf, len);
+}
+
+static void
+gen_limit (yajl_gen gen, const char *key, uint64_t value)
+{
+  if (value != LIBCRUN_STATS_UNLIMITED)
+    {
+      gen_uint64 (gen, key, value);
+      return;
+    }
+
+  gen_key (gen, key);
+  yajl_gen_null (gen);
+}
+
+static void
+gen_keys (yajl_gen gen, const struct stats_key_s *keys, const struct libcrun_container_stats_s *stats)
+{
+  for (; keys->name; keys++)
+    gen_uint64 (gen, keys->name, *stats_field_const (stats, keys->offset));
+}
+
+static void
+gen_pressure_values (yajl_gen gen, const char *key, const struct libcrun_pressure_s *p)
+{
+  char buf[32];
+  int len;
+
+  gen_key (gen, key);
+  yajl_gen_map_open (gen);
+
+  /* The kernel reports two decimal digits.  */
+  len = snprintf (buf, sizeof (buf), "%.2f", p->avg10);
+  gen_key (gen, "avg10");
+  yajl_gen_number (gen, buf, len);
+
+  len = snprintf (buf, sizeof (buf), "%.2f", p->avg60);
+  gen_key (gen, "avg60");
+  yajl_gen_number (gen, buf, len);
+
+  len = snprintf (buf, sizeof (buf), "%.2f", p->avg300);
+  gen_key (gen, "avg300");
+  yajl_gen_number (gen, buf, len);
+
+  gen_uint64 (gen, "total", p->total);
+
+  yajl_gen_map_close (gen);
+}
+
+static void
+gen_pressure (yajl_gen gen, const char *key, const struct libcrun_pressure_s *some,
+              const struct libcrun_pressure_s *full)
+{
+  gen_key (gen, key);
+  yajl_gen_map_open (gen);
+  gen_pressure_values (gen, "some", some);
+  gen_pressure_values (gen, "full", full);
+  yajl_gen_map_close (gen);
+}
+
+int
+libcrun_container_stats_write_json (const char *id, const struct libcrun_container_stats_s *stats, FILE *out,
+                                    libcrun_error_t *err)
+{
+  const unsigned char *content = NULL;
+  yajl_gen gen = NULL;
+  size_t len;
+  int ret = 0;
+
+  gen = yajl_gen_alloc (NULL);
+  if (gen == NULL)
+    return crun_make_error (err, 0, "cannot allocate json generator");
+
+  yajl_gen_config (gen, yajl_gen_validate_utf8, 1);
+
+  yajl_gen_map_open (gen);
+  gen_key (gen, "id");
+  yajl_gen_string (gen, YAJL_STR (id), strlen (id));
+  gen_uint64 (gen, "version", stats->version);
+  gen_uint64 (gen, "timestamp", stats->timestamp);
+
+  if (stats->valid & LIBCRUN_CONTAINER_STATS_CPU)
+    {
+      gen_key (gen, "cpu");
+      yajl_gen_map_open (gen);
+      gen_keys (gen, cpu_stat_keys, stats);
+      yajl_gen_map_close (gen);
+    }
+
+  if (stats->valid & LIBCRUN_CONTAINER_STATS_MEMORY)
+    {
+      gen_key (gen, "memory");
+      yajl_gen_map_open (gen);
+      gen_uint64 (gen, "usage", stats->memory.usage);
+      gen_limit (gen, "limit", stats->memory.limit);
+      gen_uint64 (gen, "swap_usage", stats->memory.swap_usage);
+      gen_limit (gen, "swap_limit", stats->memory.swap_limit);
+      gen_keys (gen, memory_stat_keys, stats);
+      gen_key (gen, "events");
+      yajl_gen_map_open (gen);
+      gen_keys (gen, memory_events_keys, stats);
+      yajl_gen_map_close (gen);
+      yajl_gen_map_close (gen);
+    }
+
+  if (stats->valid & LIBCRUN_CONTAINER_STATS_IO)
+    {
+      gen_key (gen, "io");
+      yajl_gen_map_open (gen);
+      gen_keys (gen, io_stat_keys, stats);
+      yajl_gen_map_close (gen);
+    }
+
+  if (stats->valid & LIBCRUN_CONTAINER_STATS_PIDS)
+    {
+      gen_key (gen, "pids");
+      yajl_gen_map_open (gen);
+      gen_uint64 (gen, "current", stats->pids.current);
+      gen_limit (gen, "limit", stats->pids.limit);
+      yajl_gen_map_close (gen);
+    }
+
+  if (stats->valid & LIBCRUN_CONTAINER_STATS_PRESSURE)
+    {
+      gen_key (gen, "pressure");
+      yajl_gen_map_open (gen);
+      gen_pressure (gen, "cpu", &stats->pressure.cpu_some, &stats->pressure.cpu_full);
+      gen_pressure (gen, "memory", &stats->pressure.memory_some, &stats->pressure.memory_full);
+      gen_pressure (gen, "io", &stats->pressure.io_some, &stats->pressure.io_full);
+      yajl_gen_map_close (gen);
+    }
+
+  yajl_gen_map_close (gen);
+
+  if (yajl_gen_get_buf (gen, &content, &len) != yajl_gen_status_ok)
+    {
+      ret = crun_make_error (err, 0, "cannot generate json stats");
+      goto exit;
+    }
+
+  if (UNLIKELY (fwrite (content, 1, len, out) != len || fputc ('\n', out) == EOF))
+    ret = crun_make_error (err, errno, "error writing to file");
+
+exit:
+  yajl_gen_free (gen);
+  return ret;
+}
+
+void
+stats_compute_delta (const struct libcrun_container_stats_s *prev, const struct libcrun_container_stats_s *cur,
+                     uint64_t elapsed, struct libcrun_container_stats_delta_s *delta)
+{
+  double seconds = elapsed / 1000000000.0;
+
+  memset (delta, 0, sizeof (*delta));
+  delta->elapsed = elapsed;
+  delta->memory_usage = cur->memory.usage;
+  delta->memory_growth = (int64_t) (cur->memory.usage - prev->memory.usage);
+  delta->pids = cur->pids.current;
+
+  if (elapsed == 0)
+    return;
+
+  /* The counters only grow, unless the cgroup was recreated.  */
+  if (cur->cpu.usage_usec >= prev->cpu.usage_usec)
+    delta->cpu_usage = (cur->cpu.usage_usec - prev->cpu.usage_usec) / 1000000.0 / seconds;
+  if (cur->io.rbytes >= prev->io.rbytes)
+    delta->io_read_rate = (cur->io.rbytes - prev->io.rbytes) / seconds;
+  if (cur->io.wbytes >= prev->io.wbytes)
+    delta->io_write_rate = (cur->io.wbytes - prev->io.wbytes) / seconds;
+}
+
+/* Only the files needed for the deltas are read, memory.stat in particular
+   is expensive for the kernel to generate.  */
+#define COLLECTOR_FILES                                                                               \
+  (STATS_FILE_BIT (STATS_FILE_CPU_STAT) | STATS_FILE_BIT (STATS_FILE_MEMORY_CURRENT)                  \
+   | STATS_FILE_BIT (STATS_FILE_IO_STAT) | STATS_FILE_BIT (STATS_FILE_PIDS_CURRENT))
+
+struct stats_collector_entry_s
+{
+  char *id;
+  /* NULL until the cgroup is opened.  */
+  libcrun_container_stats_reader_t *reader;
+  struct libcrun_container_stats_s last;
+  /* CLOCK_MONOTONIC time of LAST, 0 if there is no sample yet.  */
+  uint64_t last_time;
+};
+
+struct libcrun_stats_collector_s
+{
+  char *state_root;
+  char *run_dir;
+
+  /* Used to detect when a container is added or removed.  */
+  struct timespec run_dir_mtime;
+  nlink_t run_dir_nlink;
+  bool rescan;
+
+  /* Sorted by id.  */
+  struct stats_collector_entry_s *entries;
+  size_t entries_len;
+
+  struct libcrun_container_stats_delta_s *deltas;
+};
+
+static void
+stats_collector_entry_free (struct stats_collector_entry_s *entry)
+{
+  libcrun_container_stats_reader_free (entry->reader);
+  free (entry->id);
+}
+
+static int
+compare_names (const void *a, const void *b)
+{
+  return strcmp (*(char *const *) a, *(char *const *) b);
+}
+
+static uint64_t
+monotonic_now (void)
+{
+  struct timespec ts;
+
+  if (UNLIKELY (clock_gettime (CLOCK_MONOTONIC, &ts) < 0))
+    return 0;
+
+  return ((uint64_t) ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+/* List the state root again if it changed since the last time, keeping the
+   entries of the containers that are still there.  */
+static int
+stats_collector_rescan (libcrun_stats_collector_t *collector, libcrun_error_t *err)
+{
+  cleanup_container_list libcrun_container_list_t *list = NULL;
+  cleanup_free char **names = NULL;
+  struct stats_collector_entry_s *entries;
+  libcrun_container_list_t *it;
+  size_t i, j, len, n_names = 0;
+  struct stat st;
+  int ret;
+
+  ret = stat (collector->run_dir, &st);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "stat `%s`", collector->run_dir);
+
+  if (! collector->rescan && st.st_nlink == collector->run_dir_nlink
+      && st.st_mtim.tv_sec == collector->run_dir_mtime.tv_sec
+      && st.st_mtim.tv_nsec == collector->run_dir_mtime.tv_nsec)
+    return 0;
+
+  ret = libcrun_get_containers_list (&list, collector->state_root, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  for (it = list; it; it = it->next)
+    n_names++;
+
+  names = xmalloc (sizeof (char *) * (n_names + 1));
+  for (i = 0, it = list; it; it = it->next)
+    names[i++] = it->name;
+
+  qsort (names, n_names, sizeof (char *), compare_names);
+
+  /* Both the names and the entries are sorted, merge them.  */
+  entries = xmalloc0 (sizeof (*entries) * (n_names + 1));
+  for (i = 0, j = 0, len = 0; i < collector->entries_len || j < n_names;)
+    {
+      int cmp;
+
+      if (i == collector->entries_len)
+        cmp = 1;
+      else if (j == n_names)
+        cmp = -1;
+      else
+        cmp = strcmp (collector->entries[i].id, names[j]);
+
+      if (cmp < 0)
+        stats_collector_entry_free (&collector->entries[i++]);
+      else if (cmp == 0)
+        {
+          entries[len++] = collector->entries[i++];
+          j++;
+        }
+      else
+        entries[len++].id = xstrdup (names[j++]);
+    }
+
+  free (collector->entries);
+  collector->entries = entries;
+  collector->entries_len = len;
+
+  collector->deltas = xrealloc (collector->deltas, sizeof (*collector->deltas) * (len + 1));
+
+  collector->run_dir_mtime = st.st_mtim;
+  collector->run_dir_nlink = st.st_nlink;
+  collector->rescan = false;
+  return 0;
+}
+
+int
+libcrun_stats_collector_new (libcrun_context_t *context, libcrun_stats_collector_t **out, libcrun_error_t *err)
+{
+  cleanup_free char *run_dir = NULL;
+  libcrun_stats_collector_t *collector;
+  int cgroup_mode;
+  int ret;
+
+  cgroup_mode = libcrun_get_cgroup_mode (err);
+  if (UNLIKELY (cgroup_mode < 0))
+    return cgroup_mode;
+
+  if (cgroup_mode != CGROUP_MODE_UNIFIED)
+    return crun_make_error (err, 0, "stats are supported only on cgroup v2");
+
+  ret = get_run_directory (&run_dir, context->state_root, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  collector = xmalloc0 (sizeof (*collector));
+  collector->state_root = context->state_root ? xstrdup (context->state_root) : NULL;
+  collector->run_dir = run_dir;
+  run_dir = NULL;
+  collector->rescan = true;
+
+  *out = collector;
+  return 0;
+}
+
+void
+libcrun_stats_collector_free (libcrun_stats_collector_t *collector)
+{
+  size_t i;
+
+  if (collector == NULL)
+    return;
+
+  for (i = 0; i < collector->entries_len; i++)
+    stats_collector_entry_free (&collector->entries[i]);
+
+  free (collector->entries);
+  free (collector->deltas);
+  free (collector->state_root);
+  free (collector->run_dir);
+  free (collector);
+}
+
+int
+libcrun_stats_collector_sample (libcrun_stats_collector_t *collector,
+                                const struct libcrun_container_stats_delta_s **deltas, size_t *len,
+                                libcrun_error_t *err)
+{
+  size_t i, kept = 0, n_deltas = 0;
+  int ret;
+
+  ret = stats_collector_rescan (collector, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  for (i = 0; i < collector->entries_len; i++)
+    {
+      struct stats_collector_entry_s *entry = &collector->entries[i];
+      struct libcrun_container_stats_s stats;
+      libcrun_error_t tmp_err = NULL;
+      uint64_t now;
+
+      /* A container without a cgroup yet, e.g. still being created, is kept
+         and opened again at the next sample.  It is dropped by the rescan
+         once it disappears from the state root.  */
+      if (entry->reader == NULL)
+        {
+          ret = stats_reader_open (collector->state_root, entry->id, &entry->reader, &tmp_err);
+          if (UNLIKELY (ret < 0))
+            {
+              crun_error_release (&tmp_err);
+              collector->entries[kept++] = *entry;
+              continue;
+            }
+        }
+
+      ret = stats_reader_read_files (entry->reader, COLLECTOR_FILES, &stats, &tmp_err);
+      if (UNLIKELY (ret < 0))
+        {
+          /* The cgroup is gone, the container might have been recreated
+             with the same name.  */
+          crun_error_release (&tmp_err);
+          stats_collector_entry_free (entry);
+          collector->rescan = true;
+          continue;
+        }
+
+      now = monotonic_now ();
+      if (entry->last_time)
+        {
+          struct libcrun_container_stats_delta_s *delta = &collector->deltas[n_deltas++];
+
+          stats_compute_delta (&entry->last, &stats, now - entry->last_time, delta);
+          delta->id = entry->id;
+        }
+
+      entry->last = stats;
+      entry->last_time = now;
+      collector->entries[kept++] = *entry;
+    }
+
+  collector->entries_len = kept;
+
+  *deltas = collector->deltas;
+  *len = n_deltas;
+  return 0;
+}
+
+int
+libcrun_stats_collector_write (const struct libcrun_container_stats_delta_s *deltas, size_t len, uint64_t timestamp,
+                               FILE *out, libcrun_error_t *err)
+{
+  size_t i;
+
+  fprintf (out, "# %" PRIu64 "\n", timestamp);
+
+  for (i = 0; i < len; i++)
+    fprintf (out, "%s %.3f %" PRIu64 " %+" PRId64 " %.0f %.0f %" PRIu64 "\n", deltas[i].id, deltas[i].cpu_usage,
+             deltas[i].memory_usage, deltas[i].memory_growth, deltas[i].io_read_rate, deltas[i].io_write_rate,
+             deltas[i].pids);
+
+  if (UNLIKELY (ferror (out)))
+    return crun_make_error (err, errno, "error writing to file");
+
+  return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CGROUP_STATS_H
+#define CGROUP_STATS_H
+
+#include <config.h>
+#include "container.h"
+#include "error.h"
+
+/* The cgroup files read for the stats.  */
+enum stats_file_e
+{
+  STATS_FILE_CPU_STAT = 0,
+  STATS_FILE_MEMORY_CURRENT,
+  STATS_FILE_MEMORY_MAX,
+  STATS_FILE_MEMORY_SWAP_CURRENT,
+  STATS_FILE_MEMORY_SWAP_MAX,
+  STATS_FILE_MEMORY_STAT,
+  STATS_FILE_MEMORY_EVENTS,
+  STATS_FILE_IO_STAT,
+  STATS_FILE_PIDS_CURRENT,
+  STATS_FILE_PIDS_MAX,
+  STATS_FILE_CPU_PRESSURE,
+  STATS_FILE_MEMORY_PRESSURE,
+  STATS_FILE_IO_PRESSURE,
+  STATS_FILE_MAX,
+};
+
+#define STATS_FILE_BIT(x) (1U << (x))
+#define STATS_FILES_ALL (STATS_FILE_BIT (STATS_FILE_MAX) - 1)
+
+/* Parse CONTENT, the NUL terminated content of FILE, into STATS.  CONTENT
+   is modified.  */
+int stats_parse_file (enum stats_file_e file, char *content, struct libcrun_container_stats_s *stats,
+                      libcrun_error_t *err);
+
+/* Like libcrun_container_stats_reader_read, but read only the files in the
+   FILES mask of STATS_FILE_BIT.  */
+int stats_reader_read_files (libcrun_container_stats_reader_t *reader, uint32_t files,
+                             struct libcrun_container_stats_s *stats, libcrun_error_t *err);
+
+/* Compute the rates between PREV and CUR, two samples taken ELAPSED
+   nanoseconds apart.  */
+void stats_compute_delta (const struct libcrun_container_stats_s *prev, const struct libcrun_container_stats_s *cur,
+                          uint64_t elapsed, struct libcrun_container_stats_delta_s *delta);
+
+#endif
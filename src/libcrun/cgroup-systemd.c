@@ -2013,7 +2013,7 @@ find_systemd_subgroup (string_map *annotations)
 {
   const char *annotation;
 
-  annotation = find_string_map_value (annotations, "run.oci.systemd.subgroup");
+  annotation = find_string_map_known_value (annotations, ANNOTATION_SYSTEMD_SUBGROUP);
   if (annotation)
     {
       if (annotation[0] == '\0')
@@ -2171,13 +2171,33 @@ libcrun_destroy_cgroup_systemd (struct libcrun_cgroup_status *cgroup_status,
   return destroy_cgroup_path (path_to_scope, mode, err);
 }
 
+int
+libcrun_systemd_open_bus (void **bus, libcrun_error_t *err)
+{
+  sd_bus *b = NULL;
+  int ret;
+
+  ret = open_sd_bus_connection (&b, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  *bus = b;
+  return 0;
+}
+
+void
+libcrun_systemd_close_bus (void *bus)
+{
+  if (bus)
+    sd_bus_flush_close_unref (bus);
+}
+
 static int
 libcrun_update_resources_systemd (struct libcrun_cgroup_status *cgroup_status,
                                   const char *state_root,
                                   runtime_spec_schema_config_linux_resources *resources,
                                   libcrun_error_t *err)
 {
-  struct systemd_job_removed_s job_data = {};
   sd_bus_error error = SD_BUS_ERROR_NULL;
   cleanup_free char *state_dir = NULL;
   sd_bus_message *reply = NULL;
@@ -2194,14 +2214,17 @@ libcrun_update_resources_systemd (struct libcrun_cgroup_status *cgroup_status,
   if (UNLIKELY (cgroup_mode < 0))
     return cgroup_mode;
 
-  ret = open_sd_bus_connection (&bus, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
-
-  ret = systemd_check_job_status_setup (bus, &job_data, err);
-  if (UNLIKELY (ret < 0))
-    goto exit;
+  if (cgroup_status->systemd_bus)
+    bus = sd_bus_ref (cgroup_status->systemd_bus);
+  else
+    {
+      ret = open_sd_bus_connection (&bus, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
 
+  /* SetUnitProperties does not create a job, so there is no JobRemoved
+     signal to wait for.  */
   sd_err = sd_bus_message_new_method_call (bus, &m, "org.freedesktop.systemd1",
                                            "/org/freedesktop/systemd1",
                                            "org.freedesktop.systemd1.Manager",
@@ -2293,6 +2316,18 @@ libcrun_destroy_cgroup_systemd (struct libcrun_cgroup_status *cgroup_status,
   return crun_make_error (err, ENOTSUP, "systemd not supported");
 }
 
+int
+libcrun_systemd_open_bus (void **bus, libcrun_error_t *err arg_unused)
+{
+  *bus = NULL;
+  return 0;
+}
+
+void
+libcrun_systemd_close_bus (void *bus arg_unused)
+{
+}
+
 static int
 libcrun_update_resources_systemd (struct libcrun_cgroup_status *cgroup_status,
                                   const char *state_root,
@@ -29,4 +29,9 @@ extern char *get_cgroup_scope_path (const char *cgroup_path, const char *scope);
 
 extern struct libcrun_cgroup_manager cgroup_manager_systemd;
 
+/* Open a connection to systemd that can be shared by several resources
+   updates, see libcrun_update_cgroup_manager_resources.  */
+int libcrun_systemd_open_bus (void **bus, libcrun_error_t *err);
+void libcrun_systemd_close_bus (void *bus);
+
 #endif
@@ -27,6 +27,7 @@
 #include "ebpf.h"
 #include "utils.h"
 #include "status.h"
+#include "trace.h"
 #include <string.h>
 #include <sys/types.h>
 #include <signal.h>
@@ -38,6 +39,12 @@
 #include <sys/types.h>
 #include <fcntl.h>
 #include <libgen.h>
+#include <limits.h>
+#if HAVE_STDATOMIC_H
+#  include <stdatomic.h>
+#else
+#  define atomic_int volatile int
+#endif
 
 struct symlink_s
 {
@@ -196,7 +203,7 @@ int
 libcrun_get_cgroup_mode (libcrun_error_t *err)
 {
   int tmp;
-  static int cgroup_mode = 0;
+  static atomic_int cgroup_mode = 0;
 
   if (cgroup_mode)
     return cgroup_mode;
@@ -1066,3 +1073,193 @@ get_cgroup_dirfd_path (int dirfd, char **path, libcrun_error_t *err)
     }
   return crun_make_error (err, 0, "invalid cgroup path `%s`", cgroup_path);
 }
+
+void
+cgroup_writer_init (struct cgroup_writer_s *w, int dirfd, bool cgroup2)
+{
+  memset (w, 0, sizeof (*w));
+  w->dirfd = dirfd;
+  w->cgroup2 = cgroup2;
+}
+
+void
+cgroup_writer_release (struct cgroup_writer_s *w)
+{
+  size_t i;
+
+  for (i = 0; i < w->files_len; i++)
+    {
+      TEMP_FAILURE_RETRY (close (w->files[i].fd));
+      free (w->files[i].name);
+    }
+  free (w->files);
+  free (w->controllers);
+  memset (w, 0, sizeof (*w));
+}
+
+int
+cgroup_writer_check_controller (struct cgroup_writer_s *w, int ret, const char *name, libcrun_error_t *err)
+{
+  cleanup_free char *key = NULL;
+  char *saveptr = NULL;
+  bool found = false;
+  const char *token;
+  char *it;
+
+  if (ret >= 0 || ! w->cgroup2 || err == NULL)
+    return ret;
+
+  /* If the file is not found, try to give a more meaningful error message.  */
+  errno = crun_error_get_errno (err);
+  if (errno != ENOENT && errno != EPERM && errno != EACCES)
+    return ret;
+
+  /* Check if the specified controller is enabled.  */
+  key = xstrdup (name);
+
+  it = strchr (key, '.');
+  if (it == NULL)
+    {
+      crun_error_release (err);
+      return crun_make_error (err, 0, "the specified key has not the form CONTROLLER.VALUE `%s`", name);
+    }
+  *it = '\0';
+
+  /* cgroup. files are not part of a controller.  Return the original error.  */
+  if (strcmp (key, "cgroup") == 0)
+    return ret;
+
+  if (! w->controllers_read)
+    {
+      libcrun_error_t tmp_err = NULL;
+
+      w->controllers_read = true;
+      if (read_all_file_at (w->dirfd, "cgroup.controllers", &w->controllers, NULL, &tmp_err) < 0)
+        crun_error_release (&tmp_err);
+    }
+
+  /* If the cgroup.controllers file cannot be read, return the original error.  */
+  if (w->controllers == NULL)
+    return ret;
+
+  {
+    cleanup_free char *controllers = xstrdup (w->controllers);
+
+    for (token = strtok_r (controllers, " \n", &saveptr); token; token = strtok_r (NULL, " \n", &saveptr))
+      {
+        if (strcmp (token, key) == 0)
+          {
+            found = true;
+            break;
+          }
+      }
+  }
+  if (! found)
+    {
+      cleanup_free char *absolute_path = NULL;
+      libcrun_error_t tmp_err = NULL;
+
+      crun_error_release (err);
+      ret = get_realpath_to_file (w->dirfd, "cgroup.controllers", &absolute_path, &tmp_err);
+      if (LIKELY (ret >= 0))
+        ret = crun_make_error (err, 0, "controller `%s` is not available under %s", key, absolute_path);
+      else
+        {
+          crun_error_release (&tmp_err);
+          ret = crun_make_error (err, 0, "the requested cgroup controller `%s` is not available", key);
+        }
+    }
+  return ret;
+}
+
+static struct cgroup_writer_file_s *
+cgroup_writer_get_file (struct cgroup_writer_s *w, const char *name, libcrun_error_t *err)
+{
+  struct cgroup_writer_file_s *file;
+  bool readable = w->skip_unchanged;
+  size_t i;
+  int fd;
+
+  for (i = 0; i < w->files_len; i++)
+    if (strcmp (w->files[i].name, name) == 0)
+      return &w->files[i];
+
+  /* Open the file for reading too if the current value is compared.  Some
+     files are write-only, fall back to O_WRONLY for them.  */
+  fd = openat (w->dirfd, name, (readable ? O_RDWR : O_WRONLY) | O_CLOEXEC);
+  if (fd < 0 && readable && errno != ENOENT)
+    {
+      readable = false;
+      fd = openat (w->dirfd, name, O_WRONLY | O_CLOEXEC);
+    }
+  if (UNLIKELY (fd < 0))
+    {
+      crun_make_error (err, errno, "open `%s` for writing", name);
+      return NULL;
+    }
+
+  w->files = xrealloc (w->files, sizeof (*w->files) * (w->files_len + 1));
+  file = &w->files[w->files_len++];
+  file->name = xstrdup (name);
+  file->fd = fd;
+  file->readable = readable;
+  return file;
+}
+
+/* Whether the file already contains DATA, that is a single value.  */
+static bool
+cgroup_writer_has_value (struct cgroup_writer_file_s *file, const void *data, size_t len)
+{
+  char buf[256];
+  ssize_t ret;
+
+  if (! file->readable || len == 0 || len >= sizeof (buf) - 1 || memchr (data, '\n', len))
+    return false;
+
+  ret = TEMP_FAILURE_RETRY (pread (file->fd, buf, sizeof (buf), 0));
+  if (ret <= 0)
+    return false;
+
+  if (buf[ret - 1] == '\n')
+    ret--;
+
+  return (size_t) ret == len && memcmp (buf, data, len) == 0;
+}
+
+int
+cgroup_writer_write (struct cgroup_writer_s *w, const char *name, const char *alias, const void *data, size_t len,
+                     libcrun_error_t *err)
+{
+  struct cgroup_writer_file_s *file;
+  uint64_t start = 0;
+  int ret;
+
+  file = cgroup_writer_get_file (w, name, err);
+  if (UNLIKELY (file == NULL && alias != NULL && crun_error_get_errno (err) == ENOENT))
+    {
+      crun_error_release (err);
+      name = alias;
+      file = cgroup_writer_get_file (w, name, err);
+    }
+  if (UNLIKELY (file == NULL))
+    return -1;
+
+  if (w->skip_unchanged && cgroup_writer_has_value (file, data, len))
+    {
+      libcrun_trace_counter_add (LIBCRUN_TRACE_CGROUP_WRITES_SKIPPED, 1);
+      return (len > INT_MAX) ? INT_MAX : (int) len;
+    }
+
+  if (libcrun_trace_enabled ())
+    start = libcrun_trace_now ();
+
+  ret = safe_write (file->fd, name, data, len, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  libcrun_trace_counter_add (LIBCRUN_TRACE_CGROUP_WRITES, 1);
+  if (start)
+    libcrun_trace ("cgroup write `%s`: %llu us", name, (unsigned long long) (libcrun_trace_now () - start) / 1000);
+
+  return (len > INT_MAX) ? INT_MAX : (int) len;
+}
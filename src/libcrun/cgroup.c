@@ -90,7 +90,7 @@ find_delegate_cgroup (string_map *annotations)
 {
   const char *annotation;
 
-  annotation = find_string_map_value (annotations, "run.oci.delegate-cgroup");
+  annotation = find_string_map_known_value (annotations, ANNOTATION_DELEGATE_CGROUP);
   if (annotation)
     {
       if (annotation[0] == '\0')
@@ -208,26 +208,50 @@ libcrun_cgroup_destroy (struct libcrun_cgroup_status *cgroup_status, libcrun_err
   return cgroup_manager->destroy_cgroup (cgroup_status, err);
 }
 
+int
+libcrun_update_cgroup_manager_resources (struct libcrun_cgroup_status *cgroup_status,
+                                         const char *state_root,
+                                         runtime_spec_schema_config_linux_resources *resources,
+                                         void *systemd_bus,
+                                         libcrun_error_t *err)
+{
+  struct libcrun_cgroup_manager *cgroup_manager = NULL;
+  int ret;
+
+  cgroup_status->systemd_bus = systemd_bus;
+
+  ret = get_cgroup_manager (cgroup_status->manager, &cgroup_manager, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (cgroup_manager->update_resources == NULL)
+    return 0;
+
+  return cgroup_manager->update_resources (cgroup_status, state_root, resources, err);
+}
+
+int
+libcrun_update_cgroup_files (struct libcrun_cgroup_status *cgroup_status,
+                             const char *state_root,
+                             runtime_spec_schema_config_linux_resources *resources,
+                             libcrun_error_t *err)
+{
+  return update_cgroup_resources (cgroup_status->path, state_root, resources, ! cgroup_status->bpf_dev_set, true, err);
+}
+
 int
 libcrun_update_cgroup_resources (struct libcrun_cgroup_status *cgroup_status,
                                  const char *state_root,
                                  runtime_spec_schema_config_linux_resources *resources,
                                  libcrun_error_t *err)
 {
-  struct libcrun_cgroup_manager *cgroup_manager = NULL;
   int ret;
 
-  ret = get_cgroup_manager (cgroup_status->manager, &cgroup_manager, err);
+  ret = libcrun_update_cgroup_manager_resources (cgroup_status, state_root, resources, NULL, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
-  if (cgroup_manager->update_resources)
-    {
-      ret = cgroup_manager->update_resources (cgroup_status, state_root, resources, err);
-      if (UNLIKELY (ret < 0))
-        return ret;
-    }
-  return update_cgroup_resources (cgroup_status->path, state_root, resources, ! cgroup_status->bpf_dev_set, err);
+  return libcrun_update_cgroup_files (cgroup_status, state_root, resources, err);
 }
 
 static int
@@ -364,7 +388,7 @@ libcrun_cgroup_enter (struct libcrun_cgroup_args *args, struct libcrun_cgroup_st
 
       if (args->resources)
         {
-          ret = update_cgroup_resources (status->path, args->state_root, args->resources, ! status->bpf_dev_set, err);
+          ret = update_cgroup_resources (status->path, args->state_root, args->resources, ! status->bpf_dev_set, false, err);
           if (UNLIKELY (ret < 0))
             return ret;
         }
@@ -97,6 +97,22 @@ int libcrun_update_cgroup_resources (struct libcrun_cgroup_status *status,
                                      runtime_spec_schema_config_linux_resources *resources,
                                      libcrun_error_t *err);
 
+/* The two steps of libcrun_update_cgroup_resources: the update through the
+   cgroup manager, e.g. the systemd unit properties, and then the writes to
+   the cgroup files.  The second step does not use the cgroup manager.
+   SYSTEMD_BUS is a connection from libcrun_systemd_open_bus, or NULL to
+   open a new one.  */
+int libcrun_update_cgroup_manager_resources (struct libcrun_cgroup_status *status,
+                                             const char *state_root,
+                                             runtime_spec_schema_config_linux_resources *resources,
+                                             void *systemd_bus,
+                                             libcrun_error_t *err);
+
+int libcrun_update_cgroup_files (struct libcrun_cgroup_status *status,
+                                 const char *state_root,
+                                 runtime_spec_schema_config_linux_resources *resources,
+                                 libcrun_error_t *err);
+
 int libcrun_cgroup_is_container_paused (struct libcrun_cgroup_status *status, bool *paused, libcrun_error_t *err);
 
 int libcrun_cgroup_pause_unpause (struct libcrun_cgroup_status *status, const bool pause, libcrun_error_t *err);
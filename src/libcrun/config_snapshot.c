@@ -0,0 +1,507 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <yajl/yajl_tree.h>
+
+#include "config_snapshot.h"
+#include "utils.h"
+#include "blake3/blake3.h"
+
+/* The file starts with struct snapshot_header_s, followed by the nodes of
+   the tree in preorder.  Each node is a tag byte and:
+
+   - string: u32 length, the bytes and a NUL terminator
+   - number: the textual representation encoded as a string, a u8 with the
+     yajl flags, the integer and the double value
+   - object: u32 count, then count keys encoded as strings, each followed by
+     its value
+   - array: u32 count, then count values
+   - true, false and null: nothing
+
+   All the integers use the byte order of the host, a snapshot written on a
+   different host is ignored.  */
+
+#define SNAPSHOT_MAGIC "CRUNSNAP"
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+#define SNAPSHOT_MAX_DEPTH 1024
+
+enum
+{
+  TAG_STRING = 's',
+  TAG_NUMBER = 'n',
+  TAG_OBJECT = 'o',
+  TAG_ARRAY = 'a',
+  TAG_TRUE = 't',
+  TAG_FALSE = 'f',
+  TAG_NULL = 'z',
+};
+
+struct snapshot_header_s
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t payload_len;
+  /* Number of nodes, object keys and child values, so that the decoder
+     allocates everything at once.  */
+  uint64_t n_nodes;
+  uint64_t n_keys;
+  uint64_t n_values;
+  /* blake3 hash of the payload.  */
+  uint8_t checksum[32];
+};
+
+struct libcrun_config_snapshot_s
+{
+  /* Set if the snapshot was read from a file.  */
+  struct libcrun_mmap_s *mmap;
+  /* Nodes, values and keys of the tree in a single allocation.  */
+  void *data;
+  yajl_val tree;
+};
+
+struct encoder_s
+{
+  char *buf;
+  size_t len;
+  size_t allocated;
+  uint64_t n_nodes;
+  uint64_t n_keys;
+  uint64_t n_values;
+};
+
+static void
+put (struct encoder_s *e, const void *data, size_t len)
+{
+  if (e->len + len > e->allocated)
+    {
+      e->allocated = (e->len + len) * 2;
+      e->buf = xrealloc (e->buf, e->allocated);
+    }
+  memcpy (e->buf + e->len, data, len);
+  e->len += len;
+}
+
+static void
+put_u8 (struct encoder_s *e, uint8_t v)
+{
+  put (e, &v, sizeof (v));
+}
+
+static int
+put_u32 (struct encoder_s *e, size_t v, libcrun_error_t *err)
+{
+  uint32_t v32 = v;
+
+  if (UNLIKELY (v > UINT32_MAX))
+    return crun_make_error (err, EOVERFLOW, "config snapshot: value too large");
+
+  put (e, &v32, sizeof (v32));
+  return 0;
+}
+
+static int
+put_string (struct encoder_s *e, const char *s, libcrun_error_t *err)
+{
+  size_t len = strlen (s);
+  int ret;
+
+  ret = put_u32 (e, len, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  put (e, s, len + 1);
+  return 0;
+}
+
+static int
+encode_node (struct encoder_s *e, yajl_val v, unsigned int depth, libcrun_error_t *err)
+{
+  size_t i;
+  int ret;
+
+  if (UNLIKELY (depth > SNAPSHOT_MAX_DEPTH))
+    return crun_make_error (err, 0, "config snapshot: nesting too deep");
+
+  e->n_nodes++;
+
+  switch (v->type)
+    {
+    case yajl_t_string:
+      put_u8 (e, TAG_STRING);
+      return put_string (e, v->u.string, err);
+
+    case yajl_t_number:
+      put_u8 (e, TAG_NUMBER);
+      ret = put_string (e, v->u.number.r, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+      put_u8 (e, v->u.number.flags);
+      put (e, &v->u.number.i, sizeof (v->u.number.i));
+      put (e, &v->u.number.d, sizeof (v->u.number.d));
+      return 0;
+
+    case yajl_t_object:
+      put_u8 (e, TAG_OBJECT);
+      ret = put_u32 (e, v->u.object.len, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+      e->n_keys += v->u.object.len;
+      e->n_values += v->u.object.len;
+      for (i = 0; i < v->u.object.len; i++)
+        {
+          ret = put_string (e, v->u.object.keys[i], err);
+          if (UNLIKELY (ret < 0))
+            return ret;
+
+          ret = encode_node (e, v->u.object.values[i], depth + 1, err);
+          if (UNLIKELY (ret < 0))
+            return ret;
+        }
+      return 0;
+
+    case yajl_t_array:
+      put_u8 (e, TAG_ARRAY);
+      ret = put_u32 (e, v->u.array.len, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+      e->n_values += v->u.array.len;
+      for (i = 0; i < v->u.array.len; i++)
+        {
+          ret = encode_node (e, v->u.array.values[i], depth + 1, err);
+          if (UNLIKELY (ret < 0))
+            return ret;
+        }
+      return 0;
+
+    case yajl_t_true:
+      put_u8 (e, TAG_TRUE);
+      return 0;
+
+    case yajl_t_false:
+      put_u8 (e, TAG_FALSE);
+      return 0;
+
+    case yajl_t_null:
+      put_u8 (e, TAG_NULL);
+      return 0;
+
+    default:
+      return crun_make_error (err, 0, "config snapshot: unknown JSON type `%d`", (int) v->type);
+    }
+}
+
+int
+libcrun_config_snapshot_encode (yajl_val tree, char **out, size_t *out_len, libcrun_error_t *err)
+{
+  struct snapshot_header_s header;
+  struct encoder_s e;
+  blake3_hasher hasher;
+  int ret;
+
+  memset (&e, 0, sizeof (e));
+  memset (&header, 0, sizeof (header));
+
+  /* Reserve the space for the header, it is filled at the end.  */
+  put (&e, &header, sizeof (header));
+
+  ret = encode_node (&e, tree, 0, err);
+  if (UNLIKELY (ret < 0))
+    {
+      free (e.buf);
+      return ret;
+    }
+
+  memcpy (header.magic, SNAPSHOT_MAGIC, sizeof (header.magic));
+  header.version = LIBCRUN_CONFIG_SNAPSHOT_VERSION;
+  header.byte_order = SNAPSHOT_BYTE_ORDER;
+  header.payload_len = e.len - sizeof (header);
+  header.n_nodes = e.n_nodes;
+  header.n_keys = e.n_keys;
+  header.n_values = e.n_values;
+
+  blake3_hasher_init (&hasher);
+  blake3_hasher_update (&hasher, e.buf + sizeof (header), header.payload_len);
+  blake3_hasher_finalize (&hasher, header.checksum, sizeof (header.checksum));
+
+  memcpy (e.buf, &header, sizeof (header));
+
+  *out = e.buf;
+  *out_len = e.len;
+  return 0;
+}
+
+struct decoder_s
+{
+  const char *p;
+  const char *end;
+
+  struct yajl_val_s *nodes;
+  size_t n_nodes;
+  yajl_val *values;
+  size_t n_values;
+  const char **keys;
+  size_t n_keys;
+};
+
+static bool
+get (struct decoder_s *d, void *out, size_t len)
+{
+  if ((size_t) (d->end - d->p) < len)
+    return false;
+  memcpy (out, d->p, len);
+  d->p += len;
+  return true;
+}
+
+static bool
+get_string (struct decoder_s *d, char **out)
+{
+  uint32_t len;
+
+  if (! get (d, &len, sizeof (len)))
+    return false;
+
+  if ((size_t) (d->end - d->p) <= len || d->p[len] != '\0')
+    return false;
+
+  *out = (char *) d->p;
+  d->p += len + 1;
+  return true;
+}
+
+static bool
+decode_node (struct decoder_s *d, yajl_val *out, unsigned int depth)
+{
+  struct yajl_val_s *v;
+  uint32_t i, len;
+  uint8_t tag, flags;
+
+  if (depth > SNAPSHOT_MAX_DEPTH || d->n_nodes == 0)
+    return false;
+
+  if (! get (d, &tag, sizeof (tag)))
+    return false;
+
+  v = d->nodes++;
+  d->n_nodes--;
+  *out = v;
+
+  switch (tag)
+    {
+    case TAG_STRING:
+      v->type = yajl_t_string;
+      return get_string (d, &v->u.string);
+
+    case TAG_NUMBER:
+      v->type = yajl_t_number;
+      if (! get_string (d, &v->u.number.r) || ! get (d, &flags, sizeof (flags)))
+        return false;
+      v->u.number.flags = flags;
+      return get (d, &v->u.number.i, sizeof (v->u.number.i)) && get (d, &v->u.number.d, sizeof (v->u.number.d));
+
+    case TAG_OBJECT:
+      v->type = yajl_t_object;
+      if (! get (d, &len, sizeof (len)) || len > d->n_keys || len > d->n_values)
+        return false;
+      v->u.object.len = len;
+      v->u.object.keys = d->keys;
+      v->u.object.values = d->values;
+      d->keys += len;
+      d->n_keys -= len;
+      d->values += len;
+      d->n_values -= len;
+      for (i = 0; i < len; i++)
+        {
+          if (! get_string (d, (char **) &v->u.object.keys[i]))
+            return false;
+          if (! decode_node (d, &v->u.object.values[i], depth + 1))
+            return false;
+        }
+      return true;
+
+    case TAG_ARRAY:
+      v->type = yajl_t_array;
+      if (! get (d, &len, sizeof (len)) || len > d->n_values)
+        return false;
+      v->u.array.len = len;
+      v->u.array.values = d->values;
+      d->values += len;
+      d->n_values -= len;
+      for (i = 0; i < len; i++)
+        {
+          if (! decode_node (d, &v->u.array.values[i], depth + 1))
+            return false;
+        }
+      return true;
+
+    case TAG_TRUE:
+      v->type = yajl_t_true;
+      return true;
+
+    case TAG_FALSE:
+      v->type = yajl_t_false;
+      return true;
+
+    case TAG_NULL:
+      v->type = yajl_t_null;
+      return true;
+
+    default:
+      return false;
+    }
+}
+
+int
+libcrun_config_snapshot_from_memory (const void *data, size_t len, struct libcrun_config_snapshot_s **out,
+                                     libcrun_error_t *err)
+{
+  struct libcrun_config_snapshot_s *snapshot;
+  struct snapshot_header_s header;
+  uint8_t checksum[32];
+  blake3_hasher hasher;
+  struct decoder_s d;
+  const char *payload;
+
+  *out = NULL;
+
+  if (len < sizeof (header))
+    return crun_make_error (err, EINVAL, "config snapshot: file too short");
+
+  memcpy (&header, data, sizeof (header));
+  if (memcmp (header.magic, SNAPSHOT_MAGIC, sizeof (header.magic)) != 0)
+    return crun_make_error (err, EINVAL, "config snapshot: invalid magic");
+
+  if (header.version != LIBCRUN_CONFIG_SNAPSHOT_VERSION || header.byte_order != SNAPSHOT_BYTE_ORDER)
+    return 0;
+
+  payload = (const char *) data + sizeof (header);
+  if (header.payload_len != len - sizeof (header))
+    return crun_make_error (err, EINVAL, "config snapshot: invalid length");
+
+  blake3_hasher_init (&hasher);
+  blake3_hasher_update (&hasher, payload, header.payload_len);
+  blake3_hasher_finalize (&hasher, checksum, sizeof (checksum));
+  if (memcmp (checksum, header.checksum, sizeof (checksum)) != 0)
+    return crun_make_error (err, EINVAL, "config snapshot: checksum mismatch");
+
+  /* Every node, key and value takes at least one byte of the payload.  */
+  if (header.n_nodes == 0 || header.n_nodes > header.payload_len || header.n_keys > header.payload_len
+      || header.n_values > header.payload_len)
+    return crun_make_error (err, EINVAL, "config snapshot: invalid header");
+
+  snapshot = xmalloc0 (sizeof (*snapshot));
+  snapshot->data = xmalloc (header.n_nodes * sizeof (struct yajl_val_s) + header.n_values * sizeof (yajl_val)
+                            + header.n_keys * sizeof (const char *));
+
+  d.p = payload;
+  d.end = payload + header.payload_len;
+  d.nodes = snapshot->data;
+  d.n_nodes = header.n_nodes;
+  d.values = (yajl_val *) (d.nodes + header.n_nodes);
+  d.n_values = header.n_values;
+  d.keys = (const char **) (d.values + header.n_values);
+  d.n_keys = header.n_keys;
+
+  if (! decode_node (&d, &snapshot->tree, 0) || d.p != d.end || d.n_nodes || d.n_values || d.n_keys)
+    {
+      libcrun_config_snapshot_free (snapshot);
+      return crun_make_error (err, EINVAL, "config snapshot: corrupted data");
+    }
+
+  *out = snapshot;
+  return 1;
+}
+
+int
+libcrun_config_snapshot_open (const char *path, struct libcrun_config_snapshot_s **out, libcrun_error_t *err)
+{
+  struct libcrun_mmap_s *mm = NULL;
+  cleanup_close int fd = -1;
+  struct stat st;
+  int ret;
+
+  *out = NULL;
+
+  fd = TEMP_FAILURE_RETRY (open (path, O_RDONLY | O_CLOEXEC));
+  if (UNLIKELY (fd < 0))
+    {
+      if (errno == ENOENT)
+        return 0;
+      return crun_make_error (err, errno, "open `%s`", path);
+    }
+
+  ret = fstat (fd, &st);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "fstat `%s`", path);
+
+  if (st.st_size < (off_t) sizeof (struct snapshot_header_s))
+    return crun_make_error (err, EINVAL, "config snapshot: file `%s` too short", path);
+
+  ret = libcrun_mmap (&mm, NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = libcrun_config_snapshot_from_memory (mm->addr, mm->length, out, err);
+  if (ret <= 0)
+    {
+      libcrun_error_t tmp_err = NULL;
+
+      if (UNLIKELY (libcrun_munmap (mm, &tmp_err) < 0))
+        crun_error_release (&tmp_err);
+      return ret;
+    }
+
+  (*out)->mmap = mm;
+  return 1;
+}
+
+yajl_val
+libcrun_config_snapshot_tree (struct libcrun_config_snapshot_s *snapshot)
+{
+  return snapshot->tree;
+}
+
+void
+libcrun_config_snapshot_free (struct libcrun_config_snapshot_s *snapshot)
+{
+  if (snapshot == NULL)
+    return;
+
+  if (snapshot->mmap)
+    {
+      libcrun_error_t tmp_err = NULL;
+
+      if (UNLIKELY (libcrun_munmap (snapshot->mmap, &tmp_err) < 0))
+        crun_error_release (&tmp_err);
+    }
+
+  free (snapshot->data);
+  free (snapshot);
+}
@@ -0,0 +1,57 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONFIG_SNAPSHOT_H
+#define CONFIG_SNAPSHOT_H
+
+#include <config.h>
+#include <stddef.h>
+#include <yajl/yajl_tree.h>
+#include "error.h"
+
+/* A snapshot is a binary encoding of the JSON tree of config.json, stored
+   in the state directory next to it.  It is mapped in memory and turned
+   back into a yajl tree without tokenizing anything: the strings point
+   directly into the mapping.  */
+
+#define LIBCRUN_CONFIG_SNAPSHOT_VERSION 1
+
+struct libcrun_config_snapshot_s;
+
+/* Encode TREE in *OUT.  */
+int libcrun_config_snapshot_encode (yajl_val tree, char **out, size_t *out_len, libcrun_error_t *err);
+
+/* Map the snapshot stored at PATH.
+   Returns:
+   < 0 in case of errors
+   == 0 if there is no snapshot, or it was written by a different version
+   == 1 if the snapshot is loaded in *OUT.  */
+int libcrun_config_snapshot_open (const char *path, struct libcrun_config_snapshot_s **out, libcrun_error_t *err);
+
+/* Same as libcrun_config_snapshot_open for a snapshot in memory.  DATA must
+   outlive the snapshot.  */
+int libcrun_config_snapshot_from_memory (const void *data, size_t len, struct libcrun_config_snapshot_s **out,
+                                         libcrun_error_t *err);
+
+/* The decoded tree, valid until the snapshot is freed.  It must not be
+   released with yajl_tree_free.  */
+yajl_val libcrun_config_snapshot_tree (struct libcrun_config_snapshot_s *snapshot);
+
+void libcrun_config_snapshot_free (struct libcrun_config_snapshot_s *snapshot);
+
+#endif
@@ -30,6 +30,11 @@
 #include "scheduler.h"
 #include "seccomp_notify.h"
 #include "custom-handler.h"
+#include "trace.h"
+#include "psi.h"
+#include "spawn.h"
+#include "task_graph.h"
+#include "syscalls.h"
 #include <stdbool.h>
 #include <argp.h>
 #include <unistd.h>
@@ -46,9 +51,12 @@
 #include "io_priority.h"
 #include "cgroup.h"
 #include "cgroup-utils.h"
+#include "cgroup-systemd.h"
 #include <sys/prctl.h>
+#include <sys/mman.h>
 #include <sys/signalfd.h>
 #include <sys/epoll.h>
+#include <poll.h>
 #include <sys/socket.h>
 #ifdef HAVE_CAP
 #  include <sys/capability.h>
@@ -105,6 +113,37 @@ struct sync_socket_message_s
 
 typedef runtime_spec_schema_defs_hook hook;
 
+/* Output handler of the calling thread before an operation on a context
+   started, restored when the operation is done.  */
+struct context_logging_s
+{
+  crun_output_handler handler;
+  void *arg;
+};
+
+static inline void
+cleanup_context_loggingp (struct context_logging_s *logging)
+{
+  crun_set_thread_output_handler (logging->handler, logging->arg);
+}
+
+#define cleanup_context_logging __attribute__ ((cleanup (cleanup_context_loggingp)))
+
+/* Send the messages of the operation running on the calling thread to the
+   output handler of CONTEXT, so that different contexts can be used at the
+   same time from different threads.  */
+static struct context_logging_s
+enter_context_logging (libcrun_context_t *context)
+{
+  struct context_logging_s prev;
+
+  crun_get_thread_output_handler (&prev.handler, &prev.arg);
+  if (context && context->output_handler)
+    crun_set_thread_output_handler (context->output_handler, context->output_handler_arg);
+
+  return prev;
+}
+
 // linux hooks
 char *hooks[] = {
   "prestart",
@@ -480,8 +519,10 @@ is_memory_limit_too_low (runtime_spec_schema_config_schema *def)
   return false;
 }
 
+/* Wait for a sync message.  If VALUE is not NULL, it is set to the value
+   carried by the message.  */
 static int
-sync_socket_wait_sync (libcrun_context_t *context, int fd, bool flush, libcrun_error_t *err)
+sync_socket_wait_sync_with_value (libcrun_context_t *context, int fd, bool flush, int *value, libcrun_error_t *err)
 {
   struct sync_socket_message_s msg;
 
@@ -509,7 +550,12 @@ sync_socket_wait_sync (libcrun_context_t *context, int fd, bool flush, libcrun_e
         }
 
       if (! flush && msg.type == SYNC_SOCKET_SYNC_MESSAGE)
-        return 0;
+        {
+          libcrun_trace_counter_add (LIBCRUN_TRACE_SYNC_SOCKET_MESSAGES, 1);
+          if (value)
+            *value = msg.error_value;
+          return 0;
+        }
       else if (msg.type == SYNC_SOCKET_DEBUG_MESSAGE)
         {
           if (context)
@@ -528,17 +574,28 @@ sync_socket_wait_sync (libcrun_context_t *context, int fd, bool flush, libcrun_e
 }
 
 static int
-sync_socket_send_sync (int fd, bool flush_errors, libcrun_error_t *err)
+sync_socket_wait_sync (libcrun_context_t *context, int fd, bool flush, libcrun_error_t *err)
+{
+  return sync_socket_wait_sync_with_value (context, fd, flush, NULL, err);
+}
+
+/* Send a sync message carrying VALUE, so that data needed by the other end
+   does not require a separate message.  */
+static int
+sync_socket_send_sync_with_value (int fd, bool flush_errors, int value, libcrun_error_t *err)
 {
   int ret;
   struct sync_socket_message_s msg = {
     0,
   };
   msg.type = SYNC_SOCKET_SYNC_MESSAGE;
+  msg.error_value = value;
 
   if (fd < 0)
     return 0;
 
+  libcrun_trace_counter_add (LIBCRUN_TRACE_SYNC_SOCKET_MESSAGES, 1);
+
   ret = TEMP_FAILURE_RETRY (write (fd, &msg, SYNC_SOCKET_MESSAGE_LEN (msg, 0)));
   if (UNLIKELY (ret < 0))
     {
@@ -556,6 +613,12 @@ sync_socket_send_sync (int fd, bool flush_errors, libcrun_error_t *err)
   return 0;
 }
 
+static int
+sync_socket_send_sync (int fd, bool flush_errors, libcrun_error_t *err)
+{
+  return sync_socket_send_sync_with_value (fd, flush_errors, 0, err);
+}
+
 static libcrun_container_t *
 make_container (runtime_spec_schema_config_schema *container_def, const char *path, const char *config)
 {
@@ -576,18 +639,49 @@ make_container (runtime_spec_schema_config_schema *container_def, const char *pa
   return container;
 }
 
+/* Parse JSON and build the definition from the tree, the same as
+   runtime_spec_schema_config_schema_parse_data does, but keep the tree in
+   *TREE.  */
+static runtime_spec_schema_config_schema *
+parse_container_def (const char *json, yajl_val *tree, char **oci_error)
+{
+  struct parser_context ctx = { 0, stderr };
+  runtime_spec_schema_config_schema *container_def;
+  char errbuf[1024];
+
+  *tree = yajl_tree_parse (json, errbuf, sizeof (errbuf));
+  if (*tree == NULL)
+    {
+      xasprintf (oci_error, "cannot parse the data: %s", errbuf);
+      return NULL;
+    }
+
+  container_def = make_runtime_spec_schema_config_schema (*tree, &ctx, oci_error);
+  if (container_def == NULL)
+    {
+      yajl_tree_free (*tree);
+      *tree = NULL;
+    }
+  return container_def;
+}
+
 libcrun_container_t *
 libcrun_container_load_from_memory (const char *json, libcrun_error_t *err)
 {
   runtime_spec_schema_config_schema *container_def;
   cleanup_free char *oci_error = NULL;
-  container_def = runtime_spec_schema_config_schema_parse_data (json, NULL, &oci_error);
+  libcrun_container_t *container;
+  yajl_val tree;
+
+  container_def = parse_container_def (json, &tree, &oci_error);
   if (container_def == NULL)
     {
       crun_make_error (err, 0, "load: `%s`", oci_error);
       return NULL;
     }
-  return make_container (container_def, NULL, json);
+  container = make_container (container_def, NULL, json);
+  container->config_tree = tree;
+  return container;
 }
 
 libcrun_container_t *
@@ -595,14 +689,135 @@ libcrun_container_load_from_file (const char *path, libcrun_error_t *err)
 {
   runtime_spec_schema_config_schema *container_def;
   cleanup_free char *oci_error = NULL;
+  cleanup_free char *content = NULL;
+  libcrun_container_t *container;
+  yajl_val tree;
+  size_t len;
+  int ret;
+
   libcrun_debug ("Loading container from config file: `%s`", path);
-  container_def = runtime_spec_schema_config_schema_parse_file (path, NULL, &oci_error);
+
+  /* Keep the content, so it is not read again when it is copied to the
+     state directory or passed to a handler.  */
+  ret = read_all_file (path, &content, &len, err);
+  if (UNLIKELY (ret < 0))
+    return NULL;
+
+  container_def = parse_container_def (content, &tree, &oci_error);
   if (container_def == NULL)
     {
       crun_make_error (err, 0, "load `%s`: %s", path, oci_error);
       return NULL;
     }
-  return make_container (container_def, path, NULL);
+  container = make_container (container_def, path, content);
+  container->config_tree = tree;
+  return container;
+}
+
+static libcrun_container_t *
+load_lazy (const char *json, size_t len, const char *path, libcrun_error_t *err)
+{
+  runtime_spec_schema_config_schema *container_def;
+  struct libcrun_lazy_config_s *lazy;
+  libcrun_container_t *container;
+  int ret;
+
+  /* The sections are loaded later from the copy made by make_container,
+     which stops at the first NUL byte.  */
+  if (UNLIKELY (strlen (json) != len))
+    {
+      crun_make_error (err, 0, "load: unexpected NUL byte in the configuration");
+      if (path)
+        crun_error_wrap (err, "load `%s`", path);
+      return NULL;
+    }
+
+  ret = libcrun_lazy_config_new (json, len, &container_def, &lazy, err);
+  if (UNLIKELY (ret < 0))
+    {
+      if (path)
+        crun_error_wrap (err, "load `%s`", path);
+      return NULL;
+    }
+
+  container = make_container (container_def, path, json);
+  container->lazy_config = lazy;
+  return container;
+}
+
+libcrun_container_t *
+libcrun_container_load_lazy_from_memory (const char *json, libcrun_error_t *err)
+{
+  return load_lazy (json, strlen (json), NULL, err);
+}
+
+libcrun_container_t *
+libcrun_container_load_lazy_from_file (const char *path, libcrun_error_t *err)
+{
+  cleanup_free char *content = NULL;
+  size_t len;
+  int ret;
+
+  libcrun_debug ("Loading container lazily from config file: `%s`", path);
+
+  ret = read_all_file (path, &content, &len, err);
+  if (UNLIKELY (ret < 0))
+    return NULL;
+
+  return load_lazy (content, len, path, err);
+}
+
+int
+libcrun_container_load_sections (libcrun_container_t *container, unsigned int sections, libcrun_error_t *err)
+{
+  return libcrun_lazy_config_load (container->lazy_config, container->config_file_content, container->container_def,
+                                   sections, err);
+}
+
+/* Load the configuration stored in the state directory DIR.  The snapshot
+   written at creation time is used when it is valid, otherwise
+   config.json is indexed as libcrun_container_load_lazy_from_file does.  */
+static libcrun_container_t *
+load_lazy_from_state (const char *dir, libcrun_error_t *err)
+{
+  struct libcrun_config_snapshot_s *snapshot = NULL;
+  runtime_spec_schema_config_schema *container_def;
+  cleanup_free char *snapshot_file = NULL;
+  cleanup_free char *config_file = NULL;
+  struct libcrun_lazy_config_s *lazy;
+  libcrun_container_t *container;
+  libcrun_error_t tmp_err = NULL;
+  int ret;
+
+  ret = append_paths (&config_file, err, dir, "config.json", NULL);
+  if (UNLIKELY (ret < 0))
+    return NULL;
+
+  ret = append_paths (&snapshot_file, err, dir, "config.snapshot", NULL);
+  if (UNLIKELY (ret < 0))
+    return NULL;
+
+  ret = libcrun_config_snapshot_open (snapshot_file, &snapshot, &tmp_err);
+  if (ret > 0)
+    {
+      libcrun_debug ("Loading container from config snapshot: `%s`", snapshot_file);
+
+      /* The lazy configuration owns the snapshot.  */
+      ret = libcrun_lazy_config_new_from_snapshot (snapshot, &container_def, &lazy, &tmp_err);
+      if (LIKELY (ret == 0))
+        {
+          container = make_container (container_def, config_file, NULL);
+          container->lazy_config = lazy;
+          return container;
+        }
+    }
+  if (ret < 0)
+    {
+      libcrun_debug ("Ignoring the config snapshot `%s`: %s", snapshot_file, tmp_err->msg);
+      crun_error_release (&tmp_err);
+    }
+
+  return libcrun_container_load_lazy_from_file (config_file, err);
 }
 
 void
@@ -618,6 +833,10 @@ libcrun_container_free (libcrun_container_t *ctr)
     free_runtime_spec_schema_config_schema (ctr->container_def);
 
   free_string_map (ctr->annotations);
+  libcrun_lazy_config_free (ctr->lazy_config);
+
+  if (ctr->config_tree)
+    yajl_tree_free (ctr->config_tree);
 
   if (ctr->proc_fd >= 0)
     close (ctr->proc_fd);
@@ -806,6 +1025,7 @@ do_hooks (runtime_spec_schema_config_schema *def, pid_t pid, const char *id, boo
   for (i = 0; i < hooks_len; i++)
     {
       char **env = environ;
+      int64_t timeout_ms;
 
       if (hooks[i]->env)
         env = hooks[i]->env;
@@ -817,8 +1037,10 @@ do_hooks (runtime_spec_schema_config_schema *def, pid_t pid, const char *id, boo
           error_created = false;
         }
 
-      ret = run_process_with_stdin_timeout_envp (hooks[i]->path, hooks[i]->args, cwd, hooks[i]->timeout, env,
-                                                 stdin, stdin_len, out_fd, err_fd, err);
+      timeout_ms = hooks[i]->timeout > 0 ? (int64_t) hooks[i]->timeout * 1000 : -1;
+
+      ret = libcrun_spawn_run (hooks[i]->path, hooks[i]->args, cwd, timeout_ms, env, stdin, stdin_len, out_fd,
+                               err_fd, err);
       if (UNLIKELY (ret < 0))
         error_created = true;
 
@@ -1306,7 +1528,7 @@ apply_security_settings (struct container_entrypoint_s *entrypoint_args, runtime
 }
 
 static int
-container_init_setup (void *args, pid_t own_pid, char *notify_socket,
+container_init_setup (void *args, pid_t *own_pid, char *notify_socket,
                       int sync_socket, char **exec_path, libcrun_error_t *err)
 {
   struct container_entrypoint_s *entrypoint_args = args;
@@ -1335,8 +1557,8 @@ container_init_setup (void *args, pid_t own_pid, char *notify_socket,
   if (UNLIKELY (ret < 0))
     return ret;
 
-  /* sync 1.  */
-  ret = sync_socket_wait_sync (NULL, sync_socket, false, err);
+  /* sync 1.  It carries the container PID as seen from the host.  */
+  ret = sync_socket_wait_sync_with_value (NULL, sync_socket, false, own_pid, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
@@ -1455,7 +1677,7 @@ container_init_setup (void *args, pid_t own_pid, char *notify_socket,
   if (def->process && def->process->user)
     umask (def->process->user->umask_present ? def->process->user->umask : 0022);
 
-  ret = apply_security_settings (entrypoint_args, def, container, own_pid, err);
+  ret = apply_security_settings (entrypoint_args, def, container, *own_pid, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
@@ -1495,7 +1717,7 @@ open_hooks_output (libcrun_container_t *container, int *out_fd, int *err_fd, lib
   *err_fd = *out_fd = -1;
 
   libcrun_debug ("Opening hooks output");
-  annotation = find_annotation (container, "run.oci.hooks.stdout");
+  annotation = find_known_annotation (container, ANNOTATION_HOOKS_STDOUT);
   if (annotation)
     {
       libcrun_debug ("Found `run.oci.hooks.stdout` annotation");
@@ -1504,7 +1726,7 @@ open_hooks_output (libcrun_container_t *container, int *out_fd, int *err_fd, lib
         return crun_make_error (err, errno, "open `%s`", annotation);
     }
 
-  annotation = find_annotation (container, "run.oci.hooks.stderr");
+  annotation = find_known_annotation (container, ANNOTATION_HOOKS_STDERR);
   if (annotation)
     {
       libcrun_debug ("Found `run.oci.hooks.stderr` annotation");
@@ -1548,6 +1770,186 @@ rewrite_argv (char **argv, int argc, const char *name, char **args, size_t args_
   memcpy (argv[0], new_argv, so_far);
 }
 
+/* Marker written as first byte to the exec fifo when the process to run
+   in a zygote container is specified at start time.  */
+#define ZYGOTE_PROCESS_MARKER 'p'
+
+/* A zygote container is created with the `run.oci.zygote` annotation.  It
+   is frozen once it is ready, and the process to execute can be specified
+   when it is started.  */
+static bool
+is_zygote (libcrun_container_t *container)
+{
+  const char *annotation = find_known_annotation (container, ANNOTATION_ZYGOTE);
+
+  return annotation && strcmp (annotation, "0") != 0;
+}
+
+/* Serialize the args, env and cwd of PROCESS.  The format is the marker,
+   the number of args and env entries as uint32_t, then the cwd, the args
+   and the env as NUL terminated strings.  */
+static char *
+serialize_zygote_process (runtime_spec_schema_config_schema_process *process, size_t *len)
+{
+  uint32_t counts[2] = { process->args_len, process->env_len };
+  const char *cwd = process->cwd ? process->cwd : "";
+  size_t i, size, off;
+  char *buffer;
+
+  size = 1 + sizeof (counts) + strlen (cwd) + 1;
+  for (i = 0; i < process->args_len; i++)
+    size += strlen (process->args[i]) + 1;
+  for (i = 0; i < process->env_len; i++)
+    size += strlen (process->env[i]) + 1;
+
+  buffer = xmalloc (size);
+  buffer[0] = ZYGOTE_PROCESS_MARKER;
+  memcpy (buffer + 1, counts, sizeof (counts));
+  off = 1 + sizeof (counts);
+
+#define APPEND_STRING(s)                     \
+  do                                         \
+    {                                        \
+      size_t l = strlen (s) + 1;             \
+      memcpy (buffer + off, s, l);           \
+      off += l;                              \
+  } while (0)
+
+  APPEND_STRING (cwd);
+  for (i = 0; i < process->args_len; i++)
+    APPEND_STRING (process->args[i]);
+  for (i = 0; i < process->env_len; i++)
+    APPEND_STRING (process->env[i]);
+#undef APPEND_STRING
+
+  *len = size;
+  return buffer;
+}
+
+static int
+read_exec_fifo_payload (int fd, char **out, size_t *out_len, libcrun_error_t *err)
+{
+  cleanup_free char *buffer = NULL;
+  size_t allocated = 0, len = 0;
+  fd_set read_set;
+  int ret;
+
+  /* The fifo is not blocking.  Read until the writer closes it.  */
+  while (1)
+    {
+      if (len == allocated)
+        {
+          allocated += 4096;
+          buffer = xrealloc (buffer, allocated);
+        }
+
+      ret = TEMP_FAILURE_RETRY (read (fd, buffer + len, allocated - len));
+      if (ret == 0)
+        break;
+      if (ret > 0)
+        {
+          len += ret;
+          continue;
+        }
+      if (UNLIKELY (errno != EAGAIN))
+        return crun_make_error (err, errno, "read from the exec fifo");
+
+      FD_ZERO (&read_set);
+      FD_SET (fd, &read_set);
+      ret = select (fd + 1, &read_set, NULL, NULL, NULL);
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "select");
+    }
+
+  *out_len = len;
+  *out = buffer;
+  buffer = NULL;
+  return 0;
+}
+
+/* Read the process specified for the zygote from FD and apply it to the
+   container process: the args replace the configured ones, the env
+   entries are added to the environment and the cwd, if not empty, is the
+   new working directory.  */
+static int
+apply_zygote_process (struct container_entrypoint_s *entrypoint_args, int fd, char **exec_path,
+                      libcrun_error_t *err)
+{
+  runtime_spec_schema_config_schema *def = entrypoint_args->container->container_def;
+  cleanup_free char *buffer = NULL;
+  uint32_t counts[2];
+  char **strings;
+  size_t len, i, n, off;
+  int ret;
+
+  ret = read_exec_fifo_payload (fd, &buffer, &len, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (UNLIKELY (len < sizeof (counts) + 1 || buffer[len - 1] != '\0'))
+    return crun_make_error (err, 0, "invalid process received from the exec fifo");
+
+  memcpy (counts, buffer, sizeof (counts));
+  n = (size_t) counts[0] + counts[1] + 1;
+  if (UNLIKELY (n > len))
+    return crun_make_error (err, 0, "invalid process received from the exec fifo");
+
+  strings = xmalloc0 (sizeof (char *) * n);
+  for (i = 0, off = sizeof (counts); i < n; i++)
+    {
+      if (UNLIKELY (off >= len))
+        {
+          free (strings);
+          return crun_make_error (err, 0, "invalid process received from the exec fifo");
+        }
+      strings[i] = buffer + off;
+      off += strlen (buffer + off) + 1;
+    }
+
+  for (i = 0; i < counts[1]; i++)
+    if (UNLIKELY (putenv (xstrdup (strings[1 + counts[0] + i])) < 0))
+      {
+        free (strings);
+        return crun_make_error (err, errno, "putenv `%s`", strings[1 + counts[0] + i]);
+      }
+
+  if (strings[0][0] != '\0')
+    {
+      ret = libcrun_safe_chdir (strings[0], err);
+      if (UNLIKELY (ret < 0))
+        {
+          free (strings);
+          return ret;
+        }
+      free (def->process->cwd);
+      def->process->cwd = xstrdup (strings[0]);
+    }
+
+  if (counts[0] > 0)
+    {
+      for (i = 0; i < def->process->args_len; i++)
+        free (def->process->args[i]);
+      free (def->process->args);
+
+      def->process->args = xmalloc0 (sizeof (char *) * (counts[0] + 1));
+      for (i = 0; i < counts[0]; i++)
+        def->process->args[i] = xstrdup (strings[1 + i]);
+      def->process->args_len = counts[0];
+
+      free (*exec_path);
+      *exec_path = NULL;
+      ret = find_executable (exec_path, def->process->args[0], def->process->cwd, err);
+      if (UNLIKELY (ret < 0))
+        {
+          free (strings);
+          return ret;
+        }
+    }
+
+  free (strings);
+  return 0;
+}
+
 /* Entrypoint to the container.  */
 static int
 container_init (void *args, char *notify_socket, int sync_socket, libcrun_error_t *err)
@@ -1563,16 +1965,7 @@ container_init (void *args, char *notify_socket, int sync_socket, libcrun_error_
 
   crun_set_output_handler (log_write_to_sync_socket, args);
 
-  /* sync receive own pid.  */
-  ret = TEMP_FAILURE_RETRY (read (sync_socket, &own_pid, sizeof (own_pid)));
-  if (UNLIKELY (ret != sizeof (own_pid)))
-    {
-      if (ret >= 0)
-        errno = 0;
-      return crun_make_error (err, errno, "read from sync socket");
-    }
-
-  ret = container_init_setup (args, own_pid, notify_socket, sync_socket, &exec_path, err);
+  ret = container_init_setup (args, &own_pid, notify_socket, sync_socket, &exec_path, err);
   if (UNLIKELY (ret < 0))
     {
       /* If it fails to write the error using the sync socket, then fallback
@@ -1620,6 +2013,13 @@ container_init (void *args, char *notify_socket, int sync_socket, libcrun_error_
             return crun_make_error (err, errno, "read from the exec fifo");
       } while (ret == 0);
 
+      if (buffer[0] == ZYGOTE_PROCESS_MARKER)
+        {
+          ret = apply_zygote_process (entrypoint_args, fd, &exec_path, err);
+          if (UNLIKELY (ret < 0))
+            return ret;
+        }
+
       close_and_reset (&entrypoint_args->context->fifo_exec_wait_fd);
     }
 
@@ -1733,11 +2133,13 @@ container_init (void *args, char *notify_socket, int sync_socket, libcrun_error_
   return crun_make_error (err, errno, "exec container process `%s`", exec_path);
 }
 
+/* Load the configuration of a created container.  Only the LIBCRUN_CONFIG_*
+   SECTIONS are parsed now, the others are parsed by
+   libcrun_container_load_sections.  */
 static int
 read_container_config_from_state (libcrun_container_t **container, const char *state_root, const char *id,
-                                  libcrun_error_t *err)
+                                  unsigned int sections, libcrun_error_t *err)
 {
-  cleanup_free char *config_file = NULL;
   cleanup_free char *dir = NULL;
   int ret;
 
@@ -1747,15 +2149,11 @@ read_container_config_from_state (libcrun_container_t **container, const char *s
   if (UNLIKELY (ret < 0))
     return ret;
 
-  ret = append_paths (&config_file, err, dir, "config.json", NULL);
-  if (UNLIKELY (ret < 0))
-    return ret;
-
-  *container = libcrun_container_load_from_file (config_file, err);
+  *container = load_lazy_from_state (dir, err);
   if (*container == NULL)
     return -1;
 
-  return 0;
+  return libcrun_container_load_sections (*container, sections, err);
 }
 
 static int
@@ -1769,7 +2167,7 @@ run_poststop_hooks (libcrun_context_t *context, libcrun_container_t *container,
     {
       if (container == NULL)
         {
-          ret = read_container_config_from_state (&container_cleanup, state_root, id, err);
+          ret = read_container_config_from_state (&container_cleanup, state_root, id, 0, err);
           if (UNLIKELY (ret < 0))
             return ret;
           container = container_cleanup;
@@ -1785,7 +2183,7 @@ run_poststop_hooks (libcrun_context_t *context, libcrun_container_t *container,
 
       if (container == NULL)
         {
-          ret = read_container_config_from_state (&container_cleanup, state_root, id, err);
+          ret = read_container_config_from_state (&container_cleanup, state_root, id, 0, err);
           if (UNLIKELY (ret < 0))
             return ret;
           container = container_cleanup;
@@ -1823,6 +2221,7 @@ static int
 container_delete_internal (libcrun_context_t *context, runtime_spec_schema_config_schema *def,
                            const char *id, bool force, bool killall, libcrun_error_t *err)
 {
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
   cleanup_cgroup_status struct libcrun_cgroup_status *cgroup_status = NULL;
   cleanup_container_status libcrun_container_status_t status = {};
   cleanup_container libcrun_container_t *container = NULL;
@@ -1867,7 +2266,8 @@ container_delete_internal (libcrun_context_t *context, runtime_spec_schema_confi
 
   if (def == NULL)
     {
-      ret = read_container_config_from_state (&container, state_root, id, err);
+      /* Only the namespaces and the intel RDT configuration are needed.  */
+      ret = read_container_config_from_state (&container, state_root, id, LIBCRUN_CONFIG_LINUX, err);
       if (UNLIKELY (ret < 0))
         return ret;
 
@@ -1933,6 +2333,7 @@ libcrun_container_delete (libcrun_context_t *context, runtime_spec_schema_config
 int
 libcrun_container_kill (libcrun_context_t *context, const char *id, const char *signal, libcrun_error_t *err)
 {
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
   int sig, ret;
   const char *state_root = context->state_root;
   cleanup_container_status libcrun_container_status_t status = {};
@@ -1951,6 +2352,7 @@ libcrun_container_kill (libcrun_context_t *context, const char *id, const char *
 int
 libcrun_container_killall (libcrun_context_t *context, const char *id, const char *signal, libcrun_error_t *err)
 {
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
   int sig, ret;
   const char *state_root = context->state_root;
   cleanup_container_status libcrun_container_status_t status = {};
@@ -2100,8 +2502,39 @@ struct wait_for_process_args
   int *container_ready_fd;
   int seccomp_notify_fd;
   const char *seccomp_notify_plugins;
+  /* Used for the PSI triggers, NULL when not running a new container.  */
+  libcrun_container_t *container;
+  struct libcrun_cgroup_status *cgroup_status;
 };
 
+/* Upper limit for the run.oci.stdio_buffer_size annotation.  */
+#define STDIO_BUFFER_SIZE_MAX (64 * 1024 * 1024)
+
+static int
+get_stdio_buffer_size (libcrun_container_t *container, size_t *size, libcrun_error_t *err)
+{
+  unsigned long long value;
+  const char *annotation;
+  char *endptr = NULL;
+
+  *size = BUFSIZ;
+
+  if (container == NULL)
+    return 0;
+
+  annotation = find_known_annotation (container, ANNOTATION_STDIO_BUFFER_SIZE);
+  if (annotation == NULL)
+    return 0;
+
+  errno = 0;
+  value = strtoull (annotation, &endptr, 10);
+  if (errno != 0 || endptr == annotation || *endptr != '\0' || value == 0 || value > STDIO_BUFFER_SIZE_MAX)
+    return crun_make_error (err, 0, "invalid value for `run.oci.stdio_buffer_size`: `%s`", annotation);
+
+  *size = value;
+  return 0;
+}
+
 static int
 wait_for_process (struct wait_for_process_args *args, libcrun_error_t *err)
 {
@@ -2121,6 +2554,7 @@ wait_for_process (struct wait_for_process_args *args, libcrun_error_t *err)
   size_t i;
 
   cleanup_seccomp_notify_context struct seccomp_notify_context_s *seccomp_notify_ctx = NULL;
+  cleanup_psi_triggers struct libcrun_psi_triggers_s *psi_triggers = NULL;
 
   container_exit_code = 0;
 
@@ -2217,6 +2651,7 @@ wait_for_process (struct wait_for_process_args *args, libcrun_error_t *err)
         return crun_make_error (err, errno, "dup terminal fd");
 
       int i, non_blocking_fds[] = { terminal_fd_from, terminal_fd_to, 0, 1, -1 };
+      size_t buffer_size;
       for (i = 0; non_blocking_fds[i] >= 0; i++)
         {
           ret = set_blocking_fd (non_blocking_fds[i], false, err);
@@ -2224,8 +2659,12 @@ wait_for_process (struct wait_for_process_args *args, libcrun_error_t *err)
             return ret;
         }
 
-      from_terminal = channel_fd_pair_new (terminal_fd_from, 1, BUFSIZ);
-      to_terminal = channel_fd_pair_new (0, terminal_fd_to, BUFSIZ);
+      ret = get_stdio_buffer_size (args->container, &buffer_size, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      from_terminal = channel_fd_pair_new (terminal_fd_from, 1, buffer_size);
+      to_terminal = channel_fd_pair_new (0, terminal_fd_to, buffer_size);
     }
 
   in_fds[in_fds_len++] = signalfd;
@@ -2244,6 +2683,24 @@ wait_for_process (struct wait_for_process_args *args, libcrun_error_t *err)
   if (UNLIKELY (epollfd < 0))
     return epollfd;
 
+  if (args->container && args->cgroup_status)
+    {
+      libcrun_container_status_t cgroup_info = {};
+
+      ret = libcrun_cgroup_get_status (args->cgroup_status, &cgroup_info, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      ret = libcrun_psi_triggers_new (args->container, args->context->id, cgroup_info.cgroup_path,
+                                      args->context->psi_fd, &psi_triggers, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      ret = libcrun_psi_triggers_register (psi_triggers, epollfd, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
   while (1)
     {
       struct epoll_event events[max_events];
@@ -2321,7 +2778,11 @@ wait_for_process (struct wait_for_process_args *args, libcrun_error_t *err)
             }
           else
             {
-              return crun_make_error (err, 0, "internal error: unknown fd from epoll_wait");
+              ret = libcrun_psi_triggers_handle (psi_triggers, epollfd, events[i].data.fd, events[i].events, err);
+              if (UNLIKELY (ret < 0))
+                return ret;
+              if (ret == 0)
+                return crun_make_error (err, 0, "internal error: unknown fd from epoll_wait");
             }
         }
     }
@@ -2460,7 +2921,7 @@ get_seccomp_receiver_fd (libcrun_container_t *container, int *fd, int *self_rece
   *fd = -1;
   *self_receiver_fd = -1;
 
-  tmp = find_annotation (container, "run.oci.seccomp.plugins");
+  tmp = find_known_annotation (container, ANNOTATION_SECCOMP_PLUGINS);
   if (tmp)
     {
       int fds[2];
@@ -2479,7 +2940,7 @@ get_seccomp_receiver_fd (libcrun_container_t *container, int *fd, int *self_rece
   if (def && def->linux && def->linux->seccomp && def->linux->seccomp->listener_path)
     tmp = def->linux->seccomp->listener_path;
   else
-    tmp = find_annotation (container, "run.oci.seccomp.receiver");
+    tmp = find_known_annotation (container, ANNOTATION_SECCOMP_RECEIVER);
   if (tmp == NULL)
     tmp = getenv ("RUN_OCI_SECCOMP_RECEIVER");
   if (tmp)
@@ -2503,7 +2964,7 @@ has_seccomp_receiver (libcrun_container_t *container)
   if (def && def->linux && def->linux->seccomp && def->linux->seccomp->listener_path)
     return true;
 
-  if (find_annotation (container, "run.oci.seccomp.receiver") != NULL || getenv ("RUN_OCI_SECCOMP_RECEIVER") != NULL)
+  if (find_known_annotation (container, ANNOTATION_SECCOMP_RECEIVER) != NULL || getenv ("RUN_OCI_SECCOMP_RECEIVER") != NULL)
     return true;
 
   return false;
@@ -2585,7 +3046,7 @@ setup_seccomp (libcrun_container_t *container, const char *seccomp_bpf_data,
   runtime_spec_schema_config_schema *def = container->container_def;
   int ret;
 
-  if (find_annotation (container, "run.oci.seccomp.plugins") != NULL && has_seccomp_receiver (container))
+  if (find_known_annotation (container, ANNOTATION_SECCOMP_PLUGINS) != NULL && has_seccomp_receiver (container))
     {
       return crun_make_error (err, 0, "seccomp plugins and seccomp receivers cannot be declared at the same time");
     }
@@ -2596,7 +3057,7 @@ setup_seccomp (libcrun_container_t *container, const char *seccomp_bpf_data,
       const char *annotation;
 
       libcrun_debug ("Initializing seccomp");
-      annotation = find_annotation (container, "run.oci.seccomp_fail_unknown_syscall");
+      annotation = find_known_annotation (container, ANNOTATION_SECCOMP_FAIL_UNKNOWN_SYSCALL);
       if (annotation && strcmp (annotation, "0") != 0)
         seccomp_gen_options = LIBCRUN_SECCOMP_FAIL_UNKNOWN_SYSCALL;
 
@@ -2744,16 +3205,140 @@ terminal_setup (runtime_spec_schema_config_schema *def, libcrun_context_t *conte
   return 0;
 }
 
+/* State shared by the steps that prepare the container before its
+   process is created.  They run as a task graph, each one writes only
+   its own outputs.  */
+struct create_tasks_s
+{
+  libcrun_container_t *container;
+  libcrun_context_t *context;
+  struct container_entrypoint_s *container_args;
+
+  const char *seccomp_bpf_data;
+  struct libcrun_seccomp_gen_ctx_s *seccomp_gen_ctx;
+  int *seccomp_fd;
+  int *own_seccomp_receiver_fd;
+  const char **seccomp_notify_plugins;
+
+  int *console_socket_fd;
+  int *hooks_out_fd;
+  int *hooks_err_fd;
+
+  struct libcrun_cgroup_args *cg;
+  int *cgroup_dirfd;
+  struct libcrun_dirfd_s *cgroup_dirfd_s;
+};
+
 static int
-libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_t *context,
-                                int *container_ready_fd, libcrun_error_t *err)
+create_task_keyring (void *arg, libcrun_error_t *err)
 {
-  runtime_spec_schema_config_schema *def = container->container_def;
-  int ret;
-  pid_t pid;
-  int detach = context->detach;
-  cleanup_cgroup_status struct libcrun_cgroup_status *cgroup_status = NULL;
-  cleanup_close int terminal_fd = -1;
+  struct create_tasks_s *t = arg;
+
+  return setup_container_keyring (t->container, t->context, err);
+}
+
+static int
+create_task_mempolicy (void *arg, libcrun_error_t *err)
+{
+  struct create_tasks_s *t = arg;
+
+  return libcrun_set_mempolicy (t->container->container_def, err);
+}
+
+static int
+create_task_hooks_output (void *arg, libcrun_error_t *err)
+{
+  struct create_tasks_s *t = arg;
+
+  return setup_container_hooks_output (t->container, t->container->container_def, t->container_args, t->hooks_out_fd,
+                                       t->hooks_err_fd, err);
+}
+
+static int
+create_task_seccomp (void *arg, libcrun_error_t *err)
+{
+  struct create_tasks_s *t = arg;
+  int ret;
+
+  ret = setup_seccomp (t->container, t->seccomp_bpf_data, t->seccomp_gen_ctx, t->seccomp_fd, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+  t->container_args->seccomp_fd = *t->seccomp_fd;
+
+  /* The container process waits for the filter after sync 2, generate it
+     now so it is not on the critical path.  */
+  return seccomp_generation (*t->seccomp_fd, t->seccomp_bpf_data, t->seccomp_gen_ctx, err);
+}
+
+static int
+create_task_seccomp_receiver (void *arg, libcrun_error_t *err)
+{
+  struct create_tasks_s *t = arg;
+
+  if (*t->seccomp_fd < 0)
+    return 0;
+
+  return get_seccomp_receiver_fd (t->container, &t->container_args->seccomp_receiver_fd, t->own_seccomp_receiver_fd,
+                                  t->seccomp_notify_plugins, err);
+}
+
+static int
+create_task_console_socket (void *arg, libcrun_error_t *err)
+{
+  struct create_tasks_s *t = arg;
+
+  return setup_console_socket (t->context, t->container->container_def, t->container_args, t->console_socket_fd, err);
+}
+
+static int
+create_task_cgroup (void *arg, libcrun_error_t *err)
+{
+  struct create_tasks_s *t = arg;
+
+  return setup_cgroup_manager (t->context, t->container, t->cg, t->cgroup_dirfd, t->cgroup_dirfd_s, err);
+}
+
+/* Only the seccomp step runs on a helper thread: the filter generation is
+   the slowest step and it changes no per-thread state.  It is not free of
+   side effects: setup_seccomp, through libcrun_open_seccomp_bpf, creates
+   <id>/seccomp.bpf under the state root, or links it from .cache/seccomp,
+   and a newly generated filter is then stored in that cache.  If a later
+   step fails, these files are left for the normal cleanup: seccomp.bpf
+   goes away with the state directory of the container, and the cache
+   entry is a valid filter that the cache eviction removes.  The other
+   steps create files, cgroups and connections, or change per-thread state
+   inherited by the container process, so they run on the main thread, in
+   order, and each one is skipped if the previous one failed.  The cgroup
+   is not created if the seccomp filter cannot be generated.  */
+static int
+run_create_tasks (struct create_tasks_s *t, libcrun_error_t *err)
+{
+  struct libcrun_task_graph_s graph;
+  uint32_t seccomp, prev;
+
+  libcrun_task_graph_init (&graph, "create");
+  seccomp = libcrun_task_graph_add (&graph, "seccomp", create_task_seccomp, t, 0, 0);
+  prev = libcrun_task_graph_add (&graph, "hooks-output", create_task_hooks_output, t, LIBCRUN_TASK_MAIN_THREAD, 0);
+  prev = libcrun_task_graph_add (&graph, "keyring", create_task_keyring, t, LIBCRUN_TASK_MAIN_THREAD, prev);
+  prev = libcrun_task_graph_add (&graph, "mempolicy", create_task_mempolicy, t, LIBCRUN_TASK_MAIN_THREAD, prev);
+  prev = libcrun_task_graph_add (&graph, "console-socket", create_task_console_socket, t, LIBCRUN_TASK_MAIN_THREAD,
+                                 prev);
+  prev = libcrun_task_graph_add (&graph, "cgroup", create_task_cgroup, t, LIBCRUN_TASK_MAIN_THREAD, prev | seccomp);
+  libcrun_task_graph_add (&graph, "seccomp-receiver", create_task_seccomp_receiver, t, LIBCRUN_TASK_MAIN_THREAD, prev);
+
+  return libcrun_task_graph_run (&graph, err);
+}
+
+static int
+libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_t *context,
+                                int *container_ready_fd, libcrun_error_t *err)
+{
+  runtime_spec_schema_config_schema *def = container->container_def;
+  int ret;
+  pid_t pid;
+  int detach = context->detach;
+  cleanup_cgroup_status struct libcrun_cgroup_status *cgroup_status = NULL;
+  cleanup_close int terminal_fd = -1;
   cleanup_terminal void *orig_terminal = NULL;
   cleanup_close int sync_socket = -1;
   cleanup_close int notify_socket = -1;
@@ -2766,6 +3351,7 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
   cleanup_close int own_seccomp_receiver_fd = -1;
   cleanup_close int seccomp_notify_fd = -1;
   const char *seccomp_notify_plugins = NULL;
+  size_t stdio_buffer_size;
   struct libcrun_cgroup_args cg;
   struct container_entrypoint_s container_args = {
     .container = container,
@@ -2780,7 +3366,23 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
   cleanup_close int cgroup_dirfd = -1;
   struct libcrun_dirfd_s cgroup_dirfd_s;
   struct libcrun_seccomp_gen_ctx_s seccomp_gen_ctx;
-  const char *seccomp_bpf_data = find_annotation (container, "run.oci.seccomp_bpf_data");
+  const char *seccomp_bpf_data = find_known_annotation (container, ANNOTATION_SECCOMP_BPF_DATA);
+  struct create_tasks_s create_tasks = {
+    .container = container,
+    .context = context,
+    .container_args = &container_args,
+    .seccomp_bpf_data = seccomp_bpf_data,
+    .seccomp_gen_ctx = &seccomp_gen_ctx,
+    .seccomp_fd = &seccomp_fd,
+    .own_seccomp_receiver_fd = &own_seccomp_receiver_fd,
+    .seccomp_notify_plugins = &seccomp_notify_plugins,
+    .console_socket_fd = &console_socket_fd,
+    .hooks_out_fd = &hooks_out_fd,
+    .hooks_err_fd = &hooks_err_fd,
+    .cg = &cg,
+    .cgroup_dirfd = &cgroup_dirfd,
+    .cgroup_dirfd_s = &cgroup_dirfd_s,
+  };
   int cgroup_mode;
 
   cgroup_mode = libcrun_get_cgroup_mode (err);
@@ -2790,12 +3392,17 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
   if (cgroup_mode != CGROUP_MODE_UNIFIED)
     libcrun_warning ("cgroup v1 is deprecated and will be removed in a future release.  Use cgroup v2");
 
-  ret = setup_container_hooks_output (container, def, &container_args, &hooks_out_fd, &hooks_err_fd, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
+  libcrun_trace_counter_reset (LIBCRUN_TRACE_SYNC_SOCKET_MESSAGES);
 
   container->context = context;
 
+  /* The buffers are allocated only when crun waits for a container with a
+     terminal.  Check the annotation before the container is created, so an
+     invalid value is reported by create and --detach too.  */
+  ret = get_stdio_buffer_size (container, &stdio_buffer_size, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
   if (! detach || context->notify_socket)
     {
       libcrun_debug ("Setting child subreaper");
@@ -2804,45 +3411,17 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
         return crun_make_error (err, errno, "prctl set child subreaper");
     }
 
-  ret = setup_container_keyring (container, context, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
-
   ret = setup_terminal_socket_pair (container, context, &container_args, &socket_pair_0, &socket_pair_1, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
+  /* The signals mask and the umask are inherited by the helper threads.  */
   ret = block_signals (err);
   if (UNLIKELY (ret < 0))
     return ret;
 
   umask (0);
 
-  ret = libcrun_set_mempolicy (def, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
-
-  ret = setup_seccomp (container, seccomp_bpf_data, &seccomp_gen_ctx, &seccomp_fd, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
-  container_args.seccomp_fd = seccomp_fd;
-
-  if (seccomp_fd >= 0)
-    {
-      ret = get_seccomp_receiver_fd (container, &container_args.seccomp_receiver_fd, &own_seccomp_receiver_fd,
-                                     &seccomp_notify_plugins, err);
-      if (UNLIKELY (ret < 0))
-        return ret;
-    }
-
-  ret = setup_console_socket (context, def, &container_args, &console_socket_fd, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
-
-  ret = setup_cgroup_manager (context, container, &cg, &cgroup_dirfd, &cgroup_dirfd_s, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
-
   ret = libcrun_configure_handler (container_args.context->handler_manager,
                                    container_args.context,
                                    container,
@@ -2851,6 +3430,8 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
   if (UNLIKELY (ret < 0))
     return ret;
 
+  /* The handler can change the configuration, do it before it is used
+     by the other steps.  */
   if (container_args.custom_handler && container_args.custom_handler->vtable->modify_oci_configuration)
     {
       libcrun_debug ("Using custom handler to modify OCI configuration");
@@ -2862,6 +3443,12 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
         return ret;
     }
 
+  /* All the helper threads are gone when it returns, the container process
+     is cloned from a single threaded process.  */
+  ret = run_create_tasks (&create_tasks, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
   pid = libcrun_run_linux_container (container, container_init, &container_args, &sync_socket, &cgroup_dirfd_s, err);
   if (UNLIKELY (pid < 0))
     return pid;
@@ -2894,18 +3481,8 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
   if (UNLIKELY (ret < 0))
     goto fail;
 
-  /* sync send own pid.  */
-  ret = TEMP_FAILURE_RETRY (write (sync_socket, &pid, sizeof (pid)));
-  if (UNLIKELY (ret != sizeof (pid)))
-    {
-      if (ret >= 0)
-        errno = 0;
-      crun_make_error (err, errno, "write to sync socket");
-      goto fail;
-    }
-
-  /* sync 1.  */
-  ret = sync_socket_send_sync (sync_socket, true, err);
+  /* sync 1.  Send the container its own PID together with the sync message.  */
+  ret = sync_socket_send_sync_with_value (sync_socket, true, pid, err);
   if (UNLIKELY (ret < 0))
     goto fail;
 
@@ -2941,9 +3518,6 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
         goto fail;
     }
 
-  ret = seccomp_generation (seccomp_fd, seccomp_bpf_data, &seccomp_gen_ctx, err);
-  if (UNLIKELY (ret < 0))
-    goto fail;
   close_and_reset (&seccomp_fd);
 
   /* sync 3.  */
@@ -2969,11 +3543,24 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
       goto fail;
     }
 
+  libcrun_trace ("sync socket: %u messages exchanged to create the container",
+                 libcrun_trace_counter_get (LIBCRUN_TRACE_SYNC_SOCKET_MESSAGES));
+
   libcrun_debug ("Writing container status");
   ret = write_container_status (container, context, pid, cgroup_status, err);
   if (UNLIKELY (ret < 0))
     goto fail;
 
+  /* A zygote is ready to exec the container process, keep it frozen until
+     it is started.  */
+  if (context->fifo_exec_wait_fd >= 0 && cgroup_status && is_zygote (container))
+    {
+      libcrun_debug ("Freezing zygote container");
+      ret = libcrun_cgroup_pause_unpause (cgroup_status, true, err);
+      if (UNLIKELY (ret < 0))
+        goto fail;
+    }
+
   /* Run poststart hooks here only if the container is created using "run".  For create+start, the
      hooks will be executed as part of the start command.  */
   if (context->fifo_exec_wait_fd < 0 && def->hooks && def->hooks->poststart_len)
@@ -3010,6 +3597,8 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
       .container_ready_fd = container_ready_fd,
       .seccomp_notify_fd = seccomp_notify_fd,
       .seccomp_notify_plugins = seccomp_notify_plugins,
+      .container = container,
+      .cgroup_status = cgroup_status,
     };
     ret = wait_for_process (&args, err);
   }
@@ -3049,6 +3638,36 @@ check_config_file (runtime_spec_schema_config_schema *def, libcrun_context_t *co
   return 0;
 }
 
+/* Store the snapshot of the configuration TREE in the state directory
+   DIR, so that the other commands do not need to parse the JSON again.
+   config.json is still the reference, so errors are not fatal.  */
+static void
+write_config_snapshot (const char *dir, yajl_val tree)
+{
+  cleanup_free char *snapshot_file = NULL;
+  cleanup_free char *encoded = NULL;
+  libcrun_error_t tmp_err = NULL;
+  size_t encoded_len;
+  int ret;
+
+  ret = append_paths (&snapshot_file, &tmp_err, dir, "config.snapshot", NULL);
+  if (LIKELY (ret == 0))
+    ret = libcrun_config_snapshot_encode (tree, &encoded, &encoded_len, &tmp_err);
+  if (LIKELY (ret == 0))
+    {
+      libcrun_debug ("Writing config snapshot to: `%s`", snapshot_file);
+      ret = write_file (snapshot_file, encoded, encoded_len, &tmp_err);
+    }
+
+  if (UNLIKELY (ret < 0))
+    {
+      libcrun_debug ("Cannot write the config snapshot: %s", tmp_err->msg);
+      crun_error_release (&tmp_err);
+      if (snapshot_file)
+        unlink (snapshot_file);
+    }
+}
+
 static int
 libcrun_copy_config_file (const char *id, const char *state_root, libcrun_container_t *container, libcrun_error_t *err)
 {
@@ -3069,7 +3688,7 @@ libcrun_copy_config_file (const char *id, const char *state_root, libcrun_contai
   if (container->config_file == NULL && container->config_file_content == NULL)
     return crun_make_error (err, 0, "config file not specified");
 
-  if (container->config_file == NULL)
+  if (container->config_file_content)
     {
       libcrun_debug ("Writing config file to: `%s`", dest_path);
       ret = write_file (dest_path, container->config_file_content, strlen (container->config_file_content), err);
@@ -3089,6 +3708,15 @@ libcrun_copy_config_file (const char *id, const char *state_root, libcrun_contai
         return ret;
     }
 
+  /* Without the tree, e.g. for a container loaded lazily, the other
+     commands read config.json.  */
+  if (container->config_tree)
+    {
+      write_config_snapshot (dir, container->config_tree);
+      yajl_tree_free (container->config_tree);
+      container->config_tree = NULL;
+    }
+
   return 0;
 }
 
@@ -3100,10 +3728,24 @@ force_delete_container_status (libcrun_context_t *context, runtime_spec_schema_c
   crun_error_release (&tmp_err);
 }
 
+/* Terminate the process forked by libcrun_container_run or
+   libcrun_container_create.  When the caller is multithreaded, the locks
+   held by its other threads stay locked in the child, so the atexit
+   handlers and the stdio flush are skipped as run_in_helper_process
+   does.  */
+static void __attribute__ ((noreturn))
+exit_forked_process (bool multithreaded, int status)
+{
+  if (multithreaded)
+    _safe_exit (status);
+  exit (status);
+}
+
 int
 libcrun_container_run (libcrun_context_t *context, libcrun_container_t *container, unsigned int options,
                        libcrun_error_t *err)
 {
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
   runtime_spec_schema_config_schema *def = container->container_def;
   int ret;
   int detach = context->detach;
@@ -3111,6 +3753,7 @@ libcrun_container_run (libcrun_context_t *context, libcrun_container_t *containe
   cleanup_close int pipefd0 = -1;
   cleanup_close int pipefd1 = -1;
   libcrun_error_t tmp_err = NULL;
+  bool multithreaded;
 
   container->context = context;
 
@@ -3125,11 +3768,18 @@ libcrun_container_run (libcrun_context_t *context, libcrun_container_t *containe
   if (def->process && def->process->terminal && detach && context->console_socket == NULL)
     return crun_make_error (err, 0, "use --console-socket with --detach when a terminal is used");
 
+  if (detach && context->psi_fd >= 0)
+    return crun_make_error (err, 0, "the PSI events are not watched with --detach");
+
   ret = libcrun_status_check_directories (context->state_root, context->id, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
-  if (! detach && (options & LIBCRUN_RUN_OPTIONS_PREFORK) == 0)
+  /* The umask, the signal mask and the subreaper setting changed by
+     run_internal are process-wide, so do not change them under the feet
+     of the other threads of the caller.  */
+  multithreaded = libcrun_is_multithreaded ();
+  if (! detach && (options & LIBCRUN_RUN_OPTIONS_PREFORK) == 0 && ! multithreaded)
     {
       ret = libcrun_copy_config_file (context->id, context->state_root, container, err);
       if (UNLIKELY (ret < 0))
@@ -3182,10 +3832,18 @@ libcrun_container_run (libcrun_context_t *context, libcrun_container_t *containe
 
   close_and_reset (&pipefd0);
 
-  /* forked process.  */
-  ret = detach_process ();
-  if (UNLIKELY (ret < 0))
-    libcrun_fail_with_error (errno, "detach process");
+  /* forked process.  It is detached only if it was requested, otherwise it
+     is only a helper process for a multithreaded caller.  */
+  if (detach || (options & LIBCRUN_RUN_OPTIONS_PREFORK))
+    {
+      ret = detach_process ();
+      if (UNLIKELY (ret < 0))
+        {
+          ret = crun_make_error (&tmp_err, errno, "detach process");
+          TEMP_FAILURE_RETRY (write (pipefd1, &ret, sizeof (ret)));
+          goto fail;
+        }
+    }
 
   ret = libcrun_copy_config_file (context->id, context->state_root, container, &tmp_err);
   if (UNLIKELY (ret < 0))
@@ -3196,7 +3854,7 @@ libcrun_container_run (libcrun_context_t *context, libcrun_container_t *containe
   if (UNLIKELY (ret < 0))
     goto fail;
 
-  exit (EXIT_SUCCESS);
+  exit_forked_process (multithreaded, EXIT_SUCCESS);
 fail:
 
   if (! (options & LIBCRUN_RUN_OPTIONS_KEEP))
@@ -3208,19 +3866,21 @@ fail:
       crun_error_release (&tmp_err);
     }
 
-  exit (EXIT_FAILURE);
+  exit_forked_process (multithreaded, EXIT_FAILURE);
 }
 
 int
 libcrun_container_create (libcrun_context_t *context, libcrun_container_t *container, unsigned int options,
                           libcrun_error_t *err)
 {
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
   runtime_spec_schema_config_schema *def = container->container_def;
   int ret;
   int container_ready_pipe[2];
   cleanup_close int pipefd0 = -1;
   cleanup_close int pipefd1 = -1;
   cleanup_close int exec_fifo_fd = -1;
+  bool multithreaded;
   context->detach = 1;
 
   libcrun_debug ("Creating container: `%s`", context->id);
@@ -3248,7 +3908,11 @@ libcrun_container_create (libcrun_context_t *context, libcrun_container_t *conta
   context->fifo_exec_wait_fd = exec_fifo_fd;
   exec_fifo_fd = -1;
 
-  if ((options & LIBCRUN_RUN_OPTIONS_PREFORK) == 0)
+  /* When the caller has other threads, create the container from a helper
+     process so the process-wide state changed by run_internal is not
+     shared with them.  */
+  multithreaded = libcrun_is_multithreaded ();
+  if ((options & LIBCRUN_RUN_OPTIONS_PREFORK) == 0 && ! multithreaded)
     {
       libcrun_debug ("Running with prefork enabled");
       ret = libcrun_copy_config_file (context->id, context->state_root, container, err);
@@ -3293,17 +3957,25 @@ libcrun_container_create (libcrun_context_t *context, libcrun_container_t *conta
       return crun_make_error (err, 0, "error creating container");
     }
 
-  /* forked process.  */
-  ret = detach_process ();
-  if (UNLIKELY (ret < 0))
-    libcrun_fail_with_error (errno, "detach process");
+  /* forked process.  It is detached only with prefork, otherwise it is
+     only a helper process for a multithreaded caller.  */
+  if (options & LIBCRUN_RUN_OPTIONS_PREFORK)
+    {
+      ret = detach_process ();
+      if (UNLIKELY (ret < 0))
+        {
+          libcrun_error (errno, "detach process");
+          exit_forked_process (multithreaded, EXIT_FAILURE);
+        }
+    }
 
   ret = libcrun_copy_config_file (context->id, context->state_root, container, err);
   if (UNLIKELY (ret < 0))
     {
       int errcode = crun_error_get_errno (err);
       crun_error_release (err);
-      libcrun_fail_with_error (errcode, "copy config file");
+      libcrun_error (errcode, "copy config file");
+      exit_forked_process (multithreaded, EXIT_FAILURE);
     }
 
   ret = libcrun_container_run_internal (container, context, &pipefd1, err);
@@ -3317,132 +3989,426 @@ libcrun_container_create (libcrun_context_t *context, libcrun_container_t *conta
 
   if (pipefd1 >= 0)
     TEMP_FAILURE_RETRY (write (pipefd1, &ret, sizeof (ret)));
-  exit (ret ? EXIT_FAILURE : 0);
+  exit_forked_process (multithreaded, ret ? EXIT_FAILURE : 0);
 }
 
-int
-libcrun_container_start (libcrun_context_t *context, const char *id, libcrun_error_t *err)
+struct batch_result_s
 {
-  cleanup_container libcrun_container_t *container = NULL;
-  const char *state_root = context->state_root;
-  runtime_spec_schema_config_schema *def;
-  cleanup_container_status libcrun_container_status_t status = {};
-  cleanup_close int fd = -1;
   int ret;
+  int status;
+  char msg[512];
+};
 
-  ret = libcrun_read_container_status (&status, state_root, id, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
-
-  ret = libcrun_is_container_running (&status, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
+static void __attribute__ ((noreturn))
+create_batch_worker (libcrun_context_t *context, struct libcrun_container_batch_entry_s *entry, unsigned int options,
+                     int result_fd)
+{
+  struct batch_result_s result = {};
+  libcrun_context_t worker_context = *context;
+  libcrun_error_t tmp_err = NULL;
 
-  if (! ret)
-    return crun_make_error (err, 0, "container `%s` is not running", id);
+  worker_context.id = entry->id;
+  worker_context.pid_file = entry->pid_file;
+  if (entry->bundle)
+    worker_context.bundle = entry->bundle;
 
-  ret = read_container_config_from_state (&container, state_root, id, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
+  /* The rootfs and the other relative paths in the config file are
+     resolved from the bundle directory.  */
+  if (entry->bundle && UNLIKELY (chdir (entry->bundle) < 0))
+    result.ret = crun_make_error (&tmp_err, errno, "chdir `%s`", entry->bundle);
+  else
+    result.ret = libcrun_container_create (&worker_context, entry->container, options, &tmp_err);
 
-  if (context->notify_socket)
+  if (result.ret < 0 && tmp_err)
     {
-      ret = get_notify_fd (context, container, &fd, err);
-      if (UNLIKELY (ret < 0))
-        return ret;
+      result.status = tmp_err->status;
+      snprintf (result.msg, sizeof (result.msg), "%s", tmp_err->msg);
+      crun_error_release (&tmp_err);
     }
 
-  ret = libcrun_status_write_exec_fifo (context->state_root, id, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
+  TEMP_FAILURE_RETRY (write (result_fd, &result, sizeof (result)));
+  _safe_exit (result.ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
 
-  def = container->container_def;
+/* How often the workers without a pidfd are checked.  */
+#define CREATE_BATCH_POLL_INTERVAL_MS 10
 
-  if (context->notify_socket)
-    {
-      if (fd >= 0)
-        {
-          fd_set read_set;
+struct batch_worker_s
+{
+  struct libcrun_container_batch_entry_s *entry;
+  pid_t pid;
+  /* -1 if the kernel does not support pidfd_open.  */
+  int pidfd;
+  int result_fd;
+};
 
-          while (1)
-            {
-              struct timeval timeout = {
-                .tv_sec = 0,
-                .tv_usec = 10000,
-              };
-              FD_ZERO (&read_set);
-              FD_SET (fd, &read_set);
+static int
+create_batch_spawn (libcrun_context_t *context, struct libcrun_container_batch_entry_s *entry, unsigned int options,
+                    struct batch_worker_s *worker, libcrun_error_t *err)
+{
+  int fds[2];
+  int ret;
 
-              ret = select (fd + 1, &read_set, NULL, NULL, &timeout);
-              if (UNLIKELY (ret < 0))
-                return crun_make_error (err, errno, "select failed");
-              if (ret)
-                {
-                  ret = handle_notify_socket (fd, err);
-                  if (UNLIKELY (ret < 0))
-                    return ret;
-                  if (ret)
-                    break;
-                }
-              else
-                {
-                  ret = libcrun_is_container_running (&status, err);
-                  if (UNLIKELY (ret < 0))
-                    return ret;
-                  if (! ret)
-                    return 0;
-                }
-            }
-        }
-    }
+  /* The read end is not blocking: the container init process inherits the
+     write end and keeps it open until it is started, so EOF cannot be used
+     to detect a worker that died without reporting its result.  */
+  ret = pipe2 (fds, O_CLOEXEC | O_NONBLOCK);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "pipe");
 
-  /* The container is considered running only after we got the notification from the
-     notify_socket, if any.  */
-  if (def->hooks && def->hooks->poststart_len)
+  ret = fork ();
+  if (UNLIKELY (ret < 0))
     {
-      cleanup_close int hooks_out_fd = -1;
-      cleanup_close int hooks_err_fd = -1;
-
-      ret = open_hooks_output (container, &hooks_out_fd, &hooks_err_fd, err);
-      if (UNLIKELY (ret < 0))
-        return ret;
-
-      ret = do_hooks (def, status.pid, context->id, false, status.bundle, "running", (hook **) def->hooks->poststart,
-                      def->hooks->poststart_len, hooks_out_fd, hooks_err_fd, err);
-      if (UNLIKELY (ret != 0))
-        return ret;
+      int errno_ = errno;
+      TEMP_FAILURE_RETRY (close (fds[0]));
+      TEMP_FAILURE_RETRY (close (fds[1]));
+      return crun_make_error (err, errno_, "fork");
+    }
+  if (ret == 0)
+    {
+      TEMP_FAILURE_RETRY (close (fds[0]));
+      create_batch_worker (context, entry, options, fds[1]);
     }
 
+  TEMP_FAILURE_RETRY (close (fds[1]));
+  worker->entry = entry;
+  worker->pid = ret;
+  worker->result_fd = fds[0];
+  worker->pidfd = syscall_pidfd_open (ret, 0);
   return 0;
 }
 
-int
-libcrun_get_container_state_string (const char *id, libcrun_container_status_t *status, const char *state_root,
-                                    const char **container_status, int *running, libcrun_error_t *err)
+static int
+create_batch_collect (struct batch_worker_s *worker, int wait_status)
 {
-  int ret, has_fifo = 0;
-  bool paused = false;
+  struct libcrun_container_batch_entry_s *entry = worker->entry;
+  struct batch_result_s result;
+  int ret;
 
-  ret = libcrun_is_container_running (status, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
-  *running = ret;
+  ret = TEMP_FAILURE_RETRY (read (worker->result_fd, &result, sizeof (result)));
+  if (UNLIKELY (ret != sizeof (result)))
+    return entry->ret = crun_make_error (&entry->err, 0, "the worker creating `%s` exited without a result (status: %d)",
+                                         entry->id, wait_status);
 
-  if (*running)
+  entry->ret = result.ret;
+  if (result.ret < 0)
     {
-      ret = libcrun_status_has_read_exec_fifo (state_root, id, err);
-      if (UNLIKELY (ret < 0))
-        return ret;
-      has_fifo = ret;
+      result.msg[sizeof (result.msg) - 1] = '\0';
+      return crun_make_error (&entry->err, result.status, "%s", result.msg);
     }
+  return 0;
+}
 
-  if (*running && ! has_fifo)
+/* Wait for any of the N WORKERS to exit and reap it, so that a slow worker
+   does not hold up the others.  Only the workers are waited for, not the
+   other children of the caller.  Returns the index of the reaped worker.  */
+static size_t
+create_batch_wait_any (struct batch_worker_s *workers, struct pollfd *fds, size_t n, int *wait_status)
+{
+  size_t i;
+  int ret;
+
+  while (1)
     {
-      cleanup_cgroup_status struct libcrun_cgroup_status *cgroup_status = NULL;
+      bool need_timer = false;
 
-      cgroup_status = libcrun_cgroup_make_status (status);
+      for (i = 0; i < n; i++)
+        {
+          fds[i].fd = workers[i].pidfd;
+          fds[i].events = POLLIN;
+          fds[i].revents = 0;
+          if (workers[i].pidfd < 0)
+            need_timer = true;
+        }
 
-      ret = libcrun_cgroup_is_container_paused (cgroup_status, &paused, err);
+      ret = poll (fds, n, need_timer ? CREATE_BATCH_POLL_INTERVAL_MS : -1);
+      if (UNLIKELY (ret < 0))
+        {
+          if (errno == EINTR)
+            continue;
+
+          /* Fall back to wait for the oldest worker.  */
+          waitpid_ignore_stopped (workers[0].pid, wait_status, 0);
+          return 0;
+        }
+
+      for (i = 0; i < n; i++)
+        {
+          if (workers[i].pidfd >= 0 && fds[i].revents == 0)
+            continue;
+
+          ret = waitpid_ignore_stopped (workers[i].pid, wait_status, WNOHANG);
+          if (ret != 0)
+            return i;
+
+          /* The pidfd cannot be used to wait for this worker, check it
+             with waitpid from now on.  */
+          close_and_reset (&workers[i].pidfd);
+        }
+    }
+}
+
+int
+libcrun_container_create_batch (libcrun_context_t *context, struct libcrun_container_batch_entry_s *entries,
+                                size_t len, unsigned int max_workers, unsigned int options, libcrun_error_t *err)
+{
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
+  cleanup_free char *run_dir = NULL;
+  cleanup_free struct batch_worker_s *workers = NULL;
+  cleanup_free struct pollfd *fds = NULL;
+  uint64_t start = libcrun_trace_now ();
+  size_t i, j, next = 0, running = 0;
+  int failures = 0;
+  int ret;
+
+  ret = validate_options (options, LIBCRUN_CREATE_OPTIONS_PREFORK, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  for (i = 0; i < len; i++)
+    {
+      if (UNLIKELY (entries[i].id == NULL || entries[i].container == NULL))
+        return crun_make_error (err, EINVAL, "invalid batch entry `%zu`", i);
+
+      for (j = 0; j < i; j++)
+        if (UNLIKELY (strcmp (entries[i].id, entries[j].id) == 0))
+          return crun_make_error (err, EINVAL, "container `%s` specified more than once", entries[i].id);
+
+      entries[i].ret = 0;
+      entries[i].err = NULL;
+    }
+
+  if (max_workers == 0)
+    {
+      long n = sysconf (_SC_NPROCESSORS_ONLN);
+      max_workers = n > 0 ? n : 1;
+    }
+
+  /* Do the work that is common to all the containers only once, so the
+     workers inherit it: the cgroup mode is cached by libcrun_get_cgroup_mode
+     and the state root with the seccomp cache is created here.  */
+  if (! context->force_no_cgroup)
+    {
+      ret = libcrun_get_cgroup_mode (err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  ret = get_run_directory (&run_dir, context->state_root, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (max_workers > len)
+    max_workers = len;
+
+  workers = xmalloc0 (sizeof (*workers) * (max_workers + 1));
+  fds = xmalloc0 (sizeof (*fds) * (max_workers + 1));
+
+  while (next < len || running > 0)
+    {
+      struct batch_worker_s worker;
+      int wait_status = 0;
+
+      while (next < len && running < max_workers)
+        {
+          ret = create_batch_spawn (context, &entries[next], options, &workers[running], &entries[next].err);
+          if (UNLIKELY (ret < 0))
+            {
+              entries[next].ret = ret;
+              failures++;
+            }
+          else
+            running++;
+          next++;
+        }
+
+      if (running == 0)
+        continue;
+
+      i = create_batch_wait_any (workers, fds, running, &wait_status);
+      worker = workers[i];
+      workers[i] = workers[--running];
+
+      ret = create_batch_collect (&worker, wait_status);
+      TEMP_FAILURE_RETRY (close (worker.result_fd));
+      close_and_reset (&worker.pidfd);
+      if (UNLIKELY (ret < 0))
+        {
+          libcrun_debug ("Could not create container `%s`: %s", worker.entry->id, worker.entry->err->msg);
+          failures++;
+        }
+    }
+
+  libcrun_trace ("create batch: %zu containers created by %u workers in %llu us, %d failed", len, max_workers,
+                 (unsigned long long) (libcrun_trace_now () - start) / 1000, failures);
+
+  return failures;
+}
+
+static int
+container_start (libcrun_context_t *context, const char *id, runtime_spec_schema_config_schema_process *process,
+                 libcrun_error_t *err)
+{
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
+  cleanup_container libcrun_container_t *container = NULL;
+  const char *state_root = context->state_root;
+  runtime_spec_schema_config_schema *def;
+  cleanup_container_status libcrun_container_status_t status = {};
+  cleanup_free char *payload = NULL;
+  size_t payload_len = 0;
+  cleanup_close int fd = -1;
+  bool zygote;
+  int ret;
+
+  ret = libcrun_read_container_status (&status, state_root, id, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = libcrun_is_container_running (&status, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (! ret)
+    return crun_make_error (err, 0, "container `%s` is not running", id);
+
+  /* Only the hooks and the annotations are needed.  */
+  ret = read_container_config_from_state (&container, state_root, id, 0, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (context->notify_socket)
+    {
+      ret = get_notify_fd (context, container, &fd, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  zygote = is_zygote (container);
+  if (process)
+    {
+      if (UNLIKELY (! zygote))
+        return crun_make_error (err, 0, "the process can be specified only for a zygote container");
+
+      payload = serialize_zygote_process (process, &payload_len);
+    }
+
+  if (zygote)
+    {
+      ret = libcrun_status_has_read_exec_fifo (state_root, id, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+      if (ret == 0)
+        return crun_make_error (err, 0, "container `%s` was already started", id);
+
+      ret = libcrun_container_unpause_linux (&status, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  ret = libcrun_status_write_exec_fifo_with_payload (context->state_root, id, payload, payload_len, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  def = container->container_def;
+
+  if (context->notify_socket)
+    {
+      if (fd >= 0)
+        {
+          fd_set read_set;
+
+          while (1)
+            {
+              struct timeval timeout = {
+                .tv_sec = 0,
+                .tv_usec = 10000,
+              };
+              FD_ZERO (&read_set);
+              FD_SET (fd, &read_set);
+
+              ret = select (fd + 1, &read_set, NULL, NULL, &timeout);
+              if (UNLIKELY (ret < 0))
+                return crun_make_error (err, errno, "select failed");
+              if (ret)
+                {
+                  ret = handle_notify_socket (fd, err);
+                  if (UNLIKELY (ret < 0))
+                    return ret;
+                  if (ret)
+                    break;
+                }
+              else
+                {
+                  ret = libcrun_is_container_running (&status, err);
+                  if (UNLIKELY (ret < 0))
+                    return ret;
+                  if (! ret)
+                    return 0;
+                }
+            }
+        }
+    }
+
+  /* The container is considered running only after we got the notification from the
+     notify_socket, if any.  */
+  if (def->hooks && def->hooks->poststart_len)
+    {
+      cleanup_close int hooks_out_fd = -1;
+      cleanup_close int hooks_err_fd = -1;
+
+      ret = open_hooks_output (container, &hooks_out_fd, &hooks_err_fd, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      ret = do_hooks (def, status.pid, context->id, false, status.bundle, "running", (hook **) def->hooks->poststart,
+                      def->hooks->poststart_len, hooks_out_fd, hooks_err_fd, err);
+      if (UNLIKELY (ret != 0))
+        return ret;
+    }
+
+  return 0;
+}
+
+int
+libcrun_container_start (libcrun_context_t *context, const char *id, libcrun_error_t *err)
+{
+  return container_start (context, id, NULL, err);
+}
+
+int
+libcrun_container_start_process (libcrun_context_t *context, const char *id,
+                                 runtime_spec_schema_config_schema_process *process, libcrun_error_t *err)
+{
+  return container_start (context, id, process, err);
+}
+
+int
+libcrun_get_container_state_string (const char *id, libcrun_container_status_t *status, const char *state_root,
+                                    const char **container_status, int *running, libcrun_error_t *err)
+{
+  int ret, has_fifo = 0;
+  bool paused = false;
+
+  ret = libcrun_is_container_running (status, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+  *running = ret;
+
+  if (*running)
+    {
+      ret = libcrun_status_has_read_exec_fifo (state_root, id, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+      has_fifo = ret;
+    }
+
+  if (*running && ! has_fifo)
+    {
+      cleanup_cgroup_status struct libcrun_cgroup_status *cgroup_status = NULL;
+
+      cgroup_status = libcrun_cgroup_make_status (status);
+
+      ret = libcrun_cgroup_is_container_paused (cgroup_status, &paused, err);
       if (UNLIKELY (ret < 0))
         {
           /*
@@ -3479,6 +4445,7 @@ libcrun_get_container_state_string (const char *id, libcrun_container_status_t *
 int
 libcrun_container_state (libcrun_context_t *context, const char *id, FILE *out, libcrun_error_t *err)
 {
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
   const char *const OCI_CONFIG_VERSION = "1.0.0";
   libcrun_container_status_t status = {};
   const char *state_root = context->state_root;
@@ -3541,7 +4508,6 @@ libcrun_container_state (libcrun_context_t *context, const char *id, FILE *out,
 
   {
     size_t i;
-    cleanup_free char *config_file = NULL;
     cleanup_container libcrun_container_t *container = NULL;
     cleanup_free char *dir = NULL;
 
@@ -3549,11 +4515,8 @@ libcrun_container_state (libcrun_context_t *context, const char *id, FILE *out,
     if (UNLIKELY (ret < 0))
       goto exit;
 
-    ret = append_paths (&config_file, err, dir, "config.json", NULL);
-    if (UNLIKELY (ret < 0))
-      goto exit;
-
-    container = libcrun_container_load_from_file (config_file, err);
+    /* Only the annotations are needed.  */
+    container = load_lazy_from_state (dir, err);
     if (UNLIKELY (container == NULL))
       {
         ret = -1;
@@ -3848,10 +4811,9 @@ exec_process_entrypoint (libcrun_context_t *context,
   libcrun_fail_with_error (errno, "exec");
 }
 
-int
-libcrun_container_exec_with_options (libcrun_context_t *context, const char *id,
-                                     struct libcrun_container_exec_options_s *opts,
-                                     libcrun_error_t *err)
+static int
+container_exec (libcrun_context_t *context, const char *id, struct libcrun_container_exec_options_s *opts,
+                libcrun_error_t *err)
 {
   cleanup_custom_handler_instance struct custom_handler_instance_s *custom_handler = NULL;
   int container_status, ret;
@@ -3862,7 +4824,6 @@ libcrun_container_exec_with_options (libcrun_context_t *context, const char *id,
   cleanup_close int terminal_fd = -1;
   cleanup_close int seccomp_fd = -1;
   cleanup_terminal void *orig_terminal = NULL;
-  cleanup_free char *config_file = NULL;
   cleanup_container libcrun_container_t *container = NULL;
   cleanup_free char *dir = NULL;
   int container_ret_status[2];
@@ -3890,14 +4851,15 @@ libcrun_container_exec_with_options (libcrun_context_t *context, const char *id,
   if (UNLIKELY (ret < 0))
     return ret;
 
-  ret = append_paths (&config_file, err, dir, "config.json", NULL);
-  if (UNLIKELY (ret < 0))
-    return ret;
-
-  container = libcrun_container_load_from_file (config_file, err);
+  container = load_lazy_from_state (dir, err);
   if (UNLIKELY (container == NULL))
     return -1;
 
+  /* The mounts are already in place, they are used only by some handlers.  */
+  ret = libcrun_container_load_sections (container, LIBCRUN_CONFIG_ALL & ~LIBCRUN_CONFIG_MOUNTS, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
   container->context = context;
 
   if (container_status == 0)
@@ -3924,6 +4886,13 @@ libcrun_container_exec_with_options (libcrun_context_t *context, const char *id,
   if (UNLIKELY (ret < 0))
     return ret;
 
+  if (custom_handler)
+    {
+      ret = libcrun_container_load_sections (container, LIBCRUN_CONFIG_MOUNTS, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
   ret = block_signals (err);
   if (UNLIKELY (ret < 0))
     return ret;
@@ -4140,45 +5109,141 @@ libcrun_container_exec_with_options (libcrun_context_t *context, const char *id,
   return ret;
 }
 
-int
-libcrun_container_update (libcrun_context_t *context, const char *id, const char *content, size_t len arg_unused,
-                          libcrun_error_t *err)
+typedef int (*helper_process_cb) (void *arg, libcrun_error_t *err);
+
+/* Run CB in a short-lived child process and return its result.  It is used
+   when the caller has other threads, for the operations that change
+   process-wide attributes such as the rlimits, the dumpable flag or the
+   child subreaper.  */
+static int
+run_in_helper_process (helper_process_cb cb, void *arg, libcrun_error_t *err)
 {
-  cleanup_custom_handler_instance struct custom_handler_instance_s *custom_handler = NULL;
-  runtime_spec_schema_config_linux_resources *resources = NULL;
-  cleanup_container libcrun_container_t *container = NULL;
-  const char *state_root = context->state_root;
-  struct parser_context ctx = { 0, stderr };
-  libcrun_container_status_t status = {};
-  parser_error parser_err = NULL;
-  yajl_val tree = NULL;
+  struct batch_result_s result = {};
+  cleanup_close int pipefd0 = -1;
+  cleanup_close int pipefd1 = -1;
+  int wait_status = 0;
+  int fds[2];
+  pid_t pid;
   int ret;
 
-  ret = libcrun_read_container_status (&status, state_root, id, err);
+  /* The read end is not blocking: a process created by the helper could
+     inherit the write end, so EOF cannot be used to detect a helper that
+     died without reporting its result.  */
+  ret = pipe2 (fds, O_CLOEXEC | O_NONBLOCK);
   if (UNLIKELY (ret < 0))
-    return ret;
+    return crun_make_error (err, errno, "pipe");
+  pipefd0 = fds[0];
+  pipefd1 = fds[1];
 
-  ret = read_container_config_from_state (&container, state_root, id, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
+  pid = fork ();
+  if (UNLIKELY (pid < 0))
+    return crun_make_error (err, errno, "fork");
+  if (pid == 0)
+    {
+      libcrun_error_t tmp_err = NULL;
 
-  ret = libcrun_configure_handler (context->handler_manager,
-                                   context,
-                                   container,
-                                   &custom_handler,
-                                   err);
+      close_and_reset (&pipefd0);
+
+      result.ret = cb (arg, &tmp_err);
+      if (result.ret < 0 && tmp_err)
+        {
+          result.status = tmp_err->status;
+          snprintf (result.msg, sizeof (result.msg), "%s", tmp_err->msg);
+          crun_error_release (&tmp_err);
+        }
+
+      TEMP_FAILURE_RETRY (write (pipefd1, &result, sizeof (result)));
+      _safe_exit (result.ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
+  close_and_reset (&pipefd1);
+
+  ret = waitpid_ignore_stopped (pid, &wait_status, 0);
   if (UNLIKELY (ret < 0))
-    return ret;
+    return crun_make_error (err, errno, "waitpid for the helper process");
 
-  ret = parse_json_file (&tree, content, &ctx, err);
+  ret = TEMP_FAILURE_RETRY (read (pipefd0, &result, sizeof (result)));
+  if (UNLIKELY (ret != sizeof (result)))
+    return crun_make_error (err, 0, "the helper process exited without a result (status: %d)", wait_status);
+
+  if (result.ret < 0)
+    {
+      result.msg[sizeof (result.msg) - 1] = '\0';
+      return crun_make_error (err, result.status, "%s", result.msg);
+    }
+  return result.ret;
+}
+
+struct exec_helper_args_s
+{
+  libcrun_context_t *context;
+  const char *id;
+  struct libcrun_container_exec_options_s *opts;
+};
+
+static int
+exec_helper (void *arg, libcrun_error_t *err)
+{
+  struct exec_helper_args_s *args = arg;
+
+  return container_exec (args->context, args->id, args->opts, err);
+}
+
+int
+libcrun_container_exec_with_options (libcrun_context_t *context, const char *id,
+                                     struct libcrun_container_exec_options_s *opts,
+                                     libcrun_error_t *err)
+{
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
+
+  /* The exec changes the rlimits, the dumpable flag and the child subreaper
+     of the calling process, do it from a helper process when the caller
+     has other threads.  */
+  if (libcrun_is_multithreaded ())
+    {
+      struct exec_helper_args_s args = {
+        .context = context,
+        .id = id,
+        .opts = opts,
+      };
+
+      return run_in_helper_process (exec_helper, &args, err);
+    }
+
+  return container_exec (context, id, opts, err);
+}
+
+/* Read the status of the container ID and let its handler, if any, adapt
+   RESOURCES.  */
+static int
+prepare_update_resources (libcrun_context_t *context, const char *id,
+                          runtime_spec_schema_config_linux_resources *resources, libcrun_container_status_t *status,
+                          libcrun_error_t *err)
+{
+  cleanup_custom_handler_instance struct custom_handler_instance_s *custom_handler = NULL;
+  cleanup_container libcrun_container_t *container = NULL;
+  const char *state_root = context->state_root;
+  int ret;
+
+  ret = libcrun_read_container_status (status, state_root, id, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
-  resources = make_runtime_spec_schema_config_linux_resources (tree, &ctx, &parser_err);
-  if (UNLIKELY (resources == NULL))
+  /* The configuration is needed only to find the handler that could rewrite
+     the resources, skip it when no handler can do that.  */
+  if (handler_manager_has_modify_oci_configuration (context->handler_manager))
     {
-      ret = crun_make_error (err, errno, "cannot parse resources: %s", parser_err);
-      goto cleanup;
+      ret = read_container_config_from_state (&container, state_root, id, LIBCRUN_CONFIG_ALL, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      ret = libcrun_configure_handler (context->handler_manager,
+                                       context,
+                                       container,
+                                       &custom_handler,
+                                       err);
+      if (UNLIKELY (ret < 0))
+        return ret;
     }
 
   if (custom_handler && custom_handler->vtable->modify_oci_configuration)
@@ -4198,15 +5263,130 @@ libcrun_container_update (libcrun_context_t *context, const char *id, const char
         return ret;
     }
 
-  ret = libcrun_linux_container_update (&status, state_root, resources, err);
+  return 0;
+}
 
-cleanup:
-  if (tree)
-    yajl_tree_free (tree);
+int
+libcrun_container_update_resources (libcrun_context_t *context, const char *id,
+                                    runtime_spec_schema_config_linux_resources *resources, libcrun_error_t *err)
+{
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
+  cleanup_container_status libcrun_container_status_t status = {};
+  int ret;
+
+  ret = prepare_update_resources (context, id, resources, &status, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  return libcrun_linux_container_update (&status, context->state_root, resources, err);
+}
+
+int
+libcrun_container_update_batch (libcrun_context_t *context, struct libcrun_container_update_entry_s *entries,
+                                size_t len, libcrun_error_t *err)
+{
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
+  uint64_t start = libcrun_trace_now ();
+  void *systemd_bus = NULL;
+  size_t i;
+  int failures = 0;
+  int ret;
+
+  for (i = 0; i < len; i++)
+    {
+      if (UNLIKELY (entries[i].id == NULL || entries[i].resources == NULL))
+        return crun_make_error (err, EINVAL, "invalid batch entry `%zu`", i);
+
+      entries[i].ret = 0;
+      entries[i].err = NULL;
+    }
+
+  ret = libcrun_get_cgroup_mode (err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  /* The containers are updated in order from this process.  The systemd
+     units are all updated on the same D-Bus connection, opened for the
+     first container that uses systemd.  */
+  for (i = 0; i < len; i++)
+    {
+      struct libcrun_container_update_entry_s *entry = &entries[i];
+      cleanup_container_status libcrun_container_status_t status = {};
+      struct libcrun_cgroup_status *cgroup_status;
+
+      entry->ret = prepare_update_resources (context, entry->id, entry->resources, &status, &entry->err);
+      if (UNLIKELY (entry->ret < 0))
+        goto next;
+
+      if (status.systemd_cgroup && systemd_bus == NULL)
+        {
+          entry->ret = libcrun_systemd_open_bus (&systemd_bus, &entry->err);
+          if (UNLIKELY (entry->ret < 0))
+            goto next;
+        }
+
+      cgroup_status = libcrun_cgroup_make_status (&status);
+      entry->ret = libcrun_update_cgroup_manager_resources (cgroup_status, context->state_root, entry->resources,
+                                                            systemd_bus, &entry->err);
+      if (LIKELY (entry->ret == 0))
+        entry->ret = libcrun_update_cgroup_files (cgroup_status, context->state_root, entry->resources,
+                                                  &entry->err);
+      libcrun_cgroup_status_free (cgroup_status);
+
+    next:
+      if (entry->ret < 0)
+        {
+          libcrun_debug ("Could not update container `%s`: %s", entry->id, entry->err->msg);
+          failures++;
+        }
+    }
+
+  libcrun_systemd_close_bus (systemd_bus);
+
+  libcrun_trace ("update batch: %zu containers updated in %llu us, %d failed", len,
+                 (unsigned long long) (libcrun_trace_now () - start) / 1000, failures);
+
+  return failures;
+}
+
+int
+libcrun_container_parse_resources (const char *content, runtime_spec_schema_config_linux_resources **out,
+                                   libcrun_error_t *err)
+{
+  struct parser_context ctx = { 0, stderr };
+  parser_error parser_err = NULL;
+  yajl_val tree = NULL;
+  int ret;
+
+  *out = NULL;
+
+  ret = parse_json_file (&tree, content, &ctx, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  *out = make_runtime_spec_schema_config_linux_resources (tree, &ctx, &parser_err);
+  if (UNLIKELY (*out == NULL))
+    ret = crun_make_error (err, errno, "cannot parse resources: %s", parser_err);
+
+  yajl_tree_free (tree);
   free (parser_err);
-  if (resources)
-    free_runtime_spec_schema_config_linux_resources (resources);
+  return ret;
+}
 
+int
+libcrun_container_update (libcrun_context_t *context, const char *id, const char *content, size_t len arg_unused,
+                          libcrun_error_t *err)
+{
+  runtime_spec_schema_config_linux_resources *resources = NULL;
+  int ret;
+
+  ret = libcrun_container_parse_resources (content, &resources, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = libcrun_container_update_resources (context, id, resources, err);
+
+  free_runtime_spec_schema_config_linux_resources (resources);
   return ret;
 }
 
@@ -4237,17 +5417,227 @@ compare_update_values (const void *a, const void *b)
   return strcmp (aa->name, bb->name);
 }
 
+static int
+parse_update_value (const struct libcrun_update_value_s *value, bool is_signed, int64_t *out, libcrun_error_t *err)
+{
+  char *endptr = NULL;
+
+  errno = 0;
+  if (is_signed)
+    *out = strtoll (value->value, &endptr, 10);
+  else
+    {
+      if (strchr (value->value, '-'))
+        return crun_make_error (err, 0, "invalid value `%s` for `%s.%s`", value->value, value->section, value->name);
+      *out = (int64_t) strtoull (value->value, &endptr, 10);
+    }
+  if (UNLIKELY (errno != 0 || endptr == value->value || *endptr != '\0'))
+    return crun_make_error (err, errno, "invalid value `%s` for `%s.%s`", value->value, value->section, value->name);
+
+  return 0;
+}
+
+/* Store VALUE in RESOURCES.  Returns 1 if the value was stored, 0 if it is
+   not known and the generic path must be used.  */
+static int
+set_update_value (runtime_spec_schema_config_linux_resources *resources, const struct libcrun_update_value_s *value,
+                  libcrun_error_t *err)
+{
+  const char *section = value->section;
+  const char *name = value->name;
+  int64_t v;
+  int ret;
+
+  if (! value->numeric)
+    {
+      if (strcmp (section, "cpu") != 0 || (strcmp (name, "cpus") != 0 && strcmp (name, "mems") != 0))
+        return 0;
+
+      if (resources->cpu == NULL)
+        resources->cpu = xmalloc0 (sizeof (*resources->cpu));
+
+      if (strcmp (name, "cpus") == 0)
+        {
+          free (resources->cpu->cpus);
+          resources->cpu->cpus = xstrdup (value->value);
+        }
+      else
+        {
+          free (resources->cpu->mems);
+          resources->cpu->mems = xstrdup (value->value);
+        }
+      return 1;
+    }
+
+  if (strcmp (section, "cpu") == 0)
+    {
+      bool is_signed = strcmp (name, "quota") == 0 || strcmp (name, "realtimeRuntime") == 0;
+
+      if (! is_signed && strcmp (name, "period") != 0 && strcmp (name, "shares") != 0
+          && strcmp (name, "realtimePeriod") != 0)
+        return 0;
+
+      ret = parse_update_value (value, is_signed, &v, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      if (resources->cpu == NULL)
+        resources->cpu = xmalloc0 (sizeof (*resources->cpu));
+
+      if (strcmp (name, "quota") == 0)
+        {
+          resources->cpu->quota = v;
+          resources->cpu->quota_present = true;
+        }
+      else if (strcmp (name, "realtimeRuntime") == 0)
+        {
+          resources->cpu->realtime_runtime = v;
+          resources->cpu->realtime_runtime_present = true;
+        }
+      else if (strcmp (name, "period") == 0)
+        {
+          resources->cpu->period = (uint64_t) v;
+          resources->cpu->period_present = true;
+        }
+      else if (strcmp (name, "shares") == 0)
+        {
+          resources->cpu->shares = (uint64_t) v;
+          resources->cpu->shares_present = true;
+        }
+      else
+        {
+          resources->cpu->realtime_period = (uint64_t) v;
+          resources->cpu->realtime_period_present = true;
+        }
+      return 1;
+    }
+
+  if (strcmp (section, "memory") == 0)
+    {
+      runtime_spec_schema_config_linux_resources_memory *memory;
+
+      if (strcmp (name, "limit") != 0 && strcmp (name, "reservation") != 0 && strcmp (name, "swap") != 0
+          && strcmp (name, "kernel") != 0 && strcmp (name, "kernelTCP") != 0)
+        return 0;
+
+      ret = parse_update_value (value, true, &v, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      if (resources->memory == NULL)
+        resources->memory = xmalloc0 (sizeof (*resources->memory));
+      memory = resources->memory;
+
+      if (strcmp (name, "limit") == 0)
+        {
+          memory->limit = v;
+          memory->limit_present = true;
+        }
+      else if (strcmp (name, "reservation") == 0)
+        {
+          memory->reservation = v;
+          memory->reservation_present = true;
+        }
+      else if (strcmp (name, "swap") == 0)
+        {
+          memory->swap = v;
+          memory->swap_present = true;
+        }
+      else if (strcmp (name, "kernel") == 0)
+        {
+          memory->kernel = v;
+          memory->kernel_present = true;
+        }
+      else
+        {
+          memory->kernel_tcp = v;
+          memory->kernel_tcp_present = true;
+        }
+      return 1;
+    }
+
+  if (strcmp (section, "pids") == 0 && strcmp (name, "limit") == 0)
+    {
+      ret = parse_update_value (value, true, &v, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      if (resources->pids == NULL)
+        resources->pids = xmalloc0 (sizeof (*resources->pids));
+      resources->pids->limit = v;
+      resources->pids->limit_present = true;
+      return 1;
+    }
+
+  if (strcmp (section, "blockIO") == 0 && strcmp (name, "weight") == 0)
+    {
+      ret = parse_update_value (value, false, &v, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+      if (UNLIKELY (v > UINT16_MAX))
+        return crun_make_error (err, ERANGE, "invalid value `%s` for `%s.%s`", value->value, section, name);
+
+      if (resources->block_io == NULL)
+        resources->block_io = xmalloc0 (sizeof (*resources->block_io));
+      resources->block_io->weight = (uint16_t) v;
+      resources->block_io->weight_present = true;
+      return 1;
+    }
+
+  return 0;
+}
+
+/* Build the resources directly from VALUES, without a round trip through
+   JSON.  Returns 0 and sets OUT to NULL if any of the values is not known.  */
+static int
+make_resources_from_values (struct libcrun_update_value_s *values, size_t len,
+                            runtime_spec_schema_config_linux_resources **out, libcrun_error_t *err)
+{
+  runtime_spec_schema_config_linux_resources *resources;
+  size_t i;
+  int ret;
+
+  *out = NULL;
+
+  resources = xmalloc0 (sizeof (*resources));
+  for (i = 0; i < len; i++)
+    {
+      ret = set_update_value (resources, &values[i], err);
+      if (ret <= 0)
+        {
+          free_runtime_spec_schema_config_linux_resources (resources);
+          return ret;
+        }
+    }
+
+  *out = resources;
+  return 0;
+}
+
 int
 libcrun_container_update_from_values (libcrun_context_t *context, const char *id,
                                       struct libcrun_update_value_s *values, size_t len,
                                       libcrun_error_t *err)
 {
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
+  runtime_spec_schema_config_linux_resources *resources = NULL;
   const char *current_section = NULL;
   const unsigned char *buf;
   yajl_gen gen = NULL;
   size_t i, buf_len;
   int ret;
 
+  ret = make_resources_from_values (values, len, &resources, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (resources)
+    {
+      ret = libcrun_container_update_resources (context, id, resources, err);
+      free_runtime_spec_schema_config_linux_resources (resources);
+      return ret;
+    }
+
   gen = yajl_gen_alloc (NULL);
   if (gen == NULL)
     return crun_make_error (err, 0, "yajl_gen_alloc failed");
@@ -4489,6 +5879,7 @@ libcrun_container_spec (bool root, FILE *out, libcrun_error_t *err)
 int
 libcrun_container_pause (libcrun_context_t *context, const char *id, libcrun_error_t *err)
 {
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
   int ret;
   const char *state_root = context->state_root;
   libcrun_container_status_t status = {};
@@ -4509,6 +5900,7 @@ libcrun_container_pause (libcrun_context_t *context, const char *id, libcrun_err
 int
 libcrun_container_unpause (libcrun_context_t *context, const char *id, libcrun_error_t *err)
 {
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
   int ret;
   const char *state_root = context->state_root;
   libcrun_container_status_t status = {};
@@ -4530,6 +5922,7 @@ int
 libcrun_container_checkpoint (libcrun_context_t *context, const char *id, libcrun_checkpoint_restore_t *cr_options,
                               libcrun_error_t *err)
 {
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
   int ret;
   const char *state_root = context->state_root;
   libcrun_container_status_t status = {};
@@ -4545,7 +5938,7 @@ libcrun_container_checkpoint (libcrun_context_t *context, const char *id, libcru
   if (ret == 0)
     return crun_make_error (err, errno, "the container `%s` is not running", id);
 
-  ret = read_container_config_from_state (&container, state_root, id, err);
+  ret = read_container_config_from_state (&container, state_root, id, LIBCRUN_CONFIG_ALL, err);
   if (UNLIKELY (ret < 0))
     return ret;
   ret = libcrun_container_checkpoint_linux (&status, container, cr_options, err);
@@ -4614,6 +6007,7 @@ int
 libcrun_container_restore (libcrun_context_t *context, const char *id, libcrun_checkpoint_restore_t *cr_options,
                            libcrun_error_t *err)
 {
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
   cleanup_cgroup_status struct libcrun_cgroup_status *cgroup_status = NULL;
   cleanup_container libcrun_container_t *container = NULL;
   cleanup_close int proxy_pid_pipe0 = -1;
@@ -4834,6 +6228,7 @@ libcrun_container_restore (libcrun_context_t *context, const char *id, libcrun_c
 int
 libcrun_container_read_pids (libcrun_context_t *context, const char *id, bool recurse, pid_t **pids, libcrun_error_t *err)
 {
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
   cleanup_cgroup_status struct libcrun_cgroup_status *cgroup_status = NULL;
   cleanup_container_status libcrun_container_status_t status = {};
   int ret;
@@ -4949,6 +6344,7 @@ exit:
 int
 libcrun_container_update_intel_rdt (libcrun_context_t *context, const char *id, struct libcrun_intel_rdt_update *update, libcrun_error_t *err)
 {
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
   cleanup_container libcrun_container_t *container = NULL;
   cleanup_free char *config_file = NULL;
   cleanup_free char *dir = NULL;
@@ -4972,6 +6368,7 @@ libcrun_container_update_intel_rdt (libcrun_context_t *context, const char *id,
 static int
 libcrun_container_add_or_remove_mounts_from_file (libcrun_context_t *context, const char *id, const char *file, bool add, libcrun_error_t *err)
 {
+  cleanup_context_logging struct context_logging_s logging = enter_context_logging (context);
   cleanup_custom_handler_instance struct custom_handler_instance_s *custom_handler = NULL;
   cleanup_container libcrun_container_t *container = NULL;
   cleanup_free runtime_spec_schema_defs_mount **mounts = NULL;
@@ -4993,7 +6390,7 @@ libcrun_container_add_or_remove_mounts_from_file (libcrun_context_t *context, co
   if (UNLIKELY (ret < 0))
     return ret;
 
-  ret = read_container_config_from_state (&container, state_root, id, err);
+  ret = read_container_config_from_state (&container, state_root, id, LIBCRUN_CONFIG_ALL, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
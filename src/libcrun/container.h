@@ -23,6 +23,7 @@
 #include <ocispec/runtime_spec_schema_config_schema.h>
 #include "error.h"
 #include "string_map.h"
+#include "lazy_config.h"
 
 enum handler_configure_phase
 {
@@ -33,6 +34,7 @@ enum handler_configure_phase
 };
 
 struct custom_handler_manager_s;
+struct libcrun_mmap_s;
 
 struct libcrun_context_s
 {
@@ -63,6 +65,14 @@ struct libcrun_context_s
   int argc;
 
   struct custom_handler_manager_s *handler_manager;
+
+  /* Compiled wasm module found in the cache by the handler before the
+     pivot_root, and executed in place of the module.  */
+  struct libcrun_mmap_s *wasm_cached_module;
+
+  /* Where crun run writes the PSI events while it waits for the container.
+     -1 sends them to the notify socket.  */
+  int psi_fd;
 };
 
 enum
@@ -92,6 +102,15 @@ struct libcrun_container_s
 
   string_map *annotations;
 
+  /* Set when the container was loaded lazily, tracks the sections of
+     CONTAINER_DEF that are not parsed yet.  */
+  struct libcrun_lazy_config_s *lazy_config;
+
+  /* JSON tree CONTAINER_DEF was built from.  It is kept until the config
+     snapshot is written to the state directory, so that the configuration
+     is not parsed again.  */
+  yajl_val config_tree;
+
   int proc_fd;
 
   void *private_data;
@@ -210,6 +229,14 @@ struct libcrun_checkpoint_restore_s
   int network_lock_method;
   char *lsm_profile;
   char *lsm_mount_context;
+  /* Run up to PRE_DUMP_ITERATIONS pre-dumps before the final dump, stopping
+     once a pre-dump writes at most PRE_DUMP_THRESHOLD pages or the pages
+     written stop decreasing.  */
+  unsigned int pre_dump_iterations;
+  uint64_t pre_dump_threshold;
+  /* If set, called after each pre-dump.  */
+  void (*pre_dump_cb) (void *arg, unsigned int iteration, uint64_t pages, uint64_t duration_usec);
+  void *pre_dump_cb_arg;
 };
 typedef struct libcrun_checkpoint_restore_s libcrun_checkpoint_restore_t;
 
@@ -217,6 +244,17 @@ LIBCRUN_PUBLIC libcrun_container_t *libcrun_container_load_from_file (const char
 
 LIBCRUN_PUBLIC libcrun_container_t *libcrun_container_load_from_memory (const char *json, libcrun_error_t *err);
 
+/* Like libcrun_container_load_from_file, but the LIBCRUN_CONFIG_* sections
+   are parsed only by libcrun_container_load_sections.  */
+LIBCRUN_PUBLIC libcrun_container_t *libcrun_container_load_lazy_from_file (const char *path, libcrun_error_t *err);
+
+LIBCRUN_PUBLIC libcrun_container_t *libcrun_container_load_lazy_from_memory (const char *json, libcrun_error_t *err);
+
+/* Make sure the LIBCRUN_CONFIG_* SECTIONS are present in container_def.
+   It does nothing for a container that was not loaded lazily.  */
+LIBCRUN_PUBLIC int libcrun_container_load_sections (libcrun_container_t *container, unsigned int sections,
+                                                    libcrun_error_t *err);
+
 LIBCRUN_PUBLIC void libcrun_container_free (libcrun_container_t *);
 
 LIBCRUN_PUBLIC int libcrun_container_run (libcrun_context_t *context, libcrun_container_t *container,
@@ -234,8 +272,38 @@ LIBCRUN_PUBLIC int libcrun_container_killall (libcrun_context_t *context, const
 LIBCRUN_PUBLIC int libcrun_container_create (libcrun_context_t *context, libcrun_container_t *container,
                                              unsigned int options, libcrun_error_t *err);
 
+struct libcrun_container_batch_entry_s
+{
+  const char *id;
+  const char *bundle;
+  const char *pid_file;
+  libcrun_container_t *container;
+
+  /* Result of the creation, filled by libcrun_container_create_batch.  On
+     failure ERR is set and must be released by the caller.  */
+  int ret;
+  libcrun_error_t err;
+};
+
+/* Create LEN containers using at most MAX_WORKERS parallel workers (0 means
+   the number of online CPUs).  Returns the number of containers that could
+   not be created, or a negative value on errors that prevent the whole
+   batch from running.  */
+LIBCRUN_PUBLIC int libcrun_container_create_batch (libcrun_context_t *context,
+                                                   struct libcrun_container_batch_entry_s *entries, size_t len,
+                                                   unsigned int max_workers, unsigned int options,
+                                                   libcrun_error_t *err);
+
 LIBCRUN_PUBLIC int libcrun_container_start (libcrun_context_t *context, const char *id, libcrun_error_t *err);
 
+/* Start a zygote container running the args of PROCESS instead of the
+   configured ones.  The env entries of PROCESS are added to the
+   configured environment and its cwd, if set, replaces the configured
+   one.  All the other fields are ignored.  */
+LIBCRUN_PUBLIC int libcrun_container_start_process (libcrun_context_t *context, const char *id,
+                                                    runtime_spec_schema_config_schema_process *process,
+                                                    libcrun_error_t *err);
+
 LIBCRUN_PUBLIC int libcrun_container_state (libcrun_context_t *context, const char *id, FILE *out,
                                             libcrun_error_t *err);
 
@@ -272,6 +340,36 @@ LIBCRUN_PUBLIC int libcrun_container_update (libcrun_context_t *context, const c
 LIBCRUN_PUBLIC int libcrun_container_update_from_file (libcrun_context_t *context, const char *id, const char *file,
                                                        libcrun_error_t *err);
 
+/* Update the container resources from RESOURCES, without going through
+   JSON.  Only the cgroup files for the values set in RESOURCES are written.  */
+LIBCRUN_PUBLIC int libcrun_container_update_resources (libcrun_context_t *context, const char *id,
+                                                       runtime_spec_schema_config_linux_resources *resources,
+                                                       libcrun_error_t *err);
+
+/* Parse the JSON resources block in CONTENT into OUT.  */
+LIBCRUN_PUBLIC int libcrun_container_parse_resources (const char *content,
+                                                      runtime_spec_schema_config_linux_resources **out,
+                                                      libcrun_error_t *err);
+
+struct libcrun_container_update_entry_s
+{
+  const char *id;
+  runtime_spec_schema_config_linux_resources *resources;
+
+  /* Result of the update, filled by libcrun_container_update_batch.  On
+     failure ERR must be released by the caller.  */
+  int ret;
+  libcrun_error_t err;
+};
+
+/* Update the resources of LEN containers, in order.  The updates through
+   systemd share a single D-Bus connection.  Returns the number of containers
+   that could not be updated, or < 0 if an error prevented the batch from
+   running.  */
+LIBCRUN_PUBLIC int libcrun_container_update_batch (libcrun_context_t *context,
+                                                   struct libcrun_container_update_entry_s *entries, size_t len,
+                                                   libcrun_error_t *err);
+
 struct libcrun_update_value_s
 {
   const char *section;
@@ -311,6 +409,175 @@ LIBCRUN_PUBLIC int libcrun_container_restore (libcrun_context_t *context, const
 
 LIBCRUN_PUBLIC int libcrun_container_read_pids (libcrun_context_t *context, const char *id, bool recurse, pid_t **pids, libcrun_error_t *err);
 
+/* Version of struct libcrun_container_stats_s.  New fields are only added
+   at the end of the struct, and the version is bumped when it happens.  */
+#define LIBCRUN_CONTAINER_STATS_VERSION 1
+
+/* Value used for the limits that are not set.  */
+#define LIBCRUN_STATS_UNLIMITED UINT64_MAX
+
+enum
+{
+  LIBCRUN_CONTAINER_STATS_CPU = (1 << 0),
+  LIBCRUN_CONTAINER_STATS_MEMORY = (1 << 1),
+  LIBCRUN_CONTAINER_STATS_IO = (1 << 2),
+  LIBCRUN_CONTAINER_STATS_PIDS = (1 << 3),
+  LIBCRUN_CONTAINER_STATS_PRESSURE = (1 << 4),
+};
+
+struct libcrun_pressure_s
+{
+  double avg10;
+  double avg60;
+  double avg300;
+  uint64_t total;
+};
+
+struct libcrun_container_stats_s
+{
+  uint32_t version;
+  /* Mask of LIBCRUN_CONTAINER_STATS_*, the sections that were read.  A
+     section is missing when its controller is not enabled.  */
+  uint32_t valid;
+  /* CLOCK_REALTIME when the stats were read, in nanoseconds.  */
+  uint64_t timestamp;
+
+  /* cpu.stat.  */
+  struct
+  {
+    uint64_t usage_usec;
+    uint64_t user_usec;
+    uint64_t system_usec;
+    uint64_t nr_periods;
+    uint64_t nr_throttled;
+    uint64_t throttled_usec;
+  } cpu;
+
+  /* memory.current, memory.max, memory.swap.*, memory.stat and memory.events.  */
+  struct
+  {
+    uint64_t usage;
+    uint64_t limit;
+    uint64_t swap_usage;
+    uint64_t swap_limit;
+    uint64_t anon;
+    uint64_t file;
+    uint64_t kernel_stack;
+    uint64_t slab;
+    uint64_t sock;
+    uint64_t shmem;
+    uint64_t file_mapped;
+    uint64_t file_dirty;
+    uint64_t file_writeback;
+    uint64_t active_anon;
+    uint64_t inactive_anon;
+    uint64_t active_file;
+    uint64_t inactive_file;
+    uint64_t pgfault;
+    uint64_t pgmajfault;
+    uint64_t events_low;
+    uint64_t events_high;
+    uint64_t events_max;
+    uint64_t events_oom;
+    uint64_t events_oom_kill;
+  } memory;
+
+  /* io.stat, summed over all the devices.  */
+  struct
+  {
+    uint64_t rbytes;
+    uint64_t wbytes;
+    uint64_t rios;
+    uint64_t wios;
+    uint64_t dbytes;
+    uint64_t dios;
+  } io;
+
+  /* pids.current and pids.max.  */
+  struct
+  {
+    uint64_t current;
+    uint64_t limit;
+  } pids;
+
+  /* cpu.pressure, memory.pressure and io.pressure.  */
+  struct
+  {
+    struct libcrun_pressure_s cpu_some;
+    struct libcrun_pressure_s cpu_full;
+    struct libcrun_pressure_s memory_some;
+    struct libcrun_pressure_s memory_full;
+    struct libcrun_pressure_s io_some;
+    struct libcrun_pressure_s io_full;
+  } pressure;
+};
+
+typedef struct libcrun_container_stats_reader_s libcrun_container_stats_reader_t;
+
+/* Open the cgroup of the container ID for reading its stats.  The reader
+   keeps the cgroup files open, so reading the stats again only costs one
+   read per file.  Only cgroup v2 is supported.  */
+LIBCRUN_PUBLIC int libcrun_container_stats_reader_open (libcrun_context_t *context, const char *id,
+                                                        libcrun_container_stats_reader_t **out, libcrun_error_t *err);
+
+LIBCRUN_PUBLIC int libcrun_container_stats_reader_read (libcrun_container_stats_reader_t *reader,
+                                                        struct libcrun_container_stats_s *stats, libcrun_error_t *err);
+
+LIBCRUN_PUBLIC void libcrun_container_stats_reader_free (libcrun_container_stats_reader_t *reader);
+
+/* Read the stats for the container ID once.  */
+LIBCRUN_PUBLIC int libcrun_container_stats (libcrun_context_t *context, const char *id,
+                                            struct libcrun_container_stats_s *stats, libcrun_error_t *err);
+
+/* Write STATS as a single line JSON object to OUT.  The limits that are not
+   set are written as null.  */
+LIBCRUN_PUBLIC int libcrun_container_stats_write_json (const char *id, const struct libcrun_container_stats_s *stats,
+                                                       FILE *out, libcrun_error_t *err);
+
+/* Usage of a container between two samples of a stats collector.  */
+struct libcrun_container_stats_delta_s
+{
+  const char *id;
+  /* Time between the two samples, in nanoseconds.  */
+  uint64_t elapsed;
+  /* CPU time used per second, 1.0 is one full CPU.  */
+  double cpu_usage;
+  /* memory.current, and how much it changed since the previous sample.  */
+  uint64_t memory_usage;
+  int64_t memory_growth;
+  /* Bytes read and written per second.  */
+  double io_read_rate;
+  double io_write_rate;
+  uint64_t pids;
+};
+
+typedef struct libcrun_stats_collector_s libcrun_stats_collector_t;
+
+/* Create a collector for all the containers under the state root of
+   CONTEXT.  The state root is listed again only when containers are added
+   or removed, and the cgroup files of each container stay open between the
+   samples.  Only cgroup v2 is supported.  */
+LIBCRUN_PUBLIC int libcrun_stats_collector_new (libcrun_context_t *context, libcrun_stats_collector_t **out,
+                                                libcrun_error_t *err);
+
+/* Sample all the containers.  DELTAS is set to the usage of the containers
+   that were also present in the previous sample, it is owned by the
+   collector and valid until the next call.  Containers that cannot be read
+   are skipped.  */
+LIBCRUN_PUBLIC int libcrun_stats_collector_sample (libcrun_stats_collector_t *collector,
+                                                   const struct libcrun_container_stats_delta_s **deltas,
+                                                   size_t *len, libcrun_error_t *err);
+
+LIBCRUN_PUBLIC void libcrun_stats_collector_free (libcrun_stats_collector_t *collector);
+
+/* Write DELTAS to OUT, one line per container preceded by a line with the
+   TIMESTAMP in nanoseconds:
+
+   # TIMESTAMP
+   ID CPU MEMORY MEMORY_GROWTH READ_RATE WRITE_RATE PIDS  */
+LIBCRUN_PUBLIC int libcrun_stats_collector_write (const struct libcrun_container_stats_delta_s *deltas, size_t len,
+                                                  uint64_t timestamp, FILE *out, libcrun_error_t *err);
+
 LIBCRUN_PUBLIC int libcrun_write_json_containers_list (libcrun_context_t *context, FILE *out, libcrun_error_t *err);
 
 LIBCRUN_PUBLIC int libcrun_container_add_mounts_from_file (libcrun_context_t *context, const char *id, const char *file,
@@ -28,6 +28,8 @@
 #  include <sys/stat.h>
 #  include <sys/mount.h>
 #  include <fcntl.h>
+#  include <dirent.h>
+#  include <inttypes.h>
 
 #  include "container.h"
 #  include "linux.h"
@@ -35,6 +37,7 @@
 #  include "utils.h"
 #  include "cgroup.h"
 #  include "cgroup-utils.h"
+#  include "trace.h"
 
 #  ifndef STATIC
 #    include <dlfcn.h>
@@ -271,6 +274,129 @@ criu_check_mem_track (char *work_path, libcrun_error_t *err)
                           work_path, CRIU_CHECKPOINT_LOG_FILE);
 }
 
+/* Number of pages written by a pre-dump to the images in DIRFD.  */
+static int
+count_dumped_pages (int dirfd, uint64_t *pages, libcrun_error_t *err)
+{
+  cleanup_dir DIR *dir = NULL;
+  struct dirent *de;
+  uint64_t size = 0;
+  int fd;
+
+  fd = dup (dirfd);
+  if (UNLIKELY (fd < 0))
+    return crun_make_error (err, errno, "dup");
+
+  dir = fdopendir (fd);
+  if (UNLIKELY (dir == NULL))
+    {
+      close (fd);
+      return crun_make_error (err, errno, "fdopendir");
+    }
+
+  for (de = readdir (dir); de; de = readdir (dir))
+    {
+      struct stat st;
+
+      if (! has_prefix (de->d_name, "pages-") || ! has_suffix (de->d_name, ".img"))
+        continue;
+
+      if (UNLIKELY (fstatat (dirfd, de->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0))
+        return crun_make_error (err, errno, "stat `%s`", de->d_name);
+
+      size += st.st_size;
+    }
+
+  *pages = size / sysconf (_SC_PAGESIZE);
+  return 0;
+}
+
+/* Run pre-dumps in the directories pre-dump-1, pre-dump-2... under the
+   image path, each one on top of the previous one, until the pages written
+   drop below the threshold or stop decreasing.  The final dump then has to
+   copy only the pages dirtied since the last pre-dump, so the container is
+   frozen for a shorter time.  *PARENT is set to the last pre-dump, relative
+   to the image path.  */
+static int
+iterative_pre_dump (libcrun_checkpoint_restore_t *cr_options, int image_fd, char **parent, libcrun_error_t *err)
+{
+  cleanup_free char *previous = NULL;
+  uint64_t previous_pages = 0;
+  unsigned int i;
+  int ret;
+
+  if (cr_options->parent_path)
+    {
+      if (UNLIKELY (cr_options->parent_path[0] == '/'))
+        return crun_make_error (err, 0, "--parent-path must be relative");
+      previous = xstrdup (cr_options->parent_path);
+    }
+
+  for (i = 1; i <= cr_options->pre_dump_iterations; i++)
+    {
+      cleanup_free char *parent_images = NULL;
+      cleanup_free char *name = NULL;
+      cleanup_close int dirfd = -1;
+      uint64_t start, pages;
+
+      xasprintf (&name, "pre-dump-%u", i);
+
+      ret = mkdirat (image_fd, name, 0700);
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "error creating pre-dump directory `%s/%s`", cr_options->image_path, name);
+
+      dirfd = openat (image_fd, name, O_DIRECTORY | O_CLOEXEC);
+      if (UNLIKELY (dirfd < 0))
+        return crun_make_error (err, errno, "error opening pre-dump directory `%s/%s`", cr_options->image_path, name);
+
+      libcriu_wrapper->criu_set_images_dir_fd (dirfd);
+
+      /* The parent is relative to the images directory.  */
+      if (previous)
+        {
+          xasprintf (&parent_images, "../%s", previous);
+          ret = libcriu_wrapper->criu_set_parent_images (parent_images);
+          if (UNLIKELY (ret != 0))
+            return crun_make_error (err, -ret, "error setting CRIU parent images path to `%s`", parent_images);
+        }
+
+      libcriu_wrapper->criu_set_track_mem (true);
+
+      start = libcrun_trace_now ();
+      ret = libcriu_wrapper->criu_pre_dump ();
+      if (UNLIKELY (ret != 0))
+        return crun_make_error (err, 0, "CRIU pre-dump %u failed %d.  Please check CRIU logfile %s/%s", i, ret,
+                                cr_options->work_path, CRIU_CHECKPOINT_LOG_FILE);
+
+      ret = count_dumped_pages (dirfd, &pages, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      libcrun_debug ("pre-dump %u: %" PRIu64 " pages written", i, pages);
+      if (cr_options->pre_dump_cb)
+        cr_options->pre_dump_cb (cr_options->pre_dump_cb_arg, i, pages, (libcrun_trace_now () - start) / 1000);
+
+      free (previous);
+      previous = name;
+      name = NULL;
+
+      if (pages <= cr_options->pre_dump_threshold)
+        break;
+
+      /* The container dirties memory faster than it is copied.  */
+      if (i > 1 && pages >= previous_pages)
+        break;
+
+      previous_pages = pages;
+    }
+
+  libcriu_wrapper->criu_set_images_dir_fd (image_fd);
+
+  *parent = previous;
+  previous = NULL;
+  return 0;
+}
+
 #  endif
 
 static int
@@ -473,7 +599,7 @@ handle_criu_config_file (libcrun_container_t *container, libcrun_error_t *err)
   const char *criu_config_annotation;
   const char *config_file = CRIU_RUNC_CONFIG_FILE;
 
-  criu_config_annotation = find_annotation (container, "org.criu.config");
+  criu_config_annotation = find_known_annotation (container, ANNOTATION_CRIU_CONFIG);
 
   /* Ignore missing criu_set_config_file() API for compatibility with older CRIU versions,
    * and show an error only if config file is explicitly set with annotation.
@@ -596,11 +722,33 @@ libcrun_container_checkpoint_linux_criu (libcrun_container_status_t *status, lib
 
   {
     int criu_can_mem_track = 0;
+
+    if (cr_options->pre_dump_iterations > 0)
+      {
+        cleanup_free char *parent = NULL;
+
+        if (cr_options->pre_dump)
+          return crun_make_error (err, 0, "the pre-dump iterations cannot be used with --pre-dump");
+
+        criu_can_mem_track = criu_check_mem_track (cr_options->work_path, err);
+        if (UNLIKELY (criu_can_mem_track == -1))
+          return -1;
+
+        ret = iterative_pre_dump (cr_options, image_fd, &parent, err);
+        if (UNLIKELY (ret < 0))
+          return ret;
+
+        /* The final dump is on top of the last pre-dump.  */
+        libcriu_wrapper->criu_set_track_mem (true);
+        ret = libcriu_wrapper->criu_set_parent_images (parent);
+        if (UNLIKELY (ret != 0))
+          return crun_make_error (err, -ret, "error setting CRIU parent images path to `%s`", parent);
+      }
     /* If the user uses --pre-dump for the second time or does
      * a final dump from a previous pre-dump, setting parent_path
      * is necessary so that CRIU can find which pages have not
      * changed compared to the previous dump. */
-    if (cr_options->parent_path != NULL)
+    else if (cr_options->parent_path != NULL)
       {
         criu_can_mem_track = criu_check_mem_track (cr_options->work_path, err);
         if (UNLIKELY (criu_can_mem_track == -1))
@@ -136,6 +136,21 @@ handler_manager_free (struct custom_handler_manager_s *manager)
   free (manager);
 }
 
+bool
+handler_manager_has_modify_oci_configuration (struct custom_handler_manager_s *manager)
+{
+  size_t i;
+
+  if (manager == NULL)
+    return false;
+
+  for (i = 0; i < manager->handlers_len; i++)
+    if (manager->handlers[i]->modify_oci_configuration)
+      return true;
+
+  return false;
+}
+
 #ifdef HAVE_DLOPEN
 static int
 handler_manager_add_so (struct custom_handler_manager_s *manager, void *handle, libcrun_error_t *err)
@@ -240,6 +255,33 @@ make_custom_handler_instance_s (struct custom_handler_s *vtable)
   return ret;
 }
 
+int
+libcrun_handler_manager_warmup (struct custom_handler_manager_s *manager, const char *name,
+                                struct custom_handler_instance_s **out, libcrun_error_t *err)
+{
+  struct custom_handler_s *h;
+  int ret;
+
+  *out = NULL;
+
+  h = handler_by_name (manager, name);
+  if (h == NULL)
+    return crun_make_error (err, 0, "cannot find handler `%s`", name);
+
+  *out = make_custom_handler_instance_s (h);
+  if (h->load)
+    {
+      ret = h->load (&((*out)->cookie), err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  if (h->warmup == NULL)
+    return 0;
+
+  return h->warmup ((*out)->cookie, err);
+}
+
 static int
 find_handler_for_container (struct custom_handler_manager_s *manager,
                             libcrun_container_t *container,
@@ -290,11 +332,11 @@ libcrun_configure_handler (struct custom_handler_manager_s *manager,
   // Example sandbox container can contain pause process
   // See: https://github.com/containers/crun/issues/798
   // before invoking handler check if this is not a kubernetes sandbox
-  annotation = find_annotation (container, "io.kubernetes.cri.container-type");
+  annotation = find_known_annotation (container, ANNOTATION_CRI_CONTAINER_TYPE);
   if (annotation && (strcmp (annotation, "sandbox") == 0))
     return 0;
 
-  annotation = find_annotation (container, "run.oci.handler");
+  annotation = find_known_annotation (container, ANNOTATION_HANDLER);
 
   /* Fail with EACCESS if global handler is already configured and there was an attempt to override it via spec.  */
   if (context->handler != NULL && annotation != NULL)
@@ -48,6 +48,12 @@ struct custom_handler_s
   int (*modify_oci_configuration) (void *cookie, libcrun_context_t *context,
                                    runtime_spec_schema_config_schema *def,
                                    libcrun_error_t *err);
+
+  /* Optional.  Called once by a long running process that creates many
+     containers, e.g. crun wasm-host.  What it prepares is inherited by the
+     container processes forked afterwards, so it must stay usable after
+     fork (): no threads, locks or engines that own threads.  */
+  int (*warmup) (void *cookie, libcrun_error_t *err);
 };
 
 struct custom_handler_manager_s;
@@ -56,6 +62,10 @@ LIBCRUN_PUBLIC struct custom_handler_manager_s *libcrun_handler_manager_create (
 LIBCRUN_PUBLIC int libcrun_handler_manager_load_directory (struct custom_handler_manager_s *manager, const char *path, libcrun_error_t *err);
 LIBCRUN_PUBLIC void handler_manager_free (struct custom_handler_manager_s *manager);
 
+/* Whether any of the handlers known to MANAGER rewrites the resources on
+   update, so the container configuration must be loaded.  */
+bool handler_manager_has_modify_oci_configuration (struct custom_handler_manager_s *manager);
+
 LIBCRUN_PUBLIC struct custom_handler_s *handler_by_name (struct custom_handler_manager_s *manager, const char *name);
 LIBCRUN_PUBLIC void libcrun_handler_manager_print_feature_tags (struct custom_handler_manager_s *manager, FILE *out);
 
@@ -71,6 +81,11 @@ LIBCRUN_PUBLIC int libcrun_configure_handler (struct custom_handler_manager_s *m
                                               struct custom_handler_instance_s **out,
                                               libcrun_error_t *err);
 
+/* Load the handler NAME and keep it warm for the containers created later
+   by the same process.  The instance is returned in OUT.  */
+LIBCRUN_PUBLIC int libcrun_handler_manager_warmup (struct custom_handler_manager_s *manager, const char *name,
+                                                   struct custom_handler_instance_s **out, libcrun_error_t *err);
+
 typedef struct custom_handler_s *(*run_oci_get_handler_cb) ();
 
 #define cleanup_custom_handler_instance __attribute__ ((cleanup (cleanup_custom_handler_instancep)))
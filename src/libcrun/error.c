@@ -24,6 +24,11 @@
 #include <time.h>
 #include <sys/time.h>
 #include <stdio.h>
+#if HAVE_STDATOMIC_H
+#  include <stdatomic.h>
+#else
+#  define atomic_int volatile int
+#endif
 #include "utils.h"
 
 #include <yajl/yajl_tree.h>
@@ -41,8 +46,8 @@ enum
   LOG_FORMAT_JSON,
 };
 
-static int log_format;
-static int output_verbosity = LIBCRUN_VERBOSITY_ERROR;
+static atomic_int log_format;
+static atomic_int output_verbosity = LIBCRUN_VERBOSITY_ERROR;
 
 int
 libcrun_make_error (libcrun_error_t *err, int status, const char *msg, ...)
@@ -350,6 +355,12 @@ log_write_to_journald (int errno_, const char *msg, int verbosity, void *arg arg
 static crun_output_handler output_handler = log_write_to_stderr;
 static void *output_handler_arg = NULL;
 
+/* Output handler of the context used by the operation running on the
+   current thread.  If set, it is used instead of the process-wide one so
+   that operations on different contexts can run at the same time.  */
+static __thread crun_output_handler thread_output_handler;
+static __thread void *thread_output_handler_arg;
+
 void
 libcrun_set_verbosity (int verbosity)
 {
@@ -367,6 +378,22 @@ crun_set_output_handler (crun_output_handler handler, void *arg)
 {
   output_handler = handler;
   output_handler_arg = arg;
+  thread_output_handler = NULL;
+  thread_output_handler_arg = NULL;
+}
+
+void
+crun_set_thread_output_handler (crun_output_handler handler, void *arg)
+{
+  thread_output_handler = handler;
+  thread_output_handler_arg = arg;
+}
+
+void
+crun_get_thread_output_handler (crun_output_handler *handler, void **arg)
+{
+  *handler = thread_output_handler;
+  *arg = thread_output_handler_arg;
 }
 
 static char *
@@ -432,6 +459,8 @@ make_json_error (const char *msg, int errno_, int verbosity)
 static void
 write_log (int errno_, int verbosity, const char *msg, va_list args_list)
 {
+  crun_output_handler handler = output_handler;
+  void *handler_arg = output_handler_arg;
   int ret;
   cleanup_free char *output = NULL;
   cleanup_free char *json = NULL;
@@ -439,25 +468,31 @@ write_log (int errno_, int verbosity, const char *msg, va_list args_list)
   if (verbosity > output_verbosity)
     return;
 
+  if (thread_output_handler)
+    {
+      handler = thread_output_handler;
+      handler_arg = thread_output_handler_arg;
+    }
+
   ret = vasprintf (&output, msg, args_list);
   if (UNLIKELY (ret < 0))
     OOM ();
 
-  if (verbosity == LIBCRUN_VERBOSITY_ERROR && output_handler != log_write_to_stderr)
+  if (verbosity == LIBCRUN_VERBOSITY_ERROR && handler != log_write_to_stderr)
     log_write_to_stderr (errno_, output, LIBCRUN_VERBOSITY_ERROR, NULL);
 
   switch (log_format)
     {
     case LOG_FORMAT_TEXT:
-      output_handler (errno_, output, verbosity, output_handler_arg);
+      handler (errno_, output, verbosity, handler_arg);
       break;
 
     case LOG_FORMAT_JSON:
       json = make_json_error (output, errno_, verbosity);
       if (json)
-        output_handler (0, json, verbosity, output_handler_arg);
+        handler (0, json, verbosity, handler_arg);
       else
-        output_handler (errno_, output, verbosity, output_handler_arg);
+        handler (errno_, output, verbosity, handler_arg);
       break;
     }
 }
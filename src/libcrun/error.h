@@ -73,8 +73,17 @@ extern void __gcov_dump (void);
 
 typedef void (*crun_output_handler) (int errno_, const char *msg, int verbosity, void *arg);
 
+/* Set the process-wide output handler.  It also resets the handler of the
+   calling thread.  */
 void crun_set_output_handler (crun_output_handler handler, void *arg);
 
+/* Set the output handler for the calling thread only, it takes precedence
+   over the process-wide one.  HANDLER can be NULL to use the process-wide
+   handler again.  */
+void crun_set_thread_output_handler (crun_output_handler handler, void *arg);
+
+void crun_get_thread_output_handler (crun_output_handler *handler, void **arg);
+
 void log_write_to_journald (int errno_, const char *msg, int verbosity, void *arg);
 
 void log_write_to_syslog (int errno_, const char *msg, int verbosity, void *arg);
@@ -22,6 +22,10 @@
 #include "../container.h"
 #include "../utils.h"
 #include "handler-utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 int
 wasm_can_handle_container (libcrun_container_t *container, libcrun_error_t *err arg_unused)
@@ -34,7 +38,7 @@ wasm_can_handle_container (libcrun_container_t *container, libcrun_error_t *err
 
   entrypoint_executable = container->container_def->process->args[0];
 
-  annotation = find_annotation (container, "run.oci.handler");
+  annotation = find_known_annotation (container, ANNOTATION_HANDLER);
   if (annotation)
     {
 
@@ -50,7 +54,7 @@ wasm_can_handle_container (libcrun_container_t *container, libcrun_error_t *err
       return strcmp (annotation, "wasm") == 0 ? 1 : 0;
     }
 
-  annotation = find_annotation (container, "module.wasm.image/variant");
+  annotation = find_known_annotation (container, ANNOTATION_MODULE_WASM_VARIANT);
   if (annotation)
     {
 
@@ -69,3 +73,51 @@ wasm_can_handle_container (libcrun_container_t *container, libcrun_error_t *err
 
   return 0;
 }
+
+int
+wasm_map_module_fd (libcrun_container_t *container, int fd, const char *pathname, bool writable,
+                    struct libcrun_mmap_s **module, libcrun_error_t *err)
+{
+  const char *annotation;
+  struct stat st;
+  int flags = MAP_PRIVATE;
+  int ret;
+
+  ret = fstat (fd, &st);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "fstat `%s`", pathname);
+
+  if (UNLIKELY (st.st_size == 0))
+    return crun_make_error (err, 0, "the wasm module `%s` is empty", pathname);
+
+  annotation = find_known_annotation (container, ANNOTATION_WASM_POPULATE);
+  if (annotation && strcmp (annotation, "1") == 0)
+    flags |= MAP_POPULATE;
+
+  ret = libcrun_mmap (module, NULL, st.st_size, PROT_READ | (writable ? PROT_WRITE : 0), flags, fd, 0, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  /* The engines parse the module front to back, only once: start the
+     readahead now and let the kernel drop the pages behind the parser.  */
+  if (! (flags & MAP_POPULATE))
+    {
+      (void) madvise ((*module)->addr, (*module)->length, MADV_SEQUENTIAL);
+      (void) madvise ((*module)->addr, (*module)->length, MADV_WILLNEED);
+    }
+
+  return 0;
+}
+
+int
+wasm_map_module (libcrun_container_t *container, const char *pathname, bool writable,
+                 struct libcrun_mmap_s **module, libcrun_error_t *err)
+{
+  cleanup_close int fd = -1;
+
+  fd = TEMP_FAILURE_RETRY (open (pathname, O_RDONLY | O_CLOEXEC));
+  if (UNLIKELY (fd < 0))
+    return crun_make_error (err, errno, "open `%s`", pathname);
+
+  return wasm_map_module_fd (container, fd, pathname, writable, module, err);
+}
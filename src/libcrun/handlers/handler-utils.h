@@ -19,8 +19,19 @@
 #define HANDLER_UTILS_H
 
 #include "../container.h"
+#include "../utils.h"
 #include <unistd.h>
 
 int wasm_can_handle_container (libcrun_container_t *container, libcrun_error_t *err);
 
+/* Map the module in FD without copying it.  The mapping is private and
+   read-only unless WRITABLE is set, in which case writes are copy-on-write.
+   The pages are prefaulted when the container sets the
+   run.oci.wasm_populate=1 annotation.  */
+int wasm_map_module_fd (libcrun_container_t *container, int fd, const char *pathname, bool writable,
+                        struct libcrun_mmap_s **module, libcrun_error_t *err);
+
+int wasm_map_module (libcrun_container_t *container, const char *pathname, bool writable,
+                     struct libcrun_mmap_s **module, libcrun_error_t *err);
+
 #endif
@@ -22,6 +22,7 @@
 #include "../container.h"
 #include "../utils.h"
 #include "../linux.h"
+#include "../trace.h"
 #include <unistd.h>
 #include <sys/stat.h>
 #include <errno.h>
@@ -68,6 +69,10 @@
 #define KRUN_FLAVOR_AWS_NITRO "aws-nitro"
 #define KRUN_FLAVOR_SEV "sev"
 
+#define LIBKRUN_SO "libkrun.so.1"
+#define LIBKRUN_SEV_SO "libkrun-sev.so.1"
+#define LIBKRUN_AWSNITRO_SO "libkrun-awsnitro.so.1"
+
 struct krun_config
 {
   void *handle;
@@ -84,10 +89,45 @@ struct krun_config
 
 /* libkrun handler.  */
 #if HAVE_DLOPEN && HAVE_LIBKRUN
+
+/* Context created by libkrun_load for the warmed up handler, in a long
+   running process that forks a new process for each container.  The
+   warmed up handler never runs a VM, so the first libkrun_load in each
+   container process takes the context from its own copy instead of
+   creating a new one.  The context is taken with an atomic exchange, so
+   it is used only once when containers are loaded from several threads.  */
+struct krun_spare_ctx
+{
+  const char *library;
+  /* The context is valid only for the library instance that created it,
+     it stays loaded as long as the warmed up handler is alive.  */
+  void *handle;
+  int32_t ctx_id;
+};
+
+static struct krun_spare_ctx spare_ctxs[] = {
+  { .library = LIBKRUN_SO, .ctx_id = -1 },
+  { .library = LIBKRUN_SEV_SO, .ctx_id = -1 },
+  { .library = LIBKRUN_AWSNITRO_SO, .ctx_id = -1 },
+};
+
+static struct krun_spare_ctx *
+get_spare_ctx (const char *library)
+{
+  size_t i;
+
+  for (i = 0; i < sizeof (spare_ctxs) / sizeof (spare_ctxs[0]); i++)
+    if (strcmp (spare_ctxs[i].library, library) == 0)
+      return &spare_ctxs[i];
+
+  return NULL;
+}
+
 static int32_t
-libkrun_create_context (void *handle, libcrun_error_t *err)
+libkrun_new_context (void *handle, const char *library, libcrun_error_t *err)
 {
   int32_t (*krun_create_ctx) ();
+  uint64_t start = libcrun_trace_now ();
   int32_t ctx_id;
 
   krun_create_ctx = dlsym (handle, "krun_create_ctx");
@@ -98,9 +138,70 @@ libkrun_create_context (void *handle, libcrun_error_t *err)
   if (UNLIKELY (ctx_id < 0))
     return crun_make_error (err, -ctx_id, "could not create krun context");
 
+  libcrun_trace ("krun: context %d for `%s` created in %llu us", ctx_id, library,
+                 (unsigned long long) (libcrun_trace_now () - start) / 1000);
+
   return ctx_id;
 }
 
+static int32_t
+libkrun_create_context (void *handle, const char *library, libcrun_error_t *err)
+{
+  struct krun_spare_ctx *spare = get_spare_ctx (library);
+
+  if (spare && __atomic_load_n (&spare->handle, __ATOMIC_ACQUIRE) == handle)
+    {
+      int32_t ctx_id = __atomic_exchange_n (&spare->ctx_id, -1, __ATOMIC_ACQ_REL);
+
+      if (ctx_id >= 0)
+        {
+          libcrun_trace ("krun: spare context %d for `%s` used", ctx_id, library);
+          return ctx_id;
+        }
+    }
+
+  return libkrun_new_context (handle, library, err);
+}
+
+/* Hand CTX_ID, created for the warmed up handler, to the next load.  */
+static void
+libkrun_set_spare_ctx (void *handle, const char *library, int32_t ctx_id)
+{
+  struct krun_spare_ctx *spare = get_spare_ctx (library);
+
+  if (handle == NULL || spare == NULL)
+    return;
+
+  /* The handle is set before the context is published.  */
+  __atomic_store_n (&spare->handle, handle, __ATOMIC_RELEASE);
+  __atomic_store_n (&spare->ctx_id, ctx_id, __ATOMIC_RELEASE);
+}
+
+/* Drop the spare context CTX_ID published for HANDLE before the library
+   is closed, so that a later load never takes a context from an unloaded
+   library.  The other instances of the same library keep it loaded while
+   the warmed up handler is alive, so only its own context is dropped.  */
+static void
+libkrun_clear_spare_ctx (void *handle, int32_t ctx_id)
+{
+  size_t i;
+
+  if (handle == NULL || ctx_id < 0)
+    return;
+
+  for (i = 0; i < sizeof (spare_ctxs) / sizeof (spare_ctxs[0]); i++)
+    {
+      int32_t expected = ctx_id;
+
+      if (__atomic_load_n (&spare_ctxs[i].handle, __ATOMIC_ACQUIRE) != handle)
+        continue;
+
+      if (__atomic_compare_exchange_n (&spare_ctxs[i].ctx_id, &expected, -1, false, __ATOMIC_ACQ_REL,
+                                       __ATOMIC_ACQUIRE))
+        __atomic_store_n (&spare_ctxs[i].handle, NULL, __ATOMIC_RELEASE);
+    }
+}
+
 static int
 libkrun_configure_kernel (uint32_t ctx_id, void *handle, yajl_val *config_tree, libcrun_error_t *err)
 {
@@ -287,7 +388,7 @@ libkrun_configure_flavor (void *cookie, yajl_val *config_tree, libcrun_container
   close_handles[1] = NULL;
 
   // Check if the user provided the krun variant through OCI annotations.
-  flavor = find_annotation (container, "krun.variant");
+  flavor = find_known_annotation (container, ANNOTATION_KRUN_VARIANT);
   if (flavor == NULL && *config_tree != NULL)
     {
       // If the user doesn't specify a variant via OCI annotations, check the krun VM config to see if the "flavor" field was populated.
@@ -546,21 +647,33 @@ libkrun_configure_container (void *cookie, enum handler_configure_phase phase,
     {
       cleanup_free char *origin_config_path = NULL;
       cleanup_free char *state_dir = NULL;
-      cleanup_free char *config = NULL;
+      cleanup_free char *config_buffer = NULL;
       cleanup_close int fd = -1;
+      const char *config;
       size_t config_size;
 
-      ret = libcrun_get_state_directory (&state_dir, context->state_root, context->id, err);
-      if (UNLIKELY (ret < 0))
-        return ret;
+      /* The configuration the container was loaded from is the same that
+         was copied to the state directory, use it when it is available.  */
+      if (container->config_file_content)
+        {
+          config = container->config_file_content;
+          config_size = strlen (config);
+        }
+      else
+        {
+          ret = libcrun_get_state_directory (&state_dir, context->state_root, context->id, err);
+          if (UNLIKELY (ret < 0))
+            return ret;
 
-      ret = append_paths (&origin_config_path, err, state_dir, "config.json", NULL);
-      if (UNLIKELY (ret < 0))
-        return ret;
+          ret = append_paths (&origin_config_path, err, state_dir, "config.json", NULL);
+          if (UNLIKELY (ret < 0))
+            return ret;
 
-      ret = read_all_file (origin_config_path, &config, &config_size, err);
-      if (UNLIKELY (ret < 0))
-        return ret;
+          ret = read_all_file (origin_config_path, &config_buffer, &config_size, err);
+          if (UNLIKELY (ret < 0))
+            return ret;
+          config = config_buffer;
+        }
 
       /* CVE-2025-24965: the content below rootfs cannot be trusted because it is controlled by the user.  We
          must ensure the file is opened below the rootfs directory.  */
@@ -657,9 +770,9 @@ libkrun_load (void **cookie, libcrun_error_t *err)
 {
   int32_t ret;
   struct krun_config *kconf;
-  const char *libkrun_so = "libkrun.so.1";
-  const char *libkrun_sev_so = "libkrun-sev.so.1";
-  const char *libkrun_awsnitro_so = "libkrun-awsnitro.so.1";
+  const char *libkrun_so = LIBKRUN_SO;
+  const char *libkrun_sev_so = LIBKRUN_SEV_SO;
+  const char *libkrun_awsnitro_so = LIBKRUN_AWSNITRO_SO;
 
   kconf = malloc (sizeof (struct krun_config));
   if (kconf == NULL)
@@ -684,7 +797,7 @@ libkrun_load (void **cookie, libcrun_error_t *err)
      or it won't be able to find the library bundling the kernel. */
   if (kconf->handle)
     {
-      ret = libkrun_create_context (kconf->handle, err);
+      ret = libkrun_create_context (kconf->handle, libkrun_so, err);
       if (UNLIKELY (ret < 0))
         goto error;
       kconf->ctx_id = ret;
@@ -692,14 +805,14 @@ libkrun_load (void **cookie, libcrun_error_t *err)
 
   if (kconf->handle_sev)
     {
-      ret = libkrun_create_context (kconf->handle_sev, err);
+      ret = libkrun_create_context (kconf->handle_sev, libkrun_sev_so, err);
       if (UNLIKELY (ret < 0))
         goto error;
       kconf->ctx_id_sev = ret;
     }
   if (kconf->handle_awsnitro)
     {
-      ret = libkrun_create_context (kconf->handle_awsnitro, err);
+      ret = libkrun_create_context (kconf->handle_awsnitro, libkrun_awsnitro_so, err);
       if (UNLIKELY (ret < 0))
         goto error;
       kconf->ctx_id_awsnitro = ret;
@@ -728,6 +841,10 @@ libkrun_unload (void *cookie, libcrun_error_t *err)
   struct krun_config *kconf = (struct krun_config *) cookie;
   if (kconf != NULL)
     {
+      libkrun_clear_spare_ctx (kconf->handle, kconf->ctx_id);
+      libkrun_clear_spare_ctx (kconf->handle_sev, kconf->ctx_id_sev);
+      libkrun_clear_spare_ctx (kconf->handle_awsnitro, kconf->ctx_id_awsnitro);
+
       if (kconf->handle != NULL)
         {
           r = dlclose (kconf->handle);
@@ -751,6 +868,17 @@ libkrun_unload (void *cookie, libcrun_error_t *err)
   return 0;
 }
 
+static int
+libkrun_warmup (void *cookie, libcrun_error_t *err arg_unused)
+{
+  struct krun_config *kconf = (struct krun_config *) cookie;
+
+  libkrun_set_spare_ctx (kconf->handle, LIBKRUN_SO, kconf->ctx_id);
+  libkrun_set_spare_ctx (kconf->handle_sev, LIBKRUN_SEV_SO, kconf->ctx_id_sev);
+  libkrun_set_spare_ctx (kconf->handle_awsnitro, LIBKRUN_AWSNITRO_SO, kconf->ctx_id_awsnitro);
+  return 0;
+}
+
 static runtime_spec_schema_defs_linux_device_cgroup *
 make_oci_spec_dev (const char *type, dev_t device, bool allow, const char *access)
 {
@@ -855,6 +983,7 @@ struct custom_handler_s handler_libkrun = {
   .run_func = libkrun_exec,
   .configure_container = libkrun_configure_container,
   .modify_oci_configuration = libkrun_modify_oci_configuration,
+  .warmup = libkrun_warmup,
 };
 
 #endif
@@ -153,7 +153,7 @@ mono_can_handle_container (libcrun_container_t *container, libcrun_error_t *err
 {
   const char *annotation;
 
-  annotation = find_annotation (container, "run.oci.handler");
+  annotation = find_known_annotation (container, ANNOTATION_HANDLER);
   if (annotation)
     return strcmp (annotation, "dotnet") == 0 ? 1 : 0;
 
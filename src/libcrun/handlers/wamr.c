@@ -42,6 +42,12 @@
 
 #if HAVE_DLOPEN && HAVE_WAMR
 
+/* Set by libwamr_warmup, the containers inherit the initialized runtime.
+   wasm_runtime_init only sets up the allocator and does not start any
+   thread, so it is safe to use after fork ().  It is accessed atomically,
+   as warmup can run on any thread of the caller.  */
+static bool warm_runtime;
+
 static int
 libwamr_load (void **cookie, libcrun_error_t *err)
 {
@@ -151,9 +157,8 @@ libwamr_exec (void *cookie, __attribute__ ((unused)) libcrun_container_t *contai
 
   int ret;
   const char *exception;
-  cleanup_free char *buffer = NULL;
+  cleanup_mmap struct libcrun_mmap_s *mapped = NULL;
   char error_buf[128];
-  size_t buffer_size;
   uint32_t stack_size = 8096, heap_size = 0;
   libcrun_error_t tmp_err = NULL;
   const char *wasi_proc_exit_exception = "wasi proc exit";
@@ -170,22 +175,22 @@ libwamr_exec (void *cookie, __attribute__ ((unused)) libcrun_container_t *contai
     arg_count++;
 
   // initialize the wasm runtime by default configurations
-  if (! wasm_runtime_init ())
+  if (! __atomic_load_n (&warm_runtime, __ATOMIC_ACQUIRE) && ! wasm_runtime_init ())
     error (EXIT_FAILURE, 0, "Failed to initialize the wasm runtime");
 
-  // read WASM file into a memory buffer
-  ret = read_all_file (pathname, &buffer, &buffer_size, &tmp_err);
+  // map the WASM file, the loader may patch the buffer so writes are copy-on-write
+  ret = wasm_map_module (container, pathname, true, &mapped, &tmp_err);
   if (UNLIKELY (ret < 0))
     {
       crun_error_release (&tmp_err);
       error (EXIT_FAILURE, 0, "Failed to read file");
     }
 
-  if (UNLIKELY (buffer_size > UINT32_MAX))
+  if (UNLIKELY (mapped->length > UINT32_MAX))
     error (EXIT_FAILURE, 0, "File size is too large");
 
-  // parse the WASM file from buffer and create a WASM module
-  module = wasm_runtime_load (buffer, buffer_size, error_buf, sizeof (error_buf));
+  // parse the WASM file from the mapping and create a WASM module
+  module = wasm_runtime_load (mapped->addr, mapped->length, error_buf, sizeof (error_buf));
   if (! module)
     error (EXIT_FAILURE, 0, "Failed to load WASM file");
 
@@ -228,6 +233,22 @@ libwamr_exec (void *cookie, __attribute__ ((unused)) libcrun_container_t *contai
   exit (EXIT_SUCCESS);
 }
 
+static int
+libwamr_warmup (void *cookie, libcrun_error_t *err)
+{
+  bool (*wasm_runtime_init) ();
+
+  wasm_runtime_init = dlsym (cookie, "wasm_runtime_init");
+  if (wasm_runtime_init == NULL)
+    return crun_make_error (err, 0, "could not find wasm_runtime_init symbol in `libiwasm.so`");
+
+  if (! wasm_runtime_init ())
+    return crun_make_error (err, 0, "failed to initialize the wasm runtime");
+
+  __atomic_store_n (&warm_runtime, true, __ATOMIC_RELEASE);
+  return 0;
+}
+
 static int
 libwamr_can_handle_container (libcrun_container_t *container, libcrun_error_t *err)
 {
@@ -242,6 +263,7 @@ struct custom_handler_s handler_wamr = {
   .unload = libwamr_unload,
   .run_func = libwamr_exec,
   .can_handle_container = libwamr_can_handle_container,
+  .warmup = libwamr_warmup,
 };
 
 #endif
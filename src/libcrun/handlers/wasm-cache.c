@@ -0,0 +1,376 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include "../container.h"
+#include "../utils.h"
+#include "../status.h"
+#include "../trace.h"
+#include "handler-utils.h"
+#include "wasm-cache.h"
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#ifdef HAVE_DLOPEN
+#  include <dlfcn.h>
+#endif
+
+#define WASM_CACHE_DIR ".cache/wasm"
+
+/* Upper bound for the size of all the artifacts in the cache.  When a new
+   artifact does not fit, the least recently used ones are deleted.  */
+#define WASM_CACHE_MAX_SIZE (1024LL * 1024 * 1024)
+
+/* Temporary files left behind by a compilation that was killed.  */
+#define WASM_CACHE_STALE_TMP_SECONDS 3600
+
+/* Hit and miss counters of the cache, shared by all the crun processes
+   through a mapping of this file.  The eviction skips it because of the
+   leading dot.  */
+#define WASM_CACHE_STATS_FILE ".stats"
+
+struct wasm_cache_stats_s
+{
+  uint64_t hits;
+  uint64_t misses;
+};
+
+#ifdef HAVE_DLOPEN
+
+/* The key covers the module bytes and everything that affects the
+   generated code: the engine library, its configuration and the
+   architecture.  */
+static int
+calculate_key (void *cookie, const struct wasm_cache_engine_s *engine, const void *module, size_t module_len,
+               libcrun_cache_key_t out, libcrun_error_t *err)
+{
+  blake3_hasher hasher;
+  struct stat st;
+  Dl_info info;
+  void *sym;
+  int ret;
+
+  sym = dlsym (cookie, engine->symbol);
+  if (sym == NULL || dladdr (sym, &info) == 0 || info.dli_fname == NULL)
+    return crun_make_error (err, 0, "cannot find the library for `%s`", engine->name);
+
+  ret = stat (info.dli_fname, &st);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "stat `%s`", info.dli_fname);
+
+  ret = libcrun_cache_key_init (&hasher, false, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+#  define PROCESS_DATA(X) libcrun_cache_key_add_data (&hasher, &(X), sizeof ((X)))
+
+  libcrun_cache_key_add_string (&hasher, engine->name);
+  libcrun_cache_key_add_string (&hasher, engine->config);
+  libcrun_cache_key_add_string (&hasher, info.dli_fname);
+  PROCESS_DATA (st.st_dev);
+  PROCESS_DATA (st.st_ino);
+  PROCESS_DATA (st.st_size);
+  PROCESS_DATA (st.st_mtim.tv_sec);
+  PROCESS_DATA (st.st_mtim.tv_nsec);
+  PROCESS_DATA (module_len);
+  libcrun_cache_key_add_data (&hasher, module, module_len);
+
+#  undef PROCESS_DATA
+
+  libcrun_cache_key_final (&hasher, out);
+  return 0;
+}
+
+static int
+map_artifact (int cache_dirfd, const char *key, struct libcrun_mmap_s **artifact, libcrun_error_t *err)
+{
+  struct timespec times[2] = { { .tv_nsec = UTIME_NOW }, { .tv_nsec = UTIME_OMIT } };
+  cleanup_close int fd = -1;
+  struct stat st;
+  int ret;
+
+  fd = TEMP_FAILURE_RETRY (openat (cache_dirfd, key, O_RDONLY | O_NOFOLLOW | O_CLOEXEC));
+  if (fd < 0)
+    {
+      if (errno == ENOENT)
+        return 0;
+      return crun_make_error (err, errno, "open `%s/%s`", WASM_CACHE_DIR, key);
+    }
+
+  ret = fstat (fd, &st);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "fstat `%s/%s`", WASM_CACHE_DIR, key);
+
+  if (st.st_size == 0)
+    return 0;
+
+  /* The atime drives the eviction, do not depend on the relatime setting.  */
+  (void) futimens (fd, times);
+
+  ret = libcrun_mmap (artifact, NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  return 1;
+}
+
+static int
+store_artifact (void *cookie, const struct wasm_cache_engine_s *engine, int cache_dirfd, const char *id,
+                const char *key, const char *pathname, const void *module, size_t module_len,
+                libcrun_error_t *err)
+{
+  cleanup_free char *tmp_name = NULL;
+  cleanup_close int fd = -1;
+  struct stat st;
+  int status = 0;
+  pid_t pid;
+  int ret;
+
+  /* The container id makes the name unique among concurrent writers.  */
+  xasprintf (&tmp_name, "%s.%s.tmp", key, id);
+
+  fd = TEMP_FAILURE_RETRY (openat (cache_dirfd, tmp_name, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600));
+  if (UNLIKELY (fd < 0))
+    return crun_make_error (err, errno, "open `%s/%s`", WASM_CACHE_DIR, tmp_name);
+
+  pid = fork ();
+  if (UNLIKELY (pid < 0))
+    {
+      ret = crun_make_error (err, errno, "fork");
+      goto fail;
+    }
+  if (pid == 0)
+    {
+      ret = engine->compile (cookie, pathname, module, module_len, fd);
+      _safe_exit (ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+  ret = waitpid_ignore_stopped (pid, &status, 0);
+  if (UNLIKELY (ret < 0))
+    {
+      ret = crun_make_error (err, errno, "waitpid for the `%s` compiler", engine->name);
+      goto fail;
+    }
+  if (! WIFEXITED (status) || WEXITSTATUS (status) != 0)
+    {
+      ret = crun_make_error (err, 0, "could not compile `%s` with `%s`", pathname, engine->name);
+      goto fail;
+    }
+
+  ret = fstat (fd, &st);
+  if (UNLIKELY (ret < 0))
+    {
+      ret = crun_make_error (err, errno, "fstat `%s/%s`", WASM_CACHE_DIR, tmp_name);
+      goto fail;
+    }
+
+  ret = libcrun_cache_evict (cache_dirfd, WASM_CACHE_MAX_SIZE, st.st_blocks * 512, WASM_CACHE_STALE_TMP_SECONDS, err);
+  if (UNLIKELY (ret < 0))
+    goto fail;
+
+  ret = renameat (cache_dirfd, tmp_name, cache_dirfd, key);
+  if (UNLIKELY (ret < 0))
+    {
+      ret = crun_make_error (err, errno, "rename `%s` to `%s`", tmp_name, key);
+      goto fail;
+    }
+
+  return 0;
+
+fail:
+  unlinkat (cache_dirfd, tmp_name, 0);
+  return ret;
+}
+
+/* Add the lookup to the counters in the cache directory and return their
+   new values in STATS.  The counters are informational, errors leave them
+   unchanged.  */
+static void
+count_lookup (int cache_dirfd, bool hit, struct wasm_cache_stats_s *stats)
+{
+  cleanup_mmap struct libcrun_mmap_s *mapping = NULL;
+  struct wasm_cache_stats_s *shared;
+  libcrun_error_t tmp_err = NULL;
+  cleanup_close int fd = -1;
+  struct stat st;
+  int ret;
+
+  memset (stats, 0, sizeof (*stats));
+
+  fd = TEMP_FAILURE_RETRY (openat (cache_dirfd, WASM_CACHE_STATS_FILE, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600));
+  if (UNLIKELY (fd < 0))
+    return;
+
+  /* Growing the file from several processes at once is safe, the new
+     counters start at zero and a smaller size never truncates it.  */
+  ret = fstat (fd, &st);
+  if (LIKELY (ret == 0) && st.st_size < (off_t) sizeof (*shared))
+    ret = ftruncate (fd, sizeof (*shared));
+  if (UNLIKELY (ret < 0))
+    return;
+
+  ret = libcrun_mmap (&mapping, NULL, sizeof (*shared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0, &tmp_err);
+  if (UNLIKELY (ret < 0))
+    {
+      crun_error_release (&tmp_err);
+      return;
+    }
+  shared = mapping->addr;
+
+  __atomic_add_fetch (hit ? &shared->hits : &shared->misses, 1, __ATOMIC_RELAXED);
+  stats->hits = __atomic_load_n (&shared->hits, __ATOMIC_RELAXED);
+  stats->misses = __atomic_load_n (&shared->misses, __ATOMIC_RELAXED);
+}
+
+static int
+open_cache_dirfd (libcrun_context_t *context, libcrun_error_t *err)
+{
+  cleanup_free char *dir = NULL;
+  cleanup_close int dirfd = -1;
+  int ret;
+
+  ret = libcrun_get_state_directory (&dir, context->state_root, NULL, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  dirfd = TEMP_FAILURE_RETRY (open (dir, O_PATH | O_DIRECTORY | O_CLOEXEC));
+  if (UNLIKELY (dirfd < 0))
+    return crun_make_error (err, errno, "open `%s`", dir);
+
+  ret = crun_ensure_directory_at (dirfd, WASM_CACHE_DIR, 0700, true, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = TEMP_FAILURE_RETRY (openat (dirfd, WASM_CACHE_DIR, O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "open `%s/%s`", dir, WASM_CACHE_DIR);
+
+  return ret;
+}
+
+int
+wasm_cache_lookup (void *cookie, const struct wasm_cache_engine_s *engine, libcrun_context_t *context,
+                   libcrun_container_t *container, const char *rootfs, struct libcrun_mmap_s **artifact,
+                   libcrun_error_t *err)
+{
+  runtime_spec_schema_config_schema *def = container->container_def;
+  cleanup_close int cache_dirfd = -1;
+  cleanup_close int rootfsfd = -1;
+  cleanup_mmap struct libcrun_mmap_s *module = NULL;
+  cleanup_close int fd = -1;
+  const char *annotation;
+  struct wasm_cache_stats_s stats;
+  libcrun_cache_key_t key;
+  const char *pathname;
+  uint64_t start;
+  int ret;
+
+  *artifact = NULL;
+
+  annotation = find_known_annotation (container, ANNOTATION_WASM_CACHE);
+  if (annotation && strcmp (annotation, "0") == 0)
+    return 0;
+
+  /* Only an absolute entrypoint can be resolved before the pivot_root.  */
+  if (def->process == NULL || def->process->args_len == 0 || def->process->args[0][0] != '/')
+    return 0;
+
+  pathname = def->process->args[0];
+  start = libcrun_trace_now ();
+
+  rootfsfd = TEMP_FAILURE_RETRY (open (rootfs, O_PATH | O_DIRECTORY | O_CLOEXEC));
+  if (UNLIKELY (rootfsfd < 0))
+    return crun_make_error (err, errno, "open `%s`", rootfs);
+
+  fd = safe_openat (rootfsfd, rootfs, pathname, O_RDONLY | O_CLOEXEC, 0, err);
+  if (UNLIKELY (fd < 0))
+    return fd;
+
+  ret = wasm_map_module_fd (container, fd, pathname, false, &module, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = calculate_key (cookie, engine, module->addr, module->length, key, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  cache_dirfd = open_cache_dirfd (context, err);
+  if (UNLIKELY (cache_dirfd < 0))
+    {
+      int errno_ = crun_error_get_errno (err);
+
+      /* The state directory is not writeable, e.g. from a user namespace.  */
+      if (errno_ == EACCES || errno_ == EPERM || errno_ == EROFS)
+        {
+          crun_error_release (err);
+          return 0;
+        }
+      return cache_dirfd;
+    }
+
+  ret = map_artifact (cache_dirfd, key, artifact, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+  if (ret > 0)
+    {
+      count_lookup (cache_dirfd, true, &stats);
+      libcrun_trace ("wasm cache: %s hit for `%s` (%.12s, %zu bytes) in %llu us, %" PRIu64 " hits, %" PRIu64 " misses",
+                     engine->name, pathname, key, (*artifact)->length,
+                     (unsigned long long) ((libcrun_trace_now () - start) / 1000), stats.hits, stats.misses);
+      return 1;
+    }
+
+  ret = store_artifact (cookie, engine, cache_dirfd, context->id, key, pathname, module->addr, module->length, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = map_artifact (cache_dirfd, key, artifact, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  count_lookup (cache_dirfd, false, &stats);
+  libcrun_trace ("wasm cache: %s miss for `%s` (%.12s), compiled in %llu us, %" PRIu64 " hits, %" PRIu64 " misses",
+                 engine->name, pathname, key, (unsigned long long) ((libcrun_trace_now () - start) / 1000), stats.hits,
+                 stats.misses);
+  return ret;
+}
+
+#else
+
+int
+wasm_cache_lookup (void *cookie arg_unused, const struct wasm_cache_engine_s *engine arg_unused,
+                   libcrun_context_t *context arg_unused, libcrun_container_t *container arg_unused,
+                   const char *rootfs arg_unused, struct libcrun_mmap_s **artifact, libcrun_error_t *err arg_unused)
+{
+  *artifact = NULL;
+  return 0;
+}
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WASM_CACHE_H
+#define WASM_CACHE_H
+
+#include "../container.h"
+#include "../utils.h"
+
+/* Compile the module MODULE, read from PATHNAME, and write the serialized
+   artifact to OUT_FD.  It runs in a short-lived child process, so the
+   threads started by the engine do not leak into the container init.
+   Returns 0 on success.  */
+typedef int (*wasm_cache_compile_cb) (void *cookie, const char *pathname, const void *module,
+                                      size_t module_len, int out_fd);
+
+struct wasm_cache_engine_s
+{
+  /* Name of the handler, e.g. "wasmtime".  */
+  const char *name;
+  /* A symbol exported by the engine library, used to fingerprint it.  */
+  const char *symbol;
+  /* Engine configuration that affects the generated code.  */
+  const char *config;
+  wasm_cache_compile_cb compile;
+};
+
+/* Look up the precompiled artifact for the container entrypoint in the
+   cache under the state root, compiling and storing it on a miss.  It must
+   be called before the pivot_root, the mapping stays valid afterwards.
+
+   Returns:
+   < 0 in case of errors
+   == 0 if there is no artifact for the entrypoint
+   == 1 if the artifact is mapped in ARTIFACT.  */
+int wasm_cache_lookup (void *cookie, const struct wasm_cache_engine_s *engine, libcrun_context_t *context,
+                       libcrun_container_t *container, const char *rootfs, struct libcrun_mmap_s **artifact,
+                       libcrun_error_t *err);
+
+#endif
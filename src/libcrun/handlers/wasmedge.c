@@ -23,12 +23,14 @@
 #include "../utils.h"
 #include "../linux.h"
 #include "handler-utils.h"
+#include "wasm-cache.h"
 #include <unistd.h>
 #include <sys/stat.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <fcntl.h>
 #include <sched.h>
+#include <stdio.h>
 
 #ifdef HAVE_DLOPEN
 #  include <dlfcn.h>
@@ -39,6 +41,11 @@
 #endif
 
 #if HAVE_DLOPEN && HAVE_WASMEDGE
+/* Configuration created by libwasmedge_warmup, inherited by the containers.
+   It is plain data, the VM is still created after the fork.  It is
+   accessed atomically, as warmup can run on any thread of the caller.  */
+static WasmEdge_ConfigureContext *warm_configure;
+
 static int
 libwasmedge_load (void **cookie, libcrun_error_t *err)
 {
@@ -66,17 +73,44 @@ libwasmedge_unload (void *cookie, libcrun_error_t *err)
   return 0;
 }
 
-static int
-libwasmedge_exec (void *cookie, __attribute__ ((unused)) libcrun_container_t *container, const char *pathname, char *const argv[])
+/* Configuration shared by the VM and the AOT compiler.  */
+static WasmEdge_ConfigureContext *
+libwasmedge_create_configure (void *cookie)
 {
   WasmEdge_ConfigureContext *(*WasmEdge_ConfigureCreate) (void);
-  void (*WasmEdge_ConfigureDelete) (WasmEdge_ConfigureContext *Cxt);
   void (*WasmEdge_ConfigureAddProposal) (WasmEdge_ConfigureContext *Cxt, const enum WasmEdge_Proposal Prop);
   void (*WasmEdge_ConfigureAddHostRegistration) (WasmEdge_ConfigureContext *Cxt, enum WasmEdge_HostRegistration Host);
+  WasmEdge_ConfigureContext *configure;
+
+  WasmEdge_ConfigureCreate = dlsym (cookie, "WasmEdge_ConfigureCreate");
+  WasmEdge_ConfigureAddProposal = dlsym (cookie, "WasmEdge_ConfigureAddProposal");
+  WasmEdge_ConfigureAddHostRegistration = dlsym (cookie, "WasmEdge_ConfigureAddHostRegistration");
+  if (WasmEdge_ConfigureCreate == NULL || WasmEdge_ConfigureAddProposal == NULL
+      || WasmEdge_ConfigureAddHostRegistration == NULL)
+    return NULL;
+
+  configure = WasmEdge_ConfigureCreate ();
+  if (UNLIKELY (configure == NULL))
+    return NULL;
+
+  WasmEdge_ConfigureAddProposal (configure, WasmEdge_Proposal_BulkMemoryOperations);
+  WasmEdge_ConfigureAddProposal (configure, WasmEdge_Proposal_ReferenceTypes);
+  WasmEdge_ConfigureAddProposal (configure, WasmEdge_Proposal_SIMD);
+  WasmEdge_ConfigureAddHostRegistration (configure, WasmEdge_HostRegistration_Wasi);
+  return configure;
+}
+
+static int
+libwasmedge_exec (void *cookie, libcrun_container_t *container, const char *pathname, char *const argv[])
+{
+  /* AOT compiled module found in the cache before the pivot_root.  */
+  struct libcrun_mmap_s *cached_module = container->context ? container->context->wasm_cached_module : NULL;
+  void (*WasmEdge_ConfigureDelete) (WasmEdge_ConfigureContext *Cxt);
   WasmEdge_VMContext *(*WasmEdge_VMCreate) (const WasmEdge_ConfigureContext *ConfCxt, WasmEdge_StoreContext *StoreCxt);
   void (*WasmEdge_VMDelete) (WasmEdge_VMContext *Cxt);
   WasmEdge_Result (*WasmEdge_VMRegisterModuleFromFile) (WasmEdge_VMContext *Cxt, WasmEdge_String ModuleName, const char *Path);
   WasmEdge_Result (*WasmEdge_VMRunWasmFromFile) (WasmEdge_VMContext *Cxt, const char *Path, const WasmEdge_String FuncName, const WasmEdge_Value *Params, const uint32_t ParamLen, WasmEdge_Value *Returns, const uint32_t ReturnLen);
+  WasmEdge_Result (*WasmEdge_VMRunWasmFromBuffer) (WasmEdge_VMContext *Cxt, const uint8_t *Buf, const uint32_t BufLen, const WasmEdge_String FuncName, const WasmEdge_Value *Params, const uint32_t ParamLen, WasmEdge_Value *Returns, const uint32_t ReturnLen);
   void (*WasmEdge_PluginLoadFromPath) (const char *Path);
   void (*WasmEdge_PluginInitWASINN) (const char *const *NNPreloads, const uint32_t PreloadsLen);
   bool (*WasmEdge_ResultOK) (const WasmEdge_Result Res);
@@ -93,35 +127,30 @@ libwasmedge_exec (void *cookie, __attribute__ ((unused)) libcrun_container_t *co
   void (*WasmEdge_ModuleInstanceInitWASI) (WasmEdge_ModuleInstanceContext *Cxt, const char *const *Args, const uint32_t ArgLen, const char *const *Envs, const uint32_t EnvLen, const char *const *Dirs, const uint32_t DirLen, const char *const *Preopens, const uint32_t PreopenLen);
   WasmEdge_ModuleInstanceInitWASI = dlsym (cookie, "WasmEdge_ModuleInstanceInitWASI");
 
-  WasmEdge_ConfigureCreate = dlsym (cookie, "WasmEdge_ConfigureCreate");
   WasmEdge_ConfigureDelete = dlsym (cookie, "WasmEdge_ConfigureDelete");
-  WasmEdge_ConfigureAddProposal = dlsym (cookie, "WasmEdge_ConfigureAddProposal");
-  WasmEdge_ConfigureAddHostRegistration = dlsym (cookie, "WasmEdge_ConfigureAddHostRegistration");
   WasmEdge_VMCreate = dlsym (cookie, "WasmEdge_VMCreate");
   WasmEdge_VMDelete = dlsym (cookie, "WasmEdge_VMDelete");
   WasmEdge_VMRegisterModuleFromFile = dlsym (cookie, "WasmEdge_VMRegisterModuleFromFile");
   WasmEdge_VMGetImportModuleContext = dlsym (cookie, "WasmEdge_VMGetImportModuleContext");
   WasmEdge_VMRunWasmFromFile = dlsym (cookie, "WasmEdge_VMRunWasmFromFile");
+  WasmEdge_VMRunWasmFromBuffer = dlsym (cookie, "WasmEdge_VMRunWasmFromBuffer");
   WasmEdge_PluginLoadFromPath = dlsym (cookie, "WasmEdge_PluginLoadFromPath");
   WasmEdge_PluginInitWASINN = dlsym (cookie, "WasmEdge_PluginInitWASINN");
   WasmEdge_ResultOK = dlsym (cookie, "WasmEdge_ResultOK");
   WasmEdge_StringCreateByCString = dlsym (cookie, "WasmEdge_StringCreateByCString");
 
-  if (WasmEdge_ConfigureCreate == NULL || WasmEdge_ConfigureDelete == NULL || WasmEdge_ConfigureAddProposal == NULL
-      || WasmEdge_ConfigureAddHostRegistration == NULL || WasmEdge_VMCreate == NULL || WasmEdge_VMDelete == NULL
+  if (WasmEdge_ConfigureDelete == NULL || WasmEdge_VMCreate == NULL || WasmEdge_VMDelete == NULL
       || WasmEdge_VMRegisterModuleFromFile == NULL || WasmEdge_VMGetImportModuleContext == NULL
       || WasmEdge_ModuleInstanceInitWASI == NULL || WasmEdge_VMRunWasmFromFile == NULL
       || WasmEdge_ResultOK == NULL || WasmEdge_StringCreateByCString == NULL)
     error (EXIT_FAILURE, 0, "could not find symbol in `libwasmedge.so.0`");
 
-  configure = WasmEdge_ConfigureCreate ();
+  configure = __atomic_load_n (&warm_configure, __ATOMIC_ACQUIRE);
+  if (configure == NULL)
+    configure = libwasmedge_create_configure (cookie);
   if (UNLIKELY (configure == NULL))
     error (EXIT_FAILURE, 0, "could not create wasmedge configure");
 
-  WasmEdge_ConfigureAddProposal (configure, WasmEdge_Proposal_BulkMemoryOperations);
-  WasmEdge_ConfigureAddProposal (configure, WasmEdge_Proposal_ReferenceTypes);
-  WasmEdge_ConfigureAddProposal (configure, WasmEdge_Proposal_SIMD);
-  WasmEdge_ConfigureAddHostRegistration (configure, WasmEdge_HostRegistration_Wasi);
   // Check if the necessary environment variables are set
   const char *plugin_path_env = getenv ("WASMEDGE_PLUGIN_PATH");
   if (plugin_path_env != NULL)
@@ -154,7 +183,10 @@ libwasmedge_exec (void *cookie, __attribute__ ((unused)) libcrun_container_t *co
 
   WasmEdge_ModuleInstanceInitWASI (wasi_module, (const char *const *) &argv[0], argn, (const char *const *) &environ[0], envn, dirs, 1, NULL, 0);
 
-  result = WasmEdge_VMRunWasmFromFile (vm, pathname, WasmEdge_StringCreateByCString ("_start"), NULL, 0, NULL, 0);
+  if (cached_module != NULL && WasmEdge_VMRunWasmFromBuffer != NULL && cached_module->length <= UINT32_MAX)
+    result = WasmEdge_VMRunWasmFromBuffer (vm, cached_module->addr, cached_module->length, WasmEdge_StringCreateByCString ("_start"), NULL, 0, NULL, 0);
+  else
+    result = WasmEdge_VMRunWasmFromFile (vm, pathname, WasmEdge_StringCreateByCString ("_start"), NULL, 0, NULL, 0);
 
   if (UNLIKELY (! WasmEdge_ResultOK (result)))
     {
@@ -168,6 +200,77 @@ libwasmedge_exec (void *cookie, __attribute__ ((unused)) libcrun_container_t *co
   exit (EXIT_SUCCESS);
 }
 
+static int
+libwasmedge_compile (void *cookie, const char *pathname, const void *module, size_t module_len, int out_fd)
+{
+  void (*WasmEdge_ConfigureCompilerSetOutputFormat) (WasmEdge_ConfigureContext *Cxt, const enum WasmEdge_CompilerOutputFormat Format);
+  WasmEdge_CompilerContext *(*WasmEdge_CompilerCreate) (const WasmEdge_ConfigureContext *ConfCxt);
+  WasmEdge_Result (*WasmEdge_CompilerCompileFromBuffer) (WasmEdge_CompilerContext *Cxt, const uint8_t *InBuffer, const uint64_t InBufferLen, const char *OutPath);
+  bool (*WasmEdge_ResultOK) (const WasmEdge_Result Res);
+  WasmEdge_ConfigureContext *configure;
+  WasmEdge_CompilerContext *compiler;
+  char out_path[64];
+
+  /* wat files are not supported by the wasmedge handler.  */
+  if (has_suffix (pathname, "wat") > 0)
+    return -1;
+
+  WasmEdge_ConfigureCompilerSetOutputFormat = dlsym (cookie, "WasmEdge_ConfigureCompilerSetOutputFormat");
+  WasmEdge_CompilerCreate = dlsym (cookie, "WasmEdge_CompilerCreate");
+  WasmEdge_CompilerCompileFromBuffer = dlsym (cookie, "WasmEdge_CompilerCompileFromBuffer");
+  WasmEdge_ResultOK = dlsym (cookie, "WasmEdge_ResultOK");
+
+  /* The AOT compiler is missing when wasmedge is built without LLVM.  */
+  if (WasmEdge_ConfigureCompilerSetOutputFormat == NULL || WasmEdge_CompilerCreate == NULL
+      || WasmEdge_CompilerCompileFromBuffer == NULL || WasmEdge_ResultOK == NULL)
+    return -1;
+
+  configure = libwasmedge_create_configure (cookie);
+  if (configure == NULL)
+    return -1;
+
+  WasmEdge_ConfigureCompilerSetOutputFormat (configure, WasmEdge_CompilerOutputFormat_Wasm);
+
+  compiler = WasmEdge_CompilerCreate (configure);
+  if (compiler == NULL)
+    return -1;
+
+  snprintf (out_path, sizeof (out_path), "/proc/self/fd/%d", out_fd);
+  if (! WasmEdge_ResultOK (WasmEdge_CompilerCompileFromBuffer (compiler, module, module_len, out_path)))
+    return -1;
+
+  /* The process exits right away, no need to release the compiler.  */
+  return 0;
+}
+
+static struct wasm_cache_engine_s wasmedge_cache_engine = {
+  .name = "wasmedge",
+  .symbol = "WasmEdge_VMCreate",
+  .config = "bulk-memory,reference-types,simd",
+  .compile = libwasmedge_compile,
+};
+
+static int
+libwasmedge_warmup (void *cookie, libcrun_error_t *err)
+{
+  void (*WasmEdge_ConfigureDelete) (WasmEdge_ConfigureContext *Cxt);
+  WasmEdge_ConfigureContext *configure, *expected = NULL;
+
+  configure = libwasmedge_create_configure (cookie);
+  if (UNLIKELY (configure == NULL))
+    return crun_make_error (err, 0, "could not create wasmedge configure");
+
+  /* Keep the first one if the handler was already warmed up.  */
+  if (! __atomic_compare_exchange_n (&warm_configure, &expected, configure, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      WasmEdge_ConfigureDelete = dlsym (cookie, "WasmEdge_ConfigureDelete");
+      if (WasmEdge_ConfigureDelete)
+        WasmEdge_ConfigureDelete (configure);
+    }
+
+  return 0;
+}
+
 static int
 wasmedge_can_handle_container (libcrun_container_t *container, libcrun_error_t *err)
 {
@@ -176,13 +279,21 @@ wasmedge_can_handle_container (libcrun_container_t *container, libcrun_error_t *
 
 // This works only when the plugin is present in /usr/lib/wasmedge
 static int
-libwasmedge_configure_container (void *cookie arg_unused, enum handler_configure_phase phase,
-                                 libcrun_context_t *context arg_unused, libcrun_container_t *container,
-                                 const char *rootfs arg_unused, libcrun_error_t *err)
+libwasmedge_configure_container (void *cookie, enum handler_configure_phase phase,
+                                 libcrun_context_t *context, libcrun_container_t *container,
+                                 const char *rootfs, libcrun_error_t *err)
 {
   int ret;
   runtime_spec_schema_config_schema *def = container->container_def;
 
+  if (phase == HANDLER_CONFIGURE_AFTER_MOUNTS)
+    {
+      /* The cache is only an optimization, never fail the container for it.  */
+      ret = wasm_cache_lookup (cookie, &wasmedge_cache_engine, context, container, rootfs, &context->wasm_cached_module, err);
+      if (UNLIKELY (ret < 0))
+        crun_error_write_warning_and_release (context->output_handler_arg, &err);
+    }
+
   char **container_env = def->process->env;
   bool has_plugin_path = false, has_preload = false;
 
@@ -239,6 +350,7 @@ struct custom_handler_s handler_wasmedge = {
   .run_func = libwasmedge_exec,
   .can_handle_container = wasmedge_can_handle_container,
   .configure_container = libwasmedge_configure_container,
+  .warmup = libwasmedge_warmup,
 };
 
 #endif
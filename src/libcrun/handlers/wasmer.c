@@ -23,6 +23,7 @@
 #include "../utils.h"
 #include "../linux.h"
 #include "handler-utils.h"
+#include "wasm-cache.h"
 #include <unistd.h>
 #include <sys/stat.h>
 #include <errno.h>
@@ -40,16 +41,19 @@
 
 #if HAVE_DLOPEN && HAVE_WASMER
 #  define WASMER_BUF_SIZE 128
+
 static int
-libwasmer_exec (void *cookie, libcrun_container_t *container arg_unused,
+libwasmer_exec (void *cookie, libcrun_container_t *container,
                 const char *pathname, char *const argv[])
 {
+  /* Serialized module found in the cache before the pivot_root.  */
+  struct libcrun_mmap_s *cached_module = container->context ? container->context->wasm_cached_module : NULL;
   int ret;
   char buffer[WASMER_BUF_SIZE] = { 0 };
   size_t data_read_size = WASMER_BUF_SIZE;
   const wasm_func_t *core_func;
-  FILE *wat_wasm_file;
-  size_t file_size;
+  cleanup_mmap struct libcrun_mmap_s *mapped = NULL;
+  libcrun_error_t tmp_err = NULL;
   wasm_byte_vec_t wat;
   wasm_byte_vec_t binary_bytes;
   wasm_byte_vec_t wasm_bytes;
@@ -73,6 +77,7 @@ libwasmer_exec (void *cookie, libcrun_container_t *container arg_unused,
   wasm_engine_t *(*wasm_engine_new) ();
   void (*wat2wasm) (const wasm_byte_vec_t *wat, wasm_byte_vec_t *out);
   wasm_module_t *(*wasm_module_new) (wasm_store_t *, const wasm_byte_vec_t *binary);
+  wasm_module_t *(*wasm_module_deserialize) (wasm_store_t *, const wasm_byte_vec_t *);
   wasm_store_t *(*wasm_store_new) (wasm_engine_t *);
   wasm_instance_t *(*wasm_instance_new) (wasm_store_t *, const wasm_module_t *, const wasm_extern_vec_t *imports, wasm_trap_t **);
   void (*wasm_instance_exports) (const wasm_instance_t *, wasm_extern_vec_t *out);
@@ -85,7 +90,6 @@ libwasmer_exec (void *cookie, libcrun_container_t *container arg_unused,
   void (*wasm_byte_vec_delete) (wasm_byte_vec_t *);
   void (*wasm_importtype_vec_delete) (wasm_importtype_vec_t *);
   void (*wasm_extern_vec_delete) (wasm_extern_vec_t *);
-  void (*wasm_byte_vec_new_uninitialized) (wasm_byte_vec_t *, size_t);
   void (*wasm_extern_vec_new_uninitialized) (wasm_extern_vec_t *, size_t);
   void (*wasi_config_capture_stdout) (struct wasi_config_t *);
   void (*wasi_config_inherit_stdout) (struct wasi_config_t *);
@@ -112,12 +116,12 @@ libwasmer_exec (void *cookie, libcrun_container_t *container arg_unused,
   wasm_instance_new = dlsym (cookie, "wasm_instance_new");
   wasm_store_new = dlsym (cookie, "wasm_store_new");
   wasm_module_new = dlsym (cookie, "wasm_module_new");
+  wasm_module_deserialize = dlsym (cookie, "wasm_module_deserialize");
   wasm_engine_new = dlsym (cookie, "wasm_engine_new");
   wasm_byte_vec_new = dlsym (cookie, "wasm_byte_vec_new");
   wasm_byte_vec_delete = dlsym (cookie, "wasm_byte_vec_delete");
   wasm_extern_vec_delete = dlsym (cookie, "wasm_extern_vec_delete");
   wasm_importtype_vec_delete = dlsym (cookie, "wasm_importtype_vec_delete");
-  wasm_byte_vec_new_uninitialized = dlsym (cookie, "wasm_byte_vec_new_uninitialized");
   wasi_config_new = dlsym (cookie, "wasi_config_new");
   wasi_config_arg = dlsym (cookie, "wasi_config_arg");
   wasi_config_capture_stdout = dlsym (cookie, "wasi_config_capture_stdout");
@@ -137,45 +141,54 @@ libwasmer_exec (void *cookie, libcrun_container_t *container arg_unused,
       || wasm_extern_as_func == NULL || wasm_instance_exports == NULL || wasm_instance_new == NULL
       || wasm_store_new == NULL || wasm_engine_new == NULL || wasm_byte_vec_new == NULL
       || wasm_byte_vec_delete == NULL || wasm_extern_vec_delete == NULL
-      || wasm_byte_vec_new_uninitialized == NULL || wasi_config_new == NULL
+      || wasi_config_new == NULL
       || wasi_config_capture_stdout == NULL || wasi_env_new == NULL || wasm_module_imports == NULL
       || wasi_env_read_stdout == NULL || wasi_env_delete == NULL || wasm_func_delete == NULL
       || wasm_importtype_vec_delete == NULL || wasm_extern_vec_new_uninitialized == NULL
       || wasi_get_imports == NULL || wasi_get_start_function == NULL || wasi_config_inherit_stdout == NULL)
     error (EXIT_FAILURE, 0, "could not find symbol in `libwasmer.so`");
 
-  wat_wasm_file = fopen (pathname, "rbe");
-
-  if (! wat_wasm_file)
-    error (EXIT_FAILURE, errno, "error opening wat/wasm module");
-
-  fseek (wat_wasm_file, 0L, SEEK_END);
-  file_size = ftell (wat_wasm_file);
-  fseek (wat_wasm_file, 0L, SEEK_SET);
-
-  wasm_byte_vec_new_uninitialized (&binary_bytes, file_size);
+  engine = wasm_engine_new ();
+  store = wasm_store_new (engine);
 
-  if (fread (binary_bytes.data, file_size, 1, wat_wasm_file) != 1)
-    error (EXIT_FAILURE, errno, "error loading wat/wasm module");
+  /* Use the precompiled module from the cache if the engine accepts it.  */
+  module = NULL;
+  if (cached_module != NULL && wasm_module_deserialize != NULL)
+    {
+      wasm_byte_vec_t serialized = {
+        .size = cached_module->length,
+        .data = (wasm_byte_t *) cached_module->addr,
+      };
 
-  /* We can close entrypoint file.   */
-  fclose (wat_wasm_file);
+      module = wasm_module_deserialize (store, &serialized);
+    }
 
-  /* We have received a wat file: convert wat to wasm.   */
-  if (has_suffix (pathname, "wat") > 0)
+  if (module == NULL)
     {
-      wat2wasm (&binary_bytes, &wasm_bytes);
-      binary_bytes = wasm_bytes;
+      ret = wasm_map_module (container, pathname, false, &mapped, &tmp_err);
+      if (UNLIKELY (ret < 0))
+        {
+          crun_error_release (&tmp_err);
+          error (EXIT_FAILURE, 0, "error loading wat/wasm module");
+        }
+
+      /* The engine reads the module in place, the vector does not own it.  */
+      binary_bytes.size = mapped->length;
+      binary_bytes.data = (wasm_byte_t *) mapped->addr;
+
+      /* We have received a wat file: convert wat to wasm.   */
+      if (has_suffix (pathname, "wat") > 0)
+        {
+          wat2wasm (&binary_bytes, &wasm_bytes);
+          binary_bytes = wasm_bytes;
+        }
+
+      module = wasm_module_new (store, &binary_bytes);
+
+      if (! module)
+        error (EXIT_FAILURE, 0, "error compiling wasm module");
     }
 
-  engine = wasm_engine_new ();
-  store = wasm_store_new (engine);
-
-  module = wasm_module_new (store, &binary_bytes);
-
-  if (! module)
-    error (EXIT_FAILURE, 0, "error compiling wasm module");
-
   config = wasi_config_new ("crun_wasi_program");
 
   /* Count number of external arguments given.  */
@@ -233,6 +246,87 @@ libwasmer_exec (void *cookie, libcrun_container_t *container arg_unused,
   exit (EXIT_SUCCESS);
 }
 
+static int
+libwasmer_compile (void *cookie, const char *pathname, const void *module, size_t module_len, int out_fd)
+{
+  libcrun_error_t tmp_err = NULL;
+  wasm_byte_vec_t binary_bytes;
+  wasm_byte_vec_t wasm_bytes;
+  wasm_byte_vec_t serialized;
+  wasm_module_t *compiled;
+  wasm_engine_t *engine;
+  wasm_store_t *store;
+  int ret;
+  wasm_engine_t *(*wasm_engine_new) ();
+  wasm_store_t *(*wasm_store_new) (wasm_engine_t *);
+  void (*wat2wasm) (const wasm_byte_vec_t *wat, wasm_byte_vec_t *out);
+  wasm_module_t *(*wasm_module_new) (wasm_store_t *, const wasm_byte_vec_t *binary);
+  void (*wasm_module_serialize) (const wasm_module_t *, wasm_byte_vec_t *out);
+
+  wasm_engine_new = dlsym (cookie, "wasm_engine_new");
+  wasm_store_new = dlsym (cookie, "wasm_store_new");
+  wat2wasm = dlsym (cookie, "wat2wasm");
+  wasm_module_new = dlsym (cookie, "wasm_module_new");
+  wasm_module_serialize = dlsym (cookie, "wasm_module_serialize");
+  if (wasm_engine_new == NULL || wasm_store_new == NULL || wat2wasm == NULL || wasm_module_new == NULL
+      || wasm_module_serialize == NULL)
+    return -1;
+
+  engine = wasm_engine_new ();
+  store = wasm_store_new (engine);
+
+  binary_bytes.size = module_len;
+  binary_bytes.data = (wasm_byte_t *) module;
+  if (has_suffix (pathname, "wat") > 0)
+    {
+      wat2wasm (&binary_bytes, &wasm_bytes);
+      binary_bytes = wasm_bytes;
+    }
+
+  compiled = wasm_module_new (store, &binary_bytes);
+  if (compiled == NULL)
+    return -1;
+
+  wasm_module_serialize (compiled, &serialized);
+  if (serialized.size == 0)
+    return -1;
+
+  ret = safe_write (out_fd, "wasm cache", serialized.data, serialized.size, &tmp_err);
+  if (UNLIKELY (ret < 0))
+    {
+      crun_error_release (&tmp_err);
+      return -1;
+    }
+
+  /* The process exits right away, no need to release the engine.  */
+  return 0;
+}
+
+static struct wasm_cache_engine_s wasmer_cache_engine = {
+  .name = "wasmer",
+  .symbol = "wasm_module_new",
+  .config = "default",
+  .compile = libwasmer_compile,
+};
+
+static int
+libwasmer_configure_container (void *cookie, enum handler_configure_phase phase,
+                               libcrun_context_t *context, libcrun_container_t *container,
+                               const char *rootfs, libcrun_error_t *err)
+{
+  int ret;
+
+  if (phase != HANDLER_CONFIGURE_AFTER_MOUNTS)
+    return 0;
+
+  /* The cache is only an optimization, never fail the container for it.  */
+  ret = wasm_cache_lookup (cookie, &wasmer_cache_engine, context, container, rootfs, &context->wasm_cached_module, err);
+  if (UNLIKELY (ret < 0))
+    crun_error_write_warning_and_release (context->output_handler_arg, &err);
+
+  return 0;
+}
+
 static int
 libwasmer_load (void **cookie, libcrun_error_t *err)
 {
@@ -274,6 +368,7 @@ struct custom_handler_s handler_wasmer = {
   .unload = libwasmer_unload,
   .run_func = libwasmer_exec,
   .can_handle_container = libwasmer_can_handle_container,
+  .configure_container = libwasmer_configure_container,
 };
 
 #endif
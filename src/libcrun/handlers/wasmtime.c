@@ -23,6 +23,7 @@
 #include "../utils.h"
 #include "../linux.h"
 #include "handler-utils.h"
+#include "wasm-cache.h"
 #include <unistd.h>
 #include <sys/stat.h>
 #include <errno.h>
@@ -45,9 +46,11 @@
 
 #if HAVE_DLOPEN && HAVE_WASMTIME
 static int
-libwasmtime_exec (void *cookie, libcrun_container_t *container arg_unused,
+libwasmtime_exec (void *cookie, libcrun_container_t *container,
                   const char *pathname, char *const argv[])
 {
+  /* Serialized module found in the cache before the pivot_root.  */
+  struct libcrun_mmap_s *cached_module = container->context ? container->context->wasm_cached_module : NULL;
   size_t args_size = 0;
   char *const *arg;
   wasm_byte_vec_t error_message;
@@ -56,7 +59,6 @@ libwasmtime_exec (void *cookie, libcrun_container_t *container arg_unused,
   wasmtime_error_t *(*wasmtime_wat2wasm) (const char *wat, size_t wat_len, wasm_byte_vec_t *out);
   void (*wasm_engine_delete) (wasm_engine_t *);
   void (*wasm_byte_vec_delete) (wasm_byte_vec_t *);
-  void (*wasm_byte_vec_new_uninitialized) (wasm_byte_vec_t *, size_t);
   wasi_config_t *(*wasi_config_new) (const char *);
   wasmtime_store_t *(*wasmtime_store_new) (wasm_engine_t *engine, void *data, void (*finalizer) (void *));
   wasmtime_context_t *(*wasmtime_store_context) (wasmtime_store_t *store);
@@ -94,6 +96,11 @@ libwasmtime_exec (void *cookie, libcrun_container_t *container arg_unused,
       wasmtime_val_t *results,
       size_t nresults,
       wasm_trap_t **trap);
+  wasmtime_error_t *(*wasmtime_module_deserialize) (
+      wasm_engine_t *engine,
+      const uint8_t *bytes,
+      size_t bytes_len,
+      wasmtime_module_t **ret);
   void (*wasmtime_module_delete) (wasmtime_module_t *m);
   void (*wasmtime_store_delete) (wasmtime_store_t *store);
   void (*wasmtime_error_message) (const wasmtime_error_t *error, wasm_name_t *message);
@@ -104,7 +111,6 @@ libwasmtime_exec (void *cookie, libcrun_container_t *container arg_unused,
   wasm_engine_new = dlsym (cookie, "wasm_engine_new");
   wasm_engine_delete = dlsym (cookie, "wasm_engine_delete");
   wasm_byte_vec_delete = dlsym (cookie, "wasm_byte_vec_delete");
-  wasm_byte_vec_new_uninitialized = dlsym (cookie, "wasm_byte_vec_new_uninitialized");
   wasi_config_new = dlsym (cookie, "wasi_config_new");
   wasi_config_set_argv = dlsym (cookie, "wasi_config_set_argv");
   wasmtime_store_new = dlsym (cookie, "wasmtime_store_new");
@@ -112,6 +118,7 @@ libwasmtime_exec (void *cookie, libcrun_container_t *container arg_unused,
   wasmtime_linker_new = dlsym (cookie, "wasmtime_linker_new");
   wasmtime_linker_define_wasi = dlsym (cookie, "wasmtime_linker_define_wasi");
   wasmtime_module_new = dlsym (cookie, "wasmtime_module_new");
+  wasmtime_module_deserialize = dlsym (cookie, "wasmtime_module_deserialize");
   wasi_config_inherit_argv = dlsym (cookie, "wasi_config_inherit_argv");
   wasi_config_inherit_stdout = dlsym (cookie, "wasi_config_inherit_stdout");
   wasi_config_inherit_stdin = dlsym (cookie, "wasi_config_inherit_stdin");
@@ -128,7 +135,7 @@ libwasmtime_exec (void *cookie, libcrun_container_t *container arg_unused,
   wasi_config_preopen_dir = dlsym (cookie, "wasi_config_preopen_dir");
 
   if (wasm_engine_new == NULL || wasm_engine_delete == NULL || wasm_byte_vec_delete == NULL
-      || wasm_byte_vec_new_uninitialized == NULL || wasi_config_new == NULL || wasmtime_store_new == NULL
+      || wasi_config_new == NULL || wasmtime_store_new == NULL
       || wasmtime_store_context == NULL || wasmtime_linker_new == NULL || wasmtime_linker_define_wasi == NULL
       || wasmtime_module_new == NULL || wasi_config_inherit_argv == NULL || wasi_config_inherit_stdout == NULL
       || wasi_config_inherit_stdin == NULL || wasi_config_inherit_stderr == NULL
@@ -156,44 +163,64 @@ libwasmtime_exec (void *cookie, libcrun_container_t *container arg_unused,
       error (EXIT_FAILURE, 0, "failed to link wasi: %.*s", (int) error_message.size, error_message.data);
     }
 
-  wasm_byte_vec_t wasm;
-  // Load and parse container entrypoint
-  FILE *file = fopen (pathname, "rbe");
-  if (! file)
-    error (EXIT_FAILURE, 0, "error loading entrypoint");
-  fseek (file, 0L, SEEK_END);
-  size_t file_size = ftell (file);
-  wasm_byte_vec_new_uninitialized (&wasm, file_size);
-  fseek (file, 0L, SEEK_SET);
-  if (fread (wasm.data, file_size, 1, file) != 1)
-    error (EXIT_FAILURE, 0, "error load");
-  fclose (file);
-
-  // If entrypoint contains a webassembly text format
-  // compile it on the fly and convert to equivalent
-  // binary format.
-  if (has_suffix (pathname, "wat") > 0)
+  // Use the precompiled module from the cache if the engine accepts it
+  wasmtime_module_t *module = NULL;
+  if (cached_module != NULL && wasmtime_module_deserialize != NULL)
     {
-      wasmtime_error_t *err = wasmtime_wat2wasm ((char *) &wasm_bytes, file_size, &wasm);
+      err = wasmtime_module_deserialize (engine, cached_module->addr, cached_module->length, &module);
       if (err != NULL)
         {
-          wasmtime_error_message (err, &error_message);
           wasmtime_error_delete (err);
-          error (EXIT_FAILURE, 0, "failed while compiling wat to wasm binary : %.*s", (int) error_message.size, error_message.data);
+          module = NULL;
         }
-      wasm = wasm_bytes;
     }
 
-  // Compile wasm modules
-  wasmtime_module_t *module = NULL;
-  err = wasmtime_module_new (engine, (uint8_t *) wasm.data, wasm.size, &module);
-  if (! module)
+  if (module == NULL)
     {
-      wasmtime_error_message (err, &error_message);
-      wasmtime_error_delete (err);
-      error (EXIT_FAILURE, 0, "failed to compile module: %.*s", (int) error_message.size, error_message.data);
+      cleanup_mmap struct libcrun_mmap_s *mapped = NULL;
+      libcrun_error_t tmp_err = NULL;
+      const uint8_t *wasm_data;
+      size_t wasm_size;
+      int ret;
+
+      // Map the container entrypoint, the engine reads it in place
+      ret = wasm_map_module (container, pathname, false, &mapped, &tmp_err);
+      if (UNLIKELY (ret < 0))
+        {
+          crun_error_release (&tmp_err);
+          error (EXIT_FAILURE, 0, "error loading entrypoint");
+        }
+      wasm_data = mapped->addr;
+      wasm_size = mapped->length;
+
+      // If entrypoint contains a webassembly text format
+      // compile it on the fly and convert to equivalent
+      // binary format.
+      wasm_bytes.size = 0;
+      if (has_suffix (pathname, "wat") > 0)
+        {
+          wasmtime_error_t *err = wasmtime_wat2wasm (mapped->addr, mapped->length, &wasm_bytes);
+          if (err != NULL)
+            {
+              wasmtime_error_message (err, &error_message);
+              wasmtime_error_delete (err);
+              error (EXIT_FAILURE, 0, "failed while compiling wat to wasm binary : %.*s", (int) error_message.size, error_message.data);
+            }
+          wasm_data = (const uint8_t *) wasm_bytes.data;
+          wasm_size = wasm_bytes.size;
+        }
+
+      // Compile wasm modules
+      err = wasmtime_module_new (engine, wasm_data, wasm_size, &module);
+      if (! module)
+        {
+          wasmtime_error_message (err, &error_message);
+          wasmtime_error_delete (err);
+          error (EXIT_FAILURE, 0, "failed to compile module: %.*s", (int) error_message.size, error_message.data);
+        }
+      if (wasm_bytes.size > 0)
+        wasm_byte_vec_delete (&wasm_bytes);
     }
-  wasm_byte_vec_delete (&wasm);
 
   // Init WASI program
   wasi_config_t *wasi_config = wasi_config_new ("crun_wasi_program");
@@ -253,6 +280,86 @@ libwasmtime_exec (void *cookie, libcrun_container_t *container arg_unused,
   exit (EXIT_SUCCESS);
 }
 
+static int
+libwasmtime_compile (void *cookie, const char *pathname, const void *module, size_t module_len, int out_fd)
+{
+  libcrun_error_t tmp_err = NULL;
+  wasm_byte_vec_t serialized;
+  wasm_byte_vec_t wasm_bytes;
+  wasmtime_module_t *compiled = NULL;
+  wasmtime_error_t *err;
+  wasm_engine_t *engine;
+  int ret;
+  wasm_engine_t *(*wasm_engine_new) ();
+  wasmtime_error_t *(*wasmtime_wat2wasm) (const char *wat, size_t wat_len, wasm_byte_vec_t *out);
+  wasmtime_error_t *(*wasmtime_module_new) (wasm_engine_t *engine, const uint8_t *wasm, size_t wasm_len, wasmtime_module_t **ret);
+  wasmtime_error_t *(*wasmtime_module_serialize) (wasmtime_module_t *module, wasm_byte_vec_t *ret);
+
+  wasm_engine_new = dlsym (cookie, "wasm_engine_new");
+  wasmtime_wat2wasm = dlsym (cookie, "wasmtime_wat2wasm");
+  wasmtime_module_new = dlsym (cookie, "wasmtime_module_new");
+  wasmtime_module_serialize = dlsym (cookie, "wasmtime_module_serialize");
+  if (wasm_engine_new == NULL || wasmtime_wat2wasm == NULL || wasmtime_module_new == NULL
+      || wasmtime_module_serialize == NULL)
+    return -1;
+
+  engine = wasm_engine_new ();
+  if (engine == NULL)
+    return -1;
+
+  if (has_suffix (pathname, "wat") > 0)
+    {
+      err = wasmtime_wat2wasm (module, module_len, &wasm_bytes);
+      if (err != NULL)
+        return -1;
+      module = wasm_bytes.data;
+      module_len = wasm_bytes.size;
+    }
+
+  err = wasmtime_module_new (engine, module, module_len, &compiled);
+  if (err != NULL || compiled == NULL)
+    return -1;
+
+  err = wasmtime_module_serialize (compiled, &serialized);
+  if (err != NULL)
+    return -1;
+
+  ret = safe_write (out_fd, "wasm cache", serialized.data, serialized.size, &tmp_err);
+  if (UNLIKELY (ret < 0))
+    {
+      crun_error_release (&tmp_err);
+      return -1;
+    }
+
+  /* The process exits right away, no need to release the engine.  */
+  return 0;
+}
+
+static struct wasm_cache_engine_s wasmtime_cache_engine = {
+  .name = "wasmtime",
+  .symbol = "wasmtime_module_new",
+  .config = "default",
+  .compile = libwasmtime_compile,
+};
+
+static int
+libwasmtime_configure_container (void *cookie, enum handler_configure_phase phase,
+                                 libcrun_context_t *context, libcrun_container_t *container,
+                                 const char *rootfs, libcrun_error_t *err)
+{
+  int ret;
+
+  if (phase != HANDLER_CONFIGURE_AFTER_MOUNTS)
+    return 0;
+
+  /* The cache is only an optimization, never fail the container for it.  */
+  ret = wasm_cache_lookup (cookie, &wasmtime_cache_engine, context, container, rootfs, &context->wasm_cached_module, err);
+  if (UNLIKELY (ret < 0))
+    crun_error_write_warning_and_release (context->output_handler_arg, &err);
+
+  return 0;
+}
+
 static int
 libwasmtime_load (void **cookie, libcrun_error_t *err)
 {
@@ -294,6 +401,7 @@ struct custom_handler_s handler_wasmtime = {
   .unload = libwasmtime_unload,
   .run_func = libwasmtime_exec,
   .can_handle_container = libwasmtime_can_handle_container,
+  .configure_container = libwasmtime_configure_container,
 };
 
 #endif
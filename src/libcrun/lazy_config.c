@@ -0,0 +1,746 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <yajl/yajl_tree.h>
+#include <ocispec/runtime_spec_schema_config_schema.h>
+
+#include "lazy_config.h"
+#include "config_snapshot.h"
+#include "utils.h"
+
+/* A config.json for a large container is mostly the environment
+   variables, the mounts, the seccomp profile and the resources.  The
+   commands that operate on an existing container often need only a few
+   fields.  To avoid building the full libocispec tree for them, the
+   first pass only finds where the big sections start and end, without
+   tokenizing their content.  Each section is parsed in isolation the
+   first time it is requested.
+
+   When the configuration comes from a snapshot, the tree is already
+   decoded and the sections are only converted to the libocispec
+   structs.  */
+
+struct json_range_s
+{
+  size_t start;
+  size_t end;
+};
+
+struct json_member_s
+{
+  /* The key including the quotes.  */
+  struct json_range_s key;
+  struct json_range_s value;
+};
+
+enum
+{
+  SECTION_PROCESS = 0,
+  SECTION_MOUNTS,
+  SECTION_LINUX,
+  SECTION_LINUX_RESOURCES,
+  SECTION_LINUX_SECCOMP,
+  SECTIONS_MAX,
+};
+
+struct libcrun_lazy_config_s
+{
+  /* Value of each section, START == END if it is not present.  */
+  struct json_range_s sections[SECTIONS_MAX];
+
+  /* Members of the "linux" object, used to parse it without the
+     resources and the seccomp profile.  */
+  struct json_member_s *linux_members;
+  size_t linux_members_len;
+
+  /* Set when the configuration is read from a snapshot, the sections
+     are then taken from its tree instead of the JSON data.  */
+  struct libcrun_config_snapshot_s *snapshot;
+  yajl_val trees[SECTIONS_MAX];
+
+  unsigned int pending;
+};
+
+static size_t
+skip_ws (const char *json, size_t i, size_t len)
+{
+  while (i < len && (json[i] == ' ' || json[i] == '\t' || json[i] == '\n' || json[i] == '\r'))
+    i++;
+  return i;
+}
+
+/* Return the offset after the string starting at I, or 0 if it is not
+   terminated.  */
+static size_t
+skip_string (const char *json, size_t i, size_t len)
+{
+  for (i++; i < len; i++)
+    {
+      if (json[i] == '\\')
+        i++;
+      else if (json[i] == '"')
+        return i + 1;
+    }
+  return 0;
+}
+
+/* Return the offset after the value starting at I, or 0 on errors.  The
+   nesting is followed only to find the end of the value, the content is
+   validated when the section is parsed.  */
+static size_t
+skip_value (const char *json, size_t i, size_t len)
+{
+  size_t depth = 0;
+
+  do
+    {
+      i = skip_ws (json, i, len);
+      if (i >= len)
+        return 0;
+
+      switch (json[i])
+        {
+        case '"':
+          i = skip_string (json, i, len);
+          if (i == 0)
+            return 0;
+          break;
+
+        case '{':
+        case '[':
+          depth++;
+          i++;
+          break;
+
+        case '}':
+        case ']':
+          if (depth == 0)
+            return 0;
+          depth--;
+          i++;
+          break;
+
+        case ',':
+        case ':':
+          if (depth == 0)
+            return 0;
+          i++;
+          break;
+
+        default:
+          while (i < len && strchr (" \t\r\n,:[]{}\"", json[i]) == NULL)
+            i++;
+          break;
+        }
+  } while (depth > 0);
+
+  return i;
+}
+
+/* Split the object in RANGE into its members.  END is set to the offset
+   after the object.  */
+static int
+scan_object (const char *json, struct json_range_s range, struct json_member_s **members, size_t *members_len,
+             size_t *end, libcrun_error_t *err)
+{
+  size_t i, next, allocated = 0;
+
+  *members = NULL;
+  *members_len = 0;
+
+  i = skip_ws (json, range.start, range.end);
+  if (i >= range.end || json[i] != '{')
+    goto fail;
+
+  i = skip_ws (json, i + 1, range.end);
+  if (i < range.end && json[i] == '}')
+    {
+      *end = i + 1;
+      return 0;
+    }
+
+  while (1)
+    {
+      struct json_member_s *m;
+
+      if (*members_len == allocated)
+        {
+          allocated = allocated ? allocated * 2 : 16;
+          *members = xrealloc (*members, allocated * sizeof (**members));
+        }
+      m = &(*members)[*members_len];
+
+      if (i >= range.end || json[i] != '"')
+        goto fail;
+      m->key.start = i;
+      next = skip_string (json, i, range.end);
+      if (next == 0)
+        goto fail;
+      i = m->key.end = next;
+
+      i = skip_ws (json, i, range.end);
+      if (i >= range.end || json[i] != ':')
+        goto fail;
+
+      i = m->value.start = skip_ws (json, i + 1, range.end);
+      next = skip_value (json, i, range.end);
+      if (next == 0)
+        goto fail;
+      i = m->value.end = next;
+      (*members_len)++;
+
+      i = skip_ws (json, i, range.end);
+      if (i < range.end && json[i] == ',')
+        {
+          i = skip_ws (json, i + 1, range.end);
+          continue;
+        }
+      if (i < range.end && json[i] == '}')
+        {
+          *end = i + 1;
+          return 0;
+        }
+      goto fail;
+    }
+
+fail:
+  free (*members);
+  *members = NULL;
+  *members_len = 0;
+  return crun_make_error (err, 0, "invalid JSON at offset %zu", i);
+}
+
+static bool
+key_is (const char *json, const struct json_member_s *m, const char *name)
+{
+  size_t len = strlen (name);
+
+  return m->key.end - m->key.start == len + 2 && memcmp (json + m->key.start + 1, name, len) == 0;
+}
+
+/* Join the members of an object that are not skipped.  */
+static char *
+join_members (const char *json, const struct json_member_s *members, size_t members_len, const bool *skip)
+{
+  size_t i, size = 3, off = 0;
+  char *ret;
+
+  for (i = 0; i < members_len; i++)
+    size += members[i].value.end - members[i].key.start + 1;
+
+  ret = xmalloc (size);
+  ret[off++] = '{';
+  for (i = 0; i < members_len; i++)
+    {
+      size_t l = members[i].value.end - members[i].key.start;
+
+      if (skip[i])
+        continue;
+
+      if (off > 1)
+        ret[off++] = ',';
+      memcpy (ret + off, json + members[i].key.start, l);
+      off += l;
+    }
+  ret[off++] = '}';
+  ret[off] = '\0';
+  return ret;
+}
+
+/* Make a shallow copy of the object V without the members that are
+   skipped.  The result is released with free.  */
+static yajl_val
+filter_object (yajl_val v, const bool *skip)
+{
+  size_t i, len = v->u.object.len;
+  struct yajl_val_s *ret;
+
+  ret = xmalloc0 (sizeof (*ret) + len * (sizeof (const char *) + sizeof (yajl_val)));
+  ret->type = yajl_t_object;
+  ret->u.object.values = (yajl_val *) (ret + 1);
+  ret->u.object.keys = (const char **) (ret->u.object.values + len);
+  for (i = 0; i < len; i++)
+    {
+      if (skip[i])
+        continue;
+
+      ret->u.object.keys[ret->u.object.len] = v->u.object.keys[i];
+      ret->u.object.values[ret->u.object.len] = v->u.object.values[i];
+      ret->u.object.len++;
+    }
+  return ret;
+}
+
+static bool
+is_linux_section (const char *key, yajl_val v)
+{
+  return YAJL_IS_OBJECT (v) && (strcmp (key, "resources") == 0 || strcmp (key, "seccomp") == 0);
+}
+
+int
+libcrun_lazy_config_new (const char *json, size_t len, runtime_spec_schema_config_schema **def,
+                         struct libcrun_lazy_config_s **out, libcrun_error_t *err)
+{
+  struct libcrun_lazy_config_s *lazy = NULL;
+  cleanup_free struct json_member_s *members = NULL;
+  cleanup_free bool *skip = NULL;
+  cleanup_free char *oci_error = NULL;
+  cleanup_free char *rest = NULL;
+  struct json_range_s range = { 0, len };
+  size_t i, members_len, end;
+  int ret;
+
+  *def = NULL;
+  *out = NULL;
+
+  ret = scan_object (json, range, &members, &members_len, &end, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (skip_ws (json, end, len) < len)
+    return crun_make_error (err, 0, "invalid JSON: trailing data at offset %zu", end);
+
+  lazy = xmalloc0 (sizeof (*lazy));
+  skip = xmalloc0 (sizeof (*skip) * (members_len + 1));
+
+  for (i = 0; i < members_len; i++)
+    {
+      char first = json[members[i].value.start];
+      int section = -1;
+
+      /* Anything unexpected, e.g. a null section, is left to the
+         libocispec parser.  */
+      if (first == '{' && key_is (json, &members[i], "process"))
+        section = SECTION_PROCESS;
+      else if (first == '[' && key_is (json, &members[i], "mounts"))
+        section = SECTION_MOUNTS;
+      else if (first == '{' && key_is (json, &members[i], "linux"))
+        section = SECTION_LINUX;
+
+      if (section < 0)
+        continue;
+
+      skip[i] = true;
+      lazy->sections[section] = members[i].value;
+      lazy->pending |= 1 << section;
+    }
+
+  if (lazy->pending & LIBCRUN_CONFIG_LINUX)
+    {
+      ret = scan_object (json, lazy->sections[SECTION_LINUX], &lazy->linux_members, &lazy->linux_members_len, &end, err);
+      if (UNLIKELY (ret < 0))
+        goto fail;
+
+      for (i = 0; i < lazy->linux_members_len; i++)
+        {
+          struct json_member_s *m = &lazy->linux_members[i];
+
+          if (json[m->value.start] != '{')
+            continue;
+
+          if (key_is (json, m, "resources"))
+            {
+              lazy->sections[SECTION_LINUX_RESOURCES] = m->value;
+              lazy->pending |= LIBCRUN_CONFIG_LINUX_RESOURCES;
+            }
+          else if (key_is (json, m, "seccomp"))
+            {
+              lazy->sections[SECTION_LINUX_SECCOMP] = m->value;
+              lazy->pending |= LIBCRUN_CONFIG_LINUX_SECCOMP;
+            }
+        }
+    }
+
+  rest = join_members (json, members, members_len, skip);
+
+  *def = runtime_spec_schema_config_schema_parse_data (rest, NULL, &oci_error);
+  if (*def == NULL)
+    {
+      ret = crun_make_error (err, 0, "load: `%s`", oci_error);
+      goto fail;
+    }
+
+  *out = lazy;
+  return 0;
+
+fail:
+  libcrun_lazy_config_free (lazy);
+  return ret;
+}
+
+int
+libcrun_lazy_config_new_from_snapshot (struct libcrun_config_snapshot_s *snapshot, runtime_spec_schema_config_schema **def,
+                                       struct libcrun_lazy_config_s **out, libcrun_error_t *err)
+{
+  yajl_val tree = libcrun_config_snapshot_tree (snapshot);
+  struct parser_context ctx = { 0, stderr };
+  struct libcrun_lazy_config_s *lazy;
+  cleanup_free parser_error parser_err = NULL;
+  cleanup_free bool *skip = NULL;
+  cleanup_free yajl_val rest = NULL;
+  size_t i;
+  int ret;
+
+  *def = NULL;
+  *out = NULL;
+
+  lazy = xmalloc0 (sizeof (*lazy));
+  lazy->snapshot = snapshot;
+
+  if (UNLIKELY (! YAJL_IS_OBJECT (tree)))
+    {
+      ret = crun_make_error (err, 0, "config snapshot: the configuration is not an object");
+      goto fail;
+    }
+
+  skip = xmalloc0 (sizeof (*skip) * (tree->u.object.len + 1));
+  for (i = 0; i < tree->u.object.len; i++)
+    {
+      const char *key = tree->u.object.keys[i];
+      yajl_val v = tree->u.object.values[i];
+      int section = -1;
+
+      if (YAJL_IS_OBJECT (v) && strcmp (key, "process") == 0)
+        section = SECTION_PROCESS;
+      else if (YAJL_IS_ARRAY (v) && strcmp (key, "mounts") == 0)
+        section = SECTION_MOUNTS;
+      else if (YAJL_IS_OBJECT (v) && strcmp (key, "linux") == 0)
+        section = SECTION_LINUX;
+
+      if (section < 0)
+        continue;
+
+      skip[i] = true;
+      lazy->trees[section] = v;
+      lazy->pending |= 1 << section;
+    }
+
+  if (lazy->pending & LIBCRUN_CONFIG_LINUX)
+    {
+      yajl_val linux_tree = lazy->trees[SECTION_LINUX];
+
+      for (i = 0; i < linux_tree->u.object.len; i++)
+        {
+          const char *key = linux_tree->u.object.keys[i];
+          yajl_val v = linux_tree->u.object.values[i];
+
+          if (! is_linux_section (key, v))
+            continue;
+
+          if (strcmp (key, "resources") == 0)
+            {
+              lazy->trees[SECTION_LINUX_RESOURCES] = v;
+              lazy->pending |= LIBCRUN_CONFIG_LINUX_RESOURCES;
+            }
+          else
+            {
+              lazy->trees[SECTION_LINUX_SECCOMP] = v;
+              lazy->pending |= LIBCRUN_CONFIG_LINUX_SECCOMP;
+            }
+        }
+    }
+
+  rest = filter_object (tree, skip);
+
+  *def = make_runtime_spec_schema_config_schema (rest, &ctx, &parser_err);
+  if (*def == NULL)
+    {
+      ret = crun_make_error (err, 0, "load: `%s`", parser_err);
+      goto fail;
+    }
+
+  *out = lazy;
+  return 0;
+
+fail:
+  libcrun_lazy_config_free (lazy);
+  return ret;
+}
+
+static int
+parse_section (struct libcrun_lazy_config_s *lazy, const char *json, int section, yajl_val *tree, libcrun_error_t *err)
+{
+  struct json_range_s *range = &lazy->sections[section];
+  size_t len = range->end - range->start;
+  cleanup_free char *data = NULL;
+
+  if (lazy->snapshot)
+    {
+      *tree = lazy->trees[section];
+      return 0;
+    }
+
+  data = xmalloc (len + 1);
+  memcpy (data, json + range->start, len);
+  data[len] = '\0';
+
+  return parse_json_file (tree, data, NULL, err);
+}
+
+static void
+release_section (struct libcrun_lazy_config_s *lazy, yajl_val tree)
+{
+  /* The trees from a snapshot point into its mapping.  */
+  if (lazy->snapshot == NULL)
+    yajl_tree_free (tree);
+}
+
+static int
+load_process (struct libcrun_lazy_config_s *lazy, const char *json, runtime_spec_schema_config_schema *def,
+              libcrun_error_t *err)
+{
+  struct parser_context ctx = { 0, stderr };
+  parser_error parser_err = NULL;
+  yajl_val tree = NULL;
+  int ret;
+
+  ret = parse_section (lazy, json, SECTION_PROCESS, &tree, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  def->process = make_runtime_spec_schema_config_schema_process (tree, &ctx, &parser_err);
+  if (UNLIKELY (def->process == NULL))
+    ret = crun_make_error (err, 0, "cannot parse process: %s", parser_err);
+
+  release_section (lazy, tree);
+  free (parser_err);
+  return ret;
+}
+
+static int
+load_mounts (struct libcrun_lazy_config_s *lazy, const char *json, runtime_spec_schema_config_schema *def,
+             libcrun_error_t *err)
+{
+  struct parser_context ctx = { 0, stderr };
+  runtime_spec_schema_defs_mount **mounts;
+  parser_error parser_err = NULL;
+  yajl_val tree = NULL;
+  size_t i, n_mounts;
+  int ret;
+
+  ret = parse_section (lazy, json, SECTION_MOUNTS, &tree, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (! YAJL_IS_ARRAY (tree))
+    {
+      release_section (lazy, tree);
+      return crun_make_error (err, 0, "mounts must be an array");
+    }
+
+  n_mounts = YAJL_GET_ARRAY (tree)->len;
+  mounts = xmalloc0 ((n_mounts + 1) * sizeof (*mounts));
+  for (i = 0; i < n_mounts; i++)
+    {
+      mounts[i] = make_runtime_spec_schema_defs_mount (YAJL_GET_ARRAY (tree)->values[i], &ctx, &parser_err);
+      if (UNLIKELY (mounts[i] == NULL))
+        {
+          ret = crun_make_error (err, 0, "cannot parse mount: %s", parser_err);
+          while (i-- > 0)
+            free_runtime_spec_schema_defs_mount (mounts[i]);
+          free (mounts);
+          goto exit;
+        }
+    }
+
+  def->mounts = mounts;
+  def->mounts_len = n_mounts;
+
+exit:
+  release_section (lazy, tree);
+  free (parser_err);
+  return ret;
+}
+
+static int
+load_linux (struct libcrun_lazy_config_s *lazy, const char *json, runtime_spec_schema_config_schema *def,
+            libcrun_error_t *err)
+{
+  struct parser_context ctx = { 0, stderr };
+  parser_error parser_err = NULL;
+  cleanup_free char *rest = NULL;
+  cleanup_free bool *skip = NULL;
+  yajl_val tree = NULL;
+  size_t i;
+  int ret;
+
+  if (lazy->snapshot)
+    {
+      yajl_val linux_tree = lazy->trees[SECTION_LINUX];
+
+      skip = xmalloc0 (sizeof (*skip) * (linux_tree->u.object.len + 1));
+      for (i = 0; i < linux_tree->u.object.len; i++)
+        skip[i] = is_linux_section (linux_tree->u.object.keys[i], linux_tree->u.object.values[i]);
+
+      tree = filter_object (linux_tree, skip);
+    }
+  else
+    {
+      skip = xmalloc0 (sizeof (*skip) * (lazy->linux_members_len + 1));
+      for (i = 0; i < lazy->linux_members_len; i++)
+        {
+          struct json_member_s *m = &lazy->linux_members[i];
+
+          skip[i] = json[m->value.start] == '{' && (key_is (json, m, "resources") || key_is (json, m, "seccomp"));
+        }
+
+      rest = join_members (json, lazy->linux_members, lazy->linux_members_len, skip);
+
+      ret = parse_json_file (&tree, rest, &ctx, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  ret = 0;
+  def->linux = make_runtime_spec_schema_config_linux (tree, &ctx, &parser_err);
+  if (UNLIKELY (def->linux == NULL))
+    ret = crun_make_error (err, 0, "cannot parse linux: %s", parser_err);
+
+  if (lazy->snapshot)
+    free (tree);
+  else
+    yajl_tree_free (tree);
+  free (parser_err);
+  return ret;
+}
+
+static int
+load_linux_resources (struct libcrun_lazy_config_s *lazy, const char *json, runtime_spec_schema_config_schema *def,
+                      libcrun_error_t *err)
+{
+  struct parser_context ctx = { 0, stderr };
+  parser_error parser_err = NULL;
+  yajl_val tree = NULL;
+  int ret;
+
+  ret = parse_section (lazy, json, SECTION_LINUX_RESOURCES, &tree, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  def->linux->resources = make_runtime_spec_schema_config_linux_resources (tree, &ctx, &parser_err);
+  if (UNLIKELY (def->linux->resources == NULL))
+    ret = crun_make_error (err, 0, "cannot parse resources: %s", parser_err);
+
+  release_section (lazy, tree);
+  free (parser_err);
+  return ret;
+}
+
+static int
+load_linux_seccomp (struct libcrun_lazy_config_s *lazy, const char *json, runtime_spec_schema_config_schema *def,
+                    libcrun_error_t *err)
+{
+  struct parser_context ctx = { 0, stderr };
+  parser_error parser_err = NULL;
+  yajl_val tree = NULL;
+  int ret;
+
+  ret = parse_section (lazy, json, SECTION_LINUX_SECCOMP, &tree, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  def->linux->seccomp = make_runtime_spec_schema_config_linux_seccomp (tree, &ctx, &parser_err);
+  if (UNLIKELY (def->linux->seccomp == NULL))
+    ret = crun_make_error (err, 0, "cannot parse seccomp: %s", parser_err);
+
+  release_section (lazy, tree);
+  free (parser_err);
+  return ret;
+}
+
+int
+libcrun_lazy_config_load (struct libcrun_lazy_config_s *lazy, const char *json, runtime_spec_schema_config_schema *def,
+                          unsigned int sections, libcrun_error_t *err)
+{
+  int ret;
+
+  if (lazy == NULL)
+    return 0;
+
+  /* The resources and the seccomp profile are stored in the linux
+     object.  */
+  if (sections & (LIBCRUN_CONFIG_LINUX_RESOURCES | LIBCRUN_CONFIG_LINUX_SECCOMP))
+    sections |= LIBCRUN_CONFIG_LINUX;
+
+  sections &= lazy->pending;
+
+  if (sections & LIBCRUN_CONFIG_PROCESS)
+    {
+      ret = load_process (lazy, json, def, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+      lazy->pending &= ~LIBCRUN_CONFIG_PROCESS;
+    }
+
+  if (sections & LIBCRUN_CONFIG_MOUNTS)
+    {
+      ret = load_mounts (lazy, json, def, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+      lazy->pending &= ~LIBCRUN_CONFIG_MOUNTS;
+    }
+
+  if (sections & LIBCRUN_CONFIG_LINUX)
+    {
+      ret = load_linux (lazy, json, def, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+      lazy->pending &= ~LIBCRUN_CONFIG_LINUX;
+    }
+
+  if (sections & LIBCRUN_CONFIG_LINUX_RESOURCES)
+    {
+      ret = load_linux_resources (lazy, json, def, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+      lazy->pending &= ~LIBCRUN_CONFIG_LINUX_RESOURCES;
+    }
+
+  if (sections & LIBCRUN_CONFIG_LINUX_SECCOMP)
+    {
+      ret = load_linux_seccomp (lazy, json, def, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+      lazy->pending &= ~LIBCRUN_CONFIG_LINUX_SECCOMP;
+    }
+
+  return 0;
+}
+
+unsigned int
+libcrun_lazy_config_pending (struct libcrun_lazy_config_s *lazy)
+{
+  return lazy ? lazy->pending : 0;
+}
+
+void
+libcrun_lazy_config_free (struct libcrun_lazy_config_s *lazy)
+{
+  if (lazy == NULL)
+    return;
+
+  libcrun_config_snapshot_free (lazy->snapshot);
+  free (lazy->linux_members);
+  free (lazy);
+}
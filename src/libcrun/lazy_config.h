@@ -0,0 +1,65 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LAZY_CONFIG_H
+#define LAZY_CONFIG_H
+
+#include <config.h>
+#include <ocispec/runtime_spec_schema_config_schema.h>
+#include "error.h"
+#include "config_snapshot.h"
+
+/* Sections of the configuration that are parsed only when they are
+   needed.  */
+enum
+{
+  LIBCRUN_CONFIG_PROCESS = (1 << 0),
+  LIBCRUN_CONFIG_MOUNTS = (1 << 1),
+  /* Everything under "linux" except the resources and the seccomp
+     profile.  */
+  LIBCRUN_CONFIG_LINUX = (1 << 2),
+  LIBCRUN_CONFIG_LINUX_RESOURCES = (1 << 3),
+  LIBCRUN_CONFIG_LINUX_SECCOMP = (1 << 4),
+  LIBCRUN_CONFIG_ALL = (1 << 5) - 1,
+};
+
+struct libcrun_lazy_config_s;
+
+/* Index the sections above in JSON and parse everything else in DEF.
+   The sections are not validated until they are loaded.  */
+int libcrun_lazy_config_new (const char *json, size_t len, runtime_spec_schema_config_schema **def,
+                             struct libcrun_lazy_config_s **out, libcrun_error_t *err);
+
+/* Same as libcrun_lazy_config_new for a configuration decoded from
+   SNAPSHOT.  The lazy configuration takes the ownership of SNAPSHOT and
+   JSON is ignored when the sections are loaded.  */
+int libcrun_lazy_config_new_from_snapshot (struct libcrun_config_snapshot_s *snapshot,
+                                           runtime_spec_schema_config_schema **def, struct libcrun_lazy_config_s **out,
+                                           libcrun_error_t *err);
+
+/* Parse SECTIONS from JSON, the same data passed to libcrun_lazy_config_new,
+   and store them in DEF.  The sections already loaded are skipped.  */
+int libcrun_lazy_config_load (struct libcrun_lazy_config_s *lazy, const char *json, runtime_spec_schema_config_schema *def,
+                              unsigned int sections, libcrun_error_t *err);
+
+/* Sections not loaded yet.  */
+unsigned int libcrun_lazy_config_pending (struct libcrun_lazy_config_s *lazy);
+
+void libcrun_lazy_config_free (struct libcrun_lazy_config_s *lazy);
+
+#endif
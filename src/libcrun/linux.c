@@ -54,6 +54,9 @@
 #include "intelrdt.h"
 #include "io_priority.h"
 #include "net_device.h"
+#include "trace.h"
+#include "arena.h"
+#include "blake3/blake3.h"
 
 #include <sys/socket.h>
 #include <libgen.h>
@@ -86,6 +89,10 @@
 #  define OPEN_TREE_CLONE 1
 #endif
 
+#ifndef NSFS_MAGIC
+#  define NSFS_MAGIC 0x6e736673
+#endif
+
 #ifndef OPEN_TREE_CLOEXEC
 #  define OPEN_TREE_CLOEXEC O_CLOEXEC
 #endif
@@ -124,6 +131,9 @@ struct remount_s
 
 struct private_data_s
 {
+  /* Allocations that are needed only while the container is set up.  */
+  struct libcrun_arena_s *arena;
+
   struct remount_s *remounts;
 
   /* Filled by libcrun_run_linux_container().  Useful to query what
@@ -184,6 +194,7 @@ cleanup_private_data (void *private_data)
   free (p->container_notify_socket_path);
   free (p->external_descriptors);
   free (p->maskdir_proc_path);
+  libcrun_arena_free (p->arena);
   free (p);
 }
 
@@ -197,6 +208,7 @@ get_private_data (struct libcrun_container_s *container)
       p->rootfsfd = -1;
       p->notify_socket_tree_fd = -1;
       p->maskdir_fd = -1;
+      p->arena = libcrun_arena_new ();
       container->cleanup_private_data = cleanup_private_data;
     }
   return container->private_data;
@@ -247,19 +259,6 @@ syscall_keyctl_join (const char *name)
   return (int) syscall (__NR_keyctl, KEYCTL_JOIN_SESSION_KEYRING, name, 0);
 }
 
-static int
-syscall_pidfd_open (pid_t pid, unsigned int flags)
-{
-#if defined __NR_pidfd_open
-  return (int) syscall (__NR_pidfd_open, pid, flags);
-#else
-  (void) pid;
-  (void) flags;
-  errno = ENOSYS;
-  return -1;
-#endif
-}
-
 static int
 syscall_pidfd_send_signal (int pidfd, int sig, siginfo_t *info, unsigned int flags)
 {
@@ -503,19 +502,148 @@ has_same_mappings (runtime_spec_schema_config_schema *def, runtime_spec_schema_d
   return true;
 }
 
-static pid_t
-maybe_create_userns_for_idmapped_mount (libcrun_container_t *container,
-                                        runtime_spec_schema_config_schema *def,
-                                        runtime_spec_schema_defs_mount *mnt,
-                                        const char *options, pid_t *pid_out,
-                                        libcrun_error_t *err)
+/* User namespaces created for the idmapped mounts, keyed by the uid and gid
+   mappings written to them, so that the mounts with the same mappings use
+   the same user namespace.  */
+struct idmapped_userns_entry_s
 {
-  cleanup_pid pid_t pid = -1;
-  bool need_new_userns = mnt->uid_mappings_len ? ! has_same_mappings (def, mnt) : options != NULL;
+  char *key;
+  int fd;
+};
 
-  if (! need_new_userns)
+struct idmapped_userns_cache_s
+{
+  struct idmapped_userns_entry_s *entries;
+  size_t len;
+  /* If set, the user namespaces are bind mounted in this directory and
+     shared with the other containers in the same pod.  */
+  char *shared_dir;
+};
+
+static void
+cleanup_idmapped_userns_cachep (struct idmapped_userns_cache_s *cache)
+{
+  size_t i;
+
+  for (i = 0; i < cache->len; i++)
+    {
+      free (cache->entries[i].key);
+      TEMP_FAILURE_RETRY (close (cache->entries[i].fd));
+    }
+  free (cache->entries);
+  free (cache->shared_dir);
+  memset (cache, 0, sizeof (*cache));
+}
+
+#define cleanup_idmapped_userns_cache __attribute__ ((cleanup (cleanup_idmapped_userns_cachep)))
+
+/* The user namespaces are shared in the state directory of the pod sandbox
+   only if the annotation run.oci.idmapped_mounts.share_userns is set.  */
+static int
+init_idmapped_userns_cache (libcrun_container_t *container, struct idmapped_userns_cache_s *cache, libcrun_error_t *err)
+{
+  cleanup_free char *state_dir = NULL;
+  const char *annotation;
+  const char *sandbox_id;
+  int ret;
+
+  memset (cache, 0, sizeof (*cache));
+
+  annotation = find_known_annotation (container, ANNOTATION_IDMAPPED_MOUNTS_SHARE_USERNS);
+  if (annotation == NULL || strcmp (annotation, "0") == 0 || container->context == NULL)
     return 0;
 
+  sandbox_id = find_known_annotation (container, ANNOTATION_CRIO_SANDBOX_ID);
+  if (sandbox_id == NULL)
+    sandbox_id = find_known_annotation (container, ANNOTATION_CRI_SANDBOX_ID);
+  if (sandbox_id == NULL)
+    sandbox_id = container->context->id;
+
+  ret = libcrun_get_state_directory (&state_dir, container->context->state_root, sandbox_id, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = append_paths (&cache->shared_dir, err, state_dir, "idmapped-userns", NULL);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  /* The directory is removed together with the sandbox state.  */
+  ret = mkdir (cache->shared_dir, 0700);
+  if (ret < 0 && errno != EEXIST)
+    {
+      libcrun_debug ("cannot create `%s`, the idmapped mounts user namespaces are not shared: %s", cache->shared_dir, strerror (errno));
+      free (cache->shared_dir);
+      cache->shared_dir = NULL;
+    }
+
+  return 0;
+}
+
+static int
+format_idmapped_mount_mappings (runtime_spec_schema_config_schema *def,
+                                runtime_spec_schema_defs_mount *mnt,
+                                const char *options, char **uid_map,
+                                char **gid_map, libcrun_error_t *err)
+{
+  cleanup_free char *dup_options = NULL;
+  char *option, *saveptr = NULL;
+  size_t written = 0;
+  int ret;
+
+  if (mnt->uid_mappings_len)
+    {
+      ret = format_mount_mappings (uid_map, mnt->uid_mappings, mnt->uid_mappings_len, &written, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      return format_mount_mappings (gid_map, mnt->gid_mappings, mnt->gid_mappings_len, &written, err);
+    }
+
+  if (! options)
+    return crun_make_error (err, 0, "internal error: no mappings found");
+
+  dup_options = xstrdup (options);
+
+  /* If there are no OCI mappings specified, then parse the annotation.  */
+  for (option = strtok_r (dup_options, ";", &saveptr); option; option = strtok_r (NULL, ";", &saveptr))
+    {
+      bool is_uids = false;
+      char **out;
+      size_t len = 0;
+
+      if (has_prefix (option, "uids="))
+        is_uids = true;
+      else if (! has_prefix (option, "gids="))
+        return crun_make_error (err, 0, "invalid option `%s` specified", option);
+
+      out = is_uids ? uid_map : gid_map;
+      if (*out)
+        return crun_make_error (err, 0, "invalid option `%s` specified: mappings already set", option);
+
+      ret = parse_idmapped_mount_option (def, is_uids, option + 5 /* strlen ("uids="), strlen ("gids=")*/, out, &len, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  /* A missing map is left unset in the new user namespace.  */
+  if (*uid_map == NULL)
+    *uid_map = xstrdup ("");
+  if (*gid_map == NULL)
+    *gid_map = xstrdup ("");
+
+  return 0;
+}
+
+/* Create a user namespace with the specified mappings and return a fd
+   to it.  The process used to create it is terminated before returning,
+   the fd keeps the namespace alive.  */
+static int
+create_userns_with_mappings (libcrun_container_t *container, const char *uid_map,
+                             const char *gid_map, libcrun_error_t *err)
+{
+  cleanup_pid pid_t pid = -1;
+  int ret;
+
   pid = syscall_clone (CLONE_NEWUSER | SIGCHLD, NULL);
   if (UNLIKELY (pid < 0))
     return crun_make_error (err, errno, "clone");
@@ -528,88 +656,164 @@ maybe_create_userns_for_idmapped_mount (libcrun_container_t *container,
       _safe_exit (EXIT_SUCCESS);
     }
 
-  if (mnt->uid_mappings_len)
+  if (uid_map[0])
     {
-      cleanup_free char *uid_map = NULL;
-      cleanup_free char *gid_map = NULL;
-      size_t written = 0;
-      int ret;
-
-      ret = format_mount_mappings (&uid_map, mnt->uid_mappings, mnt->uid_mappings_len, &written, err);
-      if (UNLIKELY (ret < 0))
-        return ret;
-
       cleanup_close int fd = -1;
 
       fd = libcrun_open_proc_pid_file (container, pid, "uid_map", O_WRONLY, err);
       if (UNLIKELY (fd < 0))
         return fd;
 
-      ret = safe_write (fd, "uid_map", uid_map, written, err);
-      if (UNLIKELY (ret < 0))
-        return ret;
-
-      ret = format_mount_mappings (&gid_map, mnt->gid_mappings, mnt->gid_mappings_len, &written, err);
+      ret = safe_write (fd, "uid_map", uid_map, strlen (uid_map), err);
       if (UNLIKELY (ret < 0))
         return ret;
+    }
 
-      close_and_reset (&fd);
+  if (gid_map[0])
+    {
+      cleanup_close int fd = -1;
 
       fd = libcrun_open_proc_pid_file (container, pid, "gid_map", O_WRONLY, err);
       if (UNLIKELY (fd < 0))
         return fd;
 
-      ret = safe_write (fd, "gid_map", gid_map, written, err);
+      ret = safe_write (fd, "gid_map", gid_map, strlen (gid_map), err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
-  else
+
+  return libcrun_open_proc_pid_file (container, pid, "ns/user", O_RDONLY, err);
+}
+
+static int
+get_shared_userns_path (char **out, struct idmapped_userns_cache_s *cache, const char *key, libcrun_error_t *err)
+{
+  char name[33];
+  blake3_hasher hasher;
+  unsigned char hash[16];
+  size_t i;
+
+  blake3_hasher_init (&hasher);
+  blake3_hasher_update (&hasher, key, strlen (key));
+  blake3_hasher_finalize (&hasher, hash, sizeof (hash));
+
+  for (i = 0; i < sizeof (hash); i++)
+    sprintf (&name[i * 2], "%02x", hash[i]);
+
+  return append_paths (out, err, cache->shared_dir, name, NULL);
+}
+
+/* Look up the user namespace for KEY in the pod shared directory.
+   Returns a fd to it, or -1 if it is not there.  */
+static int
+open_shared_userns (const char *path)
+{
+  cleanup_close int fd = -1;
+  struct statfs sfs;
+
+  fd = open (path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+
+  /* An entry that is not mounted is left by a container that was
+     still creating it, or that failed.  */
+  if (fstatfs (fd, &sfs) < 0 || sfs.f_type != NSFS_MAGIC)
+    return -1;
+
+  return get_and_reset (&fd);
+}
+
+/* Make the user namespace USERNS_FD available to the other containers in
+   the pod.  Failures are not fatal, the namespace is used only by this
+   container.  */
+static void
+share_userns (const char *path, int userns_fd)
+{
+  proc_fd_path_t procpath;
+  int fd;
+
+  fd = open (path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0400);
+  if (fd < 0)
+    return;
+  close (fd);
+
+  get_proc_self_fd_path (procpath, userns_fd);
+  if (mount (procpath, path, NULL, MS_BIND, NULL) < 0)
     {
-      cleanup_free char *dup_options = NULL;
-      char *option, *saveptr = NULL;
+      libcrun_debug ("cannot share the idmapped mount user namespace `%s`: %s", path, strerror (errno));
+      unlink (path);
+    }
+}
 
-      if (! options)
-        return crun_make_error (err, 0, "internal error: no mappings found");
+/* Get the user namespace for the idmapped mount MNT.  *USERNS_FD is set to
+   -1 if the mount uses the same mappings as the container, otherwise it
+   is owned by CACHE.  */
+static int
+get_userns_for_idmapped_mount (libcrun_container_t *container,
+                               runtime_spec_schema_config_schema *def,
+                               runtime_spec_schema_defs_mount *mnt,
+                               const char *options,
+                               struct idmapped_userns_cache_s *cache,
+                               int *userns_fd,
+                               libcrun_error_t *err)
+{
+  bool need_new_userns = mnt->uid_mappings_len ? ! has_same_mappings (def, mnt) : options != NULL;
+  cleanup_free char *shared_path = NULL;
+  cleanup_free char *uid_map = NULL;
+  cleanup_free char *gid_map = NULL;
+  cleanup_free char *key = NULL;
+  cleanup_close int fd = -1;
+  size_t i;
+  int ret;
 
-      dup_options = xstrdup (options);
+  *userns_fd = -1;
 
-      /* If there are no OCI mappings specified, then parse the annotation.  */
-      for (option = strtok_r (dup_options, ";", &saveptr); option; option = strtok_r (NULL, ";", &saveptr))
-        {
-          cleanup_free char *mappings = NULL;
-          cleanup_close int map_fd = -1;
-          bool is_uids = false;
-          size_t len = 0;
-          int ret;
+  if (! need_new_userns)
+    return 0;
 
-          if (has_prefix (option, "uids="))
-            {
-              is_uids = true;
-              map_fd = libcrun_open_proc_pid_file (container, pid, "uid_map", O_WRONLY, err);
-              if (UNLIKELY (map_fd < 0))
-                return map_fd;
-            }
-          else if (has_prefix (option, "gids="))
-            {
-              map_fd = libcrun_open_proc_pid_file (container, pid, "gid_map", O_WRONLY, err);
-              if (UNLIKELY (map_fd < 0))
-                return map_fd;
-            }
-          else
-            return crun_make_error (err, 0, "invalid option `%s` specified", option);
+  ret = format_idmapped_mount_mappings (def, mnt, options, &uid_map, &gid_map, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
 
-          ret = parse_idmapped_mount_option (def, is_uids, option + 5 /* strlen ("uids="), strlen ("gids=")*/, &mappings, &len, err);
-          if (UNLIKELY (ret < 0))
-            return ret;
+  xasprintf (&key, "uid_map:%sgid_map:%s", uid_map, gid_map);
 
-          ret = safe_write (map_fd, is_uids ? "uid_map" : "gid_map", mappings, len, err);
-          if (UNLIKELY (ret < 0))
-            return ret;
-        }
+  for (i = 0; i < cache->len; i++)
+    if (strcmp (cache->entries[i].key, key) == 0)
+      {
+        *userns_fd = cache->entries[i].fd;
+        return 0;
+      }
+
+  if (cache->shared_dir)
+    {
+      ret = get_shared_userns_path (&shared_path, cache, key, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      fd = open_shared_userns (shared_path);
+      if (fd >= 0)
+        libcrun_trace ("idmapped mount user namespace `%s` shared with the pod", shared_path);
     }
 
-  *pid_out = pid;
-  pid = -1;
+  if (fd < 0)
+    {
+      fd = create_userns_with_mappings (container, uid_map, gid_map, err);
+      if (UNLIKELY (fd < 0))
+        return fd;
+
+      libcrun_trace ("created a user namespace for the idmapped mount on `%s`", mnt->destination);
+
+      if (shared_path)
+        share_userns (shared_path, fd);
+    }
+
+  cache->entries = xrealloc (cache->entries, sizeof (*cache->entries) * (cache->len + 1));
+  cache->entries[cache->len].key = key;
+  cache->entries[cache->len].fd = fd;
+  cache->len++;
+  key = NULL;
+
+  *userns_fd = get_and_reset (&fd);
   return 0;
 }
 
@@ -710,20 +914,19 @@ get_mount_flags (const char *name, int current_flags, int *found, unsigned long
   return current_flags | prop->flags;
 }
 
+/* OPTION is allocated in ARENA.  */
 static unsigned long
-get_mount_flags_or_option (const char *name, int current_flags, unsigned long *extra_flags, char **option, uint64_t *rec_clear, uint64_t *rec_set)
+get_mount_flags_or_option (struct libcrun_arena_s *arena, const char *name, int current_flags, unsigned long *extra_flags, char **option, uint64_t *rec_clear, uint64_t *rec_set)
 {
   int found;
-  __attribute__ ((unused)) cleanup_free char *prev = NULL;
   unsigned long flags = get_mount_flags (name, current_flags, &found, extra_flags, rec_clear, rec_set);
   if (found)
     return flags;
 
-  prev = *option;
   if (*option && **option)
-    xasprintf (option, "%s,%s", *option, name);
+    *option = libcrun_arena_asprintf (arena, "%s,%s", *option, name);
   else
-    *option = xstrdup (name);
+    *option = libcrun_arena_strdup (arena, name);
 
   return 0;
 }
@@ -734,6 +937,7 @@ pivot_root (const char *new_root, const char *put_old)
   return syscall (__NR_pivot_root, new_root, put_old);
 }
 
+/* The remount itself is in the container arena, only the fd is released.  */
 static void
 free_remount (struct remount_s *r)
 {
@@ -741,19 +945,17 @@ free_remount (struct remount_s *r)
     return;
   if (r->targetfd >= 0)
     close (r->targetfd);
-  free (r->data);
-  free (r->target);
-  free (r);
 }
 
 static struct remount_s *
-make_remount (int targetfd, const char *target, unsigned long flags, const char *data, struct remount_s *next)
+make_remount (libcrun_container_t *container, int targetfd, const char *target, unsigned long flags, const char *data)
 {
-  struct remount_s *ret = xmalloc (sizeof (*ret));
-  ret->target = xstrdup (target);
+  struct private_data_s *private_data = get_private_data (container);
+  struct remount_s *ret = libcrun_arena_alloc (private_data->arena, sizeof (*ret));
+  ret->target = libcrun_arena_strdup (private_data->arena, target);
   ret->flags = flags;
-  ret->data = data ? xstrdup (data) : NULL;
-  ret->next = next;
+  ret->data = data ? libcrun_arena_strdup (private_data->arena, data) : NULL;
+  ret->next = private_data->remounts;
   ret->targetfd = targetfd;
   return ret;
 }
@@ -1082,7 +1284,7 @@ get_selinux_context_type (libcrun_container_t *container)
 {
   const char *context_type;
 
-  context_type = find_annotation (container, "run.oci.mount_context_type");
+  context_type = find_known_annotation (container, ANNOTATION_MOUNT_CONTEXT_TYPE);
   if (context_type)
     return context_type;
 
@@ -1282,7 +1484,7 @@ do_mount (libcrun_container_t *container, const char *source, int targetfd,
             }
 
           /* The remount owns the fd.  */
-          r = make_remount (get_and_reset (&fd), target, remount_flags, data, get_private_data (container)->remounts);
+          r = make_remount (container, get_and_reset (&fd), target, remount_flags, data);
           get_private_data (container)->remounts = r;
         }
     }
@@ -1936,28 +2138,31 @@ append_tmpfs_mode_if_missing (libcrun_container_t *container, runtime_spec_schem
   if (ret < 0)
     return crun_make_error (err, errno, "fstat `%s`", mount->destination);
 
-  xasprintf (data, "%s%smode=%o", empty_data ? "" : *data, empty_data ? "" : ",", st.st_mode & 07777);
+  *data = libcrun_arena_asprintf (get_private_data (container)->arena, "%s%smode=%o", empty_data ? "" : *data, empty_data ? "" : ",", st.st_mode & 07777);
   return 0;
 }
 
+/* DATA is allocated in the container arena.  */
 static int
 get_default_flags (libcrun_container_t *container, const char *destination, char **data)
 {
+  struct libcrun_arena_s *arena = get_private_data (container)->arena;
+
   if (strcmp (destination, "/proc") == 0)
     return 0;
   if (strcmp (destination, "/dev/cgroup") == 0 || strcmp (destination, "/sys/fs/cgroup") == 0)
     {
-      *data = xstrdup ("none,name=");
+      *data = libcrun_arena_strdup (arena, "none,name=");
       return MS_NOEXEC | MS_NOSUID | MS_STRICTATIME;
     }
   if (strcmp (destination, "/dev") == 0)
     {
-      *data = xstrdup ("mode=755");
+      *data = libcrun_arena_strdup (arena, "mode=755");
       return MS_NOEXEC | MS_STRICTATIME;
     }
   if (strcmp (destination, "/dev/shm") == 0)
     {
-      *data = xstrdup ("mode=1777,size=65536k");
+      *data = libcrun_arena_strdup (arena, "mode=1777,size=65536k");
       return MS_NOEXEC | MS_NOSUID | MS_NODEV;
     }
   if (strcmp (destination, "/dev/mqueue") == 0)
@@ -1965,9 +2170,9 @@ get_default_flags (libcrun_container_t *container, const char *destination, char
   if (strcmp (destination, "/dev/pts") == 0)
     {
       if (container->host_uid == 0)
-        *data = xstrdup ("newinstance,ptmxmode=0666,mode=620,gid=5");
+        *data = libcrun_arena_strdup (arena, "newinstance,ptmxmode=0666,mode=620,gid=5");
       else
-        *data = xstrdup ("newinstance,ptmxmode=0666,mode=620");
+        *data = libcrun_arena_strdup (arena, "newinstance,ptmxmode=0666,mode=620");
       return MS_NOEXEC | MS_NOSUID;
     }
   if (strcmp (destination, "/sys") == 0)
@@ -1977,7 +2182,7 @@ get_default_flags (libcrun_container_t *container, const char *destination, char
 }
 
 static char *
-append_mode_if_missing (char *data, const char *mode)
+append_mode_if_missing (struct libcrun_arena_s *arena, char *data, const char *mode)
 {
   char *new_data;
   bool append;
@@ -1988,11 +2193,9 @@ append_mode_if_missing (char *data, const char *mode)
   append = data != NULL && data[0] != '\0';
 
   if (append)
-    xasprintf (&new_data, "%s,%s", data, mode);
+    new_data = libcrun_arena_asprintf (arena, "%s,%s", data, mode);
   else
-    new_data = xstrdup (mode);
-
-  free (data);
+    new_data = libcrun_arena_strdup (arena, mode);
 
   return new_data;
 }
@@ -2000,7 +2203,7 @@ append_mode_if_missing (char *data, const char *mode)
 static const char *
 get_force_cgroup_v1_annotation (libcrun_container_t *container)
 {
-  return find_annotation (container, "run.oci.systemd.force_cgroup_v1");
+  return find_known_annotation (container, ANNOTATION_SYSTEMD_FORCE_CGROUP_V1);
 }
 
 static int
@@ -2161,7 +2364,8 @@ process_single_mount (libcrun_container_t *container, const char *rootfs,
 {
   const char *target = consume_slashes (mount->destination);
   cleanup_close int source_mountfd = -1;
-  cleanup_free char *data = NULL;
+  struct libcrun_arena_s *arena = get_private_data (container)->arena;
+  char *data = NULL;
   char *type;
   char *source;
   unsigned long flags = 0;
@@ -2187,7 +2391,7 @@ process_single_mount (libcrun_container_t *container, const char *rootfs,
       size_t j;
 
       for (j = 0; j < mount->options_len; j++)
-        flags |= get_mount_flags_or_option (mount->options[j], flags, &extra_flags, &data, &rec_clear, &rec_set);
+        flags |= get_mount_flags_or_option (arena, mount->options[j], flags, &extra_flags, &data, &rec_clear, &rec_set);
     }
 
   if (type == NULL && (flags & MS_BIND) == 0)
@@ -2238,7 +2442,7 @@ process_single_mount (libcrun_container_t *container, const char *rootfs,
           source_mountfd = ret;
         }
 
-      data = append_mode_if_missing (data, "mode=1755");
+      data = append_mode_if_missing (arena, data, "mode=1755");
     }
 
   if (S_ISLNK (src_mode) && (extra_flags & OPTION_COPY_SYMLINK))
@@ -2392,7 +2596,8 @@ int
 libcrun_container_do_bind_mount (libcrun_container_t *container, char *mount_source, char *mount_destination, char **mount_options, size_t mount_options_len, libcrun_error_t *err)
 {
   const char *target = consume_slashes (mount_destination);
-  cleanup_free char *data = NULL;
+  struct libcrun_arena_s *arena = get_private_data (container)->arena;
+  char *data = NULL;
   unsigned long flags = 0;
   unsigned long extra_flags = 0;
   cleanup_close int targetfd = -1;
@@ -2412,7 +2617,7 @@ libcrun_container_do_bind_mount (libcrun_container_t *container, char *mount_sou
       size_t j;
 
       for (j = 0; j < mount_options_len; j++)
-        flags |= get_mount_flags_or_option (mount_options[j], flags, &extra_flags, &data, &rec_clear, &rec_set);
+        flags |= get_mount_flags_or_option (arena, mount_options[j], flags, &extra_flags, &data, &rec_clear, &rec_set);
     }
 
   if (path_is_slash_dev (mount_destination))
@@ -2424,7 +2629,7 @@ libcrun_container_do_bind_mount (libcrun_container_t *container, char *mount_sou
       if (UNLIKELY (is_dir < 0))
         return is_dir;
 
-      data = append_mode_if_missing (data, "mode=1755");
+      data = append_mode_if_missing (arena, data, "mode=1755");
     }
 
   /* Make sure any other directory/file is created and take a O_PATH reference to it.  */
@@ -2740,7 +2945,7 @@ libcrun_set_mounts (struct container_entrypoint_s *entrypoint_args, libcrun_cont
       if (UNLIKELY (fd < 0))
         return crun_make_error (err, errno, "dup fd for `%s`", rootfs);
 
-      r = make_remount (fd, rootfs, remount_flags, NULL, get_private_data (container)->remounts);
+      r = make_remount (container, fd, rootfs, remount_flags, NULL);
       get_private_data (container)->remounts = r;
     }
 
@@ -3039,7 +3244,7 @@ can_setgroups (libcrun_container_t *container, libcrun_error_t *err)
       const char *annotation;
 
       /* Skip setgroups if the annotation is set to anything different than "0".  */
-      annotation = find_annotation (container, "run.oci.keep_original_groups");
+      annotation = find_known_annotation (container, ANNOTATION_KEEP_ORIGINAL_GROUPS);
       if (annotation)
         return strcmp (annotation, "0") == 0 ? 1 : 0;
     }
@@ -3938,6 +4143,8 @@ send_success_to_sync_socket (int sync_socket, libcrun_error_t *err)
   const int success = 0;
   int ret;
 
+  libcrun_trace_counter_add (LIBCRUN_TRACE_SYNC_SOCKET_MESSAGES, 1);
+
   ret = TEMP_FAILURE_RETRY (write (sync_socket, &success, sizeof (success)));
   if (UNLIKELY (ret < 0))
     return crun_make_error (err, errno, "write to sync socket");
@@ -3945,6 +4152,31 @@ send_success_to_sync_socket (int sync_socket, libcrun_error_t *err)
   return 0;
 }
 
+struct sync_pid_message_s
+{
+  int status;
+  pid_t pid;
+};
+
+/* Report success and the PID of a new process with a single message.  */
+static inline int
+send_success_and_pid_to_sync_socket (int sync_socket, pid_t pid, libcrun_error_t *err)
+{
+  const struct sync_pid_message_s msg = {
+    .status = 0,
+    .pid = pid,
+  };
+  int ret;
+
+  libcrun_trace_counter_add (LIBCRUN_TRACE_SYNC_SOCKET_MESSAGES, 1);
+
+  ret = TEMP_FAILURE_RETRY (write (sync_socket, &msg, sizeof (msg)));
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "write to sync socket");
+
+  return 0;
+}
+
 static __attribute__ ((noreturn)) void
 send_error_to_sync_socket_and_die (int sync_socket_fd, bool has_terminal, libcrun_error_t *err)
 {
@@ -3969,6 +4201,8 @@ expect_success_from_sync_socket (int sync_fd, libcrun_error_t *err)
   int res = 1;
   int ret;
 
+  libcrun_trace_counter_add (LIBCRUN_TRACE_SYNC_SOCKET_MESSAGES, 1);
+
   ret = TEMP_FAILURE_RETRY (read (sync_fd, &res, sizeof (res)));
   if (UNLIKELY (ret != sizeof (res)))
     return crun_make_error (err, errno, "read status from sync socket");
@@ -3985,9 +4219,51 @@ expect_success_from_sync_socket (int sync_fd, libcrun_error_t *err)
   return crun_make_error (err, res, "read from sync socket");
 }
 
+/* Counterpart of send_success_and_pid_to_sync_socket.  An error is sent as a
+   status-only message, followed by the error string.  */
+static int
+expect_success_and_pid_from_sync_socket (int sync_fd, pid_t *pid, libcrun_error_t *err)
+{
+  cleanup_free char *err_str = NULL;
+  struct sync_pid_message_s msg = {
+    .status = 1,
+    .pid = 0,
+  };
+  int res;
+  int ret;
+
+  libcrun_trace_counter_add (LIBCRUN_TRACE_SYNC_SOCKET_MESSAGES, 1);
+
+  ret = TEMP_FAILURE_RETRY (read (sync_fd, &msg, sizeof (msg)));
+  if (UNLIKELY (ret < (int) sizeof (msg.status)))
+    return crun_make_error (err, errno, "read status from sync socket");
+
+  res = msg.status;
+  if (res == 0)
+    {
+      if (UNLIKELY (ret != sizeof (msg)))
+        return crun_make_error (err, 0, "read pid from sync socket");
+
+      *pid = msg.pid;
+      return 0;
+    }
+
+  if (read_error_from_sync_socket (sync_fd, &res, &err_str))
+    {
+      if (! is_empty_string (err_str))
+        return crun_make_error (err, res, "%s", err_str);
+    }
+
+  return crun_make_error (err, res, "read from sync socket");
+}
+
+/* NAMESPACES_TO_JOIN_VALUE holds the CLONE_* flags for each fd.  An fd
+   is either a namespace file or a pidfd, in which case multiple flags
+   can be set.  */
 static int
 join_namespaces (runtime_spec_schema_config_schema *def, int *namespaces_to_join, int n_namespaces_to_join,
-                 int *namespaces_to_join_index, bool ignore_join_errors, libcrun_error_t *err)
+                 int *namespaces_to_join_index, int *namespaces_to_join_value, bool ignore_join_errors,
+                 libcrun_error_t *err)
 {
   int ret;
   int i;
@@ -4002,11 +4278,11 @@ join_namespaces (runtime_spec_schema_config_schema *def, int *namespaces_to_join
         continue;
 
       /* Skip the user namespace.  */
-      value = libcrun_find_namespace (def->linux->namespaces[orig_index]->type);
+      value = namespaces_to_join_value[i];
       if (value == CLONE_NEWUSER)
         continue;
 
-      if (value == CLONE_NEWNS)
+      if (value & CLONE_NEWNS)
         {
           cwd = getcwd (NULL, 0);
           if (UNLIKELY (cwd == NULL))
@@ -4024,7 +4300,7 @@ join_namespaces (runtime_spec_schema_config_schema *def, int *namespaces_to_join
 
       close_and_reset (&namespaces_to_join[i]);
 
-      if (value == CLONE_NEWNS)
+      if (value & CLONE_NEWNS)
         {
           ret = chdir (cwd);
           if (UNLIKELY (ret < 0))
@@ -4089,10 +4365,131 @@ cleanup_free_init_statusp (struct init_status_s *ns)
     TEMP_FAILURE_RETRY (close (ns->fd[i]));
 }
 
+/* If PATH is in the form /proc/PID/ns/NS_FILE, return PID.  */
+static pid_t
+get_pid_from_ns_path (const char *path, const char *type)
+{
+  struct linux_namespace_s *it;
+  const char *ns_file = NULL;
+  char *end = NULL;
+  long pid;
+
+  for (it = namespaces; it->name; it++)
+    if (strcmp (it->name, type) == 0)
+      ns_file = it->ns_file;
+
+  if (ns_file == NULL || ! has_prefix (path, "/proc/"))
+    return -1;
+
+  errno = 0;
+  pid = strtol (path + 6, &end, 10);
+  if (errno || end == path + 6 || pid <= 0 || ! has_prefix (end, "/ns/") || strcmp (end + 4, ns_file) != 0)
+    return -1;
+
+  return pid;
+}
+
+/* The namespaces that can be joined together with setns on a pidfd when
+   the container is created.  The user, cgroup and time namespaces need a
+   special handling and they are always joined individually.  */
+#define PIDFD_JOINABLE_NAMESPACES (CLONE_NEWNS | CLONE_NEWNET | CLONE_NEWIPC | CLONE_NEWPID | CLONE_NEWUTS)
+
+/*
+  If all the namespace paths refer to the same process and it is the init
+  process of the pod sandbox the container belongs to, open a pidfd for it
+  so that the namespaces can be joined with a single setns.  The pidfd is
+  validated against the start time recorded in the sandbox status.
+
+  return a pidfd or -1 if the namespaces must be joined individually.
+*/
+static int
+open_sandbox_pidfd (libcrun_container_t *container, int *flags, int *n_namespaces)
+{
+  runtime_spec_schema_config_schema *def = container->container_def;
+  cleanup_container_status libcrun_container_status_t status = {};
+  libcrun_error_t tmp_err = NULL;
+  const char *sandbox_id;
+  int all_flags = 0, n = 0;
+  pid_t pid = -1;
+  int pidfd;
+  size_t i;
+  int ret;
+
+  *flags = 0;
+  *n_namespaces = 0;
+
+  if (container->host_uid || container->context == NULL)
+    return -1;
+
+  for (i = 0; i < def->linux->namespaces_len; i++)
+    {
+      const char *path = def->linux->namespaces[i]->path;
+      int value = libcrun_find_namespace (def->linux->namespaces[i]->type);
+      pid_t ns_pid;
+
+      if (value == CLONE_NEWUSER)
+        return -1;
+
+      if (path == NULL)
+        continue;
+
+      if ((value & PIDFD_JOINABLE_NAMESPACES) == 0)
+        return -1;
+
+      ns_pid = get_pid_from_ns_path (path, def->linux->namespaces[i]->type);
+      if (ns_pid < 0 || (pid > 0 && ns_pid != pid))
+        return -1;
+
+      pid = ns_pid;
+      all_flags |= value;
+      n++;
+    }
+
+  /* Nothing to gain with a single namespace.  */
+  if (n < 2)
+    return -1;
+
+  sandbox_id = find_known_annotation (container, ANNOTATION_CRIO_SANDBOX_ID);
+  if (sandbox_id == NULL)
+    sandbox_id = find_known_annotation (container, ANNOTATION_CRI_SANDBOX_ID);
+  if (sandbox_id == NULL)
+    return -1;
+
+  ret = libcrun_read_container_status (&status, container->context->state_root, sandbox_id, &tmp_err);
+  if (UNLIKELY (ret < 0))
+    {
+      crun_error_release (&tmp_err);
+      return -1;
+    }
+
+  if (status.pid != pid || status.process_start_time == 0)
+    return -1;
+
+  pidfd = syscall_pidfd_open (pid, 0);
+  if (UNLIKELY (pidfd < 0))
+    return -1;
+
+  /* The pidfd pins the process, make sure it is still the sandbox one.  */
+  ret = libcrun_check_pid_valid (&status, &tmp_err);
+  if (UNLIKELY (ret <= 0))
+    {
+      crun_error_release (&tmp_err);
+      TEMP_FAILURE_RETRY (close (pidfd));
+      return -1;
+    }
+
+  libcrun_debug ("Joining namespaces of the sandbox `%s` through its pidfd", sandbox_id);
+  *flags = all_flags;
+  *n_namespaces = n;
+  return pidfd;
+}
+
 static int
 configure_init_status (struct init_status_s *ns, libcrun_container_t *container, libcrun_error_t *err)
 {
   runtime_spec_schema_config_schema *def = container->container_def;
+  int pidfd_namespaces, pidfd_n_namespaces;
+  cleanup_close int pidfd = -1;
   size_t i;
 
   for (i = 0; i < MAX_NAMESPACES + 1; i++)
@@ -4110,6 +4507,8 @@ configure_init_status (struct init_status_s *ns, libcrun_container_t *container,
   ns->idx_pidns_to_join_immediately = -1;
   ns->idx_timens_to_join_immediately = -1;
 
+  pidfd = open_sandbox_pidfd (container, &pidfd_namespaces, &pidfd_n_namespaces);
+
   for (i = 0; i < def->linux->namespaces_len; i++)
     {
       int value = libcrun_find_namespace (def->linux->namespaces[i]->type);
@@ -4126,6 +4525,25 @@ configure_init_status (struct init_status_s *ns, libcrun_container_t *container,
           libcrun_debug ("Unsharing namespace: `%s`", def->linux->namespaces[i]->type);
           ns->namespaces_to_unshare |= value;
         }
+      else if (pidfd_namespaces & value)
+        {
+          /* Joined through the sandbox pidfd, that is added only once.  */
+          if (pidfd < 0)
+            continue;
+
+          if (ns->fd_len >= MAX_NAMESPACES)
+            return crun_make_error (err, 0, "too many namespaces to join");
+
+          ns->fd[ns->fd_len] = get_and_reset (&pidfd);
+          ns->index[ns->fd_len] = i;
+          ns->value[ns->fd_len] = pidfd_namespaces;
+          ns->fd_len++;
+          ns->fd[ns->fd_len] = -1;
+
+          libcrun_trace ("namespaces: %d namespaces joined with a single setns on a pidfd, %d open and %d setns "
+                         "calls saved",
+                         pidfd_n_namespaces, pidfd_n_namespaces - 1, pidfd_n_namespaces - 1);
+        }
       else
         {
           int fd;
@@ -4290,15 +4708,16 @@ open_mount_of_type (runtime_spec_schema_defs_mount *mnt, int *out_fd, libcrun_er
 }
 
 static int
-maybe_get_idmapped_mount (libcrun_container_t *container, runtime_spec_schema_config_schema *def, runtime_spec_schema_defs_mount *mnt, pid_t pid, int *out_fd, bool *has_mappings_out, libcrun_error_t *err)
+maybe_get_idmapped_mount (libcrun_container_t *container, runtime_spec_schema_config_schema *def, runtime_spec_schema_defs_mount *mnt, pid_t pid,
+                          struct idmapped_userns_cache_s *userns_cache, int *out_fd, bool *has_mappings_out, libcrun_error_t *err)
 {
   cleanup_close int newfs_fd = -1;
-  cleanup_pid pid_t created_pid = -1;
   struct mount_attr_s attr = {
     0,
   };
   bool recursive_bind_mount = false;
-  cleanup_close int fd = -1;
+  cleanup_close int container_userns_fd = -1;
+  int userns_fd = -1;
   const char *idmap_option;
   bool recursive = false;
   const char *options = NULL;
@@ -4333,15 +4752,17 @@ maybe_get_idmapped_mount (libcrun_container_t *container, runtime_spec_schema_co
         }
     }
 
-  ret = maybe_create_userns_for_idmapped_mount (container, def, mnt, options, &created_pid, err);
+  ret = get_userns_for_idmapped_mount (container, def, mnt, options, userns_cache, &userns_fd, err);
   if (UNLIKELY (ret < 0))
     return ret;
-  if (created_pid > 0)
-    pid = created_pid;
 
-  fd = libcrun_open_proc_pid_file (container, pid, "ns/user", O_RDONLY, err);
-  if (UNLIKELY (fd < 0))
-    return fd;
+  if (userns_fd < 0)
+    {
+      container_userns_fd = libcrun_open_proc_pid_file (container, pid, "ns/user", O_RDONLY, err);
+      if (UNLIKELY (container_userns_fd < 0))
+        return container_userns_fd;
+      userns_fd = container_userns_fd;
+    }
 
   if (is_bind_mount (mnt, &recursive_bind_mount, &nofollow))
     {
@@ -4357,7 +4778,7 @@ maybe_get_idmapped_mount (libcrun_container_t *container, runtime_spec_schema_co
     }
 
   attr.attr_set = MOUNT_ATTR_IDMAP;
-  attr.userns_fd = fd;
+  attr.userns_fd = userns_fd;
 
   ret = syscall_mount_setattr (newfs_fd, "", AT_EMPTY_PATH | (recursive ? AT_RECURSIVE : 0), &attr);
   if (UNLIKELY (ret < 0))
@@ -4437,42 +4858,79 @@ precreate_device (libcrun_container_t *container, int devs_dirfd, size_t i, libc
   return get_bind_mount (devs_dirfd, name, false, false, false, err);
 }
 
+struct mount_fds_message_s
+{
+  uint32_t last;
+  uint32_t n_fds;
+  uint32_t index[LIBCRUN_MAX_FDS_PER_MESSAGE];
+};
+
+#define MOUNT_FDS_MESSAGE_LEN(n) (offsetof (struct mount_fds_message_s, index) + sizeof (uint32_t) * (n))
+
+/* Send the mount and device fds with as few messages as possible.  Each message
+   carries up to LIBCRUN_MAX_FDS_PER_MESSAGE fds, and their index in the
+   container configuration.  The devices are indexed after the mounts.  */
 static int
-send_mounts (int sync_socket_host, struct libcrun_fd_map *fds, size_t how_many, size_t total, libcrun_error_t *err)
+send_mounts (int sync_socket_host, struct libcrun_fd_map *mount_fds, struct libcrun_fd_map *dev_fds, libcrun_error_t *err)
 {
+  int fds[LIBCRUN_MAX_FDS_PER_MESSAGE];
+  struct mount_fds_message_s msg;
+  size_t total = mount_fds->nfds + dev_fds->nfds;
   size_t i;
   int ret;
 
-  ret = TEMP_FAILURE_RETRY (write (sync_socket_host, &how_many, sizeof (how_many)));
-  if (UNLIKELY (ret < 0))
-    return crun_make_error (err, errno, "write to sync socket");
+  if (total == 0)
+    return 0;
+
+  memset (&msg, 0, sizeof (msg));
 
   for (i = 0; i < total; i++)
     {
-      if (fds->fds[i] >= 0)
+      int fd = i < mount_fds->nfds ? mount_fds->fds[i] : dev_fds->fds[i - mount_fds->nfds];
+
+      if (fd < 0)
+        continue;
+
+      fds[msg.n_fds] = fd;
+      msg.index[msg.n_fds] = i;
+      msg.n_fds++;
+
+      if (msg.n_fds == LIBCRUN_MAX_FDS_PER_MESSAGE)
         {
-          ret = send_fd_to_socket_with_payload (sync_socket_host, fds->fds[i], (char *) &i, sizeof (i), err);
+          libcrun_trace_counter_add (LIBCRUN_TRACE_SYNC_SOCKET_MESSAGES, 1);
+          ret = send_fds_to_socket_with_payload (sync_socket_host, fds, msg.n_fds, &msg,
+                                                 MOUNT_FDS_MESSAGE_LEN (msg.n_fds), err);
           if (UNLIKELY (ret < 0))
             return ret;
+
+          msg.n_fds = 0;
         }
     }
-  return 0;
+
+  msg.last = 1;
+
+  libcrun_trace_counter_add (LIBCRUN_TRACE_SYNC_SOCKET_MESSAGES, 1);
+  return send_fds_to_socket_with_payload (sync_socket_host, fds, msg.n_fds, &msg, MOUNT_FDS_MESSAGE_LEN (msg.n_fds),
+                                          err);
 }
 
 static int
-prepare_and_send_mount_mounts (libcrun_container_t *container, pid_t pid, int sync_socket_host, libcrun_error_t *err)
+prepare_mount_mounts (libcrun_container_t *container, pid_t pid, struct libcrun_fd_map *mount_fds, libcrun_error_t *err)
 {
   runtime_spec_schema_config_schema *def = container->container_def;
-  cleanup_close_map struct libcrun_fd_map *mount_fds = NULL;
   bool has_userns = (get_private_data (container)->unshare_flags & CLONE_NEWUSER) ? true : false;
-  size_t how_many = 0;
+  cleanup_idmapped_userns_cache struct idmapped_userns_cache_s userns_cache = {
+    0,
+  };
   size_t i;
   int ret;
 
   if (def->mounts_len == 0)
     return 0;
 
-  mount_fds = make_libcrun_fd_map (def->mounts_len);
+  ret = init_idmapped_userns_cache (container, &userns_cache, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
 
   /* If the container is already running in a user namespace, apply the same logic as if a new
      user namespace was created as part of the container itself.  */
@@ -4492,7 +4950,7 @@ prepare_and_send_mount_mounts (libcrun_container_t *container, pid_t pid, int sy
       bool has_mappings = false;
       int mount_fd = -1;
 
-      ret = maybe_get_idmapped_mount (container, def, def->mounts[i], pid, &mount_fd, &has_mappings, err);
+      ret = maybe_get_idmapped_mount (container, def, def->mounts[i], pid, &userns_cache, &mount_fd, &has_mappings, err);
       if (UNLIKELY (ret < 0))
         return ret;
 
@@ -4505,20 +4963,16 @@ prepare_and_send_mount_mounts (libcrun_container_t *container, pid_t pid, int sy
             crun_error_release (err);
         }
 
-      if (mount_fd >= 0)
-        how_many++;
-
       mount_fds->fds[i] = mount_fd;
     }
 
-  return send_mounts (sync_socket_host, mount_fds, how_many, def->mounts_len, err);
+  return 0;
 }
 
 static int
-prepare_and_send_dev_mounts (libcrun_container_t *container, int sync_socket_host, libcrun_error_t *err)
+prepare_dev_mounts (libcrun_container_t *container, struct libcrun_fd_map *dev_fds, libcrun_error_t *err)
 {
   runtime_spec_schema_config_schema *def = container->container_def;
-  cleanup_close_map struct libcrun_fd_map *dev_fds = NULL;
   bool has_userns = (get_private_data (container)->unshare_flags & CLONE_NEWUSER) ? true : false;
   cleanup_close int current_mountns = -1;
   cleanup_free char *state_dir = NULL;
@@ -4527,7 +4981,6 @@ prepare_and_send_dev_mounts (libcrun_container_t *container, int sync_socket_hos
   cleanup_close int targetfd = -1;
   const char *context_type = NULL;
   const char *label = NULL;
-  size_t how_many = 0;
   size_t i;
   int ret;
   // To track whether the namespace has been changed.
@@ -4536,10 +4989,8 @@ prepare_and_send_dev_mounts (libcrun_container_t *container, int sync_socket_hos
   if (def->linux == NULL || def->linux->devices_len == 0)
     return 0;
 
-  dev_fds = make_libcrun_fd_map (def->linux->devices_len);
-
   if (! has_userns || is_empty_string (container->context->id) || geteuid () > 0)
-    return send_mounts (sync_socket_host, dev_fds, how_many, def->linux->devices_len, err);
+    return 0;
 
   ret = libcrun_get_state_directory (&state_dir,
                                      (container->context ? container->context->state_root : NULL),
@@ -4619,12 +5070,9 @@ prepare_and_send_dev_mounts (libcrun_container_t *container, int sync_socket_hos
         }
 
       dev_fds->fds[i] = ret;
-
-      if (dev_fds->fds[i] >= 0)
-        how_many++;
     }
 
-  ret = send_mounts (sync_socket_host, dev_fds, how_many, def->linux->devices_len, err);
+  ret = 0;
 restore_mountns:
   if (ns_changed && current_mountns >= 0)
     {
@@ -4642,51 +5090,83 @@ restore_mountns:
 static int
 prepare_and_send_mounts (libcrun_container_t *container, pid_t pid, int sync_socket_host, libcrun_error_t *err)
 {
+  runtime_spec_schema_config_schema *def = container->container_def;
+  cleanup_close_map struct libcrun_fd_map *mount_fds = NULL;
+  cleanup_close_map struct libcrun_fd_map *dev_fds = NULL;
   int ret;
 
   ret = expect_success_from_sync_socket (sync_socket_host, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
-  ret = prepare_and_send_mount_mounts (container, pid, sync_socket_host, err);
+  mount_fds = make_libcrun_fd_map (def->mounts_len);
+  dev_fds = make_libcrun_fd_map (def->linux ? def->linux->devices_len : 0);
+
+  ret = prepare_mount_mounts (container, pid, mount_fds, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
-  ret = prepare_and_send_dev_mounts (container, sync_socket_host, err);
+  ret = prepare_dev_mounts (container, dev_fds, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
-  return 0;
+  return send_mounts (sync_socket_host, mount_fds, dev_fds, err);
 }
 
 static int
-receive_mounts (struct libcrun_fd_map *fds, int sync_socket_container, libcrun_error_t *err)
+receive_mounts (libcrun_container_t *container, int sync_socket_container, libcrun_error_t *err)
 {
-  size_t i, how_many = 0;
-  int ret;
+  struct libcrun_fd_map *mount_fds = get_fd_map (container);
+  struct libcrun_fd_map *dev_fds = get_devices_fd_map (container);
+  size_t total = mount_fds->nfds + dev_fds->nfds;
+  struct mount_fds_message_s msg;
 
-  if (fds->nfds == 0)
+  if (total == 0)
     return 0;
 
-  ret = TEMP_FAILURE_RETRY (read (sync_socket_container, &how_many, sizeof (how_many)));
-  if (UNLIKELY (ret < 0))
-    return crun_make_error (err, errno, "read from sync socket");
-
-  for (i = 0; i < how_many; i++)
+  do
     {
-      size_t index;
+      int fds[LIBCRUN_MAX_FDS_PER_MESSAGE];
+      size_t n_fds = LIBCRUN_MAX_FDS_PER_MESSAGE;
+      size_t i;
+      int ret;
 
-      ret = receive_fd_from_socket_with_payload (sync_socket_container, (char *) &index, sizeof (index), err);
+      ret = receive_fds_from_socket_with_payload (sync_socket_container, fds, &n_fds, &msg, sizeof (msg), err);
       if (UNLIKELY (ret < 0))
         return ret;
-      if (index >= fds->nfds)
-        return crun_make_error (err, 0, "invalid mount data received");
 
-      if (fds->fds[index] >= 0)
-        TEMP_FAILURE_RETRY (close (fds->fds[index]));
+      if (UNLIKELY ((size_t) ret < MOUNT_FDS_MESSAGE_LEN (0) || msg.n_fds != n_fds
+                    || (size_t) ret < MOUNT_FDS_MESSAGE_LEN (n_fds)))
+        {
+          for (i = 0; i < n_fds; i++)
+            TEMP_FAILURE_RETRY (close (fds[i]));
+          return crun_make_error (err, 0, "invalid mount data received");
+        }
+
+      for (i = 0; i < n_fds; i++)
+        {
+          struct libcrun_fd_map *fds_map = mount_fds;
+          size_t index = msg.index[i];
 
-      fds->fds[index] = ret;
-    }
+          if (UNLIKELY (index >= total))
+            {
+              for (; i < n_fds; i++)
+                TEMP_FAILURE_RETRY (close (fds[i]));
+              return crun_make_error (err, 0, "invalid mount data received");
+            }
+
+          if (index >= mount_fds->nfds)
+            {
+              fds_map = dev_fds;
+              index -= mount_fds->nfds;
+            }
+
+          if (fds_map->fds[index] >= 0)
+            TEMP_FAILURE_RETRY (close (fds_map->fds[index]));
+
+          fds_map->fds[index] = fds[i];
+        }
+  } while (! msg.last);
 
   return 0;
 }
@@ -4776,11 +5256,7 @@ init_container (libcrun_container_t *container, int sync_socket_container, struc
       if (new_pid)
         {
           /* Report the new PID to the parent and exit immediately.  */
-          ret = send_success_to_sync_socket (sync_socket_container, err);
-          if (UNLIKELY (ret < 0))
-            kill (new_pid, SIGKILL);
-
-          ret = TEMP_FAILURE_RETRY (write (sync_socket_container, &new_pid, sizeof (new_pid)));
+          ret = send_success_and_pid_to_sync_socket (sync_socket_container, new_pid, err);
           if (UNLIKELY (ret < 0))
             kill (new_pid, SIGKILL);
 
@@ -4799,7 +5275,8 @@ init_container (libcrun_container_t *container, int sync_socket_container, struc
 
   if (init_status->fd_len > 0)
     {
-      ret = join_namespaces (def, init_status->fd, init_status->fd_len, init_status->index, true, err);
+      ret = join_namespaces (def, init_status->fd, init_status->fd_len, init_status->index, init_status->value, true,
+                             err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -4870,7 +5347,8 @@ init_container (libcrun_container_t *container, int sync_socket_container, struc
         return ret;
     }
 
-  ret = join_namespaces (def, init_status->fd, init_status->fd_len, init_status->index, false, err);
+  ret = join_namespaces (def, init_status->fd, init_status->fd_len, init_status->index, init_status->value, false,
+                         err);
   if (UNLIKELY (ret < 0))
     return ret;
 
@@ -4930,14 +5408,10 @@ init_container (libcrun_container_t *container, int sync_socket_container, struc
       if (pid_container)
         {
           libcrun_debug ("Running container PID after fork: `%d`", pid_container);
-          ret = send_success_to_sync_socket (sync_socket_container, err);
+          ret = send_success_and_pid_to_sync_socket (sync_socket_container, pid_container, err);
           if (UNLIKELY (ret < 0))
             return ret;
 
-          ret = TEMP_FAILURE_RETRY (write (sync_socket_container, &pid_container, sizeof (pid_container)));
-          if (UNLIKELY (ret < 0))
-            return crun_make_error (err, errno, "write to sync socket");
-
           _safe_exit (EXIT_SUCCESS);
         }
 
@@ -4950,12 +5424,8 @@ init_container (libcrun_container_t *container, int sync_socket_container, struc
   if (UNLIKELY (ret < 0))
     return ret;
 
-  /* Receive the mounts sent by `prepare_and_send_mounts`.  */
-  ret = receive_mounts (get_fd_map (container), sync_socket_container, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
-
-  ret = receive_mounts (get_devices_fd_map (container), sync_socket_container, err);
+  /* Receive the mounts and devices sent by `prepare_and_send_mounts`.  */
+  ret = receive_mounts (container, sync_socket_container, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
@@ -4973,7 +5443,7 @@ handle_pidfd_receiver (pid_t pid, libcrun_container_t *container, libcrun_error_
   cleanup_close int pidfd = -1;
   const char *v;
 
-  v = find_annotation (container, "run.oci.pidfd_receiver");
+  v = find_known_annotation (container, ANNOTATION_PIDFD_RECEIVER);
   if (v == NULL)
     return 0;
 
@@ -5093,6 +5563,13 @@ libcrun_run_linux_container (libcrun_container_t *container, container_entrypoin
               init_status.namespaces_to_unshare &= ~CLONE_NEWTIME;
             }
           break;
+
+        default:
+          /* A pidfd for multiple namespaces, it is used only when there is
+             no user namespace.  */
+          if (init_status.value[i] & CLONE_NEWPID)
+            init_status.must_fork = true;
+          break;
         }
     }
 
@@ -5167,14 +5644,10 @@ libcrun_run_linux_container (libcrun_container_t *container, container_entrypoin
         {
           pid_t new_pid = 0;
 
-          ret = expect_success_from_sync_socket (sync_socket_host, err);
+          ret = expect_success_and_pid_from_sync_socket (sync_socket_host, &new_pid, err);
           if (UNLIKELY (ret < 0))
             return ret;
 
-          ret = TEMP_FAILURE_RETRY (read (sync_socket_host, &new_pid, sizeof (new_pid)));
-          if (UNLIKELY (ret != sizeof (new_pid)))
-            return crun_make_error (err, errno, "read pid from sync socket");
-
           /* Cleanup the first process.  */
           ret = waitpid_ignore_stopped (pid, NULL, 0);
 
@@ -5207,14 +5680,10 @@ libcrun_run_linux_container (libcrun_container_t *container, container_entrypoin
         {
           pid_t grandchild = 0;
 
-          ret = expect_success_from_sync_socket (sync_socket_host, err);
+          ret = expect_success_and_pid_from_sync_socket (sync_socket_host, &grandchild, err);
           if (UNLIKELY (ret < 0))
             return ret;
 
-          ret = TEMP_FAILURE_RETRY (read (sync_socket_host, &grandchild, sizeof (grandchild)));
-          if (UNLIKELY (ret < 0))
-            return crun_make_error (err, errno, "read pid from sync socket");
-
           ret = send_success_to_sync_socket (sync_socket_host, err);
           if (UNLIKELY (ret < 0))
             return ret;
@@ -6283,24 +6752,31 @@ libcrun_make_runtime_mounts (libcrun_container_t *container, libcrun_container_s
 {
   struct mount_in_a_container_args args;
   cleanup_close_map struct libcrun_fd_map *fds = NULL;
+  cleanup_idmapped_userns_cache struct idmapped_userns_cache_s userns_cache = {
+    0,
+  };
   cleanup_close int pidfd = -1;
   pid_t pid = status->pid;
   size_t i;
   int ret;
 
+  ret = init_idmapped_userns_cache (container, &userns_cache, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
   fds = make_libcrun_fd_map (len);
 
   for (i = 0; i < len; i++)
     {
       runtime_spec_schema_config_schema *def = container->container_def;
-      cleanup_free char *data = NULL;
+      char *data = NULL;
       unsigned long extra_flags = 0;
       unsigned long flags = 0;
       uint64_t rec_clear = 0;
       uint64_t rec_set = 0;
 
       /* Do not check whether the pid is valid or not.  run_in_container_namespace will validate it.  */
-      ret = maybe_get_idmapped_mount (container, def, mounts[i], pid, &(fds->fds[i]), NULL, err);
+      ret = maybe_get_idmapped_mount (container, def, mounts[i], pid, &userns_cache, &(fds->fds[i]), NULL, err);
       if (UNLIKELY (ret < 0))
         return ret;
 
@@ -6330,7 +6806,7 @@ libcrun_make_runtime_mounts (libcrun_container_t *container, libcrun_container_s
           size_t j;
 
           for (j = 0; j < mounts[i]->options_len; j++)
-            flags |= get_mount_flags_or_option (mounts[i]->options[j], flags, &extra_flags, &data, &rec_clear, &rec_set);
+            flags |= get_mount_flags_or_option (get_private_data (container)->arena, mounts[i]->options[j], flags, &extra_flags, &data, &rec_clear, &rec_set);
         }
 
       ret = do_mount_setattr (false, mounts[i]->destination, fds->fds[i], 0, flags, err);
@@ -6365,9 +6841,9 @@ int
 libcrun_move_network_devices (libcrun_container_t *container, pid_t pid, libcrun_error_t *err)
 {
   runtime_spec_schema_config_schema *def = container->container_def;
+  cleanup_free const char **new_names = NULL;
   cleanup_close int netns_fd = -1;
-  size_t i;
-  int ret;
+  size_t i, len;
 
   if (def == NULL || def->linux == NULL || def->linux->net_devices == NULL)
     return 0;
@@ -6379,14 +6855,10 @@ libcrun_move_network_devices (libcrun_container_t *container, pid_t pid, libcrun
   if (UNLIKELY (netns_fd < 0))
     return netns_fd;
 
-  for (i = 0; i < def->linux->net_devices->len; i++)
-    {
-      const char *new_name = def->linux->net_devices->values[i]->name ?: def->linux->net_devices->keys[i];
-
-      ret = move_network_device (def->linux->net_devices->keys[i], new_name, netns_fd, err);
-      if (UNLIKELY (ret < 0))
-        return ret;
-    }
+  len = def->linux->net_devices->len;
+  new_names = xmalloc (sizeof (char *) * (len + 1));
+  for (i = 0; i < len; i++)
+    new_names[i] = def->linux->net_devices->values[i]->name ?: def->linux->net_devices->keys[i];
 
-  return 0;
+  return move_network_devices ((const char **) def->linux->net_devices->keys, new_names, len, netns_fd, err);
 }
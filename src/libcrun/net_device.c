@@ -92,8 +92,6 @@ cleanup_ip_addrsp (void *p)
   free (*pp);
 }
 
-#define cleanup_ip_addrs __attribute__ ((cleanup (cleanup_ip_addrsp)))
-
 static int
 open_netlink_fd (libcrun_error_t *err)
 {
@@ -145,88 +143,173 @@ send_request (int sock, struct nl_req *req, libcrun_error_t *err)
   return 0;
 }
 
-/* if_nametoindex with an open netlink socket.  */
-static int
-name_to_index (int sock, const char *ifname, char *buffer, size_t buffer_size, libcrun_error_t *err)
+/* Requests are appended to a batch and sent to the kernel with a single
+   send, then the replies to all of them are collected in a single sweep.
+   The kernel processes the messages in order and keeps going after an
+   error.  */
+struct nl_batch
+{
+  char *buffer;
+  size_t len;
+  size_t allocated;
+
+  size_t n_requests;
+  uint32_t *seqs;
+  /* Opaque value for each request, passed back to the caller.  */
+  size_t *tags;
+};
+
+/* Space reserved for each request in the batch.  */
+#define NL_BATCH_REQUEST_MAX 1024
+
+static void
+cleanup_nl_batchp (struct nl_batch *batch)
+{
+  free (batch->buffer);
+  free (batch->seqs);
+  free (batch->tags);
+}
+
+#define cleanup_nl_batch __attribute__ ((cleanup (cleanup_nl_batchp)))
+
+/* Add a new request to BATCH.  Attributes can be appended to the request
+   until batch_end_request is called, up to NL_BATCH_REQUEST_MAX bytes.  */
+static struct nl_req *
+batch_new_request (struct nl_batch *batch, size_t tag, int type, int flags, int msg_len)
 {
-  struct nlmsghdr *nlh;
   struct nl_req *req;
-  uint32_t seq;
-  int index = 0;
-  ssize_t len;
-  int ret;
 
-  req = (struct nl_req *) buffer;
+  if (batch->len + NL_BATCH_REQUEST_MAX > batch->allocated)
+    {
+      batch->allocated = batch->len + NL_BATCH_REQUEST_MAX * 8;
+      batch->buffer = xrealloc (batch->buffer, batch->allocated);
+    }
+  batch->seqs = xrealloc (batch->seqs, sizeof (uint32_t) * (batch->n_requests + 1));
+  batch->tags = xrealloc (batch->tags, sizeof (size_t) * (batch->n_requests + 1));
 
-  nlh = &req->nlh;
+  req = (struct nl_req *) (batch->buffer + batch->len);
+  memset (req, 0, NL_BATCH_REQUEST_MAX);
 
-  seq = reset_request (req, RTM_GETLINK, NLM_F_REQUEST, sizeof (struct ifinfomsg));
-  req->ifi.ifi_family = AF_UNSPEC;
+  batch->tags[batch->n_requests] = tag;
+  batch->seqs[batch->n_requests] = reset_request (req, type, flags, msg_len);
+  batch->n_requests++;
+  return req;
+}
 
-  ret = append_rtattr (nlh, buffer_size, IFLA_IFNAME, ifname, strlen (ifname) + 1, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
+static void
+batch_end_request (struct nl_batch *batch, struct nl_req *req)
+{
+  batch->len += NLMSG_ALIGN (req->nlh.nlmsg_len);
+}
 
-  ret = send_request (sock, req, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
+/* Called for each reply that is not an ACK or an error.  */
+typedef void (*nl_reply_cb) (void *arg, size_t tag, struct nlmsghdr *nlh);
 
-  len = TEMP_FAILURE_RETRY (recv (sock, buffer, buffer_size, 0));
-  if (UNLIKELY (len < 0))
-    return crun_make_error (err, errno, "recv");
+/* Send all the requests in BATCH and wait for a reply to each of them.
+   On errors, *FAILED_TAG is set to the tag of the first request that
+   failed.  */
+static int
+batch_send_and_wait (int sock, struct nl_batch *batch, char *buffer, size_t buffer_size, nl_reply_cb cb, void *arg,
+                     size_t *failed_tag, libcrun_error_t *err)
+{
+  cleanup_free bool *answered = NULL;
+  size_t pending = batch->n_requests;
+  int first_error = 0;
+  ssize_t len;
+  size_t i;
+  int ret;
+
+  if (batch->n_requests == 0)
+    return 0;
 
-  for (nlh = (struct nlmsghdr *) buffer; NLMSG_OK (nlh, (unsigned int) len); nlh = NLMSG_NEXT (nlh, len))
+  answered = xmalloc0 (sizeof (bool) * batch->n_requests);
+
+  ret = TEMP_FAILURE_RETRY (send (sock, batch->buffer, batch->len, 0));
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "send");
+
+  while (pending > 0)
     {
-      if (nlh->nlmsg_seq != seq)
-        continue;
+      struct nlmsghdr *nlh;
 
-      if (nlh->nlmsg_type == NLMSG_ERROR)
+      len = TEMP_FAILURE_RETRY (recv (sock, buffer, buffer_size, 0));
+      if (UNLIKELY (len < 0))
+        return crun_make_error (err, errno, "recv");
+
+      for (nlh = (struct nlmsghdr *) buffer; NLMSG_OK (nlh, (unsigned int) len); nlh = NLMSG_NEXT (nlh, len))
         {
-          struct nlmsgerr *err_data = (struct nlmsgerr *) NLMSG_DATA (nlh);
-          if (err_data->error == 0)
+          for (i = 0; i < batch->n_requests && batch->seqs[i] != nlh->nlmsg_seq; i++)
+            ;
+          if (i == batch->n_requests || answered[i])
             continue;
-          return crun_make_error (err, -err_data->error, "netlink error while looking for interface `%s`", ifname);
-        }
 
-      if (nlh->nlmsg_type == RTM_NEWLINK)
-        {
-          struct ifinfomsg *ifi = NLMSG_DATA (nlh);
-          index = ifi->ifi_index;
-          return index;
+          if (nlh->nlmsg_type == NLMSG_ERROR)
+            {
+              struct nlmsgerr *err_data = (struct nlmsgerr *) NLMSG_DATA (nlh);
+
+              if (err_data->error != 0 && first_error == 0)
+                {
+                  first_error = -err_data->error;
+                  *failed_tag = batch->tags[i];
+                }
+            }
+          else if (cb)
+            cb (arg, batch->tags[i], nlh);
+
+          answered[i] = true;
+          pending--;
         }
     }
 
-  if (index == 0)
-    return crun_make_error (err, 0, "could not find device `%s`", ifname);
+  if (first_error)
+    return crun_make_error (err, first_error, "netlink error");
 
-  return index;
+  return 0;
 }
 
+static void
+store_ifindex (void *arg, size_t tag, struct nlmsghdr *nlh)
+{
+  int *ifindexes = arg;
+
+  if (nlh->nlmsg_type == RTM_NEWLINK)
+    ifindexes[tag] = ((struct ifinfomsg *) NLMSG_DATA (nlh))->ifi_index;
+}
+
+/* if_nametoindex for all the IFNAMES with an open netlink socket.  */
 static int
-wait_for_ack (int sock, uint32_t seq, char *recv_buffer, size_t recv_buffer_size, libcrun_error_t *err)
+names_to_indexes (int sock, const char **ifnames, size_t n, int *ifindexes, char *buffer, size_t buffer_size,
+                  libcrun_error_t *err)
 {
-  struct nlmsghdr *nlh_recv = (struct nlmsghdr *) recv_buffer;
-  ssize_t len;
+  cleanup_nl_batch struct nl_batch batch = {};
+  size_t i, failed = 0;
+  int ret;
 
-  do
+  for (i = 0; i < n; i++)
     {
-      len = TEMP_FAILURE_RETRY (recv (sock, recv_buffer, recv_buffer_size, 0));
-      if (len < 0)
-        return crun_make_error (err, errno, "recv");
-  } while (nlh_recv->nlmsg_seq != seq);
+      struct nl_req *req;
 
-  if (! NLMSG_OK (nlh_recv, len))
-    return crun_make_error (err, 0, "received invalid packet");
+      ifindexes[i] = 0;
 
-  if (nlh_recv->nlmsg_type == NLMSG_ERROR)
-    {
-      struct nlmsgerr *err_data = (struct nlmsgerr *) NLMSG_DATA (nlh_recv);
-      if (err_data->error == 0)
-        return 0;
-      return crun_make_error (err, -err_data->error, "netlink error");
+      req = batch_new_request (&batch, i, RTM_GETLINK, NLM_F_REQUEST, sizeof (struct ifinfomsg));
+      req->ifi.ifi_family = AF_UNSPEC;
+
+      ret = append_rtattr (&req->nlh, NL_BATCH_REQUEST_MAX, IFLA_IFNAME, ifnames[i], strlen (ifnames[i]) + 1, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      batch_end_request (&batch, req);
     }
 
-  return crun_make_error (err, 0, "internal error: received unknown netlink packet type");
+  ret = batch_send_and_wait (sock, &batch, buffer, buffer_size, store_ifindex, ifindexes, &failed, err);
+  if (UNLIKELY (ret < 0))
+    return crun_error_wrap (err, "looking for interface `%s`", ifnames[failed]);
+
+  for (i = 0; i < n; i++)
+    if (ifindexes[i] == 0)
+      return crun_make_error (err, 0, "could not find device `%s`", ifnames[i]);
+
+  return 0;
 }
 
 static void
@@ -239,15 +322,28 @@ copy_ip_addr (struct nlmsghdr *nlh, struct ip_addr *ip)
   memcpy (ip->rta, IFA_RTA (ifa), ip->rta_len);
 };
 
+static void
+free_ip_addrs_vec (struct ip_addr **ips, size_t n)
+{
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    cleanup_ip_addrsp (&ips[i]);
+  free (ips);
+}
+
+/* Read the addresses of all the N devices in IFINDEXES with a single
+   dump.  OUT_IPS[i] is the array of addresses for IFINDEXES[i].  */
 static int
-get_ip_addresses (int sock, uint32_t ifindex, struct ip_addr **out_ips, char *buffer, size_t buffer_size, libcrun_error_t *err)
+get_ip_addresses (int sock, const int *ifindexes, size_t n, struct ip_addr **out_ips, char *buffer, size_t buffer_size,
+                  libcrun_error_t *err)
 {
   struct nl_req *req = (struct nl_req *) buffer;
-  cleanup_ip_addrs struct ip_addr *ips = NULL;
-  size_t ips_len = 0;
+  cleanup_free size_t *ips_len = xmalloc0 (sizeof (size_t) * n);
   int optval = 1;
   uint32_t seq;
   ssize_t len;
+  size_t i;
   int ret;
 
 #ifdef NETLINK_GET_STRICT_CHK
@@ -263,7 +359,8 @@ get_ip_addresses (int sock, uint32_t ifindex, struct ip_addr **out_ips, char *bu
 
   seq = reset_request (req, RTM_GETADDR, NLM_F_DUMP | NLM_F_REQUEST, sizeof (struct ifaddrmsg));
   req->ifa.ifa_family = AF_UNSPEC;
-  req->ifa.ifa_index = ifindex;
+  /* With strict checking the kernel filters the dump by the index.  */
+  req->ifa.ifa_index = n == 1 ? ifindexes[0] : 0;
 
   ret = send_request (sock, req, err);
   if (UNLIKELY (ret < 0))
@@ -276,16 +373,13 @@ get_ip_addresses (int sock, uint32_t ifindex, struct ip_addr **out_ips, char *bu
       for (nlh = (struct nlmsghdr *) buffer; NLMSG_OK (nlh, len); nlh = NLMSG_NEXT (nlh, len))
         {
           struct ifaddrmsg *ifa;
+          struct ip_addr **ips;
 
           if (nlh->nlmsg_seq != seq)
             continue;
 
           if (nlh->nlmsg_type == NLMSG_DONE)
-            {
-              *out_ips = ips;
-              ips = NULL;
-              return 0;
-            }
+            return 0;
 
           if (nlh->nlmsg_type == NLMSG_ERROR)
             {
@@ -296,19 +390,23 @@ get_ip_addresses (int sock, uint32_t ifindex, struct ip_addr **out_ips, char *bu
             }
 
           ifa = (struct ifaddrmsg *) NLMSG_DATA (nlh);
-          if (ifa->ifa_index != ifindex)
+          for (i = 0; i < n && (uint32_t) ifindexes[i] != ifa->ifa_index; i++)
+            ;
+          if (i == n)
             continue;
 
           /* Copy only permanent, globally routable IP addresses.  */
           if (! (ifa->ifa_flags & IFA_F_PERMANENT) || (ifa->ifa_scope != RT_SCOPE_UNIVERSE))
             continue;
 
+          ips = &out_ips[i];
+
           /* Always append an empty struct.  */
-          ips = xrealloc (ips, sizeof (struct ip_addr) * (++ips_len + 1));
+          *ips = xrealloc (*ips, sizeof (struct ip_addr) * (++ips_len[i] + 1));
           /* Mark the end of the array.  */
-          ips[ips_len].rta_len = -1;
+          (*ips)[ips_len[i]].rta_len = -1;
 
-          copy_ip_addr (nlh, &ips[ips_len - 1]);
+          copy_ip_addr (nlh, &(*ips)[ips_len[i] - 1]);
         }
     }
   if (UNLIKELY (len < 0))
@@ -317,9 +415,9 @@ get_ip_addresses (int sock, uint32_t ifindex, struct ip_addr **out_ips, char *bu
 }
 
 static int
-configure_ip_addresses (int sock, int ifindex, char *buffer, size_t buffer_size, const struct ip_addr *ips, libcrun_error_t *err)
+add_configure_ip_addresses (struct nl_batch *batch, size_t tag, int ifindex, const struct ip_addr *ips,
+                            libcrun_error_t *err)
 {
-  struct nl_req *req = (struct nl_req *) buffer;
   const struct ip_addr *ip;
   int ret;
 
@@ -330,10 +428,11 @@ configure_ip_addresses (int sock, int ifindex, char *buffer, size_t buffer_size,
     {
       /* RTA_NEXT modifies the argument, so use a copy.  */
       int rta_len = ip->rta_len;
+      struct nl_req *req;
       struct rtattr *rta;
-      uint32_t seq;
 
-      seq = reset_request (req, RTM_NEWADDR, NLM_F_REQUEST | NLM_F_CREATE | NLM_F_REPLACE | NLM_F_ACK, sizeof (struct ifaddrmsg));
+      req = batch_new_request (batch, tag, RTM_NEWADDR, NLM_F_REQUEST | NLM_F_CREATE | NLM_F_REPLACE | NLM_F_ACK,
+                               sizeof (struct ifaddrmsg));
 
       memcpy (&req->ifa, &ip->ifa, sizeof (struct ifaddrmsg));
 
@@ -341,31 +440,23 @@ configure_ip_addresses (int sock, int ifindex, char *buffer, size_t buffer_size,
 
       for (rta = (struct rtattr *) ip->rta; RTA_OK (rta, rta_len); rta = RTA_NEXT (rta, rta_len))
         {
-          ret = append_rtattr (&(req->nlh), buffer_size, rta->rta_type, RTA_DATA (rta), RTA_PAYLOAD (rta), err);
+          ret = append_rtattr (&(req->nlh), NL_BATCH_REQUEST_MAX, rta->rta_type, RTA_DATA (rta), RTA_PAYLOAD (rta), err);
           if (UNLIKELY (ret < 0))
             return ret;
         }
 
-      ret = send_request (sock, req, err);
-      if (UNLIKELY (ret < 0))
-        return ret;
-
-      ret = wait_for_ack (sock, seq, buffer, buffer_size, err);
-      if (ret < 0)
-        return ret;
+      batch_end_request (batch, req);
     }
 
   return 0;
 }
 
-static int
-request_enable_interface_and_wait (int sock, char *buffer, size_t buffer_size, int index, libcrun_error_t *err)
+static void
+add_enable_interface (struct nl_batch *batch, size_t tag, int index)
 {
-  struct nl_req *req = (struct nl_req *) buffer;
-  uint32_t seq;
-  int ret;
+  struct nl_req *req;
 
-  seq = reset_request (req, RTM_NEWLINK, NLM_F_REQUEST | NLM_F_ACK, sizeof (struct ifinfomsg));
+  req = batch_new_request (batch, tag, RTM_NEWLINK, NLM_F_REQUEST | NLM_F_ACK, sizeof (struct ifinfomsg));
 
   req->ifi.ifi_family = AF_UNSPEC;
   req->ifi.ifi_index = index;
@@ -373,19 +464,17 @@ request_enable_interface_and_wait (int sock, char *buffer, size_t buffer_size, i
   req->ifi.ifi_flags = IFF_UP;
   req->ifi.ifi_change = IFF_UP;
 
-  ret = send_request (sock, req, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
-
-  return wait_for_ack (sock, seq, buffer, buffer_size, err);
+  batch_end_request (batch, req);
 }
 
 static int
-setup_network_device_in_ns_helper (char *buffer, size_t buffer_size, int netns_fd, const char *newifname,
-                                   struct ip_addr *ips, libcrun_error_t *err)
+setup_network_devices_in_ns_helper (char *buffer, size_t buffer_size, int netns_fd, const char **newifnames, size_t n,
+                                    struct ip_addr **ips, libcrun_error_t *err)
 {
+  cleanup_free int *new_ifindexes = xmalloc (sizeof (int) * n);
+  cleanup_nl_batch struct nl_batch batch = {};
   cleanup_close int sock_in_ns = -1;
-  int new_ifindex;
+  size_t i, failed = 0;
   int ret;
 
   ret = setns (netns_fd, CLONE_NEWNET);
@@ -398,81 +487,111 @@ setup_network_device_in_ns_helper (char *buffer, size_t buffer_size, int netns_f
 
   /* we could ask for a specific index with IFLA_NEW_IFINDEX, and apparently the kernel tries anyway to
      reuse the existing one, but asking for a specific index could cause conflicts if the
-     target network namespace already exists, so avoid doing it and lookup the device again.  */
-  new_ifindex = name_to_index (sock_in_ns, newifname, buffer, buffer_size, err);
-  if (UNLIKELY (new_ifindex < 0))
-    return new_ifindex;
-
-  ret = configure_ip_addresses (sock_in_ns, new_ifindex, buffer, buffer_size, ips, err);
-  if (ret < 0)
+     target network namespace already exists, so avoid doing it and lookup the devices again.  */
+  ret = names_to_indexes (sock_in_ns, newifnames, n, new_ifindexes, buffer, buffer_size, err);
+  if (UNLIKELY (ret < 0))
     return ret;
 
-  return request_enable_interface_and_wait (sock_in_ns, buffer, buffer_size, new_ifindex, err);
+  for (i = 0; i < n; i++)
+    {
+      ret = add_configure_ip_addresses (&batch, i, new_ifindexes[i], ips[i], err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      add_enable_interface (&batch, i, new_ifindexes[i]);
+    }
+
+  ret = batch_send_and_wait (sock_in_ns, &batch, buffer, buffer_size, NULL, NULL, &failed, err);
+  if (UNLIKELY (ret < 0))
+    return crun_error_wrap (err, "configure device `%s`", newifnames[failed]);
+
+  return 0;
 }
 
 static int
-do_move_link_to_ns_and_wait (int sock, char *buffer, size_t buffer_size, int ifindex, int netns_fd, const char *newifname, libcrun_error_t *err)
+move_links_to_ns_and_wait (int sock, char *buffer, size_t buffer_size, const int *ifindexes, const char **ifnames,
+                           const char **newifnames, size_t n, int netns_fd, libcrun_error_t *err)
 {
-  struct nl_req *req = (struct nl_req *) buffer;
-  uint32_t seq;
+  cleanup_nl_batch struct nl_batch batch = {};
+  size_t i, failed = 0;
   int ret;
 
-  seq = reset_request (req, RTM_NEWLINK, NLM_F_REQUEST | NLM_F_ACK, sizeof (struct ifinfomsg));
-  req->ifi.ifi_family = AF_UNSPEC;
-  req->ifi.ifi_index = ifindex;
+  for (i = 0; i < n; i++)
+    {
+      struct nl_req *req;
 
-  ret = append_rtattr (&req->nlh, buffer_size, IFLA_NET_NS_FD, &netns_fd, sizeof (netns_fd), err);
-  if (UNLIKELY (ret < 0))
-    return ret;
+      req = batch_new_request (&batch, i, RTM_NEWLINK, NLM_F_REQUEST | NLM_F_ACK, sizeof (struct ifinfomsg));
+      req->ifi.ifi_family = AF_UNSPEC;
+      req->ifi.ifi_index = ifindexes[i];
 
-  ret = append_rtattr (&req->nlh, buffer_size, IFLA_IFNAME, newifname, strlen (newifname) + 1, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
+      ret = append_rtattr (&req->nlh, NL_BATCH_REQUEST_MAX, IFLA_NET_NS_FD, &netns_fd, sizeof (netns_fd), err);
+      if (UNLIKELY (ret < 0))
+        return ret;
 
-  ret = send_request (sock, req, err);
+      ret = append_rtattr (&req->nlh, NL_BATCH_REQUEST_MAX, IFLA_IFNAME, newifnames[i], strlen (newifnames[i]) + 1, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      batch_end_request (&batch, req);
+    }
+
+  ret = batch_send_and_wait (sock, &batch, buffer, buffer_size, NULL, NULL, &failed, err);
   if (UNLIKELY (ret < 0))
-    return ret;
+    return crun_error_wrap (err, "move device `%s`", ifnames[failed]);
 
-  return wait_for_ack (sock, seq, buffer, buffer_size, err);
+  return 0;
 }
 
 int
-move_network_device (const char *ifname, const char *newifname, int netns_fd, libcrun_error_t *err)
+move_network_devices (const char **ifnames, const char **newifnames, size_t n, int netns_fd, libcrun_error_t *err)
 {
-  const size_t buffer_size = 8192;
-  cleanup_ip_addrs struct ip_addr *ips = NULL;
+  const size_t buffer_size = 32768;
   cleanup_free char *buffer = xmalloc (buffer_size);
+  cleanup_free int *ifindexes = xmalloc (sizeof (int) * n);
+  struct ip_addr **ips = xmalloc0 (sizeof (struct ip_addr *) * n);
   cleanup_close int sock = -1;
   int wait_status;
-  int ifindex;
   pid_t pid;
   int ret;
 
+  if (n == 0)
+    {
+      free (ips);
+      return 0;
+    }
+
   sock = open_netlink_fd (err);
   if (sock < 0)
-    return sock;
+    {
+      ret = sock;
+      goto exit;
+    }
 
-  ifindex = name_to_index (sock, ifname, buffer, buffer_size, err);
-  if (UNLIKELY (ifindex < 0))
-    return ifindex;
+  ret = names_to_indexes (sock, ifnames, n, ifindexes, buffer, buffer_size, err);
+  if (UNLIKELY (ret < 0))
+    goto exit;
 
-  ret = get_ip_addresses (sock, ifindex, &ips, buffer, buffer_size, err);
+  ret = get_ip_addresses (sock, ifindexes, n, ips, buffer, buffer_size, err);
   if (UNLIKELY (ret < 0))
-    return ret;
+    goto exit;
 
-  /* Move the device to the target network namespace.  */
-  ret = do_move_link_to_ns_and_wait (sock, buffer, buffer_size, ifindex, netns_fd, newifname, err);
+  /* Move the devices to the target network namespace.  */
+  ret = move_links_to_ns_and_wait (sock, buffer, buffer_size, ifindexes, ifnames, newifnames, n, netns_fd, err);
   if (UNLIKELY (ret < 0))
-    return ret;
+    goto exit;
 
-  /* must be vfork to propagate the error from the child proc.  */
+  /* must be vfork to propagate the error from the child proc.  The
+     namespace is joined once for all the devices.  */
   pid = vfork ();
   if (UNLIKELY (pid < 0))
-    return crun_make_error (err, errno, "vfork");
+    {
+      ret = crun_make_error (err, errno, "vfork");
+      goto exit;
+    }
 
   if (pid == 0)
     {
-      ret = setup_network_device_in_ns_helper (buffer, buffer_size, netns_fd, newifname, ips, err);
+      ret = setup_network_devices_in_ns_helper (buffer, buffer_size, netns_fd, newifnames, n, ips, err);
       if (UNLIKELY (ret < 0))
         _safe_exit (-ret);
 
@@ -481,10 +600,16 @@ move_network_device (const char *ifname, const char *newifname, int netns_fd, li
 
   ret = waitpid_ignore_stopped (pid, &wait_status, 0);
   if (UNLIKELY (ret < 0))
-    return crun_make_error (err, errno, "waitpid for exec child pid");
+    {
+      ret = crun_make_error (err, errno, "waitpid for exec child pid");
+      goto exit;
+    }
 
+  ret = 0;
   if (wait_status != 0)
-    return -get_process_exit_status (wait_status);
+    ret = -get_process_exit_status (wait_status);
 
-  return 0;
+exit:
+  free_ip_addrs_vec (ips, n);
+  return ret;
 }
@@ -23,6 +23,10 @@
 #include <ocispec/runtime_spec_schema_config_schema.h>
 #include "error.h"
 
-int move_network_device (const char *ifname, const char *newifname, int netns_fd, libcrun_error_t *err);
+/* Move the N devices IFNAMES to the network namespace NETNS_FD, renaming
+   them to NEWIFNAMES.  The netlink requests for all the devices are sent
+   in batches and the namespace is joined only once.  */
+int move_network_devices (const char **ifnames, const char **newifnames, size_t n, int netns_fd,
+                          libcrun_error_t *err);
 
 #endif
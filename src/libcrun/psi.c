@@ -0,0 +1,405 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <yajl/yajl_gen.h>
+
+#ifdef HAVE_SYSTEMD
+#  include <systemd/sd-daemon.h>
+#endif
+
+#include "psi.h"
+#include "cgroup-utils.h"
+#include "utils.h"
+
+#define YAJL_STR(x) ((const unsigned char *) (x))
+
+static const char *psi_resources[] = { "cpu", "memory", "io", NULL };
+
+struct psi_trigger_s
+{
+  int fd;
+  const char *resource;
+  char *trigger;
+};
+
+struct libcrun_psi_triggers_s
+{
+  char *id;
+  /* Where the events are written, -1 to send them to the notify socket
+     and -2 once writing to the fd failed.  */
+  int events_fd;
+  struct psi_trigger_s *triggers;
+  size_t len;
+};
+
+static int
+parse_trigger (char *trigger, libcrun_error_t *err)
+{
+  unsigned long long stall, window;
+  char *endptr = NULL;
+  char *it = trigger;
+
+  if (has_prefix (it, "some "))
+    it += 5;
+  else if (has_prefix (it, "full "))
+    it += 5;
+  else
+    return crun_make_error (err, 0, "invalid PSI trigger `%s`, expected `some|full STALL_US WINDOW_US`", trigger);
+
+  errno = 0;
+  stall = strtoull (it, &endptr, 10);
+  if (errno != 0 || endptr == it || *endptr != ' ')
+    return crun_make_error (err, 0, "invalid stall time in the PSI trigger `%s`", trigger);
+
+  it = endptr + 1;
+  window = strtoull (it, &endptr, 10);
+  if (errno != 0 || endptr == it || *endptr != '\0')
+    return crun_make_error (err, 0, "invalid window in the PSI trigger `%s`", trigger);
+
+  if (stall == 0 || stall > window)
+    return crun_make_error (err, 0, "the stall time must be greater than 0 and not greater than the window in the PSI trigger `%s`", trigger);
+
+  return 0;
+}
+
+int
+libcrun_psi_parse_triggers (const char *value, char ***out, libcrun_error_t *err)
+{
+  cleanup_free char *copy = xstrdup (value);
+  char **triggers = NULL;
+  char *saveptr = NULL;
+  size_t len = 0;
+  char *it;
+  int ret;
+
+  for (it = strtok_r (copy, ";", &saveptr); it; it = strtok_r (NULL, ";", &saveptr))
+    {
+      while (*it == ' ')
+        it++;
+      if (*it == '\0')
+        continue;
+
+      ret = parse_trigger (it, err);
+      if (UNLIKELY (ret < 0))
+        {
+          size_t i;
+
+          for (i = 0; i < len; i++)
+            free (triggers[i]);
+          free (triggers);
+          return ret;
+        }
+
+      triggers = xrealloc (triggers, sizeof (char *) * (len + 2));
+      triggers[len++] = xstrdup (it);
+      triggers[len] = NULL;
+    }
+
+  if (triggers == NULL)
+    triggers = xmalloc0 (sizeof (char *));
+
+  *out = triggers;
+  return 0;
+}
+
+static int
+add_trigger (struct libcrun_psi_triggers_s *triggers, int dirfd, const char *resource, char *trigger,
+             libcrun_error_t *err)
+{
+  cleanup_free char *file = NULL;
+  cleanup_close int fd = -1;
+  ssize_t ret;
+
+  xasprintf (&file, "%s.pressure", resource);
+
+  fd = openat (dirfd, file, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (UNLIKELY (fd < 0))
+    return crun_make_error (err, errno, "open `%s`", file);
+
+  /* The kernel expects the terminating NUL as part of the trigger.  */
+  ret = TEMP_FAILURE_RETRY (write (fd, trigger, strlen (trigger) + 1));
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "register the PSI trigger `%s` on `%s`", trigger, file);
+
+  triggers->triggers = xrealloc (triggers->triggers, sizeof (*triggers->triggers) * (triggers->len + 1));
+  triggers->triggers[triggers->len].fd = fd;
+  triggers->triggers[triggers->len].resource = resource;
+  triggers->triggers[triggers->len].trigger = trigger;
+  triggers->len++;
+  fd = -1;
+
+  return 0;
+}
+
+int
+libcrun_psi_triggers_new (libcrun_container_t *container, const char *id, const char *cgroup_path, int events_fd,
+                          struct libcrun_psi_triggers_s **out, libcrun_error_t *err)
+{
+  cleanup_psi_triggers struct libcrun_psi_triggers_s *triggers = NULL;
+  cleanup_free char *path = NULL;
+  cleanup_close int dirfd = -1;
+  size_t i, j;
+  int ret;
+
+  *out = NULL;
+
+  for (i = 0; psi_resources[i]; i++)
+    {
+      cleanup_free char **values = NULL;
+      char annotation[32];
+      const char *v;
+
+      snprintf (annotation, sizeof (annotation), "run.oci.psi.%s", psi_resources[i]);
+      v = find_annotation (container, annotation);
+      if (v == NULL)
+        continue;
+
+      ret = libcrun_psi_parse_triggers (v, &values, err);
+      if (UNLIKELY (ret < 0))
+        return crun_error_wrap (err, "annotation `%s`", annotation);
+
+      if (values[0] == NULL)
+        continue;
+
+      if (triggers == NULL)
+        {
+          int cgroup_mode;
+
+          if (is_empty_string (cgroup_path))
+            return crun_make_error (err, 0, "PSI triggers require a cgroup");
+
+          cgroup_mode = libcrun_get_cgroup_mode (err);
+          if (UNLIKELY (cgroup_mode < 0))
+            return cgroup_mode;
+          if (cgroup_mode != CGROUP_MODE_UNIFIED)
+            return crun_make_error (err, 0, "PSI triggers are supported only on cgroup v2");
+
+          ret = append_paths (&path, err, CGROUP_ROOT, cgroup_path, NULL);
+          if (UNLIKELY (ret < 0))
+            return ret;
+
+          dirfd = open (path, O_DIRECTORY | O_PATH | O_CLOEXEC);
+          if (UNLIKELY (dirfd < 0))
+            return crun_make_error (err, errno, "open `%s`", path);
+
+          triggers = xmalloc0 (sizeof (*triggers));
+          triggers->id = xstrdup (id);
+          triggers->events_fd = -1;
+        }
+
+      for (j = 0; values[j]; j++)
+        {
+          ret = add_trigger (triggers, dirfd, psi_resources[i], values[j], err);
+          if (UNLIKELY (ret < 0))
+            {
+              for (; values[j]; j++)
+                free (values[j]);
+              return ret;
+            }
+        }
+    }
+
+  if (triggers == NULL)
+    return 0;
+
+  if (events_fd >= 0)
+    {
+      if (UNLIKELY (fcntl (events_fd, F_GETFD) < 0))
+        return crun_make_error (err, errno, "invalid fd `%d` for the PSI events", events_fd);
+
+      triggers->events_fd = events_fd;
+    }
+
+  *out = triggers;
+  triggers = NULL;
+  return 0;
+}
+
+int
+libcrun_psi_triggers_register (struct libcrun_psi_triggers_s *triggers, int epollfd, libcrun_error_t *err)
+{
+  size_t i;
+
+  if (triggers == NULL)
+    return 0;
+
+  for (i = 0; i < triggers->len; i++)
+    {
+      struct epoll_event ev = {};
+      int ret;
+
+      ev.events = EPOLLPRI;
+      ev.data.fd = triggers->triggers[i].fd;
+      ret = epoll_ctl (epollfd, EPOLL_CTL_ADD, triggers->triggers[i].fd, &ev);
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "epoll_ctl add `%d`", triggers->triggers[i].fd);
+    }
+
+  return 0;
+}
+
+static int
+write_event (struct libcrun_psi_triggers_s *triggers, struct psi_trigger_s *trigger, libcrun_error_t *err)
+{
+  const unsigned char *buf = NULL;
+  yajl_gen gen = NULL;
+  struct timespec ts;
+  uint64_t timestamp;
+  size_t len;
+  int ret = 0;
+
+  if (UNLIKELY (clock_gettime (CLOCK_REALTIME, &ts) < 0))
+    return crun_make_error (err, errno, "clock_gettime");
+  timestamp = ((uint64_t) ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+
+  if (triggers->events_fd < 0)
+    {
+#ifdef HAVE_SYSTEMD
+      cleanup_free char *msg = NULL;
+
+      xasprintf (&msg, "X_CRUN_PSI=%s %s", trigger->resource, trigger->trigger);
+      ret = sd_notify (0, msg);
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, -ret, "sd_notify");
+#endif
+      return 0;
+    }
+
+  if (triggers->events_fd == -2)
+    return 0;
+
+  gen = yajl_gen_alloc (NULL);
+  if (gen == NULL)
+    return crun_make_error (err, 0, "cannot allocate json generator");
+
+  yajl_gen_map_open (gen);
+  yajl_gen_string (gen, YAJL_STR ("type"), strlen ("type"));
+  yajl_gen_string (gen, YAJL_STR ("psi"), strlen ("psi"));
+  yajl_gen_string (gen, YAJL_STR ("id"), strlen ("id"));
+  yajl_gen_string (gen, YAJL_STR (triggers->id), strlen (triggers->id));
+  yajl_gen_string (gen, YAJL_STR ("resource"), strlen ("resource"));
+  yajl_gen_string (gen, YAJL_STR (trigger->resource), strlen (trigger->resource));
+  yajl_gen_string (gen, YAJL_STR ("trigger"), strlen ("trigger"));
+  yajl_gen_string (gen, YAJL_STR (trigger->trigger), strlen (trigger->trigger));
+  yajl_gen_string (gen, YAJL_STR ("timestamp"), strlen ("timestamp"));
+  yajl_gen_integer (gen, (long long) timestamp);
+  yajl_gen_map_close (gen);
+
+  if (yajl_gen_get_buf (gen, &buf, &len) != yajl_gen_status_ok)
+    {
+      ret = crun_make_error (err, 0, "cannot generate the PSI event");
+      goto exit;
+    }
+
+  {
+    cleanup_free char *line = xmalloc (len + 1);
+
+    memcpy (line, buf, len);
+    line[len] = '\n';
+    /* A single write, so concurrent readers see whole lines.  */
+    if (UNLIKELY (TEMP_FAILURE_RETRY (write (triggers->events_fd, line, len + 1)) < 0))
+      {
+        /* The reader went away.  All the signals are blocked while waiting
+           for the container, so consume the SIGPIPE here instead of
+           forwarding it to the container.  */
+        if (errno == EPIPE)
+          {
+            struct timespec zero = { 0, 0 };
+            sigset_t set;
+
+            sigemptyset (&set);
+            sigaddset (&set, SIGPIPE);
+            sigtimedwait (&set, NULL, &zero);
+          }
+        libcrun_warning ("cannot write the PSI event, stop sending them: %s", strerror (errno));
+        triggers->events_fd = -2;
+      }
+  }
+
+exit:
+  yajl_gen_free (gen);
+  return ret;
+}
+
+int
+libcrun_psi_triggers_handle (struct libcrun_psi_triggers_s *triggers, int epollfd, int fd, uint32_t events,
+                             libcrun_error_t *err)
+{
+  size_t i;
+  int ret;
+
+  if (triggers == NULL)
+    return 0;
+
+  for (i = 0; i < triggers->len; i++)
+    {
+      struct psi_trigger_s *trigger = &triggers->triggers[i];
+
+      if (trigger->fd != fd)
+        continue;
+
+      /* The cgroup was removed, stop watching it.  */
+      if (events & EPOLLERR)
+        {
+          epoll_ctl (epollfd, EPOLL_CTL_DEL, fd, NULL);
+          return 1;
+        }
+
+      libcrun_debug ("PSI trigger `%s %s` fired", trigger->resource, trigger->trigger);
+
+      ret = write_event (triggers, trigger, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      return 1;
+    }
+
+  return 0;
+}
+
+void
+libcrun_psi_triggers_free (struct libcrun_psi_triggers_s *triggers)
+{
+  size_t i;
+
+  if (triggers == NULL)
+    return;
+
+  for (i = 0; i < triggers->len; i++)
+    {
+      TEMP_FAILURE_RETRY (close (triggers->triggers[i].fd));
+      free (triggers->triggers[i].trigger);
+    }
+
+  free (triggers->triggers);
+  free (triggers->id);
+  free (triggers);
+}
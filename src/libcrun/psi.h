@@ -0,0 +1,55 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PSI_H
+#define PSI_H
+
+#include <config.h>
+#include "error.h"
+#include "container.h"
+
+struct libcrun_psi_triggers_s;
+
+/* Parse a list of PSI triggers, "some|full STALL_US WINDOW_US", separated
+   by ';'.  *TRIGGERS is a NULL terminated array.  */
+int libcrun_psi_parse_triggers (const char *value, char ***triggers, libcrun_error_t *err);
+
+/* Register the triggers from the run.oci.psi.{cpu,memory,io} annotations
+   on the cgroup CGROUP_PATH.  The events are written to EVENTS_FD, or sent
+   to the notify socket if it is -1.  *OUT is NULL if there are none.  */
+int libcrun_psi_triggers_new (libcrun_container_t *container, const char *id, const char *cgroup_path, int events_fd,
+                              struct libcrun_psi_triggers_s **out, libcrun_error_t *err);
+
+/* Add the triggers to EPOLLFD.  */
+int libcrun_psi_triggers_register (struct libcrun_psi_triggers_s *triggers, int epollfd, libcrun_error_t *err);
+
+/* Handle the EVENTS received on FD.  Returns 0 if FD is not a trigger, 1
+   if the event was handled.  */
+int libcrun_psi_triggers_handle (struct libcrun_psi_triggers_s *triggers, int epollfd, int fd, uint32_t events,
+                                 libcrun_error_t *err);
+
+void libcrun_psi_triggers_free (struct libcrun_psi_triggers_s *triggers);
+
+static inline void
+cleanup_psi_triggersp (struct libcrun_psi_triggers_s **p)
+{
+  libcrun_psi_triggers_free (*p);
+}
+
+#define cleanup_psi_triggers __attribute__ ((cleanup (cleanup_psi_triggersp)))
+
+#endif
@@ -18,6 +18,7 @@
 #define _GNU_SOURCE
 #include <config.h>
 #include <sys/uio.h>
+#include <sys/mman.h>
 
 #include "ring_buffer.h"
 #include "utils.h"
@@ -28,6 +29,13 @@ struct ring_buffer
   size_t size;
   size_t head;
   size_t tail;
+
+  /* The buffer is a memfd mapped twice back-to-back, so any region
+     starting in the first mapping is contiguous.  SIZE is the size of
+     a single mapping and LEN the amount of data in the buffer, TAIL is
+     not used.  No byte is reserved.  */
+  bool mapped;
+  size_t len;
 };
 
 /*
@@ -119,9 +127,28 @@ ring_buffer_advance_nocheck_tail (struct ring_buffer *rb, size_t amount)
   rb->tail = (rb->tail + amount) % rb->size;
 }
 
+/* Return the only region that can be read from a mapped ring buffer.  */
+static size_t
+ring_buffer_mapped_read_span (struct ring_buffer *rb, char **base)
+{
+  *base = rb->buffer + rb->head;
+  return rb->len;
+}
+
+/* Return the only region that can be written to a mapped ring buffer.  */
+static size_t
+ring_buffer_mapped_write_span (struct ring_buffer *rb, char **base)
+{
+  *base = rb->buffer + (rb->head + rb->len) % rb->size;
+  return rb->size - rb->len;
+}
+
 size_t
 ring_buffer_get_data_available (struct ring_buffer *rb)
 {
+  if (rb->mapped)
+    return rb->len;
+
   if (rb->head <= rb->tail)
     return rb->tail - rb->head;
 
@@ -131,12 +158,18 @@ ring_buffer_get_data_available (struct ring_buffer *rb)
 size_t
 ring_buffer_get_size (struct ring_buffer *rb)
 {
+  if (rb->mapped)
+    return rb->size;
+
   return rb->size - 1;
 }
 
 size_t
 ring_buffer_get_space_available (struct ring_buffer *rb)
 {
+  if (rb->mapped)
+    return rb->size - rb->len;
+
   return rb->size - ring_buffer_get_data_available (rb) - 1;
 }
 
@@ -149,14 +182,31 @@ ring_buffer_read (struct ring_buffer *rb, int fd, bool *is_eagain, libcrun_error
 
   *is_eagain = false;
 
-  iov_count = ring_buffer_get_write_iov (rb, iov);
+  if (rb->mapped)
+    {
+      char *base;
+      size_t len = ring_buffer_mapped_write_span (rb, &base);
+
+      if (len > 0)
+        {
+          iov[0].iov_base = base;
+          iov[0].iov_len = len;
+          iov_count = 1;
+        }
+    }
+  else
+    iov_count = ring_buffer_get_write_iov (rb, iov);
+
   if (iov_count == 0)
     {
       *is_eagain = true;
       return 0;
     }
 
-  ret = readv (fd, iov, iov_count);
+  if (iov_count == 1)
+    ret = read (fd, iov[0].iov_base, iov[0].iov_len);
+  else
+    ret = readv (fd, iov, iov_count);
   if (UNLIKELY (ret < 0))
     {
       if (errno == EIO)
@@ -168,7 +218,10 @@ ring_buffer_read (struct ring_buffer *rb, int fd, bool *is_eagain, libcrun_error
         }
       return crun_make_error (err, errno, "readv");
     }
-  ring_buffer_advance_nocheck_tail (rb, ret);
+  if (rb->mapped)
+    rb->len += ret;
+  else
+    ring_buffer_advance_nocheck_tail (rb, ret);
   return ret;
 }
 
@@ -181,14 +234,31 @@ ring_buffer_write (struct ring_buffer *rb, int fd, bool *is_eagain, libcrun_erro
 
   *is_eagain = false;
 
-  iov_count = ring_buffer_get_read_iov (rb, iov);
+  if (rb->mapped)
+    {
+      char *base;
+      size_t len = ring_buffer_mapped_read_span (rb, &base);
+
+      if (len > 0)
+        {
+          iov[0].iov_base = base;
+          iov[0].iov_len = len;
+          iov_count = 1;
+        }
+    }
+  else
+    iov_count = ring_buffer_get_read_iov (rb, iov);
+
   if (iov_count == 0)
     {
       *is_eagain = true;
       return 0;
     }
 
-  ret = writev (fd, iov, iov_count);
+  if (iov_count == 1)
+    ret = write (fd, iov[0].iov_base, iov[0].iov_len);
+  else
+    ret = writev (fd, iov, iov_count);
   if (UNLIKELY (ret < 0))
     {
       if (errno == EIO)
@@ -200,9 +270,15 @@ ring_buffer_write (struct ring_buffer *rb, int fd, bool *is_eagain, libcrun_erro
         }
       return crun_make_error (err, errno, "writev");
     }
-  ring_buffer_advance_nocheck_head (rb, ret);
+  if (rb->mapped)
+    {
+      rb->head = (rb->head + ret) % rb->size;
+      rb->len -= ret;
+    }
+  else
+    ring_buffer_advance_nocheck_head (rb, ret);
   /* If the buffer is empty, reset the head and tail.  */
-  if (rb->head == rb->tail)
+  if (rb->mapped ? rb->len == 0 : rb->head == rb->tail)
     {
       rb->head = 0;
       rb->tail = 0;
@@ -220,15 +296,83 @@ ring_buffer_make (size_t size)
   rb->buffer = xmalloc (rb->size);
   rb->head = 0;
   rb->tail = 0;
+  rb->mapped = false;
+  rb->len = 0;
 
   return rb;
 }
 
+struct ring_buffer *
+ring_buffer_make_mapped (size_t size, libcrun_error_t *err)
+{
+#ifdef HAVE_MEMFD_CREATE
+  cleanup_close int fd = -1;
+  struct ring_buffer *rb;
+  size_t page_size;
+  char *addr, *p;
+  int ret;
+
+  page_size = sysconf (_SC_PAGESIZE);
+  size = (size + page_size - 1) & ~(page_size - 1);
+  if (size == 0)
+    size = page_size;
+
+  fd = memfd_create ("crun-ring-buffer", MFD_CLOEXEC);
+  if (UNLIKELY (fd < 0))
+    {
+      crun_make_error (err, errno, "memfd_create");
+      return NULL;
+    }
+
+  ret = ftruncate (fd, size);
+  if (UNLIKELY (ret < 0))
+    {
+      crun_make_error (err, errno, "ftruncate");
+      return NULL;
+    }
+
+  /* Reserve the address space for both the mappings.  */
+  addr = mmap (NULL, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (UNLIKELY (addr == MAP_FAILED))
+    {
+      crun_make_error (err, errno, "mmap");
+      return NULL;
+    }
+
+  p = mmap (addr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+  if (p != MAP_FAILED)
+    p = mmap (addr + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+  if (UNLIKELY (p == MAP_FAILED))
+    {
+      crun_make_error (err, errno, "mmap");
+      munmap (addr, size * 2);
+      return NULL;
+    }
+
+  rb = xmalloc (sizeof (struct ring_buffer));
+  rb->buffer = addr;
+  rb->size = size;
+  rb->head = 0;
+  rb->tail = 0;
+  rb->mapped = true;
+  rb->len = 0;
+
+  return rb;
+#else
+  (void) size;
+  crun_make_error (err, ENOSYS, "memfd_create not supported");
+  return NULL;
+#endif
+}
+
 void
 ring_buffer_free (struct ring_buffer *rb)
 {
   if (rb == NULL)
     return;
-  free (rb->buffer);
+  if (rb->mapped)
+    munmap (rb->buffer, rb->size * 2);
+  else
+    free (rb->buffer);
   free (rb);
 }
@@ -37,6 +37,12 @@ int ring_buffer_write (struct ring_buffer *rb, int fd, bool *is_eagain, libcrun_
 
 struct ring_buffer *ring_buffer_make (size_t size);
 
+/* Make a ring buffer backed by a memfd mapped twice back-to-back, so that
+   every read and write is done on a single contiguous region.  SIZE is
+   rounded up to the page size.  Returns NULL on errors, or if memfd_create
+   is not available; use ring_buffer_make in that case.  */
+struct ring_buffer *ring_buffer_make_mapped (size_t size, libcrun_error_t *err);
+
 void ring_buffer_free (struct ring_buffer *rb);
 
 #define cleanup_ring_buffer __attribute__ ((cleanup (cleanup_ring_bufferp)))
@@ -34,7 +34,6 @@
 #include <sys/resource.h>
 #include <sys/sysmacros.h>
 #include <sys/types.h>
-#include <sys/utsname.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 
@@ -372,26 +371,15 @@ static int
 calculate_seccomp_checksum (runtime_spec_schema_config_linux_seccomp *seccomp, unsigned int seccomp_gen_options, seccomp_checksum_t out, libcrun_error_t *err)
 {
   blake3_hasher hasher;
-  unsigned char hash[32];
-  struct utsname utsbuf;
   size_t i;
   int ret;
 
-  blake3_hasher_init (&hasher);
-
-#define PROCESS_STRING(X)                                  \
-  do                                                       \
-    {                                                      \
-      if (X)                                               \
-        blake3_hasher_update (&hasher, (X), strlen ((X))); \
-  } while (0)
-#define PROCESS_DATA(X)                                   \
-  do                                                      \
-    {                                                     \
-      blake3_hasher_update (&hasher, &(X), sizeof ((X))); \
-  } while (0)
+  ret = libcrun_cache_key_init (&hasher, true, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
 
-  PROCESS_STRING (PACKAGE_VERSION);
+#define PROCESS_STRING(X) libcrun_cache_key_add_string (&hasher, (X))
+#define PROCESS_DATA(X) libcrun_cache_key_add_data (&hasher, &(X), sizeof ((X)))
 
 #ifdef HAVE_SECCOMP
   {
@@ -403,15 +391,6 @@ calculate_seccomp_checksum (runtime_spec_schema_config_linux_seccomp *seccomp, u
   }
 #endif
 
-  memset (&utsbuf, 0, sizeof (utsbuf));
-  ret = uname (&utsbuf);
-  if (UNLIKELY (ret != 0))
-    return crun_make_error (err, errno, "uname");
-
-  PROCESS_STRING (utsbuf.release);
-  PROCESS_STRING (utsbuf.version);
-  PROCESS_STRING (utsbuf.machine);
-
   PROCESS_DATA (seccomp_gen_options);
 
   PROCESS_DATA (seccomp->default_errno_ret);
@@ -440,16 +419,7 @@ calculate_seccomp_checksum (runtime_spec_schema_config_linux_seccomp *seccomp, u
         }
     }
 
-  blake3_hasher_finalize (&hasher, hash, sizeof (hash));
-
-  for (i = 0; i < 32; i++)
-    {
-      size_t remaining = sizeof (seccomp_checksum_t) - i * 2;
-      ret = snprintf (&out[i * 2], remaining, "%02x", hash[i]);
-      if (UNLIKELY (ret != 2))
-        return crun_make_error (err, 0, "internal error: static buffer has wrong size");
-    }
-  out[64] = 0;
+  libcrun_cache_key_final (&hasher, out);
 
 #undef PROCESS_STRING
 #undef PROCESS_DATA
@@ -474,26 +444,6 @@ open_rundir_dirfd (const char *state_root, libcrun_error_t *err)
   return dirfd;
 }
 
-struct cache_entry
-{
-  seccomp_checksum_t checksum;
-  struct timespec atime;
-};
-
-static int
-compare_entries_by_atime (const void *a, const void *b)
-{
-  const struct cache_entry *entry_a = a;
-  const struct cache_entry *entry_b = b;
-  int ret;
-
-  ret = entry_a->atime.tv_sec - entry_b->atime.tv_sec;
-  if (ret)
-    return ret;
-
-  return entry_a->atime.tv_nsec - entry_b->atime.tv_nsec;
-}
-
 static int
 evict_cache (int root_dfd, libcrun_error_t *err)
 {
@@ -516,61 +466,12 @@ evict_cache (int root_dfd, libcrun_error_t *err)
       return crun_make_error (err, errno, "open `%s`", SECCOMP_CACHE_DIR);
     }
 
+  /* Attempt to delete half of them.  The cache files are linked from the
+     state directory of the containers using them, and unknown files are
+     deleted right away.  */
   ret = TEMP_FAILURE_RETRY (fstat (cache_dir_fd, &st));
   if (ret == 0 && st.st_size > cache_dir_inode_max_size)
-    {
-      cleanup_free struct cache_entry *entries = NULL;
-      cleanup_dir DIR *d = NULL;
-      size_t i, n_entries = 0;
-      struct dirent *de;
-      int dfd;
-
-      d = fdopendir (cache_dir_fd);
-      if (d == NULL)
-        return crun_make_error (err, errno, "cannot open seccomp cache directory");
-      /* fdopendir owns the fd now.  */
-      cache_dir_fd = -1;
-
-      dfd = dirfd (d);
-      while ((de = readdir (d)))
-        {
-          if (de->d_name[0] == '.')
-            continue;
-
-          ret = TEMP_FAILURE_RETRY (fstatat (dfd, de->d_name, &st, AT_SYMLINK_NOFOLLOW));
-          if (UNLIKELY (ret < 0))
-            continue;
-
-          /* The cache file is already used, it is pointless to free it.  */
-          if (st.st_nlink > 1)
-            continue;
-
-          /* If the sticky bit is set, then ignore it.  */
-          if (st.st_mode & S_ISVTX)
-            continue;
-
-          if (strlen (de->d_name) != sizeof (seccomp_checksum_t) - 1)
-            {
-              /* No mercy for unknown files.  */
-              unlinkat (dfd, de->d_name, 0);
-              continue;
-            }
-          else
-            {
-              entries = xrealloc (entries, sizeof (struct cache_entry) * (n_entries + 1));
-
-              memcpy (entries[n_entries].checksum, de->d_name, sizeof (seccomp_checksum_t));
-              entries[n_entries].atime = st.st_atim;
-              n_entries++;
-            }
-        }
-
-      qsort (entries, n_entries, sizeof (struct cache_entry), compare_entries_by_atime);
-
-      /* Attempt to delete half of them.  */
-      for (i = 0; i < (n_entries == 1 ? 1 : n_entries / 2); i++)
-        unlinkat (dfd, entries[i].checksum, 0);
-    }
+    return libcrun_cache_evict (cache_dir_fd, -1, 0, 0, err);
   return 0;
 }
 
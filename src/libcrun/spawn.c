@@ -0,0 +1,372 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <signal.h>
+#include <sched.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "spawn.h"
+#include "utils.h"
+#include "syscalls.h"
+
+#ifndef CLONE_PIDFD
+#  define CLONE_PIDFD 0x00001000
+#endif
+
+/* How often processes without a pidfd are checked.  */
+#define SPAWN_POLL_INTERVAL_MS 10
+
+struct spawn_child_s
+{
+  const char *path;
+  char **args;
+  const char *cwd;
+  char **envp;
+  int fds[3];
+  long max_fd;
+  sigset_t *sigmask;
+  int exec_errno;
+};
+
+/* It runs on its own stack but shares the memory with the parent, which
+   is suspended until the exec, so it must not allocate memory or touch
+   any global state except for EXEC_ERRNO.  */
+static int
+spawn_child (void *arg)
+{
+  struct spawn_child_s *child = arg;
+  struct sigaction sa;
+  long fd;
+  int i;
+
+  /* No signal handler from the parent must run on the shared memory.  */
+  for (i = 1; i < NSIG; i++)
+    {
+      if (sigaction (i, NULL, &sa) < 0)
+        continue;
+      if (sa.sa_handler == SIG_DFL || sa.sa_handler == SIG_IGN)
+        continue;
+      sa.sa_handler = SIG_DFL;
+      sa.sa_flags = 0;
+      sigaction (i, &sa, NULL);
+    }
+
+  for (i = 0; i < 3; i++)
+    {
+      if (child->fds[i] == i)
+        {
+          if (fcntl (i, F_SETFD, 0) < 0)
+            goto fail;
+        }
+      else if (dup2 (child->fds[i], i) < 0)
+        goto fail;
+    }
+
+  if (syscall_close_range (3, UINT_MAX, CLOSE_RANGE_CLOEXEC) < 0)
+    {
+      for (fd = 3; fd < child->max_fd; fd++)
+        fcntl (fd, F_SETFD, FD_CLOEXEC);
+    }
+
+  if (child->cwd && chdir (child->cwd) < 0)
+    goto fail;
+
+  if (sigprocmask (SIG_SETMASK, child->sigmask, NULL) < 0)
+    goto fail;
+
+  execvpe (child->path, child->args, child->envp);
+
+fail:
+  child->exec_errno = errno;
+  _exit (127);
+}
+
+int
+libcrun_spawn (struct libcrun_spawn_s *proc, const char *path, char **args, const char *cwd, char **envp,
+               int stdin_fd, int out_fd, int err_fd, libcrun_error_t *err)
+{
+  char *tmp_args[] = { (char *) path, NULL };
+  cleanup_close int dev_null_fd = -1;
+  struct spawn_child_s child;
+  sigset_t all, oldmask;
+  size_t argc, stack_size;
+  long page_size;
+  int flags, saved_errno;
+  int pidfd = -1;
+  void *stack;
+  pid_t pid;
+
+  memset (proc, 0, sizeof (*proc));
+  proc->pidfd = -1;
+
+  if (args == NULL)
+    args = tmp_args;
+
+  if (stdin_fd < 0 || out_fd < 0 || err_fd < 0)
+    {
+      dev_null_fd = open ("/dev/null", O_RDWR | O_CLOEXEC);
+      if (UNLIKELY (dev_null_fd < 0))
+        return crun_make_error (err, errno, "open `/dev/null`");
+    }
+
+  memset (&child, 0, sizeof (child));
+  child.path = path;
+  child.args = args;
+  child.cwd = cwd;
+  child.envp = envp;
+  child.fds[0] = stdin_fd >= 0 ? stdin_fd : dev_null_fd;
+  child.fds[1] = out_fd >= 0 ? out_fd : dev_null_fd;
+  child.fds[2] = err_fd >= 0 ? err_fd : dev_null_fd;
+  child.max_fd = sysconf (_SC_OPEN_MAX);
+  child.sigmask = &oldmask;
+
+  /* execvpe copies the arguments on the stack when it falls back to
+     /bin/sh, leave some space for them.  */
+  for (argc = 0; args[argc]; argc++)
+    ;
+  page_size = sysconf (_SC_PAGESIZE);
+  stack_size = (argc + 2) * sizeof (char *) + 32 * 1024;
+  stack_size = (stack_size + page_size - 1) & ~(page_size - 1);
+
+  stack = mmap (NULL, stack_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+  if (UNLIKELY (stack == MAP_FAILED))
+    return crun_make_error (err, errno, "mmap");
+
+  /* Block the signals only in the calling thread, until the child has
+     reset the handlers.  */
+  sigfillset (&all);
+  sigprocmask (SIG_BLOCK, &all, &oldmask);
+
+  flags = CLONE_VM | CLONE_VFORK | CLONE_PIDFD | SIGCHLD;
+  pid = clone (spawn_child, (char *) stack + stack_size, flags, &child, &pidfd);
+  if (pid < 0 && errno == EINVAL)
+    {
+      /* Retry without the pidfd, libcrun_spawn_wait falls back to waitpid.  */
+      pidfd = -1;
+      flags &= ~CLONE_PIDFD;
+      pid = clone (spawn_child, (char *) stack + stack_size, flags, &child, NULL);
+    }
+  saved_errno = errno;
+
+  sigprocmask (SIG_SETMASK, &oldmask, NULL);
+  munmap (stack, stack_size);
+
+  if (UNLIKELY (pid < 0))
+    return crun_make_error (err, saved_errno, "clone `%s`", path);
+
+  /* The child has already either exec'ed or exited when clone returns.  */
+  proc->pid = pid;
+  proc->pidfd = pidfd;
+  proc->exec_errno = child.exec_errno;
+  return 0;
+}
+
+static int64_t
+monotonic_ms (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Returns 1 if the process was reaped, 0 if it is still running.  */
+static int
+spawn_try_reap (struct libcrun_spawn_s *proc, libcrun_error_t *err)
+{
+  int ret, status = 0;
+
+  ret = TEMP_FAILURE_RETRY (waitpid (proc->pid, &status, WNOHANG));
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "waitpid `%d`", proc->pid);
+  if (ret == 0)
+    return 0;
+
+  proc->exited = true;
+  proc->status = get_process_exit_status (status);
+  close_and_reset (&proc->pidfd);
+  return 1;
+}
+
+int
+libcrun_spawn_wait (struct libcrun_spawn_s *procs, size_t n, int64_t timeout_ms, libcrun_error_t *err)
+{
+  cleanup_free struct pollfd *fds = NULL;
+  int64_t deadline = timeout_ms >= 0 ? monotonic_ms () + timeout_ms : 0;
+  size_t i;
+  int ret;
+
+  if (n == 0)
+    return 0;
+
+  fds = xmalloc (sizeof (*fds) * n);
+
+  while (1)
+    {
+      bool need_timer = false, expired = false;
+      int running = 0, poll_timeout = -1, ready;
+
+      for (i = 0; i < n; i++)
+        {
+          fds[i].fd = -1;
+          fds[i].events = POLLIN;
+          fds[i].revents = 0;
+
+          if (procs[i].exited)
+            continue;
+
+          if (procs[i].pidfd < 0)
+            {
+              ret = spawn_try_reap (&procs[i], err);
+              if (UNLIKELY (ret < 0))
+                return ret;
+              if (ret > 0)
+                continue;
+              need_timer = true;
+            }
+
+          fds[i].fd = procs[i].pidfd;
+          running++;
+        }
+
+      if (running == 0)
+        return 0;
+
+      if (timeout_ms >= 0)
+        {
+          int64_t remaining = deadline - monotonic_ms ();
+
+          if (remaining <= 0)
+            {
+              remaining = 0;
+              expired = true;
+            }
+          poll_timeout = remaining > INT_MAX ? INT_MAX : (int) remaining;
+        }
+      if (need_timer && (poll_timeout < 0 || poll_timeout > SPAWN_POLL_INTERVAL_MS))
+        poll_timeout = SPAWN_POLL_INTERVAL_MS;
+
+      ready = poll (fds, n, poll_timeout);
+      if (UNLIKELY (ready < 0))
+        {
+          if (errno == EINTR)
+            continue;
+          return crun_make_error (err, errno, "poll");
+        }
+
+      for (i = 0; ready > 0 && i < n; i++)
+        {
+          if (fds[i].fd < 0 || fds[i].revents == 0)
+            continue;
+          ready--;
+
+          ret = spawn_try_reap (&procs[i], err);
+          if (UNLIKELY (ret < 0))
+            return ret;
+          if (ret > 0)
+            running--;
+          else
+            {
+              /* Before Linux 5.3 a pidfd is always readable, fall back to
+                 waitpid for this process.  */
+              close_and_reset (&procs[i].pidfd);
+            }
+        }
+
+      if (expired)
+        return running;
+    }
+}
+
+void
+libcrun_spawn_release (struct libcrun_spawn_s *proc)
+{
+  int status = 0;
+
+  if (proc->pid > 0 && ! proc->exited)
+    {
+      /* The pid cannot be reused until the process is reaped.  */
+      kill (proc->pid, SIGKILL);
+      if (waitpid_ignore_stopped (proc->pid, &status, 0) == proc->pid)
+        proc->status = get_process_exit_status (status);
+      proc->exited = true;
+    }
+  close_and_reset (&proc->pidfd);
+}
+
+int
+libcrun_spawn_run (const char *path, char **args, const char *cwd, int64_t timeout_ms, char **envp,
+                   const char *stdin, size_t stdin_len, int out_fd, int err_fd, libcrun_error_t *err)
+{
+  struct libcrun_spawn_s proc;
+  cleanup_close int pipe_r = -1;
+  cleanup_close int pipe_w = -1;
+  int stdin_pipe[2];
+  int ret;
+
+  ret = pipe2 (stdin_pipe, O_CLOEXEC);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "pipe");
+  pipe_r = stdin_pipe[0];
+  pipe_w = stdin_pipe[1];
+
+  ret = libcrun_spawn (&proc, path, args, cwd, envp, pipe_r, out_fd, err_fd, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  close_and_reset (&pipe_r);
+
+  if (UNLIKELY (proc.exec_errno))
+    {
+      libcrun_spawn_release (&proc);
+      return crun_make_error (err, proc.exec_errno, "exec `%s`", path);
+    }
+
+  ret = TEMP_FAILURE_RETRY (write (pipe_w, stdin, stdin_len));
+  /* Ignore EPIPE as the process could have already been terminated.  */
+  if (UNLIKELY (ret < 0 && errno != EPIPE))
+    {
+      ret = crun_make_error (err, errno, "write to pipe");
+      libcrun_spawn_release (&proc);
+      return ret;
+    }
+
+  close_and_reset (&pipe_w);
+
+  ret = libcrun_spawn_wait (&proc, 1, timeout_ms, err);
+  if (UNLIKELY (ret != 0))
+    {
+      libcrun_spawn_release (&proc);
+      if (ret < 0)
+        return ret;
+      return crun_make_error (err, 0, "timeout expired for `%s`", path);
+    }
+
+  libcrun_spawn_release (&proc);
+  return proc.status;
+}
@@ -0,0 +1,62 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SPAWN_H
+#define SPAWN_H
+
+#include <config.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "error.h"
+
+struct libcrun_spawn_s
+{
+  pid_t pid;
+  /* -1 if the kernel does not support CLONE_PIDFD.  */
+  int pidfd;
+  bool exited;
+  /* Valid once EXITED is set, as returned by get_process_exit_status.  */
+  int status;
+  /* errno from execvpe, 0 if the program was executed.  */
+  int exec_errno;
+};
+
+/* Run PATH in a new process sharing the memory with the caller until the
+   exec, so the cost does not depend on the size of the crun address space.
+   STDIN_FD, OUT_FD and ERR_FD are installed as the standard streams of the
+   new process, -1 means /dev/null.  Any other fd is closed on exec.  The
+   signal mask of the caller is not modified.  */
+int libcrun_spawn (struct libcrun_spawn_s *proc, const char *path, char **args, const char *cwd, char **envp,
+                   int stdin_fd, int out_fd, int err_fd, libcrun_error_t *err);
+
+/* Wait up to TIMEOUT_MS milliseconds, or indefinitely if it is negative,
+   for all the N processes in PROCS to exit.  Returns the number of
+   processes still running.  */
+int libcrun_spawn_wait (struct libcrun_spawn_s *procs, size_t n, int64_t timeout_ms, libcrun_error_t *err);
+
+/* Kill the process if it is still running, reap it and close the pidfd.  */
+void libcrun_spawn_release (struct libcrun_spawn_s *proc);
+
+/* Run PATH writing STDIN to its standard input and wait for it.  The
+   process is killed if it is still running after TIMEOUT_MS milliseconds,
+   a negative value means no timeout.  Returns the exit status of the
+   process.  */
+int libcrun_spawn_run (const char *path, char **args, const char *cwd, int64_t timeout_ms, char **envp,
+                       const char *stdin, size_t stdin_len, int out_fd, int err_fd, libcrun_error_t *err);
+
+#endif
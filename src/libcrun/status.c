@@ -544,6 +544,19 @@ rmdirfd (const char *namedir, int fd, libcrun_error_t *err)
 
       /* Ignore errors here and keep deleting, the final unlinkat (AT_REMOVEDIR) will fail anyway.  */
       ret = unlinkat (dirfd (d), de->d_name, 0);
+      if (ret < 0 && errno == EBUSY)
+        {
+          /* A file used as a mount point, e.g. a bind mounted namespace.  */
+          cleanup_close int tfd = openat (dirfd (d), de->d_name, O_CLOEXEC | O_PATH | O_NOFOLLOW);
+          if (tfd >= 0)
+            {
+              proc_fd_path_t procpath;
+
+              get_proc_self_fd_path (procpath, tfd);
+              if (umount2 (procpath, MNT_DETACH) == 0)
+                ret = unlinkat (dirfd (d), de->d_name, 0);
+            }
+        }
       if (ret < 0)
         {
         retry_unlink:
@@ -772,6 +785,15 @@ libcrun_status_create_exec_fifo (const char *state_root, const char *id, libcrun
 
 int
 libcrun_status_write_exec_fifo (const char *state_root, const char *id, libcrun_error_t *err)
+{
+  return libcrun_status_write_exec_fifo_with_payload (state_root, id, NULL, 0, err);
+}
+
+/* Write PAYLOAD to the exec fifo instead of the single NUL byte.  The
+   first byte of PAYLOAD must be different than NUL.  */
+int
+libcrun_status_write_exec_fifo_with_payload (const char *state_root, const char *id, const char *payload,
+                                             size_t len, libcrun_error_t *err)
 {
   cleanup_free char *state_dir = NULL;
   cleanup_free char *fifo_path = NULL;
@@ -781,6 +803,12 @@ libcrun_status_write_exec_fifo (const char *state_root, const char *id, libcrun_
   cleanup_close int fd = -1;
   int ret;
 
+  if (payload == NULL)
+    {
+      payload = buffer;
+      len = 1;
+    }
+
   ret = libcrun_get_state_directory (&state_dir, state_root, id, err);
   if (UNLIKELY (ret < 0))
     return ret;
@@ -797,11 +825,11 @@ libcrun_status_write_exec_fifo (const char *state_root, const char *id, libcrun_
   if (UNLIKELY (ret < 0))
     return crun_make_error (err, errno, "unlink `%s`", fifo_path);
 
-  ret = TEMP_FAILURE_RETRY (write (fd, buffer, 1));
+  ret = safe_write (fd, "exec.fifo", payload, len, err);
   if (UNLIKELY (ret < 0))
-    return crun_make_error (err, errno, "write to exec.fifo");
+    return ret;
 
-  return strtoll (buffer, NULL, 10);
+  return 0;
 }
 
 int
@@ -62,6 +62,8 @@ LIBCRUN_PUBLIC int libcrun_get_containers_list (libcrun_container_list_t **ret,
 int libcrun_status_check_directories (const char *state_root, const char *id, libcrun_error_t *err);
 int libcrun_status_create_exec_fifo (const char *state_root, const char *id, libcrun_error_t *err);
 int libcrun_status_write_exec_fifo (const char *state_root, const char *id, libcrun_error_t *err);
+int libcrun_status_write_exec_fifo_with_payload (const char *state_root, const char *id, const char *payload,
+                                                 size_t len, libcrun_error_t *err);
 int libcrun_status_has_read_exec_fifo (const char *state_root, const char *id, libcrun_error_t *err);
 int libcrun_check_pid_valid (libcrun_container_status_t *status, libcrun_error_t *err);
 int get_run_directory (char **out, const char *state_root, libcrun_error_t *err);
@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include "string_map.h"
+#include "annotations.h"
 #include "utils.h"
 
 #include <ocispec/runtime_spec_schema_config_schema.h>
@@ -35,14 +36,11 @@ struct kv_s
 struct string_map_s
 {
   size_t len;
+  /* Sorted by key.  */
   struct kv_s *kvs;
 
-#ifdef HAVE_HSEARCH_R
-  struct hsearch_data htab;
-  bool htab_initialized;
-#endif
-
-  bool sorted;
+  /* Values of the annotations known to crun, indexed by their slot.  */
+  const char *known[ANNOTATIONS_MAX];
 };
 
 static int
@@ -53,54 +51,16 @@ compare_kv (const void *a, const void *b)
 
 const char *
 find_string_map_value (string_map *map, const char *name)
-
 {
   struct kv_s *r, key;
+  int slot;
 
   if (map == NULL || map->len == 0)
     return NULL;
 
-#ifdef HAVE_HSEARCH_R
-  ENTRY e, *ep;
-
-  /* Do not bother with hash tables for small maps.  */
-  if (map->len < 8)
-    goto fallback;
-
-  if (! map->htab_initialized)
-    {
-      size_t i;
-
-      if (hcreate_r (map->len, &map->htab) == 0)
-        goto fallback;
-
-      for (i = 0; i < map->len; i++)
-        {
-          e.key = (char *) map->kvs[i].key;
-          e.data = map->kvs[i].value;
-          if (hsearch_r (e, ENTER, &ep, &map->htab) == 0)
-            {
-              hdestroy_r (&map->htab);
-              goto fallback;
-            }
-        }
-      map->htab_initialized = true;
-    }
-
-  e.key = (char *) name;
-  if (hsearch_r (e, FIND, &ep, &map->htab) == 0)
-    return NULL;
-
-  return ep->data;
-
-fallback:
-#endif
-
-  if (! map->sorted)
-    {
-      qsort (map->kvs, map->len, sizeof (struct kv_s), compare_kv);
-      map->sorted = true;
-    }
+  slot = libcrun_annotation_slot (name);
+  if (slot >= 0)
+    return map->known[slot];
 
   key.key = (char *) name;
 
@@ -108,6 +68,15 @@ fallback:
   return r ? r->value : NULL;
 }
 
+const char *
+find_string_map_known_value (string_map *map, enum libcrun_annotation slot)
+{
+  if (map == NULL)
+    return NULL;
+
+  return map->known[slot];
+}
+
 string_map *
 make_string_map_from_json (json_map_string_string *jmap)
 {
@@ -126,6 +95,18 @@ make_string_map_from_json (json_map_string_string *jmap)
       new_map->kvs[i].value = xstrdup (jmap->values[i]);
     }
 
+  qsort (new_map->kvs, new_map->len, sizeof (struct kv_s), compare_kv);
+
+  /* Classify the keys only once, every later lookup for a known annotation
+     is an index into KNOWN.  */
+  for (i = 0; i < new_map->len; i++)
+    {
+      int slot = libcrun_annotation_slot (new_map->kvs[i].key);
+
+      if (slot >= 0)
+        new_map->known[slot] = new_map->kvs[i].value;
+    }
+
   return new_map;
 }
 
@@ -152,9 +133,6 @@ free_string_map (string_map *map)
   if (map == NULL)
     return;
 
-  if (map->htab_initialized)
-    hdestroy_r (&map->htab);
-
   for (i = 0; i < map->len; i++)
     {
       free (map->kvs[i].key);
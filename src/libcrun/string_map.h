@@ -23,18 +23,17 @@
 
 #include <config.h>
 
-#ifdef HAVE_HSEARCH_R
-#  include <search.h>
-#endif
-
 #include <ocispec/runtime_spec_schema_config_schema.h>
 #include "error.h"
+#include "annotations.h"
 
 struct string_map_s;
 typedef struct string_map_s string_map;
 
 const char *find_string_map_value (string_map *map, const char *name);
 
+const char *find_string_map_known_value (string_map *map, enum libcrun_annotation slot);
+
 string_map *make_string_map_from_json (json_map_string_string *jmap);
 
 void free_string_map (string_map *map);
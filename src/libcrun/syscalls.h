@@ -201,6 +201,19 @@ syscall_clone3 (struct _clone3_args *args)
 #endif
 }
 
+static inline int
+syscall_pidfd_open (pid_t pid, unsigned int flags)
+{
+#if defined __NR_pidfd_open
+  return (int) syscall (__NR_pidfd_open, pid, flags);
+#else
+  (void) pid;
+  (void) flags;
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
 static inline int
 syscall_getcwd (char *path, size_t len)
 {
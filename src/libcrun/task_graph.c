@@ -0,0 +1,311 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "task_graph.h"
+#include "trace.h"
+#include "utils.h"
+
+/* Upper limit for the helper threads.  The tasks are mostly waiting for
+   syscalls, so they are worth overlapping even when there are fewer CPUs
+   than tasks.  */
+#define MAX_HELPERS 4
+
+struct task_graph_run_s
+{
+  struct libcrun_task_graph_s *graph;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+
+  uint32_t all;
+  uint32_t main_only;
+  uint32_t started;
+  uint32_t done;
+  uint32_t failed;
+
+  /* Output handler of the thread that runs the graph, used by the helper
+     threads too.  */
+  crun_output_handler output_handler;
+  void *output_handler_arg;
+};
+
+void
+libcrun_task_graph_init (struct libcrun_task_graph_s *graph, const char *name)
+{
+  memset (graph, 0, sizeof (*graph));
+  graph->name = name;
+}
+
+uint32_t
+libcrun_task_graph_add (struct libcrun_task_graph_s *graph, const char *name, libcrun_task_cb cb, void *arg,
+                        unsigned int flags, uint32_t deps)
+{
+  struct libcrun_task_s *task;
+  uint32_t bit;
+
+  if (UNLIKELY (graph->len == LIBCRUN_TASK_GRAPH_MAX_TASKS))
+    {
+      fprintf (stderr, "internal error: too many tasks in the graph `%s`\n", graph->name);
+      abort ();
+    }
+
+  bit = 1U << graph->len;
+  task = &graph->tasks[graph->len++];
+  memset (task, 0, sizeof (*task));
+  task->name = name;
+  task->cb = cb;
+  task->arg = arg;
+  task->flags = flags;
+  /* A task can only depend on the ones added before it, so there are no
+     cycles.  */
+  task->deps = deps & (bit - 1);
+
+  return bit;
+}
+
+/* Find a task that can run now on the current thread.  A task whose
+   dependencies failed is marked as done without running it.  Must be
+   called with the lock held.  Returns -1 if there is nothing to run.  */
+static int
+pick_task (struct task_graph_run_s *run, bool main_thread, bool *changed)
+{
+  struct libcrun_task_graph_s *graph = run->graph;
+  int fallback;
+  size_t i;
+
+again:
+  fallback = -1;
+  for (i = 0; i < graph->len; i++)
+    {
+      struct libcrun_task_s *task = &graph->tasks[i];
+      uint32_t bit = 1U << i;
+
+      if ((run->started & bit) || (task->deps & run->done) != task->deps)
+        continue;
+
+      if (task->deps & run->failed)
+        {
+          task->skipped = true;
+          run->started |= bit;
+          run->done |= bit;
+          run->failed |= bit;
+          *changed = true;
+          goto again;
+        }
+
+      if (task->flags & LIBCRUN_TASK_MAIN_THREAD)
+        {
+          if (main_thread)
+            return i;
+          continue;
+        }
+
+      if (! main_thread)
+        return i;
+
+      /* The main thread prefers its own tasks, but it helps with the
+         others when it has nothing else to do.  */
+      if (fallback < 0)
+        fallback = i;
+    }
+
+  return fallback;
+}
+
+static void
+execute_tasks (struct task_graph_run_s *run, bool main_thread)
+{
+  struct libcrun_task_graph_s *graph = run->graph;
+
+  pthread_mutex_lock (&run->lock);
+  while (run->done != run->all)
+    {
+      struct libcrun_task_s *task;
+      bool changed = false;
+      uint32_t bit;
+      int i;
+
+      /* Nothing left for the helpers once all the other tasks started.  */
+      if (! main_thread && (run->started | run->main_only) == run->all)
+        break;
+
+      i = pick_task (run, main_thread, &changed);
+      if (changed)
+        pthread_cond_broadcast (&run->cond);
+      if (i < 0)
+        {
+          if (run->done != run->all)
+            pthread_cond_wait (&run->cond, &run->lock);
+          continue;
+        }
+
+      task = &graph->tasks[i];
+      bit = 1U << i;
+      run->started |= bit;
+      pthread_mutex_unlock (&run->lock);
+
+      task->start = libcrun_trace_now ();
+      task->ret = task->cb (task->arg, &task->err);
+      task->end = libcrun_trace_now ();
+
+      pthread_mutex_lock (&run->lock);
+      run->done |= bit;
+      if (task->ret < 0)
+        run->failed |= bit;
+      pthread_cond_broadcast (&run->cond);
+    }
+  pthread_mutex_unlock (&run->lock);
+}
+
+static void *
+helper_thread (void *arg)
+{
+  struct task_graph_run_s *run = arg;
+
+  crun_set_thread_output_handler (run->output_handler, run->output_handler_arg);
+  execute_tasks (run, false);
+  return NULL;
+}
+
+static size_t
+count_helpers (struct libcrun_task_graph_s *graph)
+{
+  size_t i, helpers = 0;
+  long cpus;
+
+  for (i = 0; i < graph->len; i++)
+    if (! (graph->tasks[i].flags & LIBCRUN_TASK_MAIN_THREAD))
+      helpers++;
+
+  cpus = sysconf (_SC_NPROCESSORS_ONLN);
+  if (cpus > 0 && helpers > (size_t) cpus)
+    helpers = cpus;
+
+  return helpers > MAX_HELPERS ? MAX_HELPERS : helpers;
+}
+
+static void
+trace_task_graph (struct libcrun_task_graph_s *graph, uint64_t start, uint64_t end)
+{
+  uint64_t work = 0;
+  size_t i, j;
+
+  for (i = 0; i < graph->len; i++)
+    {
+      struct libcrun_task_s *task = &graph->tasks[i];
+      cleanup_free char *deps = NULL;
+
+      for (j = 0; j < i; j++)
+        {
+          char *tmp;
+
+          if (! (task->deps & (1U << j)))
+            continue;
+
+          xasprintf (&tmp, "%s%s%s", deps ? deps : "", deps ? "," : "", graph->tasks[j].name);
+          free (deps);
+          deps = tmp;
+        }
+
+      if (task->skipped)
+        {
+          libcrun_trace ("task graph %s: %s skipped, deps=[%s]", graph->name, task->name, deps ? deps : "");
+          continue;
+        }
+
+      work += task->end - task->start;
+      libcrun_trace ("task graph %s: %s%s start=+%" PRIu64 "us duration=%" PRIu64 "us deps=[%s]%s", graph->name,
+                     task->name, (task->flags & LIBCRUN_TASK_MAIN_THREAD) ? " [main]" : "",
+                     (task->start - start) / 1000, (task->end - task->start) / 1000, deps ? deps : "",
+                     task->ret < 0 ? " failed" : "");
+    }
+
+  libcrun_trace ("task graph %s: %zu tasks on %zu helper threads, wall=%" PRIu64 "us work=%" PRIu64 "us", graph->name,
+                 graph->len, graph->helpers, (end - start) / 1000, work / 1000);
+}
+
+int
+libcrun_task_graph_run (struct libcrun_task_graph_s *graph, libcrun_error_t *err)
+{
+  pthread_t threads[MAX_HELPERS];
+  struct task_graph_run_s run;
+  uint64_t start, end;
+  size_t i, helpers;
+  int ret = 0;
+
+  memset (&run, 0, sizeof (run));
+  run.graph = graph;
+  run.all = graph->len == 32 ? UINT32_MAX : (1U << graph->len) - 1;
+  for (i = 0; i < graph->len; i++)
+    if (graph->tasks[i].flags & LIBCRUN_TASK_MAIN_THREAD)
+      run.main_only |= 1U << i;
+  crun_get_thread_output_handler (&run.output_handler, &run.output_handler_arg);
+  pthread_mutex_init (&run.lock, NULL);
+  pthread_cond_init (&run.cond, NULL);
+
+  start = libcrun_trace_now ();
+
+  /* If a thread cannot be created, the tasks are run by the ones that
+     are already there.  */
+  helpers = count_helpers (graph);
+  for (i = 0; i < helpers; i++)
+    if (pthread_create (&threads[i], NULL, helper_thread, &run) != 0)
+      break;
+  graph->helpers = helpers = i;
+
+  execute_tasks (&run, true);
+
+  for (i = 0; i < helpers; i++)
+    pthread_join (threads[i], NULL);
+
+  end = libcrun_trace_now ();
+
+  pthread_cond_destroy (&run.cond);
+  pthread_mutex_destroy (&run.lock);
+
+  if (libcrun_trace_enabled ())
+    trace_task_graph (graph, start, end);
+
+  for (i = 0; i < graph->len; i++)
+    {
+      struct libcrun_task_s *task = &graph->tasks[i];
+
+      if (task->ret >= 0)
+        continue;
+
+      if (ret == 0)
+        {
+          ret = task->ret;
+          *err = task->err;
+          task->err = NULL;
+        }
+      else
+        crun_error_release (&task->err);
+    }
+
+  return ret;
+}
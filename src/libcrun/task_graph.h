@@ -0,0 +1,79 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include <config.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "error.h"
+
+/* A small set of tasks with dependencies between them, run once on the
+   calling thread and a few helper threads.  It is used to overlap the
+   independent steps done before the container process is cloned.  All the
+   helper threads are joined before libcrun_task_graph_run returns, so the
+   process is single threaded again when it forks.  */
+
+#define LIBCRUN_TASK_GRAPH_MAX_TASKS 32
+
+/* The task must run on the thread calling libcrun_task_graph_run, e.g. it
+   changes a per-thread state like the credentials or the memory policy.  */
+#define LIBCRUN_TASK_MAIN_THREAD (1U << 0)
+
+typedef int (*libcrun_task_cb) (void *arg, libcrun_error_t *err);
+
+struct libcrun_task_s
+{
+  const char *name;
+  libcrun_task_cb cb;
+  void *arg;
+  unsigned int flags;
+  /* Mask of the tasks that must complete before this one.  */
+  uint32_t deps;
+
+  int ret;
+  libcrun_error_t err;
+  /* Not run because one of its dependencies failed.  */
+  bool skipped;
+  uint64_t start;
+  uint64_t end;
+};
+
+struct libcrun_task_graph_s
+{
+  const char *name;
+  struct libcrun_task_s tasks[LIBCRUN_TASK_GRAPH_MAX_TASKS];
+  size_t len;
+  /* Number of helper threads used by the last run.  */
+  size_t helpers;
+};
+
+void libcrun_task_graph_init (struct libcrun_task_graph_s *graph, const char *name);
+
+/* Add a task that runs after all the tasks in DEPS.  Returns the mask
+   that identifies the new task, to be used in the DEPS of the next ones.  */
+uint32_t libcrun_task_graph_add (struct libcrun_task_graph_s *graph, const char *name, libcrun_task_cb cb, void *arg,
+                                 unsigned int flags, uint32_t deps);
+
+/* Run all the tasks.  If any task fails, the tasks depending on it are
+   skipped while the others still run, and the error of the first failed
+   task, in the order they were added, is returned.  */
+int libcrun_task_graph_run (struct libcrun_task_graph_s *graph, libcrun_error_t *err);
+
+#endif
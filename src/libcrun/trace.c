@@ -0,0 +1,83 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <stdarg.h>
+#include <time.h>
+#include "utils.h"
+#include "trace.h"
+
+/* Per thread, so that operations running at the same time on different
+   threads of the caller do not count each other's events.  */
+static __thread unsigned int trace_counters[LIBCRUN_TRACE_COUNTERS_MAX];
+
+bool
+libcrun_trace_enabled (void)
+{
+  return libcrun_get_verbosity () >= LIBCRUN_VERBOSITY_DEBUG;
+}
+
+uint64_t
+libcrun_trace_now (void)
+{
+  struct timespec ts;
+
+  if (UNLIKELY (clock_gettime (CLOCK_MONOTONIC, &ts) < 0))
+    return 0;
+
+  return ((uint64_t) ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+void
+libcrun_trace (const char *msg, ...)
+{
+  cleanup_free char *output = NULL;
+  va_list args_list;
+  int ret;
+
+  if (! libcrun_trace_enabled ())
+    return;
+
+  va_start (args_list, msg);
+  ret = vasprintf (&output, msg, args_list);
+  va_end (args_list);
+  if (UNLIKELY (ret < 0))
+    OOM ();
+
+  libcrun_debug ("trace: %s", output);
+}
+
+void
+libcrun_trace_counter_add (enum libcrun_trace_counter counter, unsigned int n)
+{
+  trace_counters[counter] += n;
+}
+
+unsigned int
+libcrun_trace_counter_get (enum libcrun_trace_counter counter)
+{
+  return trace_counters[counter];
+}
+
+void
+libcrun_trace_counter_reset (enum libcrun_trace_counter counter)
+{
+  trace_counters[counter] = 0;
+}
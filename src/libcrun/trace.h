@@ -0,0 +1,54 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <config.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Trace events are written as debug messages prefixed with "trace: ", so
+   they are visible with --log-level=debug.  */
+
+enum libcrun_trace_counter
+{
+  /* Messages exchanged on the sync socket between crun and the container
+     init process.  */
+  LIBCRUN_TRACE_SYNC_SOCKET_MESSAGES = 0,
+  /* Writes to cgroup files, and the ones skipped because the file already
+     had the value.  */
+  LIBCRUN_TRACE_CGROUP_WRITES,
+  LIBCRUN_TRACE_CGROUP_WRITES_SKIPPED,
+  LIBCRUN_TRACE_COUNTERS_MAX,
+};
+
+bool libcrun_trace_enabled (void);
+
+/* Monotonic time in nanoseconds.  */
+uint64_t libcrun_trace_now (void);
+
+void libcrun_trace (const char *msg, ...) __attribute__ ((format (printf, 1, 2)));
+
+/* The counters are kept per thread.  */
+void libcrun_trace_counter_add (enum libcrun_trace_counter counter, unsigned int n);
+
+unsigned int libcrun_trace_counter_get (enum libcrun_trace_counter counter);
+
+void libcrun_trace_counter_reset (enum libcrun_trace_counter counter);
+
+#endif
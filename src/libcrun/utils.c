@@ -20,6 +20,7 @@
 #include <config.h>
 #include "utils.h"
 #include "ring_buffer.h"
+#include "spawn.h"
 #include <stdarg.h>
 #include <unistd.h>
 #include <string.h>
@@ -42,12 +43,14 @@
 #include <linux/magic.h>
 #include <limits.h>
 #include <sys/mman.h>
+#include <sys/utsname.h>
 #ifdef HAVE_LINUX_OPENAT2_H
 #  include <linux/openat2.h>
 #endif
 #if HAVE_STDATOMIC_H
 #  include <stdatomic.h>
 #else
+#  define atomic_int volatile int
 #  define atomic_long volatile long
 #endif
 #include "syscalls.h"
@@ -372,7 +375,7 @@ int
 safe_openat (int dirfd, const char *rootfs, const char *path, int flags, int mode,
              libcrun_error_t *err)
 {
-  static bool openat2_supported = true;
+  static atomic_int openat2_supported = 1;
   int ret;
 
   if (is_empty_string (path))
@@ -401,7 +404,7 @@ safe_openat (int dirfd, const char *rootfs, const char *path, int flags, int mod
           if (errno == EINTR || errno == EAGAIN)
             goto repeat;
           if (errno == ENOSYS)
-            openat2_supported = false;
+            openat2_supported = 0;
           if (errno == ENOSYS || errno == EINVAL || errno == EPERM)
             return safe_openat_fallback (dirfd, rootfs, path, flags, mode, err);
 
@@ -678,7 +681,7 @@ int
 check_running_in_user_namespace (libcrun_error_t *err)
 {
   cleanup_free char *buffer = NULL;
-  static int run_in_userns = -1;
+  static atomic_int run_in_userns = -1;
   size_t len;
   int ret;
 
@@ -704,6 +707,21 @@ check_running_in_user_namespace (libcrun_error_t *err)
   return ret;
 }
 
+bool
+libcrun_is_multithreaded (void)
+{
+  struct stat st;
+
+  /* Every thread is a subdirectory of /proc/self/task, its link count is
+     2 + the number of threads.  If /proc is not usable, e.g. not mounted
+     yet, assume there are other threads: the callers then take the path
+     that is safe in a multithreaded process.  */
+  if (stat ("/proc/self/task", &st) < 0)
+    return true;
+
+  return st.st_nlink > 3;
+}
+
 static size_t
 get_page_size ()
 {
@@ -717,8 +735,10 @@ get_page_size ()
   return (size_t) pagesize;
 }
 
-static int selinux_enabled = -1;
-static int apparmor_enabled = -1;
+/* The caches are shared by the threads using libcrun, all of them compute
+   the same value so there is no need to serialize the first lookup.  */
+static atomic_int selinux_enabled = -1;
+static atomic_int apparmor_enabled = -1;
 
 int
 libcrun_initialize_selinux (libcrun_container_t *container, libcrun_error_t *err)
@@ -1138,14 +1158,24 @@ send_fd_to_socket (int server, int fd, libcrun_error_t *err)
 
 int
 send_fd_to_socket_with_payload (int server, int fd, const char *payload, size_t payload_len, libcrun_error_t *err)
+{
+  return send_fds_to_socket_with_payload (server, &fd, 1, payload, payload_len, err);
+}
+
+int
+send_fds_to_socket_with_payload (int server, const int *fds, size_t n_fds, const void *payload, size_t payload_len,
+                                 libcrun_error_t *err)
 {
   int ret;
   struct cmsghdr *cmsg = NULL;
-  struct iovec iov[2];
+  struct iovec iov[1];
   struct msghdr msg = {};
-  char ctrl_buf[CMSG_SPACE (1 + sizeof (int))] = {};
+  char ctrl_buf[CMSG_SPACE (sizeof (int) * LIBCRUN_MAX_FDS_PER_MESSAGE)] = {};
   char data[1];
 
+  if (UNLIKELY (n_fds > LIBCRUN_MAX_FDS_PER_MESSAGE))
+    return crun_make_error (err, 0, "internal error: too many fds to send `%zu`", n_fds);
+
   data[0] = ' ';
   iov[0].iov_base = data;
   iov[0].iov_len = sizeof (data);
@@ -1160,15 +1190,19 @@ send_fd_to_socket_with_payload (int server, int fd, const char *payload, size_t
   msg.msg_namelen = 0;
   msg.msg_iov = iov;
   msg.msg_iovlen = 1;
-  msg.msg_controllen = CMSG_SPACE (sizeof (int));
-  msg.msg_control = ctrl_buf;
 
-  cmsg = CMSG_FIRSTHDR (&msg);
-  cmsg->cmsg_level = SOL_SOCKET;
-  cmsg->cmsg_type = SCM_RIGHTS;
-  cmsg->cmsg_len = CMSG_LEN (sizeof (int));
+  if (n_fds > 0)
+    {
+      msg.msg_controllen = CMSG_SPACE (sizeof (int) * n_fds);
+      msg.msg_control = ctrl_buf;
 
-  *((int *) CMSG_DATA (cmsg)) = fd;
+      cmsg = CMSG_FIRSTHDR (&msg);
+      cmsg->cmsg_level = SOL_SOCKET;
+      cmsg->cmsg_type = SCM_RIGHTS;
+      cmsg->cmsg_len = CMSG_LEN (sizeof (int) * n_fds);
+
+      memcpy (CMSG_DATA (cmsg), fds, sizeof (int) * n_fds);
+    }
 
   ret = TEMP_FAILURE_RETRY (sendmsg (server, &msg, 0));
   if (UNLIKELY (ret < 0))
@@ -1176,6 +1210,69 @@ send_fd_to_socket_with_payload (int server, int fd, const char *payload, size_t
   return 0;
 }
 
+int
+receive_fds_from_socket_with_payload (int from, int *fds, size_t *n_fds, void *payload, size_t payload_len,
+                                      libcrun_error_t *err)
+{
+  char ctrl_buf[CMSG_SPACE (sizeof (int) * LIBCRUN_MAX_FDS_PER_MESSAGE)] = {};
+  struct cmsghdr *cmsg;
+  struct iovec iov[1];
+  struct msghdr msg = {};
+  size_t max_fds = *n_fds;
+  size_t received = 0;
+  int ret;
+
+  *n_fds = 0;
+
+  if (UNLIKELY (max_fds > LIBCRUN_MAX_FDS_PER_MESSAGE))
+    max_fds = LIBCRUN_MAX_FDS_PER_MESSAGE;
+
+  iov[0].iov_base = payload;
+  iov[0].iov_len = payload_len;
+
+  msg.msg_name = NULL;
+  msg.msg_namelen = 0;
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 1;
+  msg.msg_controllen = CMSG_SPACE (sizeof (int) * max_fds);
+  msg.msg_control = ctrl_buf;
+
+  ret = TEMP_FAILURE_RETRY (recvmsg (from, &msg, MSG_CMSG_CLOEXEC));
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "recvmsg");
+  if (UNLIKELY (ret == 0))
+    return crun_make_error (err, 0, "read FDs: connection closed");
+
+  for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg))
+    {
+      size_t n;
+
+      if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+        continue;
+
+      n = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+      if (n > max_fds - received)
+        n = max_fds - received;
+
+      memcpy (fds + received, CMSG_DATA (cmsg), sizeof (int) * n);
+      received += n;
+    }
+
+  *n_fds = received;
+
+  if (UNLIKELY (msg.msg_flags & MSG_CTRUNC))
+    {
+      size_t i;
+
+      for (i = 0; i < received; i++)
+        TEMP_FAILURE_RETRY (close (fds[i]));
+      *n_fds = 0;
+      return crun_make_error (err, 0, "too many FDs received");
+    }
+
+  return ret;
+}
+
 int
 receive_fd_from_socket_with_payload (int from, char *payload, size_t payload_len, libcrun_error_t *err)
 {
@@ -1358,21 +1455,19 @@ copy_from_fd_to_fd (int src, int dst, int consume, libcrun_error_t *err)
 int
 run_process (char **args, libcrun_error_t *err)
 {
-  pid_t pid = fork ();
-  if (UNLIKELY (pid < 0))
-    return crun_make_error (err, errno, "fork");
-  if (pid)
-    {
-      int r, status;
-      r = TEMP_FAILURE_RETRY (waitpid (pid, &status, 0));
-      if (r < 0)
-        return crun_make_error (err, errno, "waitpid");
-      if (WIFEXITED (status) || WIFSIGNALED (status))
-        return WEXITSTATUS (status);
-    }
+  struct libcrun_spawn_s proc;
+  int ret;
+
+  ret = libcrun_spawn (&proc, args[0], args, NULL, environ, 0, 1, 2, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
 
-  execvp (args[0], args);
-  _safe_exit (EXIT_FAILURE);
+  ret = libcrun_spawn_wait (&proc, 1, -1, err);
+  libcrun_spawn_release (&proc);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  return proc.status;
 }
 
 #ifndef HAVE_FGETPWENT_R
@@ -1626,170 +1721,6 @@ unset_cloexec_flag (int fd)
   return fcntl (fd, F_SETFD, flags);
 }
 
-static void __attribute__ ((__noreturn__))
-run_process_child (char *path, char **args, const char *cwd, char **envp, int pipe_r,
-                   int pipe_w, int out_fd, int err_fd)
-{
-  char *tmp_args[] = { path, NULL };
-  libcrun_error_t err = NULL;
-  int dev_null_fd = -1;
-  int ret;
-
-  ret = mark_or_close_fds_ge_than (NULL, 3, false, &err);
-  if (UNLIKELY (ret < 0))
-    libcrun_fail_with_error ((err)->status, "%s", (err)->msg);
-
-  if (out_fd < 0 || err_fd < 0)
-    {
-      dev_null_fd = open ("/dev/null", O_WRONLY | O_CLOEXEC);
-      if (UNLIKELY (dev_null_fd < 0))
-        _safe_exit (EXIT_FAILURE);
-    }
-
-  TEMP_FAILURE_RETRY (close (pipe_w));
-  dup2 (pipe_r, 0);
-  TEMP_FAILURE_RETRY (close (pipe_r));
-
-  dup2 (out_fd >= 0 ? out_fd : dev_null_fd, 1);
-  dup2 (err_fd >= 0 ? err_fd : dev_null_fd, 2);
-
-  if (out_fd >= 0)
-    unset_cloexec_flag (1);
-  if (err_fd >= 0)
-    unset_cloexec_flag (2);
-
-  if (dev_null_fd >= 0)
-    TEMP_FAILURE_RETRY (close (dev_null_fd));
-  if (out_fd >= 0)
-    TEMP_FAILURE_RETRY (close (out_fd));
-  if (err_fd >= 0)
-    TEMP_FAILURE_RETRY (close (err_fd));
-
-  if (args == NULL)
-    args = tmp_args;
-
-  if (cwd && chdir (cwd) < 0)
-    _safe_exit (EXIT_FAILURE);
-
-  execvpe (path, args, envp);
-  _safe_exit (EXIT_FAILURE);
-}
-
-/* It changes the signals mask for the current process.  */
-int
-run_process_with_stdin_timeout_envp (char *path, char **args, const char *cwd, int timeout,
-                                     char **envp, char *stdin, size_t stdin_len, int out_fd,
-                                     int err_fd, libcrun_error_t *err)
-{
-  int stdin_pipe[2];
-  pid_t pid;
-  int ret;
-  cleanup_close int pipe_r = -1;
-  cleanup_close int pipe_w = -1;
-  sigset_t oldmask, mask;
-  int r, status;
-
-  sigemptyset (&mask);
-
-  ret = pipe2 (stdin_pipe, O_CLOEXEC);
-  if (UNLIKELY (ret < 0))
-    return crun_make_error (err, errno, "pipe");
-  pipe_r = stdin_pipe[0];
-  pipe_w = stdin_pipe[1];
-
-  if (timeout > 0)
-    {
-      sigaddset (&mask, SIGCHLD);
-      ret = sigprocmask (SIG_BLOCK, &mask, &oldmask);
-      if (UNLIKELY (ret < 0))
-        return crun_make_error (err, errno, "sigprocmask");
-    }
-
-  pid = fork ();
-  if (UNLIKELY (pid < 0))
-    {
-      ret = crun_make_error (err, errno, "fork");
-      goto restore_sig_mask_and_exit;
-    }
-
-  if (pid == 0)
-    {
-      /* run_process_child doesn't return.  */
-      run_process_child (path, args, cwd, envp, pipe_r, pipe_w, out_fd, err_fd);
-    }
-
-  close_and_reset (&pipe_r);
-
-  ret = TEMP_FAILURE_RETRY (write (pipe_w, stdin, stdin_len));
-  if (UNLIKELY (ret < 0))
-    {
-      /* Ignore EPIPE as the container process could have already
-         been terminated.  */
-      if (errno != EPIPE)
-        {
-          ret = crun_make_error (err, errno, "write to pipe");
-          goto restore_sig_mask_and_exit;
-        }
-    }
-
-  close_and_reset (&pipe_w);
-
-  if (timeout)
-    {
-      time_t start = time (NULL);
-      time_t now;
-      for (now = start; now - start < timeout; now = time (NULL))
-        {
-          siginfo_t info;
-          int elapsed = now - start;
-          struct timespec ts_timeout = { .tv_sec = timeout - elapsed, .tv_nsec = 0 };
-
-          ret = sigtimedwait (&mask, &info, &ts_timeout);
-          if (UNLIKELY (ret < 0 && errno != EAGAIN))
-            {
-              ret = crun_make_error (err, errno, "sigtimedwait");
-              goto restore_sig_mask_and_exit;
-            }
-
-          if (info.si_signo == SIGCHLD && info.si_pid == pid)
-            goto read_waitpid;
-
-          if (ret < 0 && errno == EAGAIN)
-            goto timeout;
-        }
-    timeout:
-      kill (pid, SIGKILL);
-
-      ret = crun_make_error (err, 0, "timeout expired for `%s`", path);
-      goto restore_sig_mask_and_exit;
-    }
-
-read_waitpid:
-  r = waitpid_ignore_stopped (pid, &status, 0);
-  if (r < 0)
-    ret = crun_make_error (err, errno, "waitpid");
-  else
-    ret = get_process_exit_status (status);
-
-  /* Prevent to cleanup the pid again.  */
-  pid = 0;
-
-restore_sig_mask_and_exit:
-  if (timeout > 0)
-    {
-      /* Cleanup the zombie process.  */
-      if (pid > 0)
-        {
-          kill (pid, SIGKILL);
-          TEMP_FAILURE_RETRY (waitpid (pid, &status, 0));
-        }
-      r = sigprocmask (SIG_UNBLOCK, &oldmask, NULL);
-      if (UNLIKELY (r < 0 && ret >= 0))
-        ret = crun_make_error (err, errno, "restoring signal mask with sigprocmask");
-    }
-  return ret;
-}
-
 int
 mark_or_close_fds_ge_than (libcrun_container_t *container, int n, bool close_now, libcrun_error_t *err)
 {
@@ -2313,6 +2244,12 @@ find_annotation (libcrun_container_t *container, const char *name)
   return find_string_map_value (container->annotations, name);
 }
 
+const char *
+find_known_annotation (libcrun_container_t *container, enum libcrun_annotation slot)
+{
+  return find_string_map_known_value (container->annotations, slot);
+}
+
 int
 safe_write (int fd, const char *fname, const void *buf, size_t count, libcrun_error_t *err)
 {
@@ -2745,11 +2682,21 @@ struct channel_fd_pair *
 channel_fd_pair_new (int in_fd, int out_fd, size_t size)
 {
   struct channel_fd_pair *channel = xmalloc (sizeof (struct channel_fd_pair));
+  libcrun_error_t tmp_err = NULL;
+
   channel->in_fd = in_fd;
   channel->out_fd = out_fd;
   channel->infd_epoll_events = -1;
   channel->outfd_epoll_events = -1;
-  channel->rb = ring_buffer_make (size);
+
+  /* Prefer the double-mapped buffer, so data is always copied with a
+     single read or write.  */
+  channel->rb = ring_buffer_make_mapped (size, &tmp_err);
+  if (channel->rb == NULL)
+    {
+      crun_error_release (&tmp_err);
+      channel->rb = ring_buffer_make (size);
+    }
   return channel;
 }
 
@@ -2890,3 +2837,147 @@ libcrun_open_proc_pid_file (libcrun_container_t *container, pid_t pid, const cha
   xasprintf (&full_path, "%d/%s", pid, path);
   return libcrun_open_proc_file (container, full_path, flags, err);
 }
+
+int
+libcrun_cache_key_init (blake3_hasher *hasher, bool kernel, libcrun_error_t *err)
+{
+  struct utsname utsbuf;
+  int ret;
+
+  memset (&utsbuf, 0, sizeof (utsbuf));
+  ret = uname (&utsbuf);
+  if (UNLIKELY (ret != 0))
+    return crun_make_error (err, errno, "uname");
+
+  blake3_hasher_init (hasher);
+
+  libcrun_cache_key_add_string (hasher, PACKAGE_VERSION);
+  libcrun_cache_key_add_string (hasher, utsbuf.machine);
+  if (kernel)
+    {
+      libcrun_cache_key_add_string (hasher, utsbuf.release);
+      libcrun_cache_key_add_string (hasher, utsbuf.version);
+    }
+  return 0;
+}
+
+void
+libcrun_cache_key_add_data (blake3_hasher *hasher, const void *data, size_t len)
+{
+  blake3_hasher_update (hasher, data, len);
+}
+
+void
+libcrun_cache_key_add_string (blake3_hasher *hasher, const char *s)
+{
+  if (s)
+    blake3_hasher_update (hasher, s, strlen (s) + 1);
+}
+
+void
+libcrun_cache_key_final (blake3_hasher *hasher, libcrun_cache_key_t out)
+{
+  static const char hex[] = "0123456789abcdef";
+  unsigned char hash[32];
+  size_t i;
+
+  blake3_hasher_finalize (hasher, hash, sizeof (hash));
+
+  for (i = 0; i < sizeof (hash); i++)
+    {
+      out[i * 2] = hex[hash[i] >> 4];
+      out[i * 2 + 1] = hex[hash[i] & 0xf];
+    }
+  out[sizeof (hash) * 2] = '\0';
+}
+
+struct cache_entry_s
+{
+  libcrun_cache_key_t key;
+  struct timespec atime;
+  off_t size;
+};
+
+static int
+compare_cache_entries_by_atime (const void *a, const void *b)
+{
+  const struct cache_entry_s *entry_a = a;
+  const struct cache_entry_s *entry_b = b;
+
+  if (entry_a->atime.tv_sec != entry_b->atime.tv_sec)
+    return entry_a->atime.tv_sec < entry_b->atime.tv_sec ? -1 : 1;
+  if (entry_a->atime.tv_nsec != entry_b->atime.tv_nsec)
+    return entry_a->atime.tv_nsec < entry_b->atime.tv_nsec ? -1 : 1;
+  return 0;
+}
+
+int
+libcrun_cache_evict (int dirfd, off_t max_size, off_t needed, time_t stale_seconds, libcrun_error_t *err)
+{
+  cleanup_free struct cache_entry_s *entries = NULL;
+  size_t i, n_entries = 0, to_delete;
+  cleanup_dir DIR *d = NULL;
+  off_t total = needed;
+  struct dirent *de;
+  struct stat st;
+  time_t now;
+  int dfd;
+  int ret;
+
+  dfd = TEMP_FAILURE_RETRY (openat (dirfd, ".", O_DIRECTORY | O_RDONLY | O_CLOEXEC));
+  if (UNLIKELY (dfd < 0))
+    return crun_make_error (err, errno, "open cache directory");
+
+  d = fdopendir (dfd);
+  if (UNLIKELY (d == NULL))
+    {
+      ret = crun_make_error (err, errno, "cannot open cache directory");
+      TEMP_FAILURE_RETRY (close (dfd));
+      return ret;
+    }
+
+  now = time (NULL);
+  while ((de = readdir (d)))
+    {
+      if (de->d_name[0] == '.')
+        continue;
+
+      ret = TEMP_FAILURE_RETRY (fstatat (dfd, de->d_name, &st, AT_SYMLINK_NOFOLLOW));
+      if (UNLIKELY (ret < 0))
+        continue;
+
+      /* Either a file being written or a leftover.  */
+      if (strlen (de->d_name) != sizeof (libcrun_cache_key_t) - 1)
+        {
+          if (now - st.st_mtime >= stale_seconds)
+            unlinkat (dfd, de->d_name, 0);
+          continue;
+        }
+
+      total += st.st_blocks * 512;
+
+      if ((st.st_mode & S_ISVTX) || st.st_nlink > 1)
+        continue;
+
+      entries = xrealloc (entries, sizeof (struct cache_entry_s) * (n_entries + 1));
+      memcpy (entries[n_entries].key, de->d_name, sizeof (libcrun_cache_key_t));
+      entries[n_entries].atime = st.st_atim;
+      entries[n_entries].size = st.st_blocks * 512;
+      n_entries++;
+    }
+
+  if (max_size >= 0 && total <= max_size)
+    return 0;
+
+  qsort (entries, n_entries, sizeof (struct cache_entry_s), compare_cache_entries_by_atime);
+
+  to_delete = max_size >= 0 || n_entries == 1 ? n_entries : n_entries / 2;
+  for (i = 0; i < to_delete && (max_size < 0 || total > max_size); i++)
+    {
+      /* A file still open or mapped stays valid for its users.  */
+      ret = unlinkat (dfd, entries[i].key, 0);
+      if (ret == 0)
+        total -= entries[i].size;
+    }
+  return 0;
+}
@@ -24,6 +24,7 @@
 #include <errno.h>
 #include <argp.h>
 #include "error.h"
+#include "blake3/blake3.h"
 #include <dirent.h>
 #include <unistd.h>
 #include <signal.h>
@@ -299,6 +300,9 @@ int create_file_if_missing_at (int dirfd, const char *file, mode_t mode, libcrun
 
 int check_running_in_user_namespace (libcrun_error_t *err);
 
+/* Whether the calling process has more than one thread.  */
+bool libcrun_is_multithreaded (void);
+
 int set_selinux_label (libcrun_container_t *container, const char *label, bool now, libcrun_error_t *err);
 
 int add_selinux_mount_label (char **ret, const char *data, const char *label, const char *context_type, libcrun_error_t *err);
@@ -327,12 +331,23 @@ int send_fd_to_socket (int server, int fd, libcrun_error_t *err);
 
 int send_fd_to_socket_with_payload (int server, int fd, const char *payload, size_t payload_len, libcrun_error_t *err);
 
+/* Maximum number of fds the kernel accepts in a single SCM_RIGHTS message (SCM_MAX_FD).  */
+#define LIBCRUN_MAX_FDS_PER_MESSAGE 253
+
+int send_fds_to_socket_with_payload (int server, const int *fds, size_t n_fds, const void *payload, size_t payload_len,
+                                     libcrun_error_t *err);
+
 int create_socket_pair (int *pair, libcrun_error_t *err);
 
 int receive_fd_from_socket (int from, libcrun_error_t *err);
 
 int receive_fd_from_socket_with_payload (int from, char *payload, size_t payload_len, libcrun_error_t *err);
 
+/* On input N_FDS is the size of FDS, on output the number of fds received.  Returns the
+   number of payload bytes read.  */
+int receive_fds_from_socket_with_payload (int from, int *fds, size_t *n_fds, void *payload, size_t payload_len,
+                                          libcrun_error_t *err);
+
 int create_signalfd (sigset_t *mask, libcrun_error_t *err);
 
 int epoll_helper (int *in_fds, int *in_levelfds, int *out_fds, int *out_levelfds, libcrun_error_t *err);
@@ -343,9 +358,6 @@ int run_process (char **args, libcrun_error_t *err);
 
 int format_default_id_mapping (char **out, uid_t container_id, uid_t host_uid, uid_t host_id, int is_uid, libcrun_error_t *err);
 
-int run_process_with_stdin_timeout_envp (char *path, char **args, const char *cwd, int timeout, char **envp,
-                                         char *stdin, size_t stdin_len, int out_fd, int err_fd, libcrun_error_t *err);
-
 int mark_or_close_fds_ge_than (libcrun_container_t *container, int n, bool close_now, libcrun_error_t *err);
 
 void get_current_timestamp (char *out, size_t len);
@@ -373,6 +385,8 @@ int libcrun_initialize_apparmor (libcrun_error_t *err);
 
 const char *find_annotation (libcrun_container_t *container, const char *name);
 
+const char *find_known_annotation (libcrun_container_t *container, enum libcrun_annotation slot);
+
 int get_file_type_at (int dirfd, mode_t *mode, bool nofollow, const char *path);
 
 int get_file_type (mode_t *mode, bool nofollow, const char *path);
@@ -521,4 +535,27 @@ int libcrun_get_cached_proc_fd (libcrun_container_t *container, libcrun_error_t
 int libcrun_open_proc_file (libcrun_container_t *container, const char *path, int flags, libcrun_error_t *err);
 int libcrun_open_proc_pid_file (libcrun_container_t *container, pid_t pid, const char *path, int flags, libcrun_error_t *err);
 
+/* The files in a cache directory are named after the hex encoded blake3
+   hash of everything that affects their content.  */
+typedef char libcrun_cache_key_t[65];
+
+/* Start a cache key.  It covers the crun version and the architecture,
+   and the kernel version too if KERNEL is set.  */
+int libcrun_cache_key_init (blake3_hasher *hasher, bool kernel, libcrun_error_t *err);
+
+void libcrun_cache_key_add_data (blake3_hasher *hasher, const void *data, size_t len);
+
+/* Add the string S including its terminator, nothing if it is NULL.  */
+void libcrun_cache_key_add_string (blake3_hasher *hasher, const char *s);
+
+void libcrun_cache_key_final (blake3_hasher *hasher, libcrun_cache_key_t out);
+
+/* Delete the least recently used files in the cache directory DIRFD.
+   If MAX_SIZE is not negative, files are deleted until the ones left
+   plus NEEDED bytes fit in MAX_SIZE, otherwise half of them are deleted.
+   Files with the sticky bit set or with other links are never deleted.
+   Files not named after a key are deleted once they are STALE_SECONDS
+   old.  */
+int libcrun_cache_evict (int dirfd, off_t max_size, off_t needed, time_t stale_seconds, libcrun_error_t *err);
+
 #endif
@@ -33,12 +33,15 @@ enum
   OPTION_PRESERVE_FDS,
   OPTION_NO_PIVOT,
   OPTION_KEEP,
+  OPTION_PSI_FD,
 };
 
 static const char *bundle = NULL;
 
 static bool keep = false;
 
+static int psi_fd = -1;
+
 static libcrun_context_t crun_context;
 
 static struct argp_option options[]
@@ -53,6 +56,7 @@ static struct argp_option options[]
         { "no-subreaper", OPTION_NO_SUBREAPER, 0, 0, "do not create a subreaper process (ignored)", 0 },
         { "no-new-keyring", OPTION_NO_NEW_KEYRING, 0, 0, "keep the same session key", 0 },
         { "no-pivot", OPTION_NO_PIVOT, 0, 0, "do not use pivot_root", 0 },
+        { "psi-fd", OPTION_PSI_FD, "FD", 0, "write the PSI events to FD", 0 },
         {
             0,
         } };
@@ -105,6 +109,12 @@ parse_opt (int key, char *arg, struct argp_state *state)
       crun_context.no_pivot = true;
       break;
 
+    case OPTION_PSI_FD:
+      psi_fd = parse_int_or_fail (argp_mandatory_argument (arg, state), "psi-fd");
+      if (psi_fd < 0)
+        libcrun_fail_with_error (0, "invalid value `%s` for --psi-fd", arg);
+      break;
+
     case ARGP_KEY_NO_ARGS:
       libcrun_fail_with_error (0, "please specify a ID for the container");
 
@@ -123,8 +133,17 @@ get_options ()
   return keep ? LIBCRUN_RUN_OPTIONS_KEEP : 0;
 }
 
+/* init_libcrun_context runs after the options are parsed, set the fd for
+   the PSI events only once the context is initialized.  */
+static int
+container_run (libcrun_context_t *context, libcrun_container_t *container, unsigned int options, libcrun_error_t *err)
+{
+  context->psi_fd = psi_fd;
+  return libcrun_container_run (context, container, options, err);
+}
+
 int
 crun_command_run (struct crun_global_arguments *global_args, int argc, char **argv, libcrun_error_t *err)
 {
-  return crun_run_create_internal (global_args, argc, argv, libcrun_container_run, get_options, &crun_context, &run_argp, &config_file, &bundle, err);
+  return crun_run_create_internal (global_args, argc, argv, container_run, get_options, &crun_context, &run_argp, &config_file, &bundle, err);
 }
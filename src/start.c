@@ -36,20 +36,52 @@ enum
   OPTION_PID_FILE,
   OPTION_NO_SUBREAPER,
   OPTION_NO_NEW_KEYRING,
-  OPTION_PRESERVE_FDS
+  OPTION_PRESERVE_FDS,
+  OPTION_CWD
 };
 
-static struct argp_option options[] = { {
-    0,
-} };
+struct start_options_s
+{
+  char *cwd;
+  char **env;
+  size_t env_size;
+};
+
+static struct start_options_s start_options;
 
-static char args_doc[] = "start CONTAINER";
+static struct argp_option options[]
+    = { { "cwd", OPTION_CWD, "CWD", 0, "current working directory (only for zygote containers)", 0 },
+        { "env", 'e', "ENV", 0, "add an environment variable (only for zygote containers)", 0 },
+        {
+            0,
+        } };
+
+static char args_doc[] = "start CONTAINER [COMMAND [ARG...]]";
+
+static void
+append_env (const char *arg)
+{
+  start_options.env = realloc (start_options.env, (start_options.env_size + 2) * sizeof (*start_options.env));
+  if (start_options.env == NULL)
+    error (EXIT_FAILURE, errno, "cannot allocate memory");
+  start_options.env[start_options.env_size + 1] = NULL;
+  start_options.env[start_options.env_size] = xstrdup (arg);
+  start_options.env_size++;
+}
 
 static error_t
-parse_opt (int key, char *arg arg_unused, struct argp_state *state arg_unused)
+parse_opt (int key, char *arg, struct argp_state *state)
 {
   switch (key)
     {
+    case OPTION_CWD:
+      start_options.cwd = argp_mandatory_argument (arg, state);
+      break;
+
+    case 'e':
+      append_env (argp_mandatory_argument (arg, state));
+      break;
+
     case ARGP_KEY_NO_ARGS:
       libcrun_fail_with_error (0, "please specify a ID for the container");
 
@@ -71,12 +103,28 @@ crun_command_start (struct crun_global_arguments *global_args, int argc, char **
     0,
   };
 
-  argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, NULL);
-  crun_assert_n_args (argc - first_arg, 1, 1);
+  argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, &start_options);
+  crun_assert_n_args (argc - first_arg, 1, -1);
 
   ret = init_libcrun_context (&crun_context, argv[first_arg], global_args, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
+  /* The process of a zygote container can be specified at start time.  */
+  if (argc - first_arg > 1 || start_options.cwd || start_options.env_size)
+    {
+      runtime_spec_schema_config_schema_process process = {
+        0,
+      };
+
+      process.args = argv + first_arg + 1;
+      process.args_len = argc - first_arg - 1;
+      process.env = start_options.env;
+      process.env_len = start_options.env_size;
+      process.cwd = start_options.cwd;
+
+      return libcrun_container_start_process (&crun_context, argv[first_arg], &process, err);
+    }
+
   return libcrun_container_start (&crun_context, argv[first_arg], err);
 }
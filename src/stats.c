@@ -0,0 +1,254 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <argp.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "crun.h"
+#include "stats.h"
+#include "libcrun/container.h"
+#include "libcrun/utils.h"
+
+enum
+{
+  OPTION_INTERVAL = 1000,
+  OPTION_ALL,
+};
+
+static char doc[] = "OCI runtime";
+
+/* Interval between two samples, in nanoseconds.  0 means a single sample.  */
+static uint64_t interval;
+
+static bool all;
+
+static struct argp_option options[]
+    = { { "interval", OPTION_INTERVAL, "SECONDS", 0, "print the stats every SECONDS until the container exits", 0 },
+        { "all", OPTION_ALL, 0, 0, "show the usage rates of all the containers", 0 },
+        {
+            0,
+        } };
+
+static char args_doc[] = "stats [OPTION]... [CONTAINER]";
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  switch (key)
+    {
+    case OPTION_INTERVAL:
+      {
+        char *endptr = NULL;
+        double value;
+
+        errno = 0;
+        value = strtod (argp_mandatory_argument (arg, state), &endptr);
+        if (errno != 0 || *endptr != '\0' || value <= 0)
+          libcrun_fail_with_error (0, "invalid interval `%s`", arg);
+
+        interval = (uint64_t) (value * 1000000000.0);
+        if (interval == 0)
+          libcrun_fail_with_error (0, "invalid interval `%s`", arg);
+      }
+      break;
+
+    case OPTION_ALL:
+      all = true;
+      break;
+
+    case ARGP_KEY_NO_ARGS:
+      if (! all)
+        libcrun_fail_with_error (0, "please specify a ID for the container");
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+
+  return 0;
+}
+
+static struct argp run_argp = { options, parse_opt, args_doc, doc, NULL, NULL, NULL };
+
+/* Use absolute deadlines so the samples do not drift.  */
+static int
+sleep_until_next (struct timespec *next, uint64_t delay, libcrun_error_t *err)
+{
+  int ret;
+
+  next->tv_sec += delay / 1000000000ULL;
+  next->tv_nsec += delay % 1000000000ULL;
+  if (next->tv_nsec >= 1000000000L)
+    {
+      next->tv_sec++;
+      next->tv_nsec -= 1000000000L;
+    }
+
+  do
+    ret = clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, next, NULL);
+  while (ret == EINTR);
+  if (UNLIKELY (ret != 0))
+    return crun_make_error (err, ret, "clock_nanosleep");
+
+  return 0;
+}
+
+/* Print the usage rates of all the containers.  The rates need two samples,
+   so without --interval the command prints a single pass after one second.  */
+static int
+stats_all (libcrun_context_t *crun_context, libcrun_error_t *err)
+{
+  const struct libcrun_container_stats_delta_s *deltas;
+  libcrun_stats_collector_t *collector = NULL;
+  uint64_t delay = interval ? interval : 1000000000ULL;
+  struct timespec next, now;
+  size_t len;
+  int pass;
+  int ret;
+
+  ret = libcrun_stats_collector_new (crun_context, &collector, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (UNLIKELY (clock_gettime (CLOCK_MONOTONIC, &next) < 0))
+    {
+      ret = crun_make_error (err, errno, "clock_gettime");
+      goto exit;
+    }
+
+  for (pass = 0;; pass++)
+    {
+      ret = libcrun_stats_collector_sample (collector, &deltas, &len, err);
+      if (UNLIKELY (ret < 0))
+        goto exit;
+
+      if (pass > 0)
+        {
+          clock_gettime (CLOCK_REALTIME, &now);
+          ret = libcrun_stats_collector_write (deltas, len, ((uint64_t) now.tv_sec) * 1000000000ULL + now.tv_nsec,
+                                               stdout, err);
+          if (UNLIKELY (ret < 0))
+            goto exit;
+
+          if (interval == 0)
+            break;
+
+          fflush (stdout);
+        }
+
+      ret = sleep_until_next (&next, delay, err);
+      if (UNLIKELY (ret < 0))
+        goto exit;
+    }
+
+  ret = 0;
+
+exit:
+  libcrun_stats_collector_free (collector);
+  return ret;
+}
+
+int
+crun_command_stats (struct crun_global_arguments *global_args, int argc, char **argv, libcrun_error_t *err)
+{
+  libcrun_container_stats_reader_t *reader = NULL;
+  struct libcrun_container_stats_s stats;
+  libcrun_context_t crun_context = {
+    0,
+  };
+  struct timespec next;
+  bool first = true;
+  const char *id;
+  int first_arg;
+  int ret;
+
+  argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, &crun_context);
+
+  if (all)
+    {
+      crun_assert_n_args (argc - first_arg, 0, 0);
+
+      ret = init_libcrun_context (&crun_context, NULL, global_args, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      return stats_all (&crun_context, err);
+    }
+
+  crun_assert_n_args (argc - first_arg, 1, 1);
+
+  id = argv[first_arg];
+
+  ret = init_libcrun_context (&crun_context, id, global_args, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  /* The files stay open between the samples, so each one costs a read per
+     file.  */
+  ret = libcrun_container_stats_reader_open (&crun_context, id, &reader, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (UNLIKELY (clock_gettime (CLOCK_MONOTONIC, &next) < 0))
+    {
+      ret = crun_make_error (err, errno, "clock_gettime");
+      goto exit;
+    }
+
+  while (1)
+    {
+      ret = libcrun_container_stats_reader_read (reader, &stats, err);
+      if (UNLIKELY (ret < 0))
+        {
+          /* The cgroup was removed once the container exited.  */
+          if (! first && crun_error_get_errno (err) == ENODEV)
+            {
+              crun_error_release (err);
+              ret = 0;
+            }
+          goto exit;
+        }
+      first = false;
+
+      ret = libcrun_container_stats_write_json (id, &stats, stdout, err);
+      if (UNLIKELY (ret < 0))
+        goto exit;
+
+      if (interval == 0)
+        break;
+
+      fflush (stdout);
+
+      ret = sleep_until_next (&next, interval, err);
+      if (UNLIKELY (ret < 0))
+        goto exit;
+    }
+
+  ret = 0;
+
+exit:
+  libcrun_container_stats_reader_free (reader);
+  return ret;
+}
@@ -0,0 +1,121 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <argp.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "crun.h"
+#include "update_batch.h"
+#include "libcrun/container.h"
+#include "libcrun/utils.h"
+
+static char doc[] = "OCI runtime";
+
+static libcrun_context_t crun_context;
+
+static struct argp_option options[] = { {
+    0,
+} };
+
+static char args_doc[] = "update-batch [OPTION]... CONTAINER=RESOURCES...";
+
+static error_t
+parse_opt (int key, char *arg arg_unused, struct argp_state *state arg_unused)
+{
+  switch (key)
+    {
+    case ARGP_KEY_NO_ARGS:
+      libcrun_fail_with_error (0, "please specify at least a CONTAINER=RESOURCES pair");
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+
+  return 0;
+}
+
+static struct argp run_argp = { options, parse_opt, args_doc, doc, NULL, NULL, NULL };
+
+int
+crun_command_update_batch (struct crun_global_arguments *global_args, int argc, char **argv, libcrun_error_t *err)
+{
+  cleanup_free struct libcrun_container_update_entry_s *entries = NULL;
+  int first_arg = 0, ret, failures;
+  size_t i, len;
+
+  argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, &crun_context);
+  crun_assert_n_args (argc - first_arg, 1, -1);
+
+  ret = init_libcrun_context (&crun_context, NULL, global_args, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  len = argc - first_arg;
+  entries = xmalloc0 (sizeof (*entries) * len);
+
+  /* Parse all the resources files before any container is updated.  */
+  for (i = 0; i < len; i++)
+    {
+      cleanup_free char *content = NULL;
+      char *arg = argv[first_arg + i];
+      char *sep = strchr (arg, '=');
+
+      if (sep == NULL || sep == arg || sep[1] == '\0')
+        libcrun_fail_with_error (0, "invalid argument `%s`, expected CONTAINER=RESOURCES", arg);
+      *sep = '\0';
+
+      ret = read_all_file (sep + 1, &content, NULL, err);
+      if (UNLIKELY (ret < 0))
+        goto exit;
+
+      ret = libcrun_container_parse_resources (content, &entries[i].resources, err);
+      if (UNLIKELY (ret < 0))
+        goto exit;
+
+      entries[i].id = arg;
+    }
+
+  failures = libcrun_container_update_batch (&crun_context, entries, len, err);
+  if (UNLIKELY (failures < 0))
+    {
+      ret = failures;
+      goto exit;
+    }
+
+  for (i = 0; i < len; i++)
+    if (entries[i].ret < 0)
+      {
+        libcrun_error (entries[i].err->status, "update `%s`: %s", entries[i].id, entries[i].err->msg);
+        crun_error_release (&entries[i].err);
+      }
+
+  ret = 0;
+  if (failures > 0)
+    ret = crun_make_error (err, 0, "%d of %zu containers could not be updated", failures, len);
+
+exit:
+  for (i = 0; i < len; i++)
+    if (entries[i].resources)
+      free_runtime_spec_schema_config_linux_resources (entries[i].resources);
+  return ret;
+}
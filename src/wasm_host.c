@@ -0,0 +1,259 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <argp.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "crun.h"
+#include "wasm_host.h"
+#include "libcrun/container.h"
+#include "libcrun/custom-handler.h"
+#include "libcrun/utils.h"
+
+enum
+{
+  OPTION_MAX_WORKERS = 1000,
+  OPTION_HANDLER_NAME,
+  OPTION_NO_NEW_KEYRING,
+  OPTION_NO_PIVOT
+};
+
+/* How long a client can take to send its request or to read the replies
+   before the connection is dropped.  The requests are served one at a time,
+   so a stuck client must not block the others.  */
+#define CLIENT_TIMEOUT_SECONDS 10
+
+static char doc[] = "OCI runtime";
+
+static unsigned int max_workers;
+
+static const char *handler_name = "wasm";
+
+static libcrun_context_t crun_context;
+
+static struct argp_option options[]
+    = { { "max-workers", OPTION_MAX_WORKERS, "N", 0, "create at most N containers in parallel (default: number of CPUs)", 0 },
+        { "handler", OPTION_HANDLER_NAME, "NAME", 0, "handler to keep warm (default: wasm)", 0 },
+        { "no-pivot", OPTION_NO_PIVOT, 0, 0, "do not use pivot_root", 0 },
+        { "no-new-keyring", OPTION_NO_NEW_KEYRING, 0, 0, "keep the same session key", 0 },
+        {
+            0,
+        } };
+
+static char args_doc[] = "wasm-host [OPTION]... SOCKET";
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  switch (key)
+    {
+    case OPTION_MAX_WORKERS:
+      max_workers = parse_int_or_fail (argp_mandatory_argument (arg, state), "max-workers");
+      break;
+
+    case OPTION_HANDLER_NAME:
+      handler_name = argp_mandatory_argument (arg, state);
+      break;
+
+    case OPTION_NO_PIVOT:
+      crun_context.no_pivot = true;
+      break;
+
+    case OPTION_NO_NEW_KEYRING:
+      crun_context.no_new_keyring = true;
+      break;
+
+    case ARGP_KEY_NO_ARGS:
+      libcrun_fail_with_error (0, "please specify the SOCKET path");
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+
+  return 0;
+}
+
+static struct argp run_argp = { options, parse_opt, args_doc, doc, NULL, NULL, NULL };
+
+static int
+send_reply (int fd, const char *id, int ret, const char *msg)
+{
+  cleanup_free char *reply = NULL;
+  size_t len;
+
+  if (ret < 0)
+    len = xasprintf (&reply, "%s error %s\n", id, msg);
+  else
+    len = xasprintf (&reply, "%s ok\n", id);
+
+  /* The client may be gone already, do not get killed by SIGPIPE.  */
+  return TEMP_FAILURE_RETRY (send (fd, reply, len, MSG_NOSIGNAL));
+}
+
+/* A request is a list of "CONTAINER BUNDLE" lines terminated by the end of
+   the stream.  All the containers are created in parallel and a line
+   "CONTAINER ok" or "CONTAINER error MESSAGE" is sent back for each of them.  */
+static int
+serve_request (int fd, libcrun_error_t *err)
+{
+  cleanup_free struct libcrun_container_batch_entry_s *entries = NULL;
+  cleanup_free char *request = NULL;
+  char *line, *saveptr = NULL;
+  size_t i, len = 0, request_len;
+  struct timeval timeout = { .tv_sec = CLIENT_TIMEOUT_SECONDS };
+  int ret, failures;
+
+  ret = setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof (timeout));
+  if (LIKELY (ret == 0))
+    ret = setsockopt (fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof (timeout));
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "setsockopt");
+
+  ret = read_all_fd (fd, "request", &request, &request_len, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  for (line = strtok_r (request, "\n", &saveptr); line; line = strtok_r (NULL, "\n", &saveptr))
+    {
+      cleanup_free char *config_file = NULL;
+      struct libcrun_container_batch_entry_s *entry;
+      libcrun_error_t tmp_err = NULL;
+      char *sep;
+
+      sep = strchr (line, ' ');
+      if (sep == NULL || sep == line || sep[1] == '\0')
+        {
+          send_reply (fd, line, -1, "invalid request, expected CONTAINER BUNDLE");
+          continue;
+        }
+      *sep = '\0';
+
+      entries = xrealloc (entries, sizeof (*entries) * (len + 1));
+      entry = &entries[len];
+      memset (entry, 0, sizeof (*entry));
+      entry->id = line;
+
+      entry->bundle = realpath (sep + 1, NULL);
+      if (entry->bundle == NULL)
+        {
+          send_reply (fd, line, -1, strerror (errno));
+          continue;
+        }
+
+      ret = append_paths (&config_file, &tmp_err, entry->bundle, "config.json", NULL);
+      if (LIKELY (ret == 0))
+        entry->container = libcrun_container_load_from_file (config_file, &tmp_err);
+      if (entry->container == NULL)
+        {
+          send_reply (fd, line, -1, tmp_err->msg);
+          crun_error_release (&tmp_err);
+          free ((char *) entry->bundle);
+          continue;
+        }
+
+      len++;
+    }
+
+  failures = 0;
+  if (len > 0)
+    failures = libcrun_container_create_batch (&crun_context, entries, len, max_workers, 0, err);
+
+  for (i = 0; i < len; i++)
+    {
+      if (failures < 0)
+        send_reply (fd, entries[i].id, -1, (*err)->msg);
+      else
+        {
+          send_reply (fd, entries[i].id, entries[i].ret, entries[i].ret < 0 ? entries[i].err->msg : NULL);
+          if (entries[i].ret < 0)
+            crun_error_release (&entries[i].err);
+        }
+      libcrun_container_free (entries[i].container);
+      free ((char *) entries[i].bundle);
+    }
+
+  return failures < 0 ? failures : 0;
+}
+
+int
+crun_command_wasm_host (struct crun_global_arguments *global_args, int argc, char **argv, libcrun_error_t *err)
+{
+  cleanup_custom_handler_instance struct custom_handler_instance_s *handler = NULL;
+  cleanup_close int listen_fd = -1;
+  int first_arg = 0, ret;
+  struct stat st;
+
+  argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, &crun_context);
+  crun_assert_n_args (argc - first_arg, 1, 1);
+
+  ret = init_libcrun_context (&crun_context, NULL, global_args, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  /* Every container is forked from this process and finds the handler
+     library already loaded.  */
+  ret = libcrun_handler_manager_warmup (crun_context.handler_manager, handler_name, &handler, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  /* Replace the socket left by a previous instance.  */
+  if (lstat (argv[first_arg], &st) == 0 && S_ISSOCK (st.st_mode))
+    unlink (argv[first_arg]);
+
+  listen_fd = open_unix_domain_socket (argv[first_arg], 0, err);
+  if (UNLIKELY (listen_fd < 0))
+    return listen_fd;
+
+  ret = fcntl (listen_fd, F_SETFD, FD_CLOEXEC);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "fcntl");
+
+  ret = listen (listen_fd, SOMAXCONN);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "listen on `%s`", argv[first_arg]);
+
+  while (1)
+    {
+      cleanup_close int fd = -1;
+
+      fd = accept4 (listen_fd, NULL, NULL, SOCK_CLOEXEC);
+      if (UNLIKELY (fd < 0))
+        {
+          if (errno == EINTR)
+            continue;
+          return crun_make_error (err, errno, "accept on `%s`", argv[first_arg]);
+        }
+
+      ret = serve_request (fd, err);
+      if (UNLIKELY (ret < 0))
+        libcrun_error_write_warning_and_release (stderr, &err);
+    }
+
+  return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* LD_PRELOAD library that counts the calls to the allocation functions in
+   all the processes that load it.  The counters are stored in the file
+   specified by CRUN_ALLOC_COUNTER_FILE, shared by all the processes, as
+   three uint64_t values: malloc, calloc and realloc calls.  */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+enum
+{
+  COUNTER_MALLOC = 0,
+  COUNTER_CALLOC,
+  COUNTER_REALLOC,
+  COUNTERS_MAX,
+};
+
+static uint64_t *counters;
+
+__attribute__ ((constructor)) static void
+alloc_counter_init ()
+{
+  const char *path = getenv ("CRUN_ALLOC_COUNTER_FILE");
+  void *addr;
+  int fd;
+
+  if (path == NULL)
+    return;
+
+  fd = open (path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0)
+    return;
+
+  if (ftruncate (fd, sizeof (uint64_t) * COUNTERS_MAX) < 0)
+    {
+      close (fd);
+      return;
+    }
+
+  addr = mmap (NULL, sizeof (uint64_t) * COUNTERS_MAX, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close (fd);
+  if (addr != MAP_FAILED)
+    counters = addr;
+}
+
+static inline void
+count (int counter)
+{
+  if (counters)
+    __atomic_add_fetch (&counters[counter], 1, __ATOMIC_RELAXED);
+}
+
+void *
+malloc (size_t size)
+{
+  count (COUNTER_MALLOC);
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t nmemb, size_t size)
+{
+  count (COUNTER_CALLOC);
+  return __libc_calloc (nmemb, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+  count (COUNTER_REALLOC);
+  return __libc_realloc (ptr, size);
+}
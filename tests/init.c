@@ -742,9 +742,12 @@ main (int argc, char **argv)
 
   if (strcmp (argv[1], "ip") == 0)
     {
-      if (argc < 2)
+      int i;
+
+      if (argc < 3)
         error (EXIT_FAILURE, 0, "'ip' requires an argument");
-      dump_net_interface (argv[2]);
+      for (i = 2; i < argc; i++)
+        dump_net_interface (argv[i]);
       exit (EXIT_SUCCESS);
     }
 
@@ -0,0 +1,36 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Minimal libkrun replacement used by tests/tests_libcrun_krun.  It only
+   counts the contexts that are created.  */
+
+#include <stdint.h>
+
+static int32_t created_contexts;
+
+int32_t
+krun_create_ctx ()
+{
+  return created_contexts++;
+}
+
+int32_t
+krun_stub_created_contexts ()
+{
+  return created_contexts;
+}
@@ -266,6 +266,84 @@ def test_cr_pre_dump():
     return 0
 
 
+def test_cr_pre_dump_iterations():
+    if is_rootless() or 'CRIU' not in get_crun_feature_string():
+        return 77
+
+    if _get_criu_version() < 31700:
+        return 77
+
+    if "pre-dump-iterations" not in run_crun_command(["checkpoint", "--help"]):
+        return 77
+
+    conf = base_config()
+    conf['process']['args'] = [
+            '/init',
+            'memhog',
+            '10'
+    ]
+    add_all_namespaces(conf)
+
+    cid = None
+    cr_dir = os.path.join(get_tests_root(), 'checkpoint-iterations')
+    work_dir = 'work-dir'
+    try:
+        _, cid = run_and_get_output(
+            conf,
+            all_dev_null=True,
+            use_popen=True,
+            detach=True
+        )
+
+        first_cmdline = _get_cmdline(cid, get_tests_root())
+        if first_cmdline == "":
+            logger.info("test_cr_pre_dump_iterations: failed to get first cmdline")
+            return -1
+
+        out = run_crun_command([
+            "checkpoint",
+            "--pre-dump-iterations=3",
+            "--image-path=%s" % cr_dir,
+            "--work-path=%s" % work_dir,
+            cid
+        ])
+
+        iterations = [i for i in out.split('\n') if i.startswith("pre-dump ")]
+        if len(iterations) == 0 or len(iterations) > 3:
+            logger.info("test_cr_pre_dump_iterations: unexpected output: %s", out)
+            return -1
+        if not os.path.isdir(os.path.join(cr_dir, "pre-dump-1")):
+            logger.info("test_cr_pre_dump_iterations: pre-dump-1 not found")
+            return -1
+
+        bundle = os.path.join(
+            get_tests_root(),
+            cid.split('-')[1]
+        )
+
+        run_crun_command([
+            "restore",
+            "-d",
+            "--image-path=%s" % cr_dir,
+            "--bundle=%s" % bundle,
+            "--work-path=%s" % work_dir,
+            cid
+        ])
+
+        second_cmdline = _get_cmdline(cid, get_tests_root())
+        if first_cmdline != second_cmdline:
+            logger.info("test_cr_pre_dump_iterations: cmdline mismatch after restore")
+            return -1
+
+    except Exception as e:
+        logger.info("test_cr_pre_dump_iterations: exception: %s", e)
+        return -1
+    finally:
+        if cid is not None:
+            run_crun_command(["delete", "-f", cid])
+    return 0
+
+
 def test_cr():
     if is_rootless() or 'CRIU' not in get_crun_feature_string():
         return 77
@@ -401,6 +479,7 @@ all_tests = {
     "checkpoint-restore": test_cr,
     "checkpoint-restore-ext-ns": test_cr_with_ext_ns,
     "checkpoint-restore-pre-dump": test_cr_pre_dump,
+    "checkpoint-restore-pre-dump-iterations": test_cr_pre_dump_iterations,
     "checkpoint-restore-with-runc-config": test_cr_with_runc_config,
     "checkpoint-restore-with-crun-config": test_cr_with_crun_config,
     "checkpoint-restore-with-annotation-config": test_cr_with_annotation_config,
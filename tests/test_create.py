@@ -17,6 +17,10 @@
 
 import json
 import os
+import shutil
+import struct
+import subprocess
+import tempfile
 import time
 from tests_utils import *
 
@@ -166,10 +170,185 @@ def test_create_with_annotations():
                 pass
 
 
+def test_create_invalid_stdio_buffer_size():
+    """An invalid run.oci.stdio_buffer_size must make create fail."""
+    conf = base_config()
+    conf['process']['args'] = ['/init', 'true']
+    add_all_namespaces(conf)
+
+    for value in ["0", "foo", "1099511627776"]:
+        conf['annotations'] = {'run.oci.stdio_buffer_size': value}
+        cid = "test-stdio-buffer-size-%d" % os.getpid()
+        try:
+            proc, _ = run_and_get_output(conf, command='create', id_container=cid, use_popen=True, all_dev_null=True)
+            if proc.wait(timeout=60) == 0:
+                logger.info("create succeeded with run.oci.stdio_buffer_size=%s", value)
+                return -1
+        finally:
+            try:
+                run_crun_command(["delete", "-f", cid])
+            except:
+                pass
+    return 0
+
+
+def test_create_batch():
+    """Test creating multiple containers with create-batch."""
+    conf = base_config()
+    conf['process']['args'] = ['/init', 'pause']
+    add_all_namespaces(conf)
+
+    ids = []
+    args = []
+    bundles = []
+    try:
+        for i in range(4):
+            bundle = tempfile.mkdtemp(dir=get_tests_root())
+            bundles.append(bundle)
+            rootfs = os.path.join(bundle, "rootfs")
+            for d in ["proc", "sys", "dev", "tmp"]:
+                os.makedirs(os.path.join(rootfs, d))
+            shutil.copy2(get_init_path(), os.path.join(rootfs, "init"))
+            with open(os.path.join(bundle, "config.json"), "w") as f:
+                f.write(json.dumps(conf))
+            cid = 'test-batch-%s' % os.path.basename(bundle)
+            ids.append(cid)
+            args.append("%s=%s" % (cid, bundle))
+
+        cmd = [get_crun_path(), "--cgroup-manager", get_cgroup_manager(), "--root", get_tests_root_status(),
+               "create-batch", "--max-workers", "2"] + args
+        subprocess.run(cmd, stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+                       check=True, timeout=60)
+
+        for cid in ids:
+            state = json.loads(run_crun_command(["state", cid]))
+            if state['status'] != 'created':
+                logger.info("container %s in state %s", cid, state['status'])
+                return -1
+        return 0
+
+    except Exception as e:
+        logger.info("test failed: %s", e)
+        return -1
+    finally:
+        for cid in ids:
+            try:
+                run_crun_command(["delete", "-f", cid])
+            except:
+                pass
+        for bundle in bundles:
+            shutil.rmtree(bundle, ignore_errors=True)
+
+
+def _count_create_allocations(conf, n):
+    """Create N containers from CONF with tests/alloc_counter.c preloaded, that
+    counts the allocation calls in all the crun processes, including the
+    container init before it executes the container process.  Return the
+    allocation calls and the latency per container, or None when the counter
+    is not available."""
+    counter_lib = os.path.abspath(os.getenv("ALLOC_COUNTER") or "tests/.libs/liballoc_counter.so")
+    if not os.path.exists(counter_lib):
+        return None
+
+    bundle = tempfile.mkdtemp(dir=get_tests_root())
+    counter_fd, counter_file = tempfile.mkstemp(dir=get_tests_root())
+    os.close(counter_fd)
+    ids = []
+    try:
+        rootfs = os.path.join(bundle, "rootfs")
+        for d in ["proc", "sys", "dev", "tmp"]:
+            os.makedirs(os.path.join(rootfs, d))
+        shutil.copy2(get_init_path(), os.path.join(rootfs, "init"))
+        with open(os.path.join(bundle, "config.json"), "w") as f:
+            f.write(json.dumps(conf))
+
+        env = dict(os.environ)
+        env["LD_PRELOAD"] = counter_lib
+        env["CRUN_ALLOC_COUNTER_FILE"] = counter_file
+
+        elapsed = 0
+        for i in range(n):
+            cid = "test-alloc-%d-%s" % (i, os.path.basename(bundle))
+            cmd = [get_crun_path(), "--cgroup-manager", get_cgroup_manager(), "--root", get_tests_root_status(),
+                   "create", "--bundle", bundle, cid]
+            start = time.monotonic()
+            subprocess.run(cmd, env=env, stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL,
+                           stderr=subprocess.DEVNULL, check=True, timeout=60)
+            elapsed += time.monotonic() - start
+            ids.append(cid)
+
+        with open(counter_file, "rb") as f:
+            data = f.read()
+        if len(data) < 24:
+            return None
+        counters = struct.unpack("3Q", data[:24])
+        if counters[0] == 0:
+            return None
+        return sum(counters) // n, elapsed / n
+    finally:
+        for cid in ids:
+            try:
+                run_crun_command(["delete", "-f", cid])
+            except:
+                pass
+        shutil.rmtree(bundle, ignore_errors=True)
+        os.unlink(counter_file)
+
+
+def test_create_allocations():
+    """Check the allocations made by create for each mount.
+
+    The same container is created without additional mounts and with many
+    tmpfs mounts with options, as their setup makes many small allocations.
+    The difference, that includes parsing the mount from the configuration,
+    must stay under a fixed bound for each mount: the mount data is built
+    in the arena and must not cost an allocation for each option.
+
+    A tmpfs mount with five options costs about 70 allocations: about 40
+    to parse it into the yajl tree and the spec struct, about 10 for the
+    configuration snapshot and about 20 for the paths built while it is
+    mounted.  The bound leaves a small margin over that.
+    """
+    max_allocs_per_mount = 80
+    n_mounts = 30
+    n = 5
+
+    conf = base_config()
+    conf['process']['args'] = ['/init', 'true']
+    add_all_namespaces(conf)
+
+    mounts_conf = json.loads(json.dumps(conf))
+    for i in range(n_mounts):
+        mounts_conf['mounts'].append({"destination": "/tmp/mnt%d" % i, "type": "tmpfs", "source": "tmpfs",
+                                      "options": ["rw", "nosuid", "nodev", "size=%dk" % (64 + i), "nr_inodes=1000"]})
+
+    try:
+        base = _count_create_allocations(conf, n)
+        if base is None:
+            return (77, "the alloc counter is not available")
+        with_mounts = _count_create_allocations(mounts_conf, n)
+        if with_mounts is None:
+            return (77, "the alloc counter is not available")
+    except Exception as e:
+        logger.info("test failed: %s", e)
+        return -1
+
+    per_mount = (with_mounts[0] - base[0]) / n_mounts
+    logger.info("create: %d allocations, %.1f ms; with %d mounts: %d allocations, %.1f ms; %.1f allocations per mount",
+                base[0], base[1] * 1000, n_mounts, with_mounts[0], with_mounts[1] * 1000, per_mount)
+    if per_mount > max_allocs_per_mount:
+        logger.info("%.1f allocations per mount, expected at most %d", per_mount, max_allocs_per_mount)
+        return -1
+    return 0
+
+
 all_tests = {
     "create-start": test_create_start,
     "create-delete-without-start": test_create_delete_without_start,
+    "create-invalid-stdio-buffer-size": test_create_invalid_stdio_buffer_size,
     "create-with-annotations": test_create_with_annotations,
+    "create-batch": test_create_batch,
+    "create-allocations": test_create_allocations,
 }
 
 if __name__ == "__main__":
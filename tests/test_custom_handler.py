@@ -18,9 +18,13 @@
 # Tests for custom handler functionality
 
 import json
+import shutil
+import socket
 import subprocess
 import tempfile
 import os
+import re
+import time
 from tests_utils import *
 
 
@@ -219,6 +223,291 @@ def test_handler_annotation_multiple_types():
     return 0
 
 
+def _leb128(n):
+    out = bytearray()
+    while True:
+        byte = n & 0x7f
+        n >>= 7
+        if n:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def _wasm_module_header(padding_len):
+    """Build a module exporting an empty _start, followed by the header of a
+    custom section of PADDING_LEN bytes."""
+    def section(section_id, content):
+        return bytes([section_id]) + _leb128(len(content)) + content
+
+    name = b'pad'
+    custom = _leb128(len(name)) + name
+    return (b'\0asm' + b'\x01\0\0\0' +
+            section(1, b'\x01\x60\x00\x00') +
+            section(3, b'\x01\x00') +
+            section(7, b'\x01\x06_start\x00\x00') +
+            section(10, b'\x01\x02\x00\x0b') +
+            b'\0' + _leb128(len(custom) + padding_len) + custom)
+
+
+def _wasm_module(padding):
+    """Build a module exporting an empty _start, followed by a custom section of PADDING bytes."""
+    return _wasm_module_header(len(padding)) + padding
+
+
+def _wasm_config():
+    conf = base_config()
+    conf['process']['args'] = ['/module.wasm']
+    conf['annotations'] = {'run.oci.handler': 'wasm'}
+    add_all_namespaces(conf)
+    return conf
+
+
+def _wasm_bundle(conf, module):
+    bundle = tempfile.mkdtemp(dir=get_tests_root())
+    rootfs = os.path.join(bundle, "rootfs")
+    for d in ["proc", "sys", "dev", "tmp"]:
+        os.makedirs(os.path.join(rootfs, d))
+    with open(os.path.join(rootfs, 'module.wasm'), 'wb') as f:
+        f.write(module)
+    with open(os.path.join(bundle, "config.json"), "w") as f:
+        f.write(json.dumps(conf))
+    return bundle
+
+
+def _run_wasm_and_get_maxrss(bundle, conf):
+    """Run the container and return the peak RSS in KiB among crun and the
+    processes it waited for, that is the container.  crun is executed
+    directly and the test never holds the module in memory, so the memory
+    used by the test itself stays out of the measure."""
+    with open(os.path.join(bundle, "config.json"), "w") as f:
+        f.write(json.dumps(conf))
+    cid = 'test-wasm-rss-%s' % os.path.basename(bundle)
+    cmd = [get_crun_path(), "--cgroup-manager", get_cgroup_manager(), "--root", get_tests_root_status(),
+           "run", "--bundle", bundle, cid]
+    start = time.monotonic()
+    p = subprocess.Popen(cmd, stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL,
+                         stderr=subprocess.DEVNULL)
+    _, status, rusage = os.wait4(p.pid, 0)
+    elapsed = time.monotonic() - start
+    # The process is reaped already, do not let Popen wait for it.
+    p.returncode = os.waitstatus_to_exitcode(status)
+    if p.returncode != 0:
+        return None, elapsed
+    return rusage.ru_maxrss, elapsed
+
+
+def test_wasm_module_rss():
+    """Benchmark the peak RSS of a wasm container with a large module.
+
+    The module is mapped and handed to the engine in place, so the custom
+    section that the engine skips is never read.  The cold start compiles
+    the module and stores it in the cache, the warm start loads it from there.
+    """
+    features = get_crun_feature_string()
+    handlers = [i[len('+WASM:'):] for i in features.split() if i.startswith('+WASM:')]
+    if len(handlers) == 0:
+        return (77, "crun built without a wasm handler")
+
+    padding_mib = 64
+    conf = _wasm_config()
+
+    no_cache_conf = json.loads(json.dumps(conf))
+    no_cache_conf['annotations']['run.oci.wasm_cache'] = '0'
+
+    bundle = _wasm_bundle(conf, b'')
+    results = {}
+    try:
+        # Write the module in chunks, so it is never in the memory of the test.
+        with open(os.path.join(bundle, "rootfs", "module.wasm"), 'wb') as f:
+            f.write(_wasm_module_header(padding_mib * 1024 * 1024))
+            for i in range(padding_mib):
+                f.write(os.urandom(1024 * 1024))
+
+        for name, c in [('no-cache', no_cache_conf), ('cold', conf), ('warm', conf)]:
+            rss, elapsed = _run_wasm_and_get_maxrss(bundle, c)
+            if rss is None:
+                logger.info("wasm container failed to run (%s)", name)
+                return -1
+            results[name] = (rss, elapsed)
+    finally:
+        shutil.rmtree(bundle, ignore_errors=True)
+
+    for name, (rss, elapsed) in results.items():
+        logger.info("wasm %s %s start with a %d MiB module: peak RSS %d KiB, %.1f ms",
+                    ",".join(handlers), name, padding_mib, rss, elapsed * 1000)
+
+    # The module must not be copied in memory: the peak RSS stays well
+    # below its size.  wasmedge reads the module file by itself.
+    if 'wasmedge' not in handlers and results['no-cache'][0] > padding_mib * 1024:
+        logger.info("peak RSS %d KiB is bigger than the module", results['no-cache'][0])
+        return -1
+    return 0
+
+
+def _wasm_bundles(n, prefix):
+    conf = _wasm_config()
+    module = _wasm_module(b'')
+    bundles = []
+    for i in range(n):
+        bundle = _wasm_bundle(conf, module)
+        bundles.append(('%s-%s' % (prefix, os.path.basename(bundle)), bundle))
+    return bundles
+
+
+def test_wasm_cache():
+    """Test that the second run of a module uses the artifact compiled by the first one."""
+    features = get_crun_feature_string()
+    if not any(i.startswith('+WASM:') for i in features.split()):
+        return (77, "crun built without a wasm handler")
+
+    crun = [get_crun_path(), "--log-level=debug", "--cgroup-manager", get_cgroup_manager(),
+            "--root", get_tests_root_status()]
+    # The padding makes the module unknown to the cache.
+    bundle = _wasm_bundle(_wasm_config(), _wasm_module(os.urandom(4096)))
+    try:
+        outputs = []
+        for i in range(2):
+            cid = 'test-wasm-cache-%d-%s' % (i, os.path.basename(bundle))
+            p = subprocess.run(crun + ["run", "--bundle", bundle, cid], stdin=subprocess.DEVNULL,
+                               stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, timeout=60)
+            if p.returncode != 0:
+                logger.info("wasm container failed to run: %s", p.stderr)
+                return -1
+            outputs.append([l for l in p.stderr.decode(errors='replace').splitlines() if 'wasm cache: ' in l])
+
+        if len(outputs[0]) == 0:
+            return (77, "the wasm handler does not use the cache")
+        if ' miss for ' not in outputs[0][0]:
+            logger.info("the first run did not compile the module: %s", outputs[0])
+            return -1
+        if len(outputs[1]) == 0 or ' hit for ' not in outputs[1][0]:
+            logger.info("the second run did not use the cached artifact: %s", outputs[1])
+            return -1
+
+        # The counters are persistent, the hit is added to the same ones.
+        counters = [re.search(r'(\d+) hits, (\d+) misses', o[0]) for o in outputs]
+        if None in counters:
+            logger.info("the cache counters are missing: %s", outputs)
+            return -1
+        first, second = [(int(m.group(1)), int(m.group(2))) for m in counters]
+        if second != (first[0] + 1, first[1]):
+            logger.info("wrong cache counters: %s then %s", first, second)
+            return -1
+        return 0
+
+    except Exception as e:
+        logger.info("test failed: %s", e)
+        return -1
+    finally:
+        shutil.rmtree(bundle, ignore_errors=True)
+
+
+def _start_and_wait(ids, timeout=60):
+    for cid in ids:
+        run_crun_command(["start", cid])
+    deadline = time.monotonic() + timeout
+    pending = list(ids)
+    while pending:
+        if time.monotonic() > deadline:
+            raise Exception("containers %s did not stop" % pending)
+        state = json.loads(run_crun_command(["state", pending[0]]))
+        if state['status'] == 'stopped':
+            pending.pop(0)
+        else:
+            time.sleep(0.01)
+
+
+def _delete_containers(bundles):
+    for cid, bundle in bundles:
+        try:
+            run_crun_command(["delete", "-f", cid])
+        except:
+            pass
+        shutil.rmtree(bundle, ignore_errors=True)
+
+
+def test_wasm_host():
+    """Benchmark the wasm containers per second created through wasm-host.
+
+    The host keeps the handler loaded and every container is forked from
+    it, compare it with a crun create and crun start for each container.
+    """
+    features = get_crun_feature_string()
+    if not any(i.startswith('+WASM:') for i in features.split()):
+        return (77, "crun built without a wasm handler")
+
+    n = 16
+    crun = [get_crun_path(), "--cgroup-manager", get_cgroup_manager(), "--root", get_tests_root_status()]
+    sock_dir = tempfile.mkdtemp(dir=get_tests_root())
+    sock_path = os.path.join(sock_dir, "wasm-host.sock")
+    host_bundles = _wasm_bundles(n, 'test-wasm-host')
+    plain_bundles = _wasm_bundles(n, 'test-wasm-plain')
+    host = subprocess.Popen(crun + ["wasm-host", sock_path], stdin=subprocess.DEVNULL,
+                            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    try:
+        deadline = time.monotonic() + 10
+        while not os.path.exists(sock_path):
+            if host.poll() is not None or time.monotonic() > deadline:
+                logger.info("wasm-host did not start")
+                return -1
+            time.sleep(0.01)
+
+        start = time.monotonic()
+        with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as s:
+            s.connect(sock_path)
+            s.sendall(''.join('%s %s\n' % b for b in host_bundles).encode())
+            s.shutdown(socket.SHUT_WR)
+            replies = b''
+            while True:
+                data = s.recv(4096)
+                if not data:
+                    break
+                replies += data
+        replies = replies.decode().splitlines()
+        if len(replies) != n or not all(r.endswith(' ok') for r in replies):
+            logger.info("unexpected replies from wasm-host: %s", replies)
+            return -1
+        _start_and_wait([cid for cid, _ in host_bundles])
+        host_elapsed = time.monotonic() - start
+
+        start = time.monotonic()
+        for cid, bundle in plain_bundles:
+            subprocess.run(crun + ["create", "--bundle", bundle, cid], stdin=subprocess.DEVNULL,
+                           stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, check=True, timeout=60)
+        _start_and_wait([cid for cid, _ in plain_bundles])
+        plain_elapsed = time.monotonic() - start
+
+        logger.info("wasm-host: %.1f containers/s, create and start: %.1f containers/s",
+                    n / host_elapsed, n / plain_elapsed)
+
+        # A client that never completes its request is dropped after a
+        # timeout and does not block the next one.
+        with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as stalled:
+            stalled.connect(sock_path)
+            with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as s:
+                s.settimeout(60)
+                s.connect(sock_path)
+                s.sendall(b'test-wasm-host-invalid /nonexistent\n')
+                s.shutdown(socket.SHUT_WR)
+                reply = s.makefile().readline()
+        if not reply.startswith('test-wasm-host-invalid error'):
+            logger.info("unexpected reply after a stalled client: %s", reply)
+            return -1
+        return 0
+
+    except Exception as e:
+        logger.info("test failed: %s", e)
+        return -1
+    finally:
+        host.kill()
+        host.wait()
+        shutil.rmtree(sock_dir, ignore_errors=True)
+        _delete_containers(host_bundles)
+        _delete_containers(plain_bundles)
+
+
 all_tests = {
     "handler-sandbox-annotation": test_handler_sandbox_annotation,
     "handler-nonexistent": test_handler_nonexistent,
@@ -227,6 +516,9 @@ all_tests = {
     "handler-feature-tags": test_handler_feature_tags,
     "handler-empty-annotation": test_handler_empty_annotation,
     "handler-annotation-types": test_handler_annotation_multiple_types,
+    "wasm-cache": test_wasm_cache,
+    "wasm-module-rss": test_wasm_module_rss,
+    "wasm-host": test_wasm_host,
 }
 
 
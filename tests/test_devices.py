@@ -334,6 +334,49 @@ def test_net_devices():
 
     return 0
 
+def test_net_devices_batch():
+    if is_rootless():
+        return (77, "requires root privileges")
+
+    ip_path = shutil.which("ip")
+    if ip_path is None:
+        return (77, "ip command not found")
+
+    devices = 3
+    current_netns = os.open("/proc/self/ns/net", os.O_RDONLY)
+    try:
+        os.unshare(os.CLONE_NEWNET)
+
+        for i in range(devices):
+            result = subprocess.run(["ip", "link", "add", "name", "testveth%d" % i, "type", "veth", "peer", "name", "testpeer%d" % i], capture_output=True, text=True)
+            if result.returncode != 0:
+                logger.info("ip link add failed: %s", result.stderr)
+                return (77, "cannot create veth devices")
+            result = subprocess.run(["ip", "addr", "add", "10.1.%d.3/24" % i, "dev", "testveth%d" % i], capture_output=True, text=True)
+            if result.returncode != 0:
+                logger.info("ip addr add failed: %s", result.stderr)
+                return -1
+
+        conf = base_config()
+        add_all_namespaces(conf)
+        conf['process']['args'] = ['/init', 'ip'] + ["eth%d" % i for i in range(devices)]
+        conf['linux']['netDevices'] = {"testveth%d" % i: {"name": "eth%d" % i} for i in range(devices)}
+
+        try:
+            out = run_and_get_output(conf, hide_stderr=True)
+            for i in range(devices):
+                if "address: 10.1.%d.3/24" % i not in out[0]:
+                    logger.info("address for eth%d not found in output: %s", i, out[0])
+                    return -1
+        except Exception as e:
+            logger.info("test_net_devices_batch exception: %s", e)
+            return -1
+    finally:
+        os.setns(current_netns, os.CLONE_NEWNET)
+        os.close(current_netns)
+
+    return 0
+
 def test_mknod_fifo_device():
     if is_rootless():
         return (77, "requires root privileges")
@@ -435,6 +478,7 @@ all_tests = {
     "create-or-bind-mount-device" : test_create_or_bind_mount_device,
     "handle-device-trailing-slash" : test_trailing_slash_mknod_device,
     "net-devices" : test_net_devices,
+    "net-devices-batch" : test_net_devices_batch,
 }
 
 if __name__ == "__main__":
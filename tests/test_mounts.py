@@ -25,6 +25,7 @@ import json
 from tests_utils import *
 import tempfile
 import re
+import time
 from typing import List, Optional
 
 try:
@@ -854,6 +855,130 @@ def test_bind_mount_file_nofollow():
                 logger.info("error %s", e)
     return 0
 
+def _nsfs_mounts_in(directory):
+    """Return the mount points of type nsfs directly under DIRECTORY."""
+    found = set()
+    with open("/proc/self/mountinfo") as f:
+        for line in f:
+            fields = line.split()
+            fstype = fields[fields.index("-") + 1]
+            if fstype == "nsfs" and os.path.dirname(fields[4]) == directory:
+                found.add(fields[4])
+    return found
+
+def test_idmapped_mounts_many():
+    """Benchmark a container with 50 idmapped mounts using two mappings.
+
+    The mounts with the same mappings share the user namespace, so only two
+    user namespaces are created.  With run.oci.idmapped_mounts.share_userns
+    they are also shared through the state directory of the pod sandbox:
+    a second container in the same sandbox must use the nsfs bind mount
+    left by the first one instead of creating its own.
+    """
+    if is_rootless():
+        return (77, "requires root privileges")
+    source_dir = os.path.join(get_tests_root(), "test-idmapped-mounts-many")
+    sandbox_id = None
+    n_mounts = 50
+    try:
+        os.makedirs(source_dir)
+        target = os.path.join(source_dir, "file")
+
+        with open(target, "w+") as f:
+            f.write("")
+        os.chown(target, 0, 0)
+
+        idmapped_mounts_status = subprocess.call([get_init_path(), "check-feature", "idmapped-mounts", source_dir])
+        if idmapped_mounts_status != 0:
+            return (77, "idmapped mounts not supported")
+
+        template = base_config()
+        add_all_namespaces(template, userns=True)
+        fullMapping = [
+            {
+                "containerID": 0,
+                "hostID": 1,
+                "size": 10
+            }
+        ]
+        template['linux']['uidMappings'] = fullMapping
+        template['linux']['gidMappings'] = fullMapping
+
+        def add_mounts(conf, n_mappings):
+            for i in range(n_mounts):
+                mountMappings = [
+                    {
+                        "containerID": 0,
+                        "hostID": 2 + i % n_mappings,
+                        "size": 10
+                    }
+                ]
+                conf['mounts'].append({"destination": "/foo%d" % i, "type": "bind", "source": source_dir,
+                                       "options": ["bind", "ro", "idmap"],
+                                       "uidMappings": mountMappings, "gidMappings": mountMappings})
+
+        def run(conf, i, expected, **kwargs):
+            conf['process']['args'] = ['/init', 'owner', '/foo%d/file' % i]
+            start = time.monotonic()
+            out, cid = run_and_get_output(conf, chown_rootfs_to=1, **kwargs)
+            elapsed = time.monotonic() - start
+            if expected not in out:
+                logger.info("wrong file owner for /foo%d, found %s instead of %s", i, out, expected)
+                return None
+            return cid, elapsed
+
+        many = copy.deepcopy(template)
+        add_mounts(many, 2)
+        for share in [False, True]:
+            for i, expected in [(n_mounts - 2, "1:1"), (n_mounts - 1, "2:2")]:
+                conf = copy.deepcopy(many)
+                if share:
+                    conf.setdefault('annotations', {})["run.oci.idmapped_mounts.share_userns"] = "1"
+                result = run(conf, i, expected)
+                if result is None:
+                    return -1
+                logger.info("%d idmapped mounts on /foo%d (shared userns: %s): %.3fs", n_mounts, i, share, result[1])
+
+        # Two containers in the same sandbox, all the mounts with the same
+        # mappings.  The sandbox container is kept so its state directory,
+        # where the user namespace is shared, stays around.
+        sandbox_id = "test-idmapped-sandbox-%d" % os.getpid()
+        shared_dir = os.path.join(get_tests_root_status(), sandbox_id, "idmapped-userns")
+        same = copy.deepcopy(template)
+        add_mounts(same, 1)
+        same['annotations'] = {"run.oci.idmapped_mounts.share_userns": "1",
+                               "io.kubernetes.cri.sandbox-id": sandbox_id}
+
+        result = run(copy.deepcopy(same), 0, "1:1", id_container=sandbox_id, keep=True)
+        if result is None:
+            return -1
+        logger.info("%d idmapped mounts in the sandbox container: %.3fs", n_mounts, result[1])
+
+        shared = _nsfs_mounts_in(shared_dir)
+        if len(shared) != 1:
+            logger.info("expected one shared user namespace in %s, found %s", shared_dir, shared)
+            return -1
+        shared_path = shared.pop()
+        shared_ino = os.stat(shared_path).st_ino
+
+        result = run(copy.deepcopy(same), n_mounts - 1, "1:1")
+        if result is None:
+            return -1
+        logger.info("%d idmapped mounts in a container of the same sandbox: %.3fs", n_mounts, result[1])
+
+        if _nsfs_mounts_in(shared_dir) != {shared_path} or os.stat(shared_path).st_ino != shared_ino:
+            logger.info("the user namespace in %s was not shared", shared_dir)
+            return -1
+    finally:
+        if sandbox_id is not None:
+            try:
+                run_crun_command(["delete", "-f", sandbox_id])
+            except:
+                pass
+        shutil.rmtree(source_dir)
+
+    return 0
+
 def test_idmapped_mounts_without_userns():
     if is_rootless():
         return (77, "requires root privileges")
@@ -975,6 +1100,7 @@ all_tests = {
     "mount-path-with-multiple-slashes" : test_mount_path_with_multiple_slashes,
     "mount-userns-bind-mount" : test_userns_bind_mount,
     "mount-idmapped-mounts" : test_idmapped_mounts,
+    "mount-idmapped-mounts-many" : test_idmapped_mounts_many,
     "mount-idmapped-mounts-without-userns" : test_idmapped_mounts_without_userns,
     "mount-idmapped-mounts-symlink" : test_userns_bind_mount_symlink,
     "mount-linux-readonly-should-inherit-flags": test_mount_readonly_should_inherit_options_from_parent,
@@ -624,6 +624,52 @@ def test_domainname_with_uts_namespace():
         return -1
 
 
+def test_namespace_path_sandbox_pidfd():
+    """Test joining the namespaces of a pod sandbox with a single setns."""
+    if is_rootless():
+        return (77, "requires root privileges")
+
+    conf = base_config()
+    conf['process']['args'] = ['/init', 'pause']
+    add_all_namespaces(conf)
+
+    sandbox_cid = None
+    try:
+        _, sandbox_cid = run_and_get_output(conf, hide_stderr=True, command='run', detach=True)
+        state = json.loads(run_crun_command(["state", sandbox_cid]))
+        pid = state['pid']
+        sandbox_netns = os.readlink("/proc/%d/ns/net" % pid)
+
+        conf = base_config()
+        conf['process']['args'] = ['/init', 'readlink', '/proc/self/ns/net']
+        conf['annotations'] = {'io.kubernetes.cri-o.SandboxID': sandbox_cid}
+        conf['linux']['namespaces'] = [
+            {'type': 'mount'},
+            {'type': 'network', 'path': '/proc/%d/ns/net' % pid},
+            {'type': 'ipc', 'path': '/proc/%d/ns/ipc' % pid},
+            {'type': 'uts', 'path': '/proc/%d/ns/uts' % pid},
+        ]
+        out, _ = run_and_get_output(conf, debug=True)
+
+        if sandbox_netns not in out:
+            logger.info("network namespace `%s` not joined: %s", sandbox_netns, out)
+            return -1
+        if "trace: namespaces: 3 namespaces joined with a single setns" not in out:
+            logger.info("namespaces not joined through the sandbox pidfd: %s", out)
+            return -1
+        return 0
+
+    except Exception as e:
+        logger.info("test failed: %s", e)
+        return -1
+    finally:
+        if sandbox_cid is not None:
+            try:
+                run_crun_command(["delete", "-f", sandbox_cid])
+            except:
+                pass
+
+
 all_tests = {
     "pid-namespace": test_pid_namespace,
     "network-namespace": test_network_namespace,
@@ -637,6 +683,7 @@ all_tests = {
     "setgroups-deny": test_setgroups_deny,
     "multiple-uid-mappings": test_multiple_uid_mappings,
     "namespace-path-sharing": test_namespace_path_sharing,
+    "namespace-path-sandbox-pidfd": test_namespace_path_sandbox_pidfd,
     "hostname-without-uts": test_hostname_without_uts_namespace,
     "domainname-with-uts": test_domainname_with_uts_namespace,
 }
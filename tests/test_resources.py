@@ -15,9 +15,11 @@
 # You should have received a copy of the GNU General Public License
 # along with crun.  If not, see <http://www.gnu.org/licenses/>.
 
+import os
 import subprocess
 import sys
 import time
+import select
 import json
 from tests_utils import *
 import json
@@ -349,6 +351,133 @@ def test_resources_exec_cgroup():
     return 0
 
 
+def test_resources_stats():
+    if not is_cgroup_v2_unified() or is_rootless():
+        return (77, "requires cgroup v2 and root privileges")
+
+    conf = base_config()
+    add_all_namespaces(conf, cgroupns=True)
+    conf['process']['args'] = ['/init', 'pause']
+    conf['linux']['resources'] = {"pids" : {"limit" : 1024}}
+
+    cid = None
+    try:
+        _, cid = run_and_get_output(conf, hide_stderr=True, command='run', detach=True)
+        stats = json.loads(run_crun_command(["stats", cid]))
+        if stats["id"] != cid or stats["version"] < 1:
+            logger.info("wrong stats header: %s", stats)
+            return -1
+        if stats["pids"]["limit"] != 1024 or stats["pids"]["current"] < 1:
+            logger.info("wrong pids stats: %s", stats["pids"])
+            return -1
+        if "memory" in stats and stats["memory"]["usage"] == 0:
+            logger.info("wrong memory stats: %s", stats["memory"])
+            return -1
+
+        crun = get_crun_path()
+        proc = subprocess.Popen([crun, "--root", get_tests_root_status(), "stats", "--interval", "0.1", cid],
+                                stdout=subprocess.PIPE, close_fds=False)
+        try:
+            lines = [proc.stdout.readline() for i in range(2)]
+        finally:
+            proc.kill()
+            proc.wait()
+        for line in lines:
+            if json.loads(line)["pids"]["limit"] != 1024:
+                logger.info("wrong streamed stats: %s", line)
+                return -1
+    finally:
+        if cid is not None:
+            run_crun_command(["delete", "-f", cid])
+    return 0
+
+def test_resources_stats_all():
+    if not is_cgroup_v2_unified() or is_rootless():
+        return (77, "requires cgroup v2 and root privileges")
+
+    conf = base_config()
+    add_all_namespaces(conf, cgroupns=True)
+    conf['process']['args'] = ['/init', 'pause']
+
+    cid = None
+    try:
+        _, cid = run_and_get_output(conf, hide_stderr=True, command='run', detach=True)
+        out = run_crun_command(["stats", "--all"])
+        lines = out.splitlines()
+        if len(lines) == 0 or not lines[0].startswith("# "):
+            logger.info("wrong stats output: %s", out)
+            return -1
+        for line in lines[1:]:
+            fields = line.split(" ")
+            if fields[0] != cid:
+                continue
+            if len(fields) != 7 or int(fields[2]) == 0 or int(fields[6]) < 1:
+                logger.info("wrong stats line: %s", line)
+                return -1
+            return 0
+        logger.info("container %s not found in: %s", cid, out)
+        return -1
+    finally:
+        if cid is not None:
+            run_crun_command(["delete", "-f", cid])
+
+def test_resources_psi_triggers():
+    if not is_cgroup_v2_unified() or is_rootless():
+        return (77, "requires cgroup v2 and root privileges")
+    if not os.path.exists("/sys/fs/cgroup/memory.pressure"):
+        return (77, "PSI is not enabled")
+
+    conf = base_config()
+    add_all_namespaces(conf)
+    conf['process']['args'] = ['/init', 'echo', 'hi']
+    conf['annotations'] = {"run.oci.psi.memory" : "some 150000 1000000; full 500000 2000000"}
+
+    out, _ = run_and_get_output(conf, hide_stderr=True)
+    if "hi" not in out:
+        logger.info("unexpected output: %s", out)
+        return -1
+
+    conf['annotations'] = {"run.oci.psi.memory" : "some 2000000 1000000"}
+    proc, _ = run_and_get_output(conf, use_popen=True)
+    out, _ = proc.communicate()
+    if "stall time" not in out.decode():
+        logger.info("invalid trigger not detected: %s", out)
+        return -1
+
+    # Keep the container above memory.high so it is throttled, and read
+    # the event from the fd passed with --psi-fd.
+    conf['process']['args'] = ['/init', 'memhog', '128']
+    conf['linux']['resources'] = {"unified" : {"memory.high" : "16777216"}}
+    conf['annotations'] = {"run.oci.psi.memory" : "some 50000 1000000"}
+    r, w = os.pipe()
+    os.set_inheritable(w, True)
+    cid = None
+    proc = None
+    try:
+        proc, cid = run_and_get_output(conf, use_popen=True, all_dev_null=True, psi_fd=w)
+        os.close(w)
+        w = None
+        with os.fdopen(r, "r") as events:
+            r = None
+            ready, _, _ = select.select([events], [], [], 30)
+            if not ready:
+                logger.info("no PSI event received")
+                return -1
+            line = events.readline()
+        event = json.loads(line)
+        if event.get("type") != "psi" or event.get("id") != cid or event.get("resource") != "memory":
+            logger.info("wrong PSI event: %s", line)
+            return -1
+        return 0
+    finally:
+        for fd in (r, w):
+            if fd is not None:
+                os.close(fd)
+        if cid is not None:
+            run_crun_command(["delete", "-f", cid])
+        if proc is not None:
+            proc.wait()
+
 all_tests = {
     "resources-v2-swap-disabled": test_resources_cgroupv2_swap_0,
     "resources-pid-limit" : test_resources_pid_limit,
@@ -361,6 +490,9 @@ all_tests = {
     "resources-cpu-weight" : test_resources_cpu_weight,
     "resources-cpu-weight-systemd" : test_resources_cpu_weight_systemd,
     "resources-cpu-quota-minus-one" : test_resources_cpu_quota_minus_one,
+    "resources-stats" : test_resources_stats,
+    "resources-stats-all" : test_resources_stats_all,
+    "resources-psi-triggers" : test_resources_psi_triggers,
 }
 
 if __name__ == "__main__":
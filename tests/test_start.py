@@ -591,6 +591,67 @@ def test_systemd_cgroups_path_def_slice():
 
     return 0
 
+def test_sync_socket_messages():
+    if is_rootless():
+        return (77, "the handshake with a user namespace needs more messages")
+
+    conf = base_config()
+    conf['process']['args'] = ['/init', 'true']
+    add_all_namespaces(conf)
+
+    out, _ = run_and_get_output(conf, debug=True)
+
+    # The PID is sent with sync 1, mounts and devices share a single message.
+    max_messages = 7
+    for line in out.split("\n"):
+        if "trace: sync socket:" not in line:
+            continue
+        messages = int(line.split("trace: sync socket:")[1].split()[0])
+        if messages > max_messages:
+            logger.info("%d messages exchanged on the sync socket, expected at most %d", messages, max_messages)
+            return -1
+        return 0
+
+    logger.info("sync socket trace not found in the debug output")
+    return -1
+
+def test_zygote():
+    if is_rootless():
+        return (77, "requires root privileges")
+    conf = base_config()
+    conf['process']['args'] = ['/init', 'echo', 'hello']
+    conf['annotations'] = {'run.oci.zygote': '1'}
+    add_all_namespaces(conf)
+    cid = None
+    try:
+        proc, cid = run_and_get_output(conf, hide_stderr=True, command='create', use_popen=True)
+        for i in range(50):
+            try:
+                s = run_crun_command(["state", cid])
+                break
+            except Exception as e:
+                time.sleep(0.1)
+
+        # The zygote reports "created" even if its cgroup is frozen.
+        state = json.loads(run_crun_command(["state", cid]))
+        if state['status'] != 'created':
+            logger.info("unexpected state for the zygote: %s", state['status'])
+            return -1
+
+        start = time.monotonic()
+        run_crun_command(["start", "--env", "ZYGOTE=from-start", cid, "/init", "printenv", "ZYGOTE"])
+        out = proc.stdout.readline()
+        latency = time.monotonic() - start
+        proc.communicate()
+        if "from-start" not in str(out):
+            logger.info("unexpected output from the zygote: %s", out)
+            return -1
+        logger.info("zygote start-to-exec latency: %.2f ms", latency * 1000)
+    finally:
+        if cid is not None:
+            run_crun_command(["delete", "-f", cid])
+    return 0
+
 all_tests = {
     "start" : test_start,
     "start-override-config" : test_start_override_config,
@@ -613,6 +674,8 @@ all_tests = {
     "home-unknown-id": test_home_unknown_id,
     "help": test_start_help,
     "systemd-cgroups-path-def-slice": test_systemd_cgroups_path_def_slice,
+    "sync-socket-messages": test_sync_socket_messages,
+    "zygote": test_zygote,
 }
 
 if __name__ == "__main__":
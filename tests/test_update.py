@@ -17,7 +17,9 @@
 
 import json
 import os
+import shutil
 import subprocess
+import tempfile
 import time
 from tests_utils import *
 
@@ -555,6 +557,151 @@ def test_update_unified_resources():
             run_crun_command(["delete", "-f", cid])
 
 
+def test_update_batch():
+    """Benchmark 1000 updates with update-batch against one crun update for each."""
+    if is_rootless():
+        return (77, "requires root for cgroup update")
+    if not is_cgroup_v2_unified():
+        return (77, "requires cgroup v2")
+
+    conf = base_config()
+    add_all_namespaces(conf, cgroupns=True)
+    conf['process']['args'] = ['/init', 'pause']
+
+    n_containers = 50
+    n_rounds = 20
+    ids = []
+    resources_dir = tempfile.mkdtemp(dir=get_tests_root())
+    try:
+        for i in range(n_containers):
+            _, cid = run_and_get_output(conf, hide_stderr=True, command='run', detach=True)
+            ids.append(cid)
+
+        rounds = []
+        for r in range(n_rounds):
+            args = []
+            for i, cid in enumerate(ids):
+                path = os.path.join(resources_dir, "%d-%d.json" % (r, i))
+                with open(path, "w") as f:
+                    json.dump({"pids": {"limit": 100 + r * n_containers + i}}, f)
+                args.append("%s=%s" % (cid, path))
+            rounds.append(args)
+
+        n_updates = n_rounds * n_containers
+        start = time.monotonic()
+        for args in rounds:
+            run_crun_command(["update-batch"] + args)
+        batch_elapsed = time.monotonic() - start
+
+        for i, cid in enumerate(ids):
+            out = run_crun_command(['exec', cid, '/init', 'cat', '/sys/fs/cgroup/pids.max'])
+            expected = str(100 + (n_rounds - 1) * n_containers + i)
+            if out.strip() != expected:
+                logger.info("pids limit for %s is %s, expected %s", cid, out.strip(), expected)
+                return -1
+
+        n_single = 200
+        start = time.monotonic()
+        for i in range(n_single):
+            run_crun_command(["update", "--pids-limit", str(100 + i), ids[i % n_containers]])
+        single_elapsed = time.monotonic() - start
+
+        logger.info("update-batch: %d updates in %.1f ms (%.0f updates/s), update: %.0f updates/s",
+                    n_updates, batch_elapsed * 1000, n_updates / batch_elapsed, n_single / single_elapsed)
+        return 0
+
+    except Exception as e:
+        logger.info("test failed: %s", e)
+        return -1
+    finally:
+        for cid in ids:
+            run_crun_command(["delete", "-f", cid])
+        shutil.rmtree(resources_dir, ignore_errors=True)
+
+
+def test_update_invalid_value():
+    """Test that a value that is not a number is rejected."""
+    if is_rootless():
+        return (77, "requires root for cgroup update")
+
+    conf = base_config()
+    add_all_namespaces(conf, cgroupns=True)
+    conf['process']['args'] = ['/init', 'pause']
+
+    cid = None
+    try:
+        _, cid = run_and_get_output(conf, hide_stderr=True, command='run', detach=True)
+
+        for opt, value in [('--memory', '1G'), ('--cpu-period', '-1'), ('--pids-limit', '')]:
+            try:
+                run_crun_command_raw(['update', opt, value, cid])
+                logger.info("update %s %s did not fail", opt, value)
+                return -1
+            except subprocess.CalledProcessError:
+                pass
+
+        return 0
+
+    except Exception as e:
+        logger.info("test failed: %s", e)
+        return -1
+    finally:
+        if cid is not None:
+            run_crun_command(["delete", "-f", cid])
+
+
+def _systemd_property(scope, prop):
+    out = subprocess.check_output(['systemctl', 'show', '-P' + prop, scope], close_fds=False).decode().strip()
+    if out == '':
+        # crun prefers the user manager when there is one.
+        out = subprocess.check_output(['systemctl', '--user', 'show', '-P' + prop, scope], close_fds=False).decode().strip()
+    return out
+
+
+def test_update_systemd():
+    """Test that the values passed to crun update reach the systemd scope."""
+    if not is_cgroup_v2_unified() or is_rootless():
+        return (77, "requires cgroup v2 and root privileges")
+    if 'SYSTEMD' not in get_crun_feature_string():
+        return (77, "systemd support not compiled in")
+    if not running_on_systemd():
+        return (77, "not running on systemd")
+
+    conf = base_config()
+    add_all_namespaces(conf, cgroupns=True)
+    conf['process']['args'] = ['/init', 'pause']
+
+    cid = None
+    try:
+        _, cid = run_and_get_output(conf, hide_stderr=True, command='run', detach=True, cgroup_manager="systemd")
+        scope = json.loads(run_crun_command(['state', cid]))['systemd-scope']
+
+        run_crun_command(['update', '--cpu-share', '1024', '--pids-limit', '100',
+                          '--blkio-weight', '500', cid])
+
+        # 500 is converted from the BFQ range to IOWeight 4500.
+        for prop, expected in [('CPUWeight', '100'), ('TasksMax', '100'), ('IOWeight', '4500')]:
+            out = _systemd_property(scope, prop)
+            if out != expected:
+                logger.info("found wrong %s for the systemd scope: expected %s, got %s", prop, expected, out)
+                return -1
+
+        return 0
+
+    except subprocess.CalledProcessError as e:
+        output = e.output.decode('utf-8', errors='ignore') if e.output else ''
+        if "systemd" in output.lower() or "io" in output.lower():
+            return (77, "systemd cgroup manager not fully supported in this environment")
+        logger.info("test failed: %s", e)
+        return -1
+    except Exception as e:
+        logger.info("test failed: %s", e)
+        return -1
+    finally:
+        if cid is not None:
+            run_crun_command(["delete", "-f", cid])
+
+
 all_tests = {
     "update-memory-limit": test_update_memory_limit,
     "update-cpu-shares": test_update_cpu_shares,
@@ -569,6 +716,9 @@ all_tests = {
     "update-cpuset-mems": test_update_cpuset_mems,
     "update-multiple-resources": test_update_multiple_resources,
     "update-unified-resources": test_update_unified_resources,
+    "update-invalid-value": test_update_invalid_value,
+    "update-batch": test_update_batch,
+    "update-systemd": test_update_systemd,
 }
 
 if __name__ == "__main__":
@@ -0,0 +1,170 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <libcrun/annotations.h>
+#include <libcrun/string_map.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef int (*test) ();
+
+/* Test that every known annotation maps to its slot */
+static int
+test_known_annotations ()
+{
+  if (libcrun_annotation_slot ("run.oci.handler") != ANNOTATION_HANDLER)
+    return -1;
+
+  if (libcrun_annotation_slot ("run.oci.zygote") != ANNOTATION_ZYGOTE)
+    return -1;
+
+  if (libcrun_annotation_slot ("io.kubernetes.cri-o.SandboxID") != ANNOTATION_CRIO_SANDBOX_ID)
+    return -1;
+
+  if (libcrun_annotation_slot ("module.wasm.image/variant") != ANNOTATION_MODULE_WASM_VARIANT)
+    return -1;
+
+  if (libcrun_annotation_slot ("run.oci.seccomp_fail_unknown_syscall") != ANNOTATION_SECCOMP_FAIL_UNKNOWN_SYSCALL)
+    return -1;
+
+  return 0;
+}
+
+/* Test that unknown annotations have no slot */
+static int
+test_unknown_annotations ()
+{
+  if (libcrun_annotation_slot ("") != -1)
+    return -1;
+
+  if (libcrun_annotation_slot ("run.oci.") != -1)
+    return -1;
+
+  if (libcrun_annotation_slot ("run.oci.handlers") != -1)
+    return -1;
+
+  if (libcrun_annotation_slot ("RUN.OCI.HANDLER") != -1)
+    return -1;
+
+  return 0;
+}
+
+/* Test lookups of known and unknown keys in a string map */
+static int
+test_string_map_lookup ()
+{
+  char *keys[] = { "org.systemd.property.TimeoutStopUSec", "run.oci.handler", "com.example.b", "com.example.a", "run.oci.psi.io" };
+  char *values[] = { "uint64 10", "wasm", "b", "a", "some 10 1000" };
+  json_map_string_string jmap = {
+    .keys = keys,
+    .values = values,
+    .len = sizeof (keys) / sizeof (keys[0]),
+  };
+  const char *name, *value, *prev = NULL;
+  string_map *map;
+  size_t i;
+  int ret = 0;
+
+  map = make_string_map_from_json (&jmap);
+
+  if (string_map_size (map) != jmap.len)
+    ret = -1;
+
+  value = find_string_map_known_value (map, ANNOTATION_HANDLER);
+  if (value == NULL || strcmp (value, "wasm") != 0)
+    ret = -1;
+
+  value = find_string_map_value (map, "run.oci.psi.io");
+  if (value == NULL || strcmp (value, "some 10 1000") != 0)
+    ret = -1;
+
+  value = find_string_map_value (map, "com.example.a");
+  if (value == NULL || strcmp (value, "a") != 0)
+    ret = -1;
+
+  if (find_string_map_known_value (map, ANNOTATION_ZYGOTE) != NULL)
+    ret = -1;
+
+  if (find_string_map_value (map, "com.example.c") != NULL)
+    ret = -1;
+
+  /* All the keys, known or not, are still visible when iterating.  */
+  for (i = 0; i < string_map_size (map); i++)
+    {
+      if (string_map_get_at (map, i, &name, &value) < 0)
+        ret = -1;
+      else if (prev && strcmp (prev, name) >= 0)
+        ret = -1;
+      prev = name;
+    }
+
+  free_string_map (map);
+  return ret;
+}
+
+/* Test that a map without annotations has no known values */
+static int
+test_empty_string_map ()
+{
+  string_map *map;
+  int ret = 0;
+
+  map = make_string_map_from_json (NULL);
+
+  if (find_string_map_known_value (map, ANNOTATION_HANDLER) != NULL)
+    ret = -1;
+
+  if (find_string_map_value (map, "run.oci.handler") != NULL)
+    ret = -1;
+
+  free_string_map (map);
+  return ret;
+}
+
+static void
+run_and_print_test_result (const char *name, int id, test t)
+{
+  int ret = t ();
+  if (ret == 0)
+    printf ("ok %d - %s\n", id, name);
+  else if (ret == 77)
+    printf ("ok %d - %s #SKIP\n", id, name);
+  else
+    printf ("not ok %d - %s\n", id, name);
+}
+
+#define RUN_TEST(T)                            \
+  do                                           \
+    {                                          \
+      run_and_print_test_result (#T, id++, T); \
+    }                                          \
+  while (0)
+
+int
+main ()
+{
+  int id = 1;
+  printf ("1..4\n");
+  RUN_TEST (test_known_annotations);
+  RUN_TEST (test_unknown_annotations);
+  RUN_TEST (test_string_map_lookup);
+  RUN_TEST (test_empty_string_map);
+  return 0;
+}
@@ -0,0 +1,138 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libcrun/arena.h>
+#include <libcrun/utils.h>
+
+typedef int (*test) ();
+
+static int
+test_arena_alloc ()
+{
+  cleanup_arena struct libcrun_arena_s *arena = libcrun_arena_new ();
+  char *prev = NULL;
+  size_t i;
+
+  for (i = 0; i < 1000; i++)
+    {
+      char *p = libcrun_arena_alloc (arena, 1 + i % 13);
+
+      if ((uintptr_t) p % _Alignof (max_align_t))
+        return -1;
+
+      memset (p, 'a', 1 + i % 13);
+      if (prev && prev[0] != 'a')
+        return -1;
+      prev = p;
+    }
+
+  /* 1000 small allocations fit in a few chunks.  */
+  if (libcrun_arena_get_chunks (arena) > 4)
+    return -1;
+
+  return 0;
+}
+
+static int
+test_arena_strings ()
+{
+  cleanup_arena struct libcrun_arena_s *arena = libcrun_arena_new ();
+  char long_string[10000];
+  char *s, *t;
+  size_t i;
+
+  s = libcrun_arena_strdup (arena, "rw,nosuid");
+  if (strcmp (s, "rw,nosuid") != 0)
+    return -1;
+
+  for (i = 0; i < 2000; i++)
+    {
+      t = libcrun_arena_asprintf (arena, "%s,mode=%zu", s, i);
+      if (strncmp (t, "rw,nosuid,mode=", 15) != 0 || strtoul (t + 15, NULL, 10) != i)
+        return -1;
+    }
+
+  memset (long_string, 'x', sizeof (long_string) - 1);
+  long_string[sizeof (long_string) - 1] = '\0';
+
+  t = libcrun_arena_asprintf (arena, "%s%s", s, long_string);
+  if (strlen (t) != strlen (s) + strlen (long_string) || strncmp (t, s, strlen (s)) != 0)
+    return -1;
+
+  /* S was not overwritten.  */
+  if (strcmp (s, "rw,nosuid") != 0)
+    return -1;
+
+  return 0;
+}
+
+static int
+test_arena_big_alloc ()
+{
+  cleanup_arena struct libcrun_arena_s *arena = libcrun_arena_new ();
+  char *a, *b, *c;
+
+  a = libcrun_arena_alloc (arena, 16);
+  b = libcrun_arena_alloc (arena, 1 << 20);
+  c = libcrun_arena_alloc (arena, 16);
+
+  memset (b, 0, 1 << 20);
+
+  /* The big allocation has its own chunk, the small ones share the first.  */
+  if (libcrun_arena_get_chunks (arena) != 2)
+    return -1;
+
+  if (c != a + 16)
+    return -1;
+
+  return 0;
+}
+
+static void
+run_and_print_test_result (const char *name, int id, test t)
+{
+  int ret = t ();
+  if (ret == 0)
+    printf ("ok %d - %s\n", id, name);
+  else if (ret == 77)
+    printf ("ok %d - %s #SKIP\n", id, name);
+  else
+    printf ("not ok %d - %s\n", id, name);
+}
+
+#define RUN_TEST(T)                            \
+  do                                           \
+    {                                          \
+      run_and_print_test_result (#T, id++, T); \
+  } while (0)
+
+int
+main ()
+{
+  int id = 1;
+  printf ("1..3\n");
+  RUN_TEST (test_arena_alloc);
+  RUN_TEST (test_arena_strings);
+  RUN_TEST (test_arena_big_alloc);
+  return 0;
+}
@@ -20,7 +20,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
 #include <libcrun/cgroup-internal.h>
+#include <libcrun/trace.h>
+#include <libcrun/utils.h>
 
 typedef int (*test) ();
 
@@ -268,6 +272,127 @@ test_read_proc_cgroup_selective ()
   return 0;
 }
 
+static int
+make_cgroup_dir (char *dir, const char *name, const char *content)
+{
+  libcrun_error_t err = NULL;
+  int dirfd;
+
+  if (mkdtemp (dir) == NULL)
+    return -1;
+
+  dirfd = open (dir, O_DIRECTORY | O_CLOEXEC);
+  if (dirfd < 0)
+    return -1;
+
+  if (write_file_at_with_flags (dirfd, O_CREAT | O_TRUNC, 0600, name, content, strlen (content), &err) < 0)
+    {
+      crun_error_release (&err);
+      close (dirfd);
+      return -1;
+    }
+  return dirfd;
+}
+
+static void
+remove_cgroup_dir (char *dir, int dirfd, const char *name)
+{
+  unlinkat (dirfd, name, 0);
+  close (dirfd);
+  rmdir (dir);
+}
+
+/* Test that a value already in the file is not written again */
+static int
+test_cgroup_writer_skip_unchanged ()
+{
+  struct cgroup_writer_s w;
+  char dir[] = "/tmp/crun-cgroup-test.XXXXXX";
+  libcrun_error_t err = NULL;
+  int ret = -1;
+  int dirfd;
+
+  dirfd = make_cgroup_dir (dir, "pids.max", "100\n");
+  if (dirfd < 0)
+    return -1;
+
+  cgroup_writer_init (&w, dirfd, true);
+  w.skip_unchanged = true;
+  libcrun_trace_counter_reset (LIBCRUN_TRACE_CGROUP_WRITES);
+  libcrun_trace_counter_reset (LIBCRUN_TRACE_CGROUP_WRITES_SKIPPED);
+
+  if (cgroup_writer_write (&w, "pids.max", NULL, "100", 3, &err) != 3)
+    goto exit;
+  if (libcrun_trace_counter_get (LIBCRUN_TRACE_CGROUP_WRITES_SKIPPED) != 1)
+    goto exit;
+  if (libcrun_trace_counter_get (LIBCRUN_TRACE_CGROUP_WRITES) != 0)
+    goto exit;
+
+  if (cgroup_writer_write (&w, "pids.max", NULL, "200", 3, &err) != 3)
+    goto exit;
+  if (libcrun_trace_counter_get (LIBCRUN_TRACE_CGROUP_WRITES) != 1)
+    goto exit;
+
+  /* The file is opened only once.  */
+  if (w.files_len != 1)
+    goto exit;
+
+  /* Without skip_unchanged the value is written without reading the file.  */
+  cgroup_writer_release (&w);
+  cgroup_writer_init (&w, dirfd, true);
+  if (cgroup_writer_write (&w, "pids.max", NULL, "200", 3, &err) != 3)
+    goto exit;
+  if (libcrun_trace_counter_get (LIBCRUN_TRACE_CGROUP_WRITES) != 2)
+    goto exit;
+
+  ret = 0;
+exit:
+  if (err)
+    crun_error_release (&err);
+  cgroup_writer_release (&w);
+  remove_cgroup_dir (dir, dirfd, "pids.max");
+  return ret;
+}
+
+/* Test that the alias is used when the file does not exist */
+static int
+test_cgroup_writer_alias ()
+{
+  cleanup_free char *content = NULL;
+  struct cgroup_writer_s w;
+  char dir[] = "/tmp/crun-cgroup-test.XXXXXX";
+  libcrun_error_t err = NULL;
+  int ret = -1;
+  int dirfd;
+
+  dirfd = make_cgroup_dir (dir, "cpus", "\n");
+  if (dirfd < 0)
+    return -1;
+
+  cgroup_writer_init (&w, dirfd, false);
+
+  if (cgroup_writer_write (&w, "cpuset.cpus", "cpus", "0-1", 3, &err) != 3)
+    goto exit;
+
+  if (read_all_file_at (dirfd, "cpus", &content, NULL, &err) < 0)
+    goto exit;
+  if (strncmp (content, "0-1", 3) != 0)
+    goto exit;
+
+  /* A missing file without an alias is an error.  */
+  if (cgroup_writer_write (&w, "cpuset.mems", NULL, "0", 1, &err) >= 0)
+    goto exit;
+  crun_error_release (&err);
+
+  ret = 0;
+exit:
+  if (err)
+    crun_error_release (&err);
+  cgroup_writer_release (&w);
+  remove_cgroup_dir (dir, dirfd, "cpus");
+  return ret;
+}
+
 static void
 run_and_print_test_result (const char *name, int id, test t)
 {
@@ -290,7 +415,7 @@ int
 main ()
 {
   int id = 1;
-  printf ("1..8\n");
+  printf ("1..10\n");
   RUN_TEST (test_read_proc_cgroup_v2);
   RUN_TEST (test_read_proc_cgroup_v1);
   RUN_TEST (test_read_proc_cgroup_empty);
@@ -299,5 +424,7 @@ main ()
   RUN_TEST (test_convert_shares_boundary);
   RUN_TEST (test_read_proc_cgroup_null_params);
   RUN_TEST (test_read_proc_cgroup_selective);
+  RUN_TEST (test_cgroup_writer_skip_unchanged);
+  RUN_TEST (test_cgroup_writer_alias);
   return 0;
 }
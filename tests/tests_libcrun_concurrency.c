@@ -0,0 +1,273 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <libcrun/container.h>
+#include <libcrun/utils.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#if HAVE_STDATOMIC_H
+#  include <stdatomic.h>
+#else
+#  define atomic_int volatile int
+#endif
+
+typedef int (*test) ();
+
+#define STRESS_THREADS 64
+#define STRESS_ITERATIONS 4
+
+struct stress_thread_s
+{
+  pthread_t thread;
+  char prefix[32];
+  const char *config;
+  const char *state_root;
+  const char *bundle;
+
+  int failures;
+  /* Messages about this thread's containers, and messages about the
+     containers of another thread received by its output handler.  The
+     handler can be called from the helper threads of the operation.  */
+  atomic_int seen;
+  atomic_int misrouted;
+};
+
+static void
+stress_output_handler (int errno_, const char *msg, int verbosity, void *arg)
+{
+  struct stress_thread_s *t = arg;
+
+  if (strstr (msg, "stress-") == NULL)
+    return;
+
+  if (strstr (msg, t->prefix))
+    t->seen++;
+  else
+    t->misrouted++;
+}
+
+static int
+create_and_delete (struct stress_thread_s *t, int iteration)
+{
+  libcrun_container_t *container = NULL;
+  libcrun_context_t context = {};
+  libcrun_error_t err = NULL;
+  char id[64];
+  int ret;
+
+  snprintf (id, sizeof (id), "%s%d", t->prefix, iteration);
+
+  context.state_root = t->state_root;
+  context.id = id;
+  context.bundle = t->bundle;
+  context.fifo_exec_wait_fd = -1;
+  context.psi_fd = -1;
+  context.force_no_cgroup = true;
+  context.output_handler = stress_output_handler;
+  context.output_handler_arg = t;
+
+  container = libcrun_container_load_from_memory (t->config, &err);
+  if (container == NULL)
+    goto fail;
+
+  ret = libcrun_container_create (&context, container, 0, &err);
+  if (ret < 0)
+    goto fail;
+
+  ret = libcrun_container_delete (&context, NULL, id, true, &err);
+  if (ret < 0)
+    goto fail;
+
+  libcrun_container_free (container);
+  return 0;
+
+fail:
+  if (err)
+    {
+      fprintf (stderr, "# %s: %s\n", id, err->msg);
+      crun_error_release (&err);
+    }
+  libcrun_container_free (container);
+  return -1;
+}
+
+static void *
+stress_thread (void *arg)
+{
+  struct stress_thread_s *t = arg;
+  int i;
+
+  for (i = 0; i < STRESS_ITERATIONS; i++)
+    if (create_and_delete (t, i) < 0)
+      t->failures++;
+
+  return NULL;
+}
+
+static int
+copy_init (const char *init, const char *rootfs)
+{
+  cleanup_free char *content = NULL;
+  cleanup_free char *dest = NULL;
+  libcrun_error_t err = NULL;
+  size_t len;
+  int ret;
+
+  ret = read_all_file (init, &content, &len, &err);
+  if (ret < 0)
+    goto fail;
+
+  xasprintf (&dest, "%s/init", rootfs);
+  ret = write_file (dest, content, len, &err);
+  if (ret < 0)
+    goto fail;
+
+  return chmod (dest, 0755);
+
+fail:
+  crun_error_release (&err);
+  return -1;
+}
+
+/* Test that many threads can create and delete containers at the same time,
+   each with its own context and its own output handler.  */
+static int
+test_concurrent_create_delete ()
+{
+  static struct stress_thread_s threads[STRESS_THREADS];
+  char tmpdir[] = "/tmp/crun-stress-XXXXXX";
+  cleanup_free char *rootfs = NULL;
+  cleanup_free char *state_root = NULL;
+  cleanup_free char *config = NULL;
+  cleanup_free char *init = NULL;
+  struct stress_thread_s probe = {};
+  const char *init_path;
+  int i, ret = -1;
+
+  if (geteuid () != 0)
+    return 77;
+
+  init_path = getenv ("INIT");
+  if (init_path == NULL)
+    init_path = "tests/init";
+  init = realpath (init_path, NULL);
+  if (init == NULL)
+    return 77;
+
+  if (mkdtemp (tmpdir) == NULL)
+    return -1;
+
+  xasprintf (&rootfs, "%s/rootfs", tmpdir);
+  xasprintf (&state_root, "%s/run", tmpdir);
+  if (mkdir (rootfs, 0755) < 0 || mkdir (state_root, 0700) < 0)
+    goto exit;
+  if (copy_init (init, rootfs) < 0)
+    goto exit;
+
+  xasprintf (&config,
+             "{\"ociVersion\": \"1.0.0\", \"root\": {\"path\": \"%s\"},"
+             " \"process\": {\"cwd\": \"/\", \"user\": {\"uid\": 0, \"gid\": 0}, \"args\": [\"/init\", \"true\"],"
+             " \"env\": [\"PATH=/\"]},"
+             " \"linux\": {\"namespaces\": [{\"type\": \"mount\"}]}}",
+             rootfs);
+
+  libcrun_set_verbosity (LIBCRUN_VERBOSITY_DEBUG);
+
+  /* Containers cannot be created in this environment at all.  */
+  snprintf (probe.prefix, sizeof (probe.prefix), "stress-probe-");
+  probe.config = config;
+  probe.state_root = state_root;
+  probe.bundle = tmpdir;
+  if (create_and_delete (&probe, 0) < 0)
+    {
+      ret = 77;
+      goto exit;
+    }
+
+  for (i = 0; i < STRESS_THREADS; i++)
+    {
+      snprintf (threads[i].prefix, sizeof (threads[i].prefix), "stress-%d-", i);
+      threads[i].config = config;
+      threads[i].state_root = state_root;
+      threads[i].bundle = tmpdir;
+      if (pthread_create (&threads[i].thread, NULL, stress_thread, &threads[i]) != 0)
+        goto exit;
+    }
+
+  ret = 0;
+  for (i = 0; i < STRESS_THREADS; i++)
+    {
+      pthread_join (threads[i].thread, NULL);
+      if (threads[i].failures || threads[i].misrouted || threads[i].seen == 0)
+        {
+          fprintf (stderr, "# thread %d: %d failures, %d messages, %d misrouted\n", i, threads[i].failures,
+                   threads[i].seen, threads[i].misrouted);
+          ret = -1;
+        }
+    }
+
+exit:
+  libcrun_set_verbosity (LIBCRUN_VERBOSITY_ERROR);
+  if (rootfs)
+    {
+      cleanup_free char *dest = NULL;
+
+      xasprintf (&dest, "%s/init", rootfs);
+      unlink (dest);
+      rmdir (rootfs);
+    }
+  if (state_root)
+    rmdir (state_root);
+  rmdir (tmpdir);
+  return ret;
+}
+
+static void
+run_and_print_test_result (const char *name, int id, test t)
+{
+  int ret = t ();
+  if (ret == 0)
+    printf ("ok %d - %s\n", id, name);
+  else if (ret == 77)
+    printf ("ok %d - %s #SKIP\n", id, name);
+  else
+    printf ("not ok %d - %s\n", id, name);
+}
+
+#define RUN_TEST(T)                            \
+  do                                           \
+    {                                          \
+      run_and_print_test_result (#T, id++, T); \
+    }                                          \
+  while (0)
+
+int
+main ()
+{
+  int id = 1;
+  printf ("1..1\n");
+  RUN_TEST (test_concurrent_create_delete);
+  return 0;
+}
@@ -0,0 +1,373 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <libcrun/config_snapshot.h>
+#include <libcrun/utils.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <yajl/yajl_tree.h>
+
+typedef int (*test) ();
+
+/* The version follows the 8 bytes of the magic.  */
+#define VERSION_OFFSET 8
+
+static const char *documents[]
+    = { "{}",
+        "[]",
+        "\"string\"",
+        "{\"ociVersion\": \"1.0.0\", \"root\": {\"path\": \"rootfs\", \"readonly\": true}, \"hostname\": \"\"}",
+        "{\"numbers\": [0, -1, 9223372036854775807, 1.5, -2.5e-3, 1e400], \"null\": null, \"false\": false}",
+        "{\"nested\": [[[{\"a\": [{}, [], {\"b\": \"c\"}]}]]], \"empty\": {}, \"unicode\": \"\\u00e8\\u20ac\"}",
+        NULL };
+
+static bool
+same_tree (yajl_val a, yajl_val b)
+{
+  size_t i;
+
+  if (a->type != b->type)
+    return false;
+
+  switch (a->type)
+    {
+    case yajl_t_string:
+      return strcmp (a->u.string, b->u.string) == 0;
+
+    case yajl_t_number:
+      return strcmp (a->u.number.r, b->u.number.r) == 0 && a->u.number.flags == b->u.number.flags
+             && a->u.number.i == b->u.number.i && memcmp (&a->u.number.d, &b->u.number.d, sizeof (double)) == 0;
+
+    case yajl_t_object:
+      if (a->u.object.len != b->u.object.len)
+        return false;
+      for (i = 0; i < a->u.object.len; i++)
+        if (strcmp (a->u.object.keys[i], b->u.object.keys[i]) != 0
+            || ! same_tree (a->u.object.values[i], b->u.object.values[i]))
+          return false;
+      return true;
+
+    case yajl_t_array:
+      if (a->u.array.len != b->u.array.len)
+        return false;
+      for (i = 0; i < a->u.array.len; i++)
+        if (! same_tree (a->u.array.values[i], b->u.array.values[i]))
+          return false;
+      return true;
+
+    default:
+      return true;
+    }
+}
+
+/* Build a configuration of about SIZE bytes.  */
+static char *
+make_config (size_t size)
+{
+  size_t i, off = 0, allocated = size + 4096;
+  char *buf = xmalloc (allocated);
+
+#define APPEND(...)                                                       \
+  do                                                                      \
+    {                                                                     \
+      int n = snprintf (buf + off, allocated - off, __VA_ARGS__);         \
+      if ((size_t) n >= allocated - off)                                  \
+        {                                                                 \
+          allocated = allocated * 2 + n;                                  \
+          buf = xrealloc (buf, allocated);                                \
+          n = snprintf (buf + off, allocated - off, __VA_ARGS__);         \
+        }                                                                 \
+      off += n;                                                           \
+    }                                                                     \
+  while (0)
+
+  APPEND ("{\"ociVersion\": \"1.0.0\", \"root\": {\"path\": \"rootfs\"},"
+          " \"process\": {\"cwd\": \"/\", \"user\": {\"uid\": 0, \"gid\": 0}, \"args\": [\"/init\"], \"env\": [");
+  for (i = 0; off < size / 2; i++)
+    APPEND ("%s\"VARIABLE_%zu=%080zu\"", i ? ", " : "", i, i);
+  APPEND ("]}, \"mounts\": [");
+  for (i = 0; off < size; i++)
+    APPEND ("%s{\"destination\": \"/mnt/volume-%zu\", \"type\": \"bind\", \"source\": \"/var/lib/volumes/%zu\","
+            " \"options\": [\"rbind\", \"rw\", \"nosuid\", \"nodev\"]}",
+            i ? ", " : "", i, i);
+  APPEND ("], \"linux\": {\"resources\": {\"pids\": {\"limit\": 1024}}}}");
+
+#undef APPEND
+
+  return buf;
+}
+
+static double
+now ()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+encode (const char *json, yajl_val *tree, char **out, size_t *out_len)
+{
+  libcrun_error_t err = NULL;
+
+  *tree = yajl_tree_parse (json, NULL, 0);
+  if (*tree == NULL)
+    return -1;
+
+  if (libcrun_config_snapshot_encode (*tree, out, out_len, &err) < 0)
+    {
+      crun_error_release (&err);
+      yajl_tree_free (*tree);
+      return -1;
+    }
+  return 0;
+}
+
+/* Test that the decoded tree is the same as the encoded one */
+static int
+test_snapshot_round_trip ()
+{
+  libcrun_error_t err = NULL;
+  size_t i;
+
+  for (i = 0; documents[i]; i++)
+    {
+      struct libcrun_config_snapshot_s *snapshot = NULL;
+      cleanup_free char *data = NULL;
+      yajl_val tree;
+      size_t len;
+      bool same;
+
+      if (encode (documents[i], &tree, &data, &len) < 0)
+        return -1;
+
+      if (libcrun_config_snapshot_from_memory (data, len, &snapshot, &err) != 1)
+        {
+          crun_error_release (&err);
+          yajl_tree_free (tree);
+          return -1;
+        }
+
+      same = same_tree (tree, libcrun_config_snapshot_tree (snapshot));
+      libcrun_config_snapshot_free (snapshot);
+      yajl_tree_free (tree);
+      if (! same)
+        return -1;
+    }
+  return 0;
+}
+
+/* Test that a corrupted or truncated snapshot is never loaded */
+static int
+test_snapshot_corrupted ()
+{
+  struct libcrun_config_snapshot_s *snapshot = NULL;
+  cleanup_free char *data = NULL;
+  libcrun_error_t err = NULL;
+  size_t i, len;
+  yajl_val tree;
+  int ret;
+
+  if (encode (documents[4], &tree, &data, &len) < 0)
+    return -1;
+  yajl_tree_free (tree);
+
+  for (i = 0; i < len; i++)
+    {
+      data[i] ^= 0x20;
+      ret = libcrun_config_snapshot_from_memory (data, len, &snapshot, &err);
+      data[i] ^= 0x20;
+      if (ret == 1)
+        {
+          libcrun_config_snapshot_free (snapshot);
+          return -1;
+        }
+      crun_error_release (&err);
+    }
+
+  for (i = 0; i < len; i++)
+    {
+      ret = libcrun_config_snapshot_from_memory (data, i, &snapshot, &err);
+      if (ret == 1)
+        {
+          libcrun_config_snapshot_free (snapshot);
+          return -1;
+        }
+      crun_error_release (&err);
+    }
+
+  return 0;
+}
+
+/* Test that a snapshot from a different version is ignored */
+static int
+test_snapshot_version ()
+{
+  struct libcrun_config_snapshot_s *snapshot = NULL;
+  cleanup_free char *data = NULL;
+  libcrun_error_t err = NULL;
+  uint32_t version = LIBCRUN_CONFIG_SNAPSHOT_VERSION + 1;
+  yajl_val tree;
+  size_t len;
+  int ret;
+
+  if (encode (documents[3], &tree, &data, &len) < 0)
+    return -1;
+  yajl_tree_free (tree);
+
+  memcpy (data + VERSION_OFFSET, &version, sizeof (version));
+  ret = libcrun_config_snapshot_from_memory (data, len, &snapshot, &err);
+  if (ret != 0 || snapshot != NULL || err != NULL)
+    {
+      crun_error_release (&err);
+      libcrun_config_snapshot_free (snapshot);
+      return -1;
+    }
+  return 0;
+}
+
+/* Test that a snapshot is mapped from a file, and a missing one is not an
+   error */
+static int
+test_snapshot_file ()
+{
+  struct libcrun_config_snapshot_s *snapshot = NULL;
+  char path[] = "/tmp/crun-snapshot-XXXXXX";
+  cleanup_free char *data = NULL;
+  libcrun_error_t err = NULL;
+  yajl_val tree;
+  size_t len;
+  int fd, ret = -1;
+
+  if (encode (documents[5], &tree, &data, &len) < 0)
+    return -1;
+
+  fd = mkstemp (path);
+  if (fd < 0)
+    goto exit;
+  close (fd);
+
+  if (write_file (path, data, len, &err) < 0)
+    goto exit;
+
+  if (libcrun_config_snapshot_open (path, &snapshot, &err) != 1)
+    goto exit;
+  if (! same_tree (tree, libcrun_config_snapshot_tree (snapshot)))
+    goto exit;
+
+  unlink (path);
+  libcrun_config_snapshot_free (snapshot);
+  snapshot = NULL;
+
+  if (libcrun_config_snapshot_open (path, &snapshot, &err) != 0 || snapshot != NULL)
+    goto exit;
+
+  ret = 0;
+
+exit:
+  crun_error_release (&err);
+  libcrun_config_snapshot_free (snapshot);
+  yajl_tree_free (tree);
+  unlink (path);
+  return ret;
+}
+
+/* Compare parsing the JSON with decoding the snapshot for a 1MB
+   configuration.  */
+static int
+test_snapshot_benchmark ()
+{
+  cleanup_free char *json = make_config (1024 * 1024);
+  struct libcrun_config_snapshot_s *snapshot;
+  cleanup_free char *data = NULL;
+  const int iterations = 20;
+  double start, parse_time, decode_time;
+  libcrun_error_t err = NULL;
+  yajl_val tree;
+  size_t len;
+  int i;
+
+  if (encode (json, &tree, &data, &len) < 0)
+    return -1;
+  yajl_tree_free (tree);
+
+  start = now ();
+  for (i = 0; i < iterations; i++)
+    {
+      tree = yajl_tree_parse (json, NULL, 0);
+      if (tree == NULL)
+        return -1;
+      yajl_tree_free (tree);
+    }
+  parse_time = (now () - start) / iterations;
+
+  start = now ();
+  for (i = 0; i < iterations; i++)
+    {
+      if (libcrun_config_snapshot_from_memory (data, len, &snapshot, &err) != 1)
+        {
+          crun_error_release (&err);
+          return -1;
+        }
+      libcrun_config_snapshot_free (snapshot);
+    }
+  decode_time = (now () - start) / iterations;
+
+  printf ("# config size: %zu bytes, snapshot size: %zu bytes\n", strlen (json), len);
+  printf ("# JSON parse: %.0f us\n", parse_time * 1e6);
+  printf ("# snapshot decode: %.0f us\n", decode_time * 1e6);
+  return 0;
+}
+
+static void
+run_and_print_test_result (const char *name, int id, test t)
+{
+  int ret = t ();
+  if (ret == 0)
+    printf ("ok %d - %s\n", id, name);
+  else if (ret == 77)
+    printf ("ok %d - %s #SKIP\n", id, name);
+  else
+    printf ("not ok %d - %s\n", id, name);
+}
+
+#define RUN_TEST(T)                            \
+  do                                           \
+    {                                          \
+      run_and_print_test_result (#T, id++, T); \
+    }                                          \
+  while (0)
+
+int
+main ()
+{
+  int id = 1;
+  printf ("1..5\n");
+  RUN_TEST (test_snapshot_round_trip);
+  RUN_TEST (test_snapshot_corrupted);
+  RUN_TEST (test_snapshot_version);
+  RUN_TEST (test_snapshot_file);
+  RUN_TEST (test_snapshot_benchmark);
+  return 0;
+}
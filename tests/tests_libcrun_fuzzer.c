@@ -26,6 +26,7 @@
 #include <libcrun/status.h>
 #include <libcrun/seccomp.h>
 #include <libcrun/ebpf.h>
+#include <libcrun/config_snapshot.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <string.h>
@@ -311,6 +312,91 @@ test_parse_idmapped_mounts (uint8_t *buf, size_t len)
   return 0;
 }
 
+static bool
+same_tree (yajl_val a, yajl_val b)
+{
+  size_t i;
+
+  if (a->type != b->type)
+    return false;
+
+  switch (a->type)
+    {
+    case yajl_t_string:
+      return strcmp (a->u.string, b->u.string) == 0;
+
+    case yajl_t_number:
+      return strcmp (a->u.number.r, b->u.number.r) == 0 && a->u.number.flags == b->u.number.flags
+             && a->u.number.i == b->u.number.i && memcmp (&a->u.number.d, &b->u.number.d, sizeof (double)) == 0;
+
+    case yajl_t_object:
+      if (a->u.object.len != b->u.object.len)
+        return false;
+      for (i = 0; i < a->u.object.len; i++)
+        if (strcmp (a->u.object.keys[i], b->u.object.keys[i]) != 0
+            || ! same_tree (a->u.object.values[i], b->u.object.values[i]))
+          return false;
+      return true;
+
+    case yajl_t_array:
+      if (a->u.array.len != b->u.array.len)
+        return false;
+      for (i = 0; i < a->u.array.len; i++)
+        if (! same_tree (a->u.array.values[i], b->u.array.values[i]))
+          return false;
+      return true;
+
+    default:
+      return true;
+    }
+}
+
+/* The snapshot of a configuration must decode to the same tree, and a
+   corrupted snapshot must never be loaded.  */
+static int
+test_config_snapshot (uint8_t *buf, size_t len)
+{
+  struct libcrun_config_snapshot_s *snapshot = NULL;
+  cleanup_free char *encoded = NULL;
+  cleanup_free char *data = NULL;
+  libcrun_error_t err = NULL;
+  size_t encoded_len;
+  yajl_val tree;
+  int ret;
+
+  data = make_nul_terminated (buf, len);
+  if (data == NULL)
+    return 0;
+
+  tree = yajl_tree_parse (data, NULL, 0);
+  if (tree == NULL)
+    return 0;
+
+  if (libcrun_config_snapshot_encode (tree, &encoded, &encoded_len, &err) < 0)
+    {
+      crun_error_release (&err);
+      yajl_tree_free (tree);
+      return 0;
+    }
+
+  ret = libcrun_config_snapshot_from_memory (encoded, encoded_len, &snapshot, &err);
+  if (ret != 1 || ! same_tree (tree, libcrun_config_snapshot_tree (snapshot)))
+    abort ();
+  libcrun_config_snapshot_free (snapshot);
+  yajl_tree_free (tree);
+
+  if (len > 0)
+    {
+      encoded[buf[0] % encoded_len] ^= 1 + (buf[len - 1] % 255);
+      ret = libcrun_config_snapshot_from_memory (encoded, encoded_len, &snapshot, &err);
+      if (ret == 1)
+        abort ();
+      crun_error_release (&err);
+    }
+
+  return 0;
+}
+
 static int
 run_one_container (uint8_t *buf, size_t len, bool detach)
 {
@@ -341,6 +427,7 @@ run_one_container (uint8_t *buf, size_t len, bool detach)
   ctx.bundle = "rootfs";
   ctx.detach = detach;
   ctx.fifo_exec_wait_fd = -1;
+  ctx.psi_fd = -1;
 
   libcrun_container_run (&ctx, container, LIBCRUN_RUN_OPTIONS_PREFORK, &err);
   crun_error_release (&err);
@@ -435,10 +522,16 @@ run_one_test (int mode, uint8_t *buf, size_t len)
       }
       break;
 
+    case 10:
+      /* expects config.json.  */
+      test_config_snapshot (buf, len);
+      break;
+
       /* ALL mode.  */
     case -1:
       for (i = 0; i <= 8; i++)
         run_one_test (i, buf, len);
+      run_one_test (10, buf, len);
       break;
 
     default:
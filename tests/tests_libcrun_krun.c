@@ -0,0 +1,304 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <libcrun/error.h>
+#include <libcrun/custom-handler.h>
+
+#ifdef HAVE_DLOPEN
+#  include <dlfcn.h>
+#endif
+
+typedef int (*test) ();
+
+#if HAVE_DLOPEN && HAVE_LIBKRUN
+
+static struct custom_handler_manager_s *manager;
+
+/* Keep the stub loaded for the whole test, so its counter and the
+   spare context survive the handler being unloaded.  */
+static void *stub_handle;
+
+/* Number of contexts created so far by the stub library.  */
+static int
+created_contexts ()
+{
+  int32_t (*counter) ();
+
+  counter = dlsym (stub_handle, "krun_stub_created_contexts");
+  return counter ? counter () : -1;
+}
+
+/* Load the handler, as it is done for every container, and unload it.
+   Returns the number of contexts created meanwhile.  */
+static int
+load_handler ()
+{
+  struct custom_handler_s *h;
+  libcrun_error_t err = NULL;
+  void *cookie = NULL;
+  int before, ret;
+
+  h = handler_by_name (manager, "krun");
+  if (h == NULL)
+    return -1;
+
+  before = created_contexts ();
+
+  ret = h->load (&cookie, &err);
+  if (ret < 0)
+    {
+      crun_error_release (&err);
+      return -1;
+    }
+
+  ret = created_contexts () - before;
+
+  if (h->unload (cookie, &err) < 0)
+    {
+      crun_error_release (&err);
+      return -1;
+    }
+  return ret;
+}
+
+static int
+test_krun_load_without_warmup ()
+{
+  int i;
+
+  for (i = 0; i < 3; i++)
+    if (load_handler () != 1)
+      return -1;
+
+  return 0;
+}
+
+static int
+test_krun_warmup ()
+{
+  cleanup_custom_handler_instance struct custom_handler_instance_s *handler = NULL;
+  libcrun_error_t err = NULL;
+  int before, ret;
+
+  before = created_contexts ();
+
+  ret = libcrun_handler_manager_warmup (manager, "krun", &handler, &err);
+  if (ret < 0)
+    {
+      crun_error_release (&err);
+      return -1;
+    }
+
+  /* Only the context for the warmed up instance is created.  */
+  if (created_contexts () - before != 1)
+    return -1;
+
+  /* The next load takes it, the following ones create a new one.  */
+  if (load_handler () != 0)
+    return -1;
+  if (load_handler () != 1)
+    return -1;
+
+  return 0;
+}
+
+static int
+test_krun_warmup_after_fork ()
+{
+  cleanup_custom_handler_instance struct custom_handler_instance_s *handler = NULL;
+  libcrun_error_t err = NULL;
+  int ret, status;
+  pid_t pid;
+
+  ret = libcrun_handler_manager_warmup (manager, "krun", &handler, &err);
+  if (ret < 0)
+    {
+      crun_error_release (&err);
+      return -1;
+    }
+
+  /* Each child takes the context from its own copy.  */
+  pid = fork ();
+  if (pid < 0)
+    return -1;
+  if (pid == 0)
+    _exit (load_handler () == 0 ? 0 : 1);
+
+  if (waitpid (pid, &status, 0) < 0)
+    return -1;
+  if (! WIFEXITED (status) || WEXITSTATUS (status) != 0)
+    return -1;
+
+  return load_handler () == 0 ? 0 : -1;
+}
+
+static int
+test_krun_unload_warmup ()
+{
+  libcrun_error_t err = NULL;
+  int ret;
+
+  {
+    cleanup_custom_handler_instance struct custom_handler_instance_s *handler = NULL;
+
+    ret = libcrun_handler_manager_warmup (manager, "krun", &handler, &err);
+    if (ret < 0)
+      {
+        crun_error_release (&err);
+        return -1;
+      }
+  }
+
+  /* The spare context went away with the warmed up handler.  */
+  return load_handler () == 1 ? 0 : -1;
+}
+
+/* libkrun is opened by its soname, make the stub library available
+   with that name in a temporary directory and run again the test.  */
+static int
+reexec_with_stub (char **argv)
+{
+  char dir[] = "/tmp/crun-krun-test.XXXXXX";
+  cleanup_free char *link = NULL;
+
+  if (mkdtemp (dir) == NULL)
+    return -1;
+
+  if (asprintf (&link, "%s/libkrun.so.1", dir) < 0)
+    return -1;
+
+  if (symlink (KRUN_STUB_PATH, link) < 0)
+    return -1;
+
+  setenv ("LD_LIBRARY_PATH", dir, 1);
+  setenv ("CRUN_KRUN_STUB_DIR", dir, 1);
+  execv ("/proc/self/exe", argv);
+  return -1;
+}
+
+static void
+cleanup_stub_dir ()
+{
+  cleanup_free char *link = NULL;
+  const char *dir;
+
+  dir = getenv ("CRUN_KRUN_STUB_DIR");
+  if (dir == NULL)
+    return;
+
+  if (asprintf (&link, "%s/libkrun.so.1", dir) >= 0)
+    unlink (link);
+  rmdir (dir);
+}
+
+#else
+
+static int
+test_krun_load_without_warmup ()
+{
+  return 77;
+}
+
+static int
+test_krun_warmup ()
+{
+  return 77;
+}
+
+static int
+test_krun_warmup_after_fork ()
+{
+  return 77;
+}
+
+static int
+test_krun_unload_warmup ()
+{
+  return 77;
+}
+
+#endif
+
+static void
+run_and_print_test_result (const char *name, int id, test t)
+{
+  int ret = t ();
+  if (ret == 0)
+    printf ("ok %d - %s\n", id, name);
+  else if (ret == 77)
+    printf ("ok %d - %s #SKIP\n", id, name);
+  else
+    printf ("not ok %d - %s\n", id, name);
+}
+
+#define RUN_TEST(T)                            \
+  do                                           \
+    {                                          \
+      run_and_print_test_result (#T, id++, T); \
+  } while (0)
+
+int
+main (int argc, char **argv)
+{
+  int id = 1;
+
+#if HAVE_DLOPEN && HAVE_LIBKRUN
+  libcrun_error_t err = NULL;
+
+  if (getenv ("CRUN_KRUN_STUB_DIR") == NULL && reexec_with_stub (argv) < 0)
+    {
+      fprintf (stderr, "cannot run with the stub libkrun\n");
+      return 1;
+    }
+
+  stub_handle = dlopen ("libkrun.so.1", RTLD_NOW);
+  if (stub_handle == NULL)
+    {
+      fprintf (stderr, "cannot load the stub libkrun: %s\n", dlerror ());
+      return 1;
+    }
+
+  manager = libcrun_handler_manager_create (&err);
+  if (manager == NULL)
+    {
+      crun_error_release (&err);
+      return 1;
+    }
+#endif
+
+  printf ("1..4\n");
+  RUN_TEST (test_krun_load_without_warmup);
+  RUN_TEST (test_krun_warmup);
+  RUN_TEST (test_krun_warmup_after_fork);
+  RUN_TEST (test_krun_unload_warmup);
+
+#if HAVE_DLOPEN && HAVE_LIBKRUN
+  handler_manager_free (manager);
+  dlclose (stub_handle);
+  cleanup_stub_dir ();
+#endif
+  return 0;
+}
@@ -0,0 +1,421 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <libcrun/container.h>
+#include <libcrun/lazy_config.h>
+#include <libcrun/utils.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef int (*test) ();
+
+/* Build a configuration of about SIZE bytes, most of it in the
+   environment and in the mounts like for a real large container.  */
+static char *
+make_config (size_t size)
+{
+  size_t i, off = 0, allocated = size + 4096;
+  char *buf = xmalloc (allocated);
+
+#define APPEND(...)                                                       \
+  do                                                                      \
+    {                                                                     \
+      int n = snprintf (buf + off, allocated - off, __VA_ARGS__);         \
+      if ((size_t) n >= allocated - off)                                  \
+        {                                                                 \
+          allocated = allocated * 2 + n;                                  \
+          buf = xrealloc (buf, allocated);                                \
+          n = snprintf (buf + off, allocated - off, __VA_ARGS__);         \
+        }                                                                 \
+      off += n;                                                           \
+    }                                                                     \
+  while (0)
+
+  APPEND ("{\"ociVersion\": \"1.0.0\", \"hostname\": \"lazy\", \"root\": {\"path\": \"rootfs\"},"
+          " \"annotations\": {\"run.oci.handler\": \"none\", \"com.example.key\": \"value\"},"
+          " \"process\": {\"cwd\": \"/\", \"user\": {\"uid\": 0, \"gid\": 0}, \"args\": [\"/init\", \"--flag\"], \"env\": [");
+  for (i = 0; off < size / 2; i++)
+    APPEND ("%s\"VARIABLE_%zu=%080zu\"", i ? ", " : "", i, i);
+  APPEND ("]}, \"mounts\": [");
+  for (i = 0; off < size; i++)
+    APPEND ("%s{\"destination\": \"/mnt/volume-%zu\", \"type\": \"bind\", \"source\": \"/var/lib/volumes/%zu\","
+            " \"options\": [\"rbind\", \"rw\", \"nosuid\", \"nodev\"]}",
+            i ? ", " : "", i, i);
+  APPEND ("], \"linux\": {\"namespaces\": [{\"type\": \"pid\"}, {\"type\": \"mount\"}],"
+          " \"maskedPaths\": [\"/proc/kcore\"],"
+          " \"resources\": {\"pids\": {\"limit\": 1024}, \"memory\": {\"limit\": 1073741824}},"
+          " \"seccomp\": {\"defaultAction\": \"SCMP_ACT_ERRNO\", \"syscalls\": [{\"names\": [\"read\", \"write\"], \"action\": \"SCMP_ACT_ALLOW\"}]}}}");
+
+#undef APPEND
+
+  return buf;
+}
+
+static double
+now ()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Test that the lazily loaded sections match the full parse */
+static int
+test_lazy_sections_match ()
+{
+  cleanup_free char *json = make_config (64 * 1024);
+  libcrun_container_t *full = NULL, *lazy = NULL;
+  runtime_spec_schema_config_schema *a, *b;
+  libcrun_error_t err = NULL;
+  size_t i;
+  int ret = -1;
+
+  full = libcrun_container_load_from_memory (json, &err);
+  if (full == NULL)
+    goto exit;
+
+  lazy = libcrun_container_load_lazy_from_memory (json, &err);
+  if (lazy == NULL)
+    goto exit;
+
+  a = full->container_def;
+  b = lazy->container_def;
+
+  /* Nothing big is parsed until it is requested.  */
+  if (b->process || b->mounts || b->linux)
+    goto exit;
+  if (strcmp (b->hostname, "lazy") != 0 || strcmp (b->root->path, "rootfs") != 0)
+    goto exit;
+  if (strcmp (find_annotation (lazy, "com.example.key"), "value") != 0)
+    goto exit;
+
+  if (libcrun_container_load_sections (lazy, LIBCRUN_CONFIG_ALL, &err) < 0)
+    goto exit;
+
+  if (a->process->env_len != b->process->env_len || a->process->args_len != b->process->args_len)
+    goto exit;
+  for (i = 0; i < a->process->env_len; i++)
+    if (strcmp (a->process->env[i], b->process->env[i]) != 0)
+      goto exit;
+
+  if (a->mounts_len != b->mounts_len)
+    goto exit;
+  for (i = 0; i < a->mounts_len; i++)
+    if (strcmp (a->mounts[i]->destination, b->mounts[i]->destination) != 0
+        || a->mounts[i]->options_len != b->mounts[i]->options_len)
+      goto exit;
+
+  if (b->linux->namespaces_len != 2 || b->linux->masked_paths_len != 1)
+    goto exit;
+  if (b->linux->resources == NULL || b->linux->resources->pids->limit != 1024)
+    goto exit;
+  if (b->linux->seccomp == NULL || strcmp (b->linux->seccomp->default_action, "SCMP_ACT_ERRNO") != 0)
+    goto exit;
+
+  ret = 0;
+
+exit:
+  if (err)
+    crun_error_release (&err);
+  libcrun_container_free (full);
+  libcrun_container_free (lazy);
+  return ret;
+}
+
+/* Test that the sections are parsed only once and only when requested */
+static int
+test_lazy_pending ()
+{
+  cleanup_free char *json = make_config (4096);
+  libcrun_container_t *lazy;
+  runtime_spec_schema_config_schema_process *process;
+  libcrun_error_t err = NULL;
+  int ret = -1;
+
+  lazy = libcrun_container_load_lazy_from_memory (json, &err);
+  if (lazy == NULL)
+    goto exit;
+
+  if (libcrun_lazy_config_pending (lazy->lazy_config) != LIBCRUN_CONFIG_ALL)
+    goto exit;
+
+  if (libcrun_container_load_sections (lazy, LIBCRUN_CONFIG_PROCESS | LIBCRUN_CONFIG_LINUX_SECCOMP, &err) < 0)
+    goto exit;
+
+  /* The seccomp profile is stored in the linux object.  */
+  if (libcrun_lazy_config_pending (lazy->lazy_config) != (LIBCRUN_CONFIG_MOUNTS | LIBCRUN_CONFIG_LINUX_RESOURCES))
+    goto exit;
+  if (lazy->container_def->mounts || lazy->container_def->linux->resources)
+    goto exit;
+
+  process = lazy->container_def->process;
+  if (libcrun_container_load_sections (lazy, LIBCRUN_CONFIG_PROCESS, &err) < 0)
+    goto exit;
+  if (process != lazy->container_def->process)
+    goto exit;
+
+  ret = 0;
+
+exit:
+  if (err)
+    crun_error_release (&err);
+  libcrun_container_free (lazy);
+  return ret;
+}
+
+/* Test that malformed configurations are rejected */
+static int
+test_lazy_invalid ()
+{
+  const char *invalid[] = { "", "{", "{\"ociVersion\": \"1.0.0\"", "{\"ociVersion\": \"1.0.0\"} {}",
+                            "{\"ociVersion\": \"1.0.0\", \"process\": {\"args\": [}}", "[]", NULL };
+  const char *bad_section = "{\"ociVersion\": \"1.0.0\", \"mounts\": [{\"destination\": }]}";
+  libcrun_container_t *lazy;
+  libcrun_error_t err = NULL;
+  size_t i;
+  int ret;
+
+  for (i = 0; invalid[i]; i++)
+    {
+      lazy = libcrun_container_load_lazy_from_memory (invalid[i], &err);
+      if (lazy)
+        {
+          /* The content of a section is validated only when it is loaded.  */
+          ret = libcrun_container_load_sections (lazy, LIBCRUN_CONFIG_ALL, &err);
+          libcrun_container_free (lazy);
+          if (ret == 0)
+            return -1;
+        }
+      crun_error_release (&err);
+    }
+
+  lazy = libcrun_container_load_lazy_from_memory (bad_section, &err);
+  if (lazy == NULL)
+    return -1;
+
+  ret = libcrun_container_load_sections (lazy, LIBCRUN_CONFIG_MOUNTS, &err);
+  libcrun_container_free (lazy);
+  if (ret == 0)
+    return -1;
+  crun_error_release (&err);
+
+  /* A file with a NUL byte must not be indexed past the copy of the
+     content kept in the container.  */
+  {
+    const char nul_config[] = "{\"ociVersion\": \"1.0.0\"}\0{\"mounts\": [{\"destination\": \"/mnt\"}]}";
+    char path[] = "/tmp/crun-lazy-XXXXXX";
+    int fd;
+
+    fd = mkstemp (path);
+    if (fd < 0)
+      return -1;
+    close (fd);
+
+    lazy = NULL;
+    ret = write_file (path, nul_config, sizeof (nul_config) - 1, &err);
+    if (ret >= 0)
+      lazy = libcrun_container_load_lazy_from_file (path, &err);
+    unlink (path);
+    crun_error_release (&err);
+    if (ret < 0 || lazy)
+      {
+        libcrun_container_free (lazy);
+        return -1;
+      }
+  }
+
+  return 0;
+}
+
+/* Test that the sections loaded from a snapshot match the full parse */
+static int
+test_lazy_snapshot_match ()
+{
+  cleanup_free char *json = make_config (64 * 1024);
+  struct libcrun_config_snapshot_s *snapshot = NULL;
+  struct libcrun_lazy_config_s *lazy = NULL;
+  runtime_spec_schema_config_schema *a, *b = NULL;
+  libcrun_container_t *full = NULL;
+  cleanup_free char *data = NULL;
+  libcrun_error_t err = NULL;
+  yajl_val tree = NULL;
+  size_t i, len;
+  int ret = -1;
+
+  full = libcrun_container_load_from_memory (json, &err);
+  if (full == NULL)
+    goto exit;
+  a = full->container_def;
+
+  if (parse_json_file (&tree, json, NULL, &err) < 0)
+    goto exit;
+  if (libcrun_config_snapshot_encode (tree, &data, &len, &err) < 0)
+    goto exit;
+  if (libcrun_config_snapshot_from_memory (data, len, &snapshot, &err) != 1)
+    goto exit;
+
+  /* The lazy configuration takes the ownership of the snapshot.  */
+  ret = libcrun_lazy_config_new_from_snapshot (snapshot, &b, &lazy, &err);
+  snapshot = NULL;
+  if (ret < 0)
+    {
+      ret = -1;
+      goto exit;
+    }
+  ret = -1;
+
+  if (b->process || b->mounts || b->linux || strcmp (b->hostname, "lazy") != 0)
+    goto exit;
+  if (libcrun_lazy_config_pending (lazy) != LIBCRUN_CONFIG_ALL)
+    goto exit;
+
+  if (libcrun_lazy_config_load (lazy, NULL, b, LIBCRUN_CONFIG_ALL, &err) < 0)
+    goto exit;
+
+  if (a->process->env_len != b->process->env_len)
+    goto exit;
+  for (i = 0; i < a->process->env_len; i++)
+    if (strcmp (a->process->env[i], b->process->env[i]) != 0)
+      goto exit;
+
+  if (a->mounts_len != b->mounts_len)
+    goto exit;
+  for (i = 0; i < a->mounts_len; i++)
+    if (strcmp (a->mounts[i]->destination, b->mounts[i]->destination) != 0)
+      goto exit;
+
+  if (b->linux->namespaces_len != 2 || b->linux->resources == NULL || b->linux->resources->pids->limit != 1024)
+    goto exit;
+  if (b->linux->seccomp == NULL || b->linux->seccomp->syscalls_len != 1)
+    goto exit;
+
+  ret = 0;
+
+exit:
+  if (err)
+    crun_error_release (&err);
+  if (b)
+    free_runtime_spec_schema_config_schema (b);
+  if (tree)
+    yajl_tree_free (tree);
+  libcrun_lazy_config_free (lazy);
+  libcrun_config_snapshot_free (snapshot);
+  libcrun_container_free (full);
+  return ret;
+}
+
+/* Compare the full parse with the lazy one for a 1MB configuration.  The
+   lazy load only reads the annotations, as crun state does.  */
+static int
+test_lazy_benchmark ()
+{
+  cleanup_free char *json = make_config (1024 * 1024);
+  const int iterations = 20;
+  double start, full_time, lazy_time, exec_time;
+  libcrun_container_t *container;
+  libcrun_error_t err = NULL;
+  int i;
+
+  start = now ();
+  for (i = 0; i < iterations; i++)
+    {
+      container = libcrun_container_load_from_memory (json, &err);
+      if (container == NULL)
+        goto fail;
+      libcrun_container_free (container);
+    }
+  full_time = (now () - start) / iterations;
+
+  start = now ();
+  for (i = 0; i < iterations; i++)
+    {
+      container = libcrun_container_load_lazy_from_memory (json, &err);
+      if (container == NULL)
+        goto fail;
+      if (find_annotation (container, "run.oci.handler") == NULL)
+        {
+          libcrun_container_free (container);
+          return -1;
+        }
+      libcrun_container_free (container);
+    }
+  lazy_time = (now () - start) / iterations;
+
+  start = now ();
+  for (i = 0; i < iterations; i++)
+    {
+      container = libcrun_container_load_lazy_from_memory (json, &err);
+      if (container == NULL)
+        goto fail;
+      if (libcrun_container_load_sections (container, LIBCRUN_CONFIG_ALL & ~LIBCRUN_CONFIG_MOUNTS, &err) < 0)
+        {
+          libcrun_container_free (container);
+          goto fail;
+        }
+      libcrun_container_free (container);
+    }
+  exec_time = (now () - start) / iterations;
+
+  printf ("# config size: %zu bytes\n", strlen (json));
+  printf ("# full parse: %.0f us\n", full_time * 1e6);
+  printf ("# lazy, annotations only: %.0f us\n", lazy_time * 1e6);
+  printf ("# lazy, all but the mounts: %.0f us\n", exec_time * 1e6);
+  return 0;
+
+fail:
+  crun_error_release (&err);
+  return -1;
+}
+
+static void
+run_and_print_test_result (const char *name, int id, test t)
+{
+  int ret = t ();
+  if (ret == 0)
+    printf ("ok %d - %s\n", id, name);
+  else if (ret == 77)
+    printf ("ok %d - %s #SKIP\n", id, name);
+  else
+    printf ("not ok %d - %s\n", id, name);
+}
+
+#define RUN_TEST(T)                            \
+  do                                           \
+    {                                          \
+      run_and_print_test_result (#T, id++, T); \
+    }                                          \
+  while (0)
+
+int
+main ()
+{
+  int id = 1;
+  printf ("1..5\n");
+  RUN_TEST (test_lazy_sections_match);
+  RUN_TEST (test_lazy_pending);
+  RUN_TEST (test_lazy_invalid);
+  RUN_TEST (test_lazy_snapshot_match);
+  RUN_TEST (test_lazy_benchmark);
+  return 0;
+}
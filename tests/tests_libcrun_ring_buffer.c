@@ -25,6 +25,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <time.h>
 
 typedef int (*test) ();
 
@@ -490,6 +491,211 @@ test_ring_buffer_no_reserved_byte_access ()
   return 0;
 }
 
+static int
+test_ring_buffer_mapped_wraparound ()
+{
+  size_t page_size = sysconf (_SC_PAGESIZE);
+  cleanup_free char *data = xmalloc (page_size * 3);
+  cleanup_free char *read_back = xmalloc (page_size * 3);
+  libcrun_error_t err = NULL;
+  int fds_to_close[5] = {
+    -1,
+  };
+  int fds_to_close_n = 0;
+  cleanup_close_vec int *autocleanup_fds = fds_to_close;
+  cleanup_ring_buffer struct ring_buffer *rb = NULL;
+  bool is_eagain = false;
+  int fd_in[2], fd_out[2];
+
+  if (pipe2 (fd_in, O_NONBLOCK) < 0 || pipe2 (fd_out, O_NONBLOCK) < 0)
+    return 1;
+
+  fds_to_close[fds_to_close_n++] = fd_in[0];
+  fds_to_close[fds_to_close_n++] = fd_in[1];
+  fds_to_close[fds_to_close_n++] = fd_out[0];
+  fds_to_close[fds_to_close_n++] = fd_out[1];
+  fds_to_close[fds_to_close_n++] = -1;
+
+  /* Two pages, so a write to the output pipe when a page is already used
+     is truncated to exactly one page.  */
+  if (fcntl (fd_out[0], F_SETPIPE_SZ, page_size * 2) < 0)
+    return 77;
+
+  rb = ring_buffer_make_mapped (page_size * 2, &err);
+  if (rb == NULL)
+    {
+      libcrun_error_release (&err);
+      return 77;
+    }
+
+  if (ring_buffer_get_size (rb) != page_size * 2 || ring_buffer_get_space_available (rb) != page_size * 2)
+    {
+      fprintf (stderr, "wrong size for the mapped ring buffer\n");
+      return 1;
+    }
+
+  fill_data (data, page_size * 3);
+  memset (read_back, 0, page_size * 3);
+
+  /* Fill 3/4 of the buffer and write out only the first half, so the
+     data left starts in the middle of the buffer.  */
+  if (write (fd_in[1], data, page_size * 3 / 2) != (ssize_t) (page_size * 3 / 2))
+    return 1;
+  if (ring_buffer_read (rb, fd_in[0], &is_eagain, &err) != (int) (page_size * 3 / 2))
+    goto fail;
+
+  if (write (fd_out[1], read_back, page_size) != (ssize_t) page_size)
+    return 1;
+  if (ring_buffer_write (rb, fd_out[1], &is_eagain, &err) != (int) page_size)
+    goto fail;
+  if (read (fd_out[0], read_back, page_size) != (ssize_t) page_size)
+    return 1;
+  if (read (fd_out[0], read_back, page_size) != (ssize_t) page_size)
+    return 1;
+
+  /* The free space now wraps around the end of the buffer and it must be
+     filled with a single read.  */
+  if (write (fd_in[1], data + page_size * 3 / 2, page_size * 3 / 2) != (ssize_t) (page_size * 3 / 2))
+    return 1;
+  if (ring_buffer_read (rb, fd_in[0], &is_eagain, &err) != (int) (page_size * 3 / 2))
+    goto fail;
+
+  /* No byte is reserved.  */
+  if (ring_buffer_get_space_available (rb) != 0 || ring_buffer_get_data_available (rb) != page_size * 2)
+    {
+      fprintf (stderr, "the mapped ring buffer is not full\n");
+      return 1;
+    }
+
+  if (ring_buffer_write (rb, fd_out[1], &is_eagain, &err) != (int) (page_size * 2))
+    goto fail;
+  if (read (fd_out[0], read_back + page_size, page_size * 2) != (ssize_t) (page_size * 2))
+    return 1;
+
+  if (memcmp (data, read_back, page_size) != 0 || memcmp (data + page_size, read_back + page_size, page_size * 2) != 0)
+    {
+      fprintf (stderr, "data mismatch after wraparound\n");
+      return 1;
+    }
+
+  return 0;
+
+fail:
+  if (err)
+    libcrun_error_release (&err);
+  fprintf (stderr, "unexpected size for a single read or write on the mapped ring buffer\n");
+  return 1;
+}
+
+/* Copy TOTAL bytes from a pipe to another one through RB, as
+   channel_fd_pair_process does.  */
+static int
+pump_ring_buffer (struct ring_buffer *rb, size_t total, double *elapsed)
+{
+  const size_t chunk_size = 64 * 1024;
+  cleanup_free char *chunk = xmalloc (chunk_size);
+  libcrun_error_t err = NULL;
+  int fds_to_close[5] = {
+    -1,
+  };
+  int fds_to_close_n = 0;
+  cleanup_close_vec int *autocleanup_fds = fds_to_close;
+  struct timespec start, end;
+  size_t written = 0, copied = 0;
+  int fd_in[2], fd_out[2];
+  int ret;
+
+  if (pipe2 (fd_in, O_NONBLOCK) < 0 || pipe2 (fd_out, O_NONBLOCK) < 0)
+    return 1;
+
+  fds_to_close[fds_to_close_n++] = fd_in[0];
+  fds_to_close[fds_to_close_n++] = fd_in[1];
+  fds_to_close[fds_to_close_n++] = fd_out[0];
+  fds_to_close[fds_to_close_n++] = fd_out[1];
+  fds_to_close[fds_to_close_n++] = -1;
+
+  fill_data (chunk, chunk_size);
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  while (copied < total)
+    {
+      bool is_eagain = false;
+
+      if (written < total)
+        {
+          ret = write (fd_in[1], chunk, chunk_size);
+          if (ret > 0)
+            written += ret;
+        }
+
+      ret = ring_buffer_read (rb, fd_in[0], &is_eagain, &err);
+      if (ret < 0)
+        goto fail;
+
+      ret = ring_buffer_write (rb, fd_out[1], &is_eagain, &err);
+      if (ret < 0)
+        goto fail;
+
+      do
+        {
+          ret = read (fd_out[0], chunk, chunk_size);
+          if (ret > 0)
+            copied += ret;
+      } while (ret > 0);
+    }
+  clock_gettime (CLOCK_MONOTONIC, &end);
+
+  *elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  return 0;
+
+fail:
+  libcrun_error_release (&err);
+  return 1;
+}
+
+/* Size of the data copied by the throughput benchmark, in MiB.  Set
+   RING_BUFFER_BENCHMARK_MIB for a longer run.  */
+static size_t
+benchmark_size ()
+{
+  const char *value = getenv ("RING_BUFFER_BENCHMARK_MIB");
+  long mib = value ? strtol (value, NULL, 10) : 0;
+
+  return (mib > 0 ? (size_t) mib : 16) * 1024 * 1024;
+}
+
+static int
+test_ring_buffer_throughput ()
+{
+  const size_t total = benchmark_size ();
+  /* Not a multiple of the chunk size, so the data wraps around.  */
+  const size_t rb_size = 96 * 1024;
+  cleanup_ring_buffer struct ring_buffer *rb = NULL;
+  cleanup_ring_buffer struct ring_buffer *mapped_rb = NULL;
+  libcrun_error_t err = NULL;
+  double elapsed;
+  int ret;
+
+  rb = ring_buffer_make (rb_size);
+  ret = pump_ring_buffer (rb, total, &elapsed);
+  if (ret != 0)
+    return ret;
+  printf ("# ring buffer: %.0f MiB/s\n", total / elapsed / (1024 * 1024));
+
+  mapped_rb = ring_buffer_make_mapped (rb_size, &err);
+  if (mapped_rb == NULL)
+    {
+      libcrun_error_release (&err);
+      return 77;
+    }
+  ret = pump_ring_buffer (mapped_rb, total, &elapsed);
+  if (ret != 0)
+    return ret;
+  printf ("# mapped ring buffer: %.0f MiB/s\n", total / elapsed / (1024 * 1024));
+
+  return 0;
+}
+
 static void
 run_and_print_test_result (const char *name, int id, test t)
 {
@@ -512,11 +718,13 @@ int
 main ()
 {
   int id = 1;
-  printf ("1..4\n");
+  printf ("1..6\n");
 
   RUN_TEST (test_ring_buffer_read_write);
   RUN_TEST (test_ring_buffer_wraparound_data_integrity);
   RUN_TEST (test_ring_buffer_reserved_byte_boundary);
   RUN_TEST (test_ring_buffer_no_reserved_byte_access);
+  RUN_TEST (test_ring_buffer_mapped_wraparound);
+  RUN_TEST (test_ring_buffer_throughput);
   return 0;
 }
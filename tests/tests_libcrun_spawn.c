@@ -0,0 +1,152 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <libcrun/spawn.h>
+#include <libcrun/utils.h>
+
+typedef int (*test) ();
+
+static int
+test_spawn_exit_status ()
+{
+  char *args[] = { "/bin/sh", "-c", "read x; exit $x", NULL };
+  libcrun_error_t err = NULL;
+  int ret;
+
+  ret = libcrun_spawn_run ("/bin/sh", args, NULL, -1, environ, "3\n", 2, -1, -1, &err);
+  if (ret != 3)
+    {
+      if (ret < 0)
+        crun_error_release (&err);
+      return -1;
+    }
+  return 0;
+}
+
+static int
+test_spawn_exec_error ()
+{
+  libcrun_error_t err = NULL;
+  int ret;
+
+  ret = libcrun_spawn_run ("/does/not/exist", NULL, NULL, -1, environ, "", 0, -1, -1, &err);
+  if (ret >= 0)
+    return -1;
+  if (err->status != ENOENT)
+    return -1;
+  crun_error_release (&err);
+  return 0;
+}
+
+static int
+test_spawn_timeout ()
+{
+  char *args[] = { "sleep", "10", NULL };
+  libcrun_error_t err = NULL;
+  struct timespec start, end;
+  int64_t elapsed_ms;
+  int ret;
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  ret = libcrun_spawn_run ("sleep", args, NULL, 100, environ, "", 0, -1, -1, &err);
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  if (ret >= 0)
+    return -1;
+  crun_error_release (&err);
+
+  elapsed_ms = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
+  if (elapsed_ms < 100 || elapsed_ms > 5000)
+    return -1;
+  return 0;
+}
+
+static int
+test_spawn_wait_many ()
+{
+  char *fast[] = { "/bin/sh", "-c", "exit 1", NULL };
+  char *slow[] = { "sleep", "10", NULL };
+  struct libcrun_spawn_s procs[3];
+  libcrun_error_t err = NULL;
+  int ret, result = -1;
+  size_t i;
+
+  if (libcrun_spawn (&procs[0], "/bin/sh", fast, NULL, environ, -1, -1, -1, &err) < 0)
+    goto fail;
+  if (libcrun_spawn (&procs[1], "/bin/sh", fast, NULL, environ, -1, -1, -1, &err) < 0)
+    goto fail_0;
+  if (libcrun_spawn (&procs[2], "sleep", slow, NULL, environ, -1, -1, -1, &err) < 0)
+    goto fail_1;
+
+  ret = libcrun_spawn_wait (procs, 3, 200, &err);
+  if (ret < 0)
+    crun_error_release (&err);
+  else if (ret == 1 && procs[0].exited && procs[0].status == 1 && procs[1].exited && procs[1].status == 1
+           && ! procs[2].exited)
+    result = 0;
+
+  for (i = 0; i < 3; i++)
+    libcrun_spawn_release (&procs[i]);
+  return result;
+
+fail_1:
+  libcrun_spawn_release (&procs[1]);
+fail_0:
+  libcrun_spawn_release (&procs[0]);
+fail:
+  crun_error_release (&err);
+  return -1;
+}
+
+static void
+run_and_print_test_result (const char *name, int id, test t)
+{
+  int ret = t ();
+  if (ret == 0)
+    printf ("ok %d - %s\n", id, name);
+  else if (ret == 77)
+    printf ("ok %d - %s #SKIP\n", id, name);
+  else
+    printf ("not ok %d - %s\n", id, name);
+}
+
+#define RUN_TEST(T)                            \
+  do                                           \
+    {                                          \
+      run_and_print_test_result (#T, id++, T); \
+  } while (0)
+
+int
+main ()
+{
+  int id = 1;
+  printf ("1..4\n");
+  RUN_TEST (test_spawn_exit_status);
+  RUN_TEST (test_spawn_exec_error);
+  RUN_TEST (test_spawn_timeout);
+  RUN_TEST (test_spawn_wait_many);
+  return 0;
+}
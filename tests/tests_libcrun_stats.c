@@ -0,0 +1,188 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <libcrun/cgroup-stats.h>
+#include <libcrun/utils.h>
+
+typedef int (*test) ();
+
+static int
+parse (enum stats_file_e file, const char *content, struct libcrun_container_stats_s *stats)
+{
+  cleanup_free char *copy = xstrdup (content);
+  libcrun_error_t err = NULL;
+  int ret;
+
+  ret = stats_parse_file (file, copy, stats, &err);
+  if (ret < 0)
+    crun_error_release (&err);
+  return ret;
+}
+
+static int
+test_stats_cpu_stat ()
+{
+  struct libcrun_container_stats_s stats = {};
+
+  if (parse (STATS_FILE_CPU_STAT, "usage_usec 1000\nuser_usec 600\nsystem_usec 400\n"
+                                  "core_sched.force_idle_usec 0\nnr_periods 10\nnr_throttled 2\n"
+                                  "throttled_usec 50\n",
+             &stats)
+      < 0)
+    return -1;
+
+  if (stats.cpu.usage_usec != 1000 || stats.cpu.user_usec != 600 || stats.cpu.system_usec != 400)
+    return -1;
+  if (stats.cpu.nr_periods != 10 || stats.cpu.nr_throttled != 2 || stats.cpu.throttled_usec != 50)
+    return -1;
+
+  return 0;
+}
+
+static int
+test_stats_memory ()
+{
+  struct libcrun_container_stats_s stats = {};
+
+  if (parse (STATS_FILE_MEMORY_CURRENT, "4096\n", &stats) < 0)
+    return -1;
+  if (parse (STATS_FILE_MEMORY_MAX, "max\n", &stats) < 0)
+    return -1;
+  if (parse (STATS_FILE_MEMORY_STAT, "anon 100\nfile 200\nunknown_key 7\npgmajfault 3\n", &stats) < 0)
+    return -1;
+  if (parse (STATS_FILE_MEMORY_EVENTS, "low 0\nhigh 1\nmax 2\noom 3\noom_kill 4\noom_group_kill 0\n", &stats) < 0)
+    return -1;
+
+  if (stats.memory.usage != 4096 || stats.memory.limit != LIBCRUN_STATS_UNLIMITED)
+    return -1;
+  if (stats.memory.anon != 100 || stats.memory.file != 200 || stats.memory.pgmajfault != 3)
+    return -1;
+  if (stats.memory.events_high != 1 || stats.memory.events_max != 2 || stats.memory.events_oom != 3
+      || stats.memory.events_oom_kill != 4)
+    return -1;
+
+  if (parse (STATS_FILE_PIDS_CURRENT, "not a number\n", &stats) == 0)
+    return -1;
+
+  return 0;
+}
+
+static int
+test_stats_io_stat ()
+{
+  struct libcrun_container_stats_s stats = {};
+
+  if (parse (STATS_FILE_IO_STAT, "8:0 rbytes=100 wbytes=200 rios=1 wios=2 dbytes=0 dios=0\n"
+                                 "253:0 rbytes=10 wbytes=20 rios=3 wios=4 dbytes=5 dios=6\n",
+             &stats)
+      < 0)
+    return -1;
+
+  if (stats.io.rbytes != 110 || stats.io.wbytes != 220 || stats.io.rios != 4 || stats.io.wios != 6)
+    return -1;
+  if (stats.io.dbytes != 5 || stats.io.dios != 6)
+    return -1;
+
+  return 0;
+}
+
+static int
+test_stats_pressure ()
+{
+  struct libcrun_container_stats_s stats = {};
+
+  if (parse (STATS_FILE_MEMORY_PRESSURE, "some avg10=1.50 avg60=0.25 avg300=0.00 total=12345\n"
+                                         "full avg10=0.00 avg60=0.00 avg300=0.00 total=99\n",
+             &stats)
+      < 0)
+    return -1;
+
+  if (stats.pressure.memory_some.avg10 != 1.5 || stats.pressure.memory_some.avg60 != 0.25)
+    return -1;
+  if (stats.pressure.memory_some.total != 12345 || stats.pressure.memory_full.total != 99)
+    return -1;
+
+  return 0;
+}
+
+static int
+test_stats_delta ()
+{
+  struct libcrun_container_stats_s prev = {}, cur = {};
+  struct libcrun_container_stats_delta_s delta;
+
+  prev.cpu.usage_usec = 1000000;
+  prev.memory.usage = 8192;
+  prev.io.rbytes = 1000;
+  prev.io.wbytes = 0;
+
+  cur.cpu.usage_usec = 2000000;
+  cur.memory.usage = 4096;
+  cur.io.rbytes = 5000;
+  cur.io.wbytes = 2000;
+  cur.pids.current = 3;
+
+  /* Two seconds.  */
+  stats_compute_delta (&prev, &cur, 2000000000ULL, &delta);
+  if (delta.cpu_usage != 0.5 || delta.memory_usage != 4096 || delta.memory_growth != -4096)
+    return -1;
+  if (delta.io_read_rate != 2000 || delta.io_write_rate != 1000 || delta.pids != 3)
+    return -1;
+
+  /* A counter going back means the cgroup was recreated.  */
+  stats_compute_delta (&cur, &prev, 1000000000ULL, &delta);
+  if (delta.cpu_usage != 0 || delta.io_read_rate != 0 || delta.memory_growth != 4096)
+    return -1;
+
+  return 0;
+}
+
+static void
+run_and_print_test_result (const char *name, int id, test t)
+{
+  int ret = t ();
+  if (ret == 0)
+    printf ("ok %d - %s\n", id, name);
+  else if (ret == 77)
+    printf ("ok %d - %s #SKIP\n", id, name);
+  else
+    printf ("not ok %d - %s\n", id, name);
+}
+
+#define RUN_TEST(T)                            \
+  do                                           \
+    {                                          \
+      run_and_print_test_result (#T, id++, T); \
+  } while (0)
+
+int
+main ()
+{
+  int id = 1;
+  printf ("1..5\n");
+  RUN_TEST (test_stats_cpu_stat);
+  RUN_TEST (test_stats_memory);
+  RUN_TEST (test_stats_io_stat);
+  RUN_TEST (test_stats_pressure);
+  RUN_TEST (test_stats_delta);
+  return 0;
+}
@@ -0,0 +1,205 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2026 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <libcrun/error.h>
+#include <libcrun/task_graph.h>
+#include <libcrun/utils.h>
+
+typedef int (*test) ();
+
+struct order_s
+{
+  pthread_mutex_t lock;
+  int next;
+  int seen[LIBCRUN_TASK_GRAPH_MAX_TASKS];
+};
+
+struct task_arg_s
+{
+  struct order_s *order;
+  int id;
+  int fail;
+  pthread_t thread;
+};
+
+static int
+record_task (void *arg, libcrun_error_t *err)
+{
+  struct task_arg_s *t = arg;
+
+  usleep (1000);
+
+  pthread_mutex_lock (&t->order->lock);
+  t->order->seen[t->id] = t->order->next++;
+  pthread_mutex_unlock (&t->order->lock);
+
+  t->thread = pthread_self ();
+
+  if (t->fail)
+    return crun_make_error (err, EINVAL, "task %d failed", t->id);
+  return 0;
+}
+
+static int
+test_task_graph_order ()
+{
+  struct order_s order = { .lock = PTHREAD_MUTEX_INITIALIZER };
+  struct libcrun_task_graph_s graph;
+  struct task_arg_s args[6];
+  libcrun_error_t err = NULL;
+  uint32_t a, b, c, d;
+  int i, ret;
+
+  memset (args, 0, sizeof (args));
+  for (i = 0; i < 6; i++)
+    {
+      args[i].order = &order;
+      args[i].id = i;
+    }
+
+  libcrun_task_graph_init (&graph, "test");
+  a = libcrun_task_graph_add (&graph, "a", record_task, &args[0], 0, 0);
+  b = libcrun_task_graph_add (&graph, "b", record_task, &args[1], 0, a);
+  c = libcrun_task_graph_add (&graph, "c", record_task, &args[2], LIBCRUN_TASK_MAIN_THREAD, 0);
+  d = libcrun_task_graph_add (&graph, "d", record_task, &args[3], 0, b | c);
+  libcrun_task_graph_add (&graph, "e", record_task, &args[4], LIBCRUN_TASK_MAIN_THREAD, d);
+  libcrun_task_graph_add (&graph, "f", record_task, &args[5], 0, 0);
+
+  ret = libcrun_task_graph_run (&graph, &err);
+  if (ret < 0)
+    {
+      crun_error_release (&err);
+      return -1;
+    }
+
+  if (order.next != 6)
+    return -1;
+  if (order.seen[1] < order.seen[0] || order.seen[3] < order.seen[1] || order.seen[3] < order.seen[2])
+    return -1;
+  if (order.seen[4] < order.seen[3])
+    return -1;
+
+  /* The main thread tasks run on the caller.  */
+  if (! pthread_equal (args[2].thread, pthread_self ()) || ! pthread_equal (args[4].thread, pthread_self ()))
+    return -1;
+
+  for (i = 0; i < 6; i++)
+    if (graph.tasks[i].end < graph.tasks[i].start || graph.tasks[i].skipped)
+      return -1;
+
+  return 0;
+}
+
+static int
+test_task_graph_errors ()
+{
+  struct order_s order = { .lock = PTHREAD_MUTEX_INITIALIZER };
+  struct libcrun_task_graph_s graph;
+  struct task_arg_s args[5];
+  libcrun_error_t err = NULL;
+  uint32_t a, b, c;
+  int i, ret;
+
+  memset (args, 0, sizeof (args));
+  for (i = 0; i < 5; i++)
+    {
+      args[i].order = &order;
+      args[i].id = i;
+    }
+  args[1].fail = 1;
+  args[4].fail = 1;
+
+  libcrun_task_graph_init (&graph, "test");
+  a = libcrun_task_graph_add (&graph, "a", record_task, &args[0], 0, 0);
+  b = libcrun_task_graph_add (&graph, "b", record_task, &args[1], 0, a);
+  c = libcrun_task_graph_add (&graph, "c", record_task, &args[2], 0, b);
+  libcrun_task_graph_add (&graph, "d", record_task, &args[3], LIBCRUN_TASK_MAIN_THREAD, c);
+  libcrun_task_graph_add (&graph, "e", record_task, &args[4], 0, 0);
+
+  ret = libcrun_task_graph_run (&graph, &err);
+  if (ret >= 0 || err == NULL)
+    return -1;
+
+  /* The first error in the order the tasks were added.  */
+  if (strcmp (err->msg, "task 1 failed") != 0)
+    {
+      crun_error_release (&err);
+      return -1;
+    }
+  crun_error_release (&err);
+
+  /* The tasks depending on the failed one do not run, the others do.  */
+  if (! graph.tasks[2].skipped || ! graph.tasks[3].skipped)
+    return -1;
+  if (order.next != 3 || graph.tasks[4].skipped)
+    return -1;
+
+  return 0;
+}
+
+static int
+test_task_graph_empty ()
+{
+  struct libcrun_task_graph_s graph;
+  libcrun_error_t err = NULL;
+
+  libcrun_task_graph_init (&graph, "empty");
+  if (libcrun_task_graph_run (&graph, &err) != 0)
+    return -1;
+  if (graph.helpers != 0)
+    return -1;
+
+  return 0;
+}
+
+static void
+run_and_print_test_result (const char *name, int id, test t)
+{
+  int ret = t ();
+  if (ret == 0)
+    printf ("ok %d - %s\n", id, name);
+  else if (ret == 77)
+    printf ("ok %d - %s #SKIP\n", id, name);
+  else
+    printf ("not ok %d - %s\n", id, name);
+}
+
+#define RUN_TEST(T)                            \
+  do                                           \
+    {                                          \
+      run_and_print_test_result (#T, id++, T); \
+  } while (0)
+
+int
+main ()
+{
+  int id = 1;
+  printf ("1..3\n");
+  RUN_TEST (test_task_graph_order);
+  RUN_TEST (test_task_graph_errors);
+  RUN_TEST (test_task_graph_empty);
+  return 0;
+}